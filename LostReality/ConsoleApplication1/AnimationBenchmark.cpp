@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "AnimationBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+static const uint32 SNumBones = 64;
+static const int32 SNumKeys = 60;
+static const int32 SNumFrames = 120;
+static const float SFrameSec = 1.0f / 60.0f;
+
+static FFloat4x4 RandomLocal(float range)
+{
+	FFloat4x4 local;
+	local.SetRotateAndOrigin(FQuat().FromEuler(RandomFloat3(30.f)), RandomFloat3(range));
+	return local;
+}
+
+FAnimationBenchmarkSample::FAnimationBenchmarkSample()
+{
+	FProcessUnique::StaticInitialize();
+	srand(0);
+
+	// Binary tree, a parent always comes before its children as in FSkeleton.
+	vector<FFloat4x4> bindWorlds(SNumBones);
+	Parents.resize(SNumBones);
+	InvBindPoses.resize(SNumBones);
+	Tracks.resize(SNumBones);
+	for (uint32 i = 0; i < SNumBones; ++i)
+	{
+		Parents[i] = i == 0 ? -1 : (int32)(i - 1) / 2;
+
+		const FFloat4x4 local(RandomLocal(10.f));
+		bindWorlds[i] = Parents[i] < 0 ? local : local * bindWorlds[Parents[i]];
+		InvBindPoses[i] = bindWorlds[i].GetInvert();
+
+		FMatrixCurve curve;
+		curve.SetMode(FMatrixCurve::EWrap::Wrap, FMatrixCurve::EInterpolation::Linear);
+		for (int32 key = 0; key < SNumKeys; ++key)
+		{
+			curve.AddKey(key / 30.0f, RandomLocal(10.f));
+		}
+
+		Tracks[i].Bake(curve);
+	}
+
+	cout << "job system threads: " << FJobSystem::Get()->GetMaxConcurrency() << endl;
+	cout << "characters\tthreads\tms/frame\tspeedup\tdeterministic" << endl;
+
+	uint32 numCharacters[] = { 16, 64, 256 };
+	for (auto num : numCharacters)
+	{
+		Run(num);
+	}
+}
+
+FAnimationBenchmarkSample::~FAnimationBenchmarkSample()
+{
+	FProcessUnique::StaticDestroy();
+}
+
+void FAnimationBenchmarkSample::Reset(uint32 numCharacters)
+{
+	Characters.resize(numCharacters);
+	for (uint32 i = 0; i < numCharacters; ++i)
+	{
+		auto& character = Characters[i];
+		character.KeyTime = i * 0.1f;
+		character.World.SetTranslate((float)(i % 16) * 10.f, 0.f, (float)(i / 16) * 10.f);
+		character.Cursors.assign(SNumBones, FCurveCursor());
+		character.BoneWorlds.resize(SNumBones);
+		character.Skin.resize(SNumBones);
+	}
+}
+
+void FAnimationBenchmarkSample::UpdateCharacter(FCharacter& character, float sec)
+{
+	character.KeyTime += sec;
+	for (uint32 i = 0; i < SNumBones; ++i)
+	{
+		const FFloat4x4 local(Tracks[i].Eval(character.KeyTime, character.Cursors[i]));
+		character.BoneWorlds[i] = Parents[i] < 0 ? local : local * character.BoneWorlds[Parents[i]];
+		character.Skin[i] = InvBindPoses[i] * character.BoneWorlds[i];
+	}
+
+	FTransformBatch::ConcatenateMatrices(character.Skin.data(), character.World, character.Skin.data(), SNumBones);
+}
+
+void FAnimationBenchmarkSample::Run(uint32 numCharacters)
+{
+	FJobSystem* jobs = FJobSystem::Get();
+	const uint32 maxThreads = jobs->GetMaxConcurrency();
+
+	// 1, 2, 4 ... and the whole pool.
+	vector<uint32> threadCounts;
+	for (uint32 threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	threadCounts.push_back(maxThreads);
+
+	vector<FFloat4x4> reference;
+	double referenceSec = 0.0;
+	for (auto threads : threadCounts)
+	{
+		jobs->SetConcurrency(threads);
+		Reset(numCharacters);
+
+		auto start = FPerformanceCounter::GetTimeStamp();
+		for (int32 frame = 0; frame < SNumFrames; ++frame)
+		{
+			jobs->ParallelFor(numCharacters, 1, [&](uint32 begin, uint32 end)
+			{
+				for (uint32 i = begin; i < end; ++i)
+				{
+					UpdateCharacter(Characters[i], SFrameSec);
+				}
+			});
+		}
+
+		const double sec = FPerformanceCounter::GetSeconds(start);
+
+		vector<FFloat4x4> result;
+		for (auto& character : Characters)
+		{
+			result.insert(result.end(), character.Skin.begin(), character.Skin.end());
+		}
+
+		if (threads == 1)
+		{
+			reference = result;
+			referenceSec = sec;
+		}
+
+		const bool deterministic = memcmp(reference.data(), result.data(), sizeof(FFloat4x4) * result.size()) == 0;
+		cout << numCharacters << "\t" << threads << "\t" << sec * 1000.0 / SNumFrames << "\t"
+			<< referenceSec / sec << "\t" << (deterministic ? "yes" : "NO") << endl;
+	}
+
+	jobs->SetConcurrency(maxThreads);
+}
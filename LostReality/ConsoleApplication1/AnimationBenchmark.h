@@ -0,0 +1,31 @@
+#pragma once
+
+// Scaling of the scene animation phase over FJobSystem, 1 to N threads, K characters, no renderer.
+// A character runs what FSkeletalModel::UpdateAnimation does: sample one baked matrix curve per bone,
+// concatenate the hierarchy in parent order, apply the inverse bind pose and the world matrix.
+// Every run is compared with the single thread one, the skinning matrices must match bit for bit.
+class FAnimationBenchmarkSample
+{
+public:
+	FAnimationBenchmarkSample();
+	~FAnimationBenchmarkSample();
+
+private:
+	struct FCharacter
+	{
+		float KeyTime;
+		LostCore::FFloat4x4 World;
+		vector<LostCore::FCurveCursor> Cursors;
+		vector<LostCore::FFloat4x4> BoneWorlds;
+		vector<LostCore::FFloat4x4> Skin;
+	};
+
+	void Run(uint32 numCharacters);
+	void Reset(uint32 numCharacters);
+	void UpdateCharacter(FCharacter& character, float sec);
+
+	vector<int32> Parents;
+	vector<LostCore::FFloat4x4> InvBindPoses;
+	vector<LostCore::FBakedMatrixCurve> Tracks;
+	vector<FCharacter> Characters;
+};
@@ -0,0 +1,177 @@
+#include "stdafx.h"
+#include "AssetLoadBenchmark.h"
+
+using namespace LostCore;
+
+static const int32 SNumLoops = 16;
+
+// Keeps the page touching loop from being optimized away.
+static volatile uint8 SSink = 0;
+
+static void FindFiles(vector<string>& output, const string& directory, const char* ext)
+{
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileA((directory + "*." + ext).c_str(), &data);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+		{
+			output.push_back(directory + data.cFileName);
+		}
+	} while (FindNextFileA(handle, &data));
+
+	FindClose(handle);
+}
+
+static bool FileExists(const string& url)
+{
+	return GetFileAttributesA(url.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+FAssetLoadBenchmarkSample::FAssetLoadBenchmarkSample(const string& directory)
+{
+	string dir = directory;
+	ReplaceChar(dir, "/", "\\");
+	if (!dir.empty() && dir.back() != '\\')
+	{
+		dir += "\\";
+	}
+
+	vector<string> meshes, anims;
+	FindFiles(meshes, dir, K_PRIMITIVE_EXT);
+	FindFiles(anims, dir, K_ANIM_EXT_KEYFRAME);
+
+	cout << "asset\tFBinaryIO(ms)\tmapped(ms)" << endl;
+	for (const auto& url : meshes)
+	{
+		RunMesh(url);
+	}
+
+	for (const auto& url : anims)
+	{
+		RunAnimKeyFrame(url);
+	}
+}
+
+FAssetLoadBenchmarkSample::~FAssetLoadBenchmarkSample()
+{
+}
+
+void FAssetLoadBenchmarkSample::RunMesh(const string& url)
+{
+	string mappedUrl = GetMappedAssetUrl(url, K_PRIMITIVE_MAPPED_EXT);
+	if (!FileExists(mappedUrl))
+	{
+		FMeshData data;
+		data.Load(url);
+		FMappedMeshData::Save(data, mappedUrl);
+	}
+
+	uint32 checksum[2] = { 0, 0 };
+	double past[2];
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumLoops; ++i)
+	{
+		FMeshData data;
+		data.Load(url);
+		data.BuildGPUData(0, FMeshData::EGPUDataLayout::IndexedCacheOptimized);
+		checksum[0] += data.Vertices.size() + data.Indices.size();
+	}
+	past[0] = FPerformanceCounter::GetSeconds(start);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumLoops; ++i)
+	{
+		FMappedMeshData mapped;
+		if (!mapped.Open(mappedUrl))
+		{
+			return;
+		}
+
+		FMeshData data;
+		mapped.Extract(data);
+
+		// Touch every page of the GPU buffers, as the upload would.
+		auto vertices = mapped.GetVertices();
+		auto indices = mapped.GetIndices();
+		uint8 sum = 0;
+		for (uint32 offset = 0; offset < vertices.Num(); offset += 4096)
+		{
+			sum += vertices[offset];
+		}
+
+		for (uint32 offset = 0; offset < indices.Num(); offset += 4096)
+		{
+			sum += indices[offset];
+		}
+
+		SSink = sum;
+		checksum[1] += vertices.Num() + indices.Num();
+	}
+	past[1] = FPerformanceCounter::GetSeconds(start);
+
+	assert(checksum[0] == checksum[1]);
+
+	cout << url;
+	for (auto sec : past)
+	{
+		cout << "\t" << sec * 1e3 / SNumLoops;
+	}
+	cout << endl;
+}
+
+void FAssetLoadBenchmarkSample::RunAnimKeyFrame(const string& url)
+{
+	string mappedUrl = GetMappedAssetUrl(url, K_ANIM_EXT_KEYFRAME_MAPPED);
+	if (!FileExists(mappedUrl))
+	{
+		FAnimKeyFrameData data;
+		data.Load(url);
+		FMappedAnimKeyFrameData::Save(data, mappedUrl);
+	}
+
+	uint32 checksum[2] = { 0, 0 };
+	double past[2];
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumLoops; ++i)
+	{
+		FBinaryIO stream;
+		stream.ReadFromFile(url);
+
+		FBakedAnimKeyFrameData data;
+		stream >> data;
+		checksum[0] += data.KeyFrameMap.size();
+	}
+	past[0] = FPerformanceCounter::GetSeconds(start);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumLoops; ++i)
+	{
+		FMappedAnimKeyFrameData mapped;
+		if (!mapped.Open(mappedUrl))
+		{
+			return;
+		}
+
+		FBakedAnimKeyFrameData data;
+		mapped.Attach(data);
+		checksum[1] += data.KeyFrameMap.size();
+	}
+	past[1] = FPerformanceCounter::GetSeconds(start);
+
+	assert(checksum[0] == checksum[1]);
+
+	cout << url;
+	for (auto sec : past)
+	{
+		cout << "\t" << sec * 1e3 / SNumLoops;
+	}
+	cout << endl;
+}
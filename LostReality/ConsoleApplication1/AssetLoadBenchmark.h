@@ -0,0 +1,14 @@
+#pragma once
+
+// Load time of the FBinaryIO assets (.iv/.animk) against their mapped layouts (.ivm/.animkm).
+// Every .iv/.animk under directory is used, missing mapped files are converted first (untimed).
+class FAssetLoadBenchmarkSample
+{
+public:
+	explicit FAssetLoadBenchmarkSample(const string& directory);
+	~FAssetLoadBenchmarkSample();
+
+private:
+	void RunMesh(const string& url);
+	void RunAnimKeyFrame(const string& url);
+};
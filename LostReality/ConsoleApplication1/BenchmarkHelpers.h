@@ -0,0 +1,40 @@
+#pragma once
+
+// Shared by the samples comparing a loop with its batched or simd versions.
+
+// In [-range, range] by steps of range / 1000, the samples call srand(0) first so every run sees the same data.
+static float RandomFloat(float range)
+{
+	return ((float)(rand() % 2001) * 0.001f - 1.f) * range;
+}
+
+static LostCore::FFloat3 RandomFloat3(float range)
+{
+	return LostCore::FFloat3(RandomFloat(range), RandomFloat(range), RandomFloat(range));
+}
+
+static const char* GetSIMDLevelName(LostCore::ESIMDLevel level)
+{
+	return level == LostCore::ESIMDLevel::AVX2 ? "avx2" : "sse2";
+}
+
+static void WriteColumns(ostream& output)
+{
+}
+
+template <typename T, typename... TRest>
+static void WriteColumns(ostream& output, const T& column, const TRest&... rest)
+{
+	output << "\t" << column;
+	WriteColumns(output, rest...);
+}
+
+// One row of the table: the name, the measured columns, then the speedup over the reference
+// and how far the results are from it, a count of differing results or an error.
+template <typename TDifference, typename... TColumns>
+static void ReportComparison(const string& name, double speedup, const TDifference& difference, const TColumns&... columns)
+{
+	cout << name;
+	WriteColumns(cout, columns...);
+	cout << "\t" << speedup << "\t" << difference << endl;
+}
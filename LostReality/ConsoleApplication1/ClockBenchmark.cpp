@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "ClockBenchmark.h"
+
+using namespace LostCore;
+
+static double GetSteadySeconds(const chrono::steady_clock::time_point& start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+FClockBenchmarkSample::FClockBenchmarkSample(int32 numIterations)
+	: NumIterations(numIterations)
+{
+	const EClockSource detected = FPerformanceCounter::DetectClockSource();
+	uint64 checksum = 0;
+
+	cout << "iterations: " << NumIterations << ", detected: "
+		<< (detected == EClockSource::Tsc ? "tsc" : "steady_clock") << endl;
+	cout << "clock\tns per stamp" << endl;
+	cout << "QueryPerformanceCounter\t" << RunQueryPerformanceCounter(checksum) * 1e9 / NumIterations << endl;
+	cout << "steady_clock\t" << RunSource(EClockSource::SteadyClock, checksum) * 1e9 / NumIterations << endl;
+
+	if (detected == EClockSource::Tsc)
+	{
+		cout << "tsc\t" << RunSource(EClockSource::Tsc, checksum) * 1e9 / NumIterations << endl;
+
+		// Calibrates the clock before, not inside the 100ms.
+		cout << "tsc freq\t" << FPerformanceCounter::GetFreq() << endl;
+
+		const auto steadyStart = chrono::steady_clock::now();
+		const FTimeStamp start = FPerformanceCounter::GetTimeStamp();
+		this_thread::sleep_for(chrono::milliseconds(100));
+		const double sec = FPerformanceCounter::GetSeconds(start);
+		const double steadySec = GetSteadySeconds(steadyStart);
+
+		cout << "tsc against steady_clock ppm\t" << (sec - steadySec) * 1e6 / steadySec << endl;
+	}
+
+	cout << "checksum " << (checksum != 0 ? "ok" : "zero") << endl;
+}
+
+FClockBenchmarkSample::~FClockBenchmarkSample()
+{
+}
+
+double FClockBenchmarkSample::RunSource(EClockSource source, uint64& checksum)
+{
+	const auto start = chrono::steady_clock::now();
+	for (int32 i = 0; i < NumIterations; ++i)
+	{
+		checksum += (uint64)FPerformanceCounter::ReadClock(source);
+	}
+
+	return GetSteadySeconds(start);
+}
+
+double FClockBenchmarkSample::RunQueryPerformanceCounter(uint64& checksum)
+{
+	const auto start = chrono::steady_clock::now();
+	for (int32 i = 0; i < NumIterations; ++i)
+	{
+		LARGE_INTEGER stamp;
+		QueryPerformanceCounter(&stamp);
+		checksum += (uint64)stamp.QuadPart;
+	}
+
+	return GetSteadySeconds(start);
+}
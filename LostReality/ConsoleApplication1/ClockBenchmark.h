@@ -0,0 +1,18 @@
+#pragma once
+
+// Cost of a stamp of every FPerformanceCounter clock source,
+// and QueryPerformanceCounter which it replaced.
+// The tsc is also checked against steady_clock over 100ms, reports the difference in ppm.
+class FClockBenchmarkSample
+{
+public:
+	explicit FClockBenchmarkSample(int32 numIterations = 10000000);
+	~FClockBenchmarkSample();
+
+private:
+	// Seconds of steady_clock.
+	double RunSource(LostCore::EClockSource source, uint64& checksum);
+	double RunQueryPerformanceCounter(uint64& checksum);
+
+	int32 NumIterations;
+};
@@ -4,6 +4,21 @@
 #include "stdafx.h"
 //#include "ThreadSynchronize.h"
 #include "CommandBinding.h"
+#include "CurveBenchmark.h"
+#include "AssetLoadBenchmark.h"
+#include "MathBenchmark.h"
+#include "TransformBatchBenchmark.h"
+#include "AnimationBenchmark.h"
+#include "PrimeCountBenchmark.h"
+#include "FrustumCullingBenchmark.h"
+#include "PickingBenchmark.h"
+#include "TrianglePickingBenchmark.h"
+#include "HeadlessFrameBenchmark.h"
+#include "ShaderCacheBenchmark.h"
+#include "SingletonBenchmark.h"
+#include "StackCounterBenchmark.h"
+#include "ClockBenchmark.h"
+#include "MemoryCounterBenchmark.h"
 
 using namespace LostCore;
 
@@ -208,6 +223,87 @@ void TestBinding()
 	FCommandBindingSample sample;
 }
 
+void TestCurveBenchmark()
+{
+	FCurveBenchmarkSample sample;
+}
+
+void TestAssetLoadBenchmark()
+{
+	FAssetLoadBenchmarkSample sample(GetCurrentWorkingPath());
+}
+
+void TestMathBenchmark()
+{
+	FMathBenchmarkSample sample;
+}
+
+void TestTransformBatchBenchmark()
+{
+	FTransformBatchBenchmarkSample sample;
+}
+
+void TestAnimationBenchmark()
+{
+	FAnimationBenchmarkSample sample;
+}
+
+void TestPrimeCountBenchmark()
+{
+	FPrimeCountBenchmarkSample sample;
+}
+
+void TestFrustumCullingBenchmark()
+{
+	FFrustumCullingBenchmarkSample sample;
+}
+
+void TestPickingBenchmark()
+{
+	FPickingBenchmarkSample sample;
+}
+
+void TestTrianglePickingBenchmark()
+{
+	string dir = GetCurrentWorkingPath();
+	if (!dir.empty() && dir.back() != '\\')
+	{
+		dir += "\\";
+	}
+
+	FTrianglePickingBenchmarkSample sample(dir + "HeroTPP.iv");
+}
+
+void TestHeadlessFrameBenchmark()
+{
+	FHeadlessFrameBenchmarkSample sample("scene.json");
+}
+
+void TestShaderCacheBenchmark()
+{
+	FShaderCacheBenchmarkSample sample;
+}
+
+void TestSingletonBenchmark()
+{
+	FSingletonBenchmarkSample sample;
+}
+
+void TestStackCounterBenchmark()
+{
+	FStackCounterBenchmarkSample sample;
+}
+
+void TestClockBenchmark()
+{
+	FClockBenchmarkSample sample;
+}
+
+void TestMemoryCounterBenchmark()
+{
+	FMemoryCounterBenchmarkSample sample;
+}
+
 void OutputInt32(int32& var)
 {
 	cout << var << endl;
@@ -341,6 +437,21 @@ int main()
 	cout << "***************************************" << endl;
 	//TestSync();
 	//TestBinding();
+	//TestCurveBenchmark();
+	//TestAssetLoadBenchmark();
+	//TestMathBenchmark();
+	//TestTransformBatchBenchmark();
+	//TestAnimationBenchmark();
+	//TestPrimeCountBenchmark();
+	//TestFrustumCullingBenchmark();
+	//TestPickingBenchmark();
+	//TestTrianglePickingBenchmark();
+	//TestHeadlessFrameBenchmark();
+	//TestShaderCacheBenchmark();
+	//TestSingletonBenchmark();
+	//TestStackCounterBenchmark();
+	//TestClockBenchmark();
+	//TestMemoryCounterBenchmark();
 	//Test12();
 	auto p = new F13;
 	delete p;
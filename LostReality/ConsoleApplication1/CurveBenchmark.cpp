@@ -0,0 +1,84 @@
+#include "stdafx.h"
+#include "CurveBenchmark.h"
+
+using namespace LostCore;
+
+static const int32 SNumChannels = (int32)EAnimChannel::Num;
+static const int32 SNumFrames = 4096;
+
+FCurveBenchmarkSample::FCurveBenchmarkSample()
+{
+	cout << "keys\tTCurve(ns/bone)\tbaked(ns/bone)\tbaked+cursor(ns/bone)" << endl;
+
+	int32 numKeys[] = { 8, 32, 128, 512, 2048 };
+	for (auto num : numKeys)
+	{
+		Run(num);
+	}
+}
+
+FCurveBenchmarkSample::~FCurveBenchmarkSample()
+{
+}
+
+void FCurveBenchmarkSample::Run(int32 numKeys)
+{
+	const float sampleRate = 30.0f;
+
+	array<FRealCurve, SNumChannels> curves;
+	array<FBakedRealCurve, SNumChannels> bakedCurves;
+	array<FCurveCursor, SNumChannels> cursor;
+	for (int32 ch = 0; ch < SNumChannels; ++ch)
+	{
+		curves[ch].SetMode(FRealCurve::EWrap::Clamp, FRealCurve::EInterpolation::CatmullRom);
+		for (int32 i = 0; i < numKeys; ++i)
+		{
+			curves[ch].AddKey(i / sampleRate, (float)(rand() % 1000) * 0.01f);
+		}
+
+		bakedCurves[ch].Bake(curves[ch]);
+	}
+
+	const float step = curves[0].GetRange() / SNumFrames;
+	float checksum[3] = { 0.0f, 0.0f, 0.0f };
+	double past[3];
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 frame = 0; frame < SNumFrames; ++frame)
+	{
+		for (int32 ch = 0; ch < SNumChannels; ++ch)
+		{
+			checksum[0] += curves[ch].Eval(frame * step);
+		}
+	}
+	past[0] = FPerformanceCounter::GetSeconds(start);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	for (int32 frame = 0; frame < SNumFrames; ++frame)
+	{
+		for (int32 ch = 0; ch < SNumChannels; ++ch)
+		{
+			checksum[1] += bakedCurves[ch].Eval(frame * step);
+		}
+	}
+	past[1] = FPerformanceCounter::GetSeconds(start);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	for (int32 frame = 0; frame < SNumFrames; ++frame)
+	{
+		for (int32 ch = 0; ch < SNumChannels; ++ch)
+		{
+			checksum[2] += bakedCurves[ch].Eval(frame * step, cursor[ch]);
+		}
+	}
+	past[2] = FPerformanceCounter::GetSeconds(start);
+
+	assert(checksum[0] == checksum[1] && checksum[0] == checksum[2]);
+
+	cout << numKeys;
+	for (auto sec : past)
+	{
+		cout << "\t" << sec * 1e9 / SNumFrames;
+	}
+	cout << endl;
+}
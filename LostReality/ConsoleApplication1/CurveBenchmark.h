@@ -0,0 +1,13 @@
+#pragma once
+
+// Per-bone evaluation cost of TCurve against TBakedCurve as the key count grows.
+// A bone is the 9 transform channels of FAnimCurveData, played forward frame by frame.
+class FCurveBenchmarkSample
+{
+public:
+	FCurveBenchmarkSample();
+	~FCurveBenchmarkSample();
+
+private:
+	void Run(int32 numKeys);
+};
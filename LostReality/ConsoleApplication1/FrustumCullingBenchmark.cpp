@@ -0,0 +1,138 @@
+#include "stdafx.h"
+#include "FrustumCullingBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+static const uint32 SNumObjects = 10000;
+static const int32 SNumFrames = 360;
+static const float SSceneRange = 500.f;
+
+FFrustumCullingBenchmarkSample::FFrustumCullingBenchmarkSample()
+{
+	srand(0);
+
+	// Unit-ish meshes scattered over the scene, the local boxes are off center as the assets are.
+	Objects.resize(SNumObjects);
+	for (auto& object : Objects)
+	{
+		const FFloat3 size(1.f + (rand() % 100) * 0.05f, 1.f + (rand() % 100) * 0.05f, 1.f + (rand() % 100) * 0.05f);
+		object.Bounds.Set(FFloat3(-0.5f, 0.f, -0.5f) * size, FFloat3(0.5f, 1.f, 0.5f) * size);
+		object.World.SetRotateAndOrigin(FQuat().FromEuler(RandomFloat3(180.f)), RandomFloat3(SSceneRange));
+	}
+
+	Boxes.Reserve(SNumObjects);
+
+	const ESIMDLevel detected = DetectSIMDLevel();
+	cout << "objects: " << SNumObjects << ", frames: " << SNumFrames << endl;
+	cout << "culling\tms/frame\tvisible/frame\ttotal\tspeedup\tdiffers" << endl;
+
+	vector<uint8> reference, visible;
+	uint32 referenceVisible = 0, numVisible = 0;
+	const double loop = RunLoop(reference, referenceVisible);
+	ReportComparison("loop", 1.0, 0, loop * 1000.0 / SNumFrames, referenceVisible / SNumFrames, SNumObjects);
+
+	ESIMDLevel levels[] = { ESIMDLevel::SSE2, ESIMDLevel::AVX2 };
+	for (auto level : levels)
+	{
+		if ((uint8)level > (uint8)detected)
+		{
+			continue;
+		}
+
+		SetSIMDLevel(level);
+		const double batch = RunBatch(visible, numVisible);
+
+		// Fma may round a box touching a plane the other way, a few differences are expected.
+		uint32 differs = 0;
+		for (uint32 i = 0; i < visible.size(); ++i)
+		{
+			differs += visible[i] != reference[i] ? 1 : 0;
+		}
+
+		ReportComparison(GetSIMDLevelName(level), loop / batch, differs, batch * 1000.0 / SNumFrames, numVisible / SNumFrames, SNumObjects);
+	}
+
+	SetSIMDLevel(detected);
+}
+
+FFrustumCullingBenchmarkSample::~FFrustumCullingBenchmarkSample()
+{
+}
+
+// One turn around the scene center over the frames, projection as FBasicCamera, fov 90, 16:9.
+FFloat4x4 FFrustumCullingBenchmarkSample::GetViewProject(int32 frame) const
+{
+	FFloat4x4 view;
+	view.SetRotateAndOrigin(FQuat().FromEuler(FFloat3(10.f, frame * 360.f / SNumFrames, 0.f)), FFloat3(0.f, 20.f, 0.f));
+	view.Invert();
+
+	const float nearPlane = 0.1f, farPlane = 300.f;
+	const float h = 1.f / std::tan(90.f * SD2RConstant * 0.5f);
+	const float q = farPlane / (farPlane - nearPlane);
+	FFloat4x4 project;
+	memset(&project, 0, sizeof(project));
+	project.M[0][0] = h / (16.f / 9.f);
+	project.M[1][1] = h;
+	project.M[2][2] = q;
+	project.M[2][3] = 1.f;
+	project.M[3][2] = -q * nearPlane;
+
+	return view * project;
+}
+
+// One model at a time, the same bounds and planes without the streams.
+double FFrustumCullingBenchmarkSample::RunLoop(vector<uint8>& visible, uint32& numVisible)
+{
+	visible.assign(SNumObjects * SNumFrames, 0);
+	numVisible = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 frame = 0; frame < SNumFrames; ++frame)
+	{
+		const FFrustum frustum(GetViewProject(frame));
+		uint8* result = &visible[frame * SNumObjects];
+		for (uint32 i = 0; i < SNumObjects; ++i)
+		{
+			const FObject& object = Objects[i];
+			const FFloat3 center((object.Bounds.Min + object.Bounds.Max) * 0.5f);
+			const FFloat3 extent((object.Bounds.Max - object.Bounds.Min) * 0.5f);
+
+			FFloat3 worldExtent;
+			for (int32 col = 0; col < 3; ++col)
+			{
+				worldExtent[col] =
+					std::abs(object.World.M[0][col]) * extent.X +
+					std::abs(object.World.M[1][col]) * extent.Y +
+					std::abs(object.World.M[2][col]) * extent.Z;
+			}
+
+			result[i] = frustum.IsVisible(object.World.ApplyPoint(center), worldExtent) ? 1 : 0;
+			numVisible += result[i];
+		}
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
+
+// As FBasicScene::CullModels, the boxes are collected into streams and culled in one call.
+double FFrustumCullingBenchmarkSample::RunBatch(vector<uint8>& visible, uint32& numVisible)
+{
+	visible.assign(SNumObjects * SNumFrames, 0);
+	numVisible = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 frame = 0; frame < SNumFrames; ++frame)
+	{
+		Boxes.Clear();
+		for (auto& object : Objects)
+		{
+			Boxes.AddTransformed(object.Bounds, object.World);
+		}
+
+		const FFrustum frustum(GetViewProject(frame));
+		numVisible += frustum.CullBoxes(Boxes, &visible[frame * SNumObjects]);
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
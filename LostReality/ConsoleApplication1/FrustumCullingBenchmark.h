@@ -0,0 +1,26 @@
+#pragma once
+
+// Culling phase of FBasicScene::Tick over a 10k object scene, no renderer.
+// The camera turns around the scene, every frame builds the world boxes and tests them
+// against the frustum, per object FFrustum::IsVisible against CullBoxes at each SIMD level.
+// Reports ms per frame, visible/total objects and the results differing from the per object loop.
+class FFrustumCullingBenchmarkSample
+{
+public:
+	FFrustumCullingBenchmarkSample();
+	~FFrustumCullingBenchmarkSample();
+
+private:
+	struct FObject
+	{
+		LostCore::FFloat4x4 World;
+		LostCore::FAABoundingBox Bounds;
+	};
+
+	LostCore::FFloat4x4 GetViewProject(int32 frame) const;
+	double RunLoop(vector<uint8>& visible, uint32& numVisible);
+	double RunBatch(vector<uint8>& visible, uint32& numVisible);
+
+	vector<FObject> Objects;
+	LostCore::FBoxStreams Boxes;
+};
@@ -0,0 +1,92 @@
+#include "stdafx.h"
+#include "GlobalHandler.h"
+#include "LostCore-D3D11.h"
+#include "HeadlessFrameBenchmark.h"
+
+using namespace LostCore;
+
+static const int32 SWidth = 1280;
+static const int32 SHeight = 720;
+static const uint32 SNumWarmFrames = 60;
+static const uint32 SNumFrames = 600;
+static const double STimeoutSec = 60.0;
+
+// False if the render context did not finish the frames in time.
+static bool WaitFrames(uint32 numFrames, D3D11::FNullFrameStats& stats)
+{
+	auto start = FPerformanceCounter::GetTimeStamp();
+	while (FPerformanceCounter::GetSeconds(start) < STimeoutSec)
+	{
+		if (D3D11::WrappedGetNullFrameStats(&stats) == SSuccess && stats.Frame >= numFrames)
+		{
+			return true;
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+
+	return false;
+}
+
+FHeadlessFrameBenchmarkSample::FHeadlessFrameBenchmarkSample(const string& scene)
+{
+	WrappedInitializeProcessUnique();
+	WrappedInitializeWindow(NULL, true, (int32)SWidth, (int32)SHeight);
+	WrappedAssetOperate((int32)EAssetOperation::LoadScene, scene.c_str());
+
+	D3D11::FNullFrameStats stats;
+	if (!WaitFrames(SNumWarmFrames, stats))
+	{
+		cout << "null render context not running, LostCore.dll and LostCore-D3D11.dll next to the exe?" << endl;
+		return;
+	}
+
+	cout << "scene: " << scene << ", " << SWidth << "x" << SHeight << ", frames: " << SNumFrames << endl;
+
+	// Polled, a frame ending between two polls is only counted in the frame time.
+	D3D11::FNullFrameStats sum;
+	uint32 numSampled = 0;
+	const uint32 firstFrame = stats.Frame;
+	uint32 lastFrame = firstFrame;
+	auto start = FPerformanceCounter::GetTimeStamp();
+	while (lastFrame - firstFrame < SNumFrames && FPerformanceCounter::GetSeconds(start) < STimeoutSec)
+	{
+		D3D11::WrappedGetNullFrameStats(&stats);
+		if (stats.Frame != lastFrame)
+		{
+			lastFrame = stats.Frame;
+			sum.NumDraws += stats.NumDraws;
+			sum.NumInstances += stats.NumInstances;
+			sum.NumVertices += stats.NumVertices;
+			sum.NumBufferCommits += stats.NumBufferCommits;
+			sum.BufferBytes += stats.BufferBytes;
+			sum.NumCommands += stats.NumCommands;
+			sum.CommandBytes += stats.CommandBytes;
+			sum.UploadBytes += stats.UploadBytes;
+			++numSampled;
+		}
+
+		this_thread::yield();
+	}
+
+	const double sec = FPerformanceCounter::GetSeconds(start);
+	const uint32 numFrames = max(lastFrame - firstFrame, 1u);
+	numSampled = max(numSampled, 1u);
+
+	cout << "ms/frame\tdraws\tinstances\tvertices\tbuffers\tbuffer bytes\tcommands\tcommand bytes\tupload bytes" << endl;
+	cout << sec * 1000.0 / numFrames << "\t"
+		<< sum.NumDraws / numSampled << "\t"
+		<< sum.NumInstances / numSampled << "\t"
+		<< sum.NumVertices / numSampled << "\t"
+		<< sum.NumBufferCommits / numSampled << "\t"
+		<< sum.BufferBytes / numSampled << "\t"
+		<< sum.NumCommands / numSampled << "\t"
+		<< sum.CommandBytes / numSampled << "\t"
+		<< sum.UploadBytes / numSampled << endl;
+}
+
+FHeadlessFrameBenchmarkSample::~FHeadlessFrameBenchmarkSample()
+{
+	WrappedShutdown();
+	WrappedDestroyProcessUnique();
+}
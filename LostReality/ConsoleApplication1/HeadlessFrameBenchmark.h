@@ -0,0 +1,12 @@
+#pragma once
+
+// The whole editor frame of LostCore.dll (scene, camera, gizmo, gui, fonts) over the null render context.
+// InitializeWindow without a window starts the editor and render threads with nothing drawn,
+// the scene is loaded as the editor does, the counters of the recorded frames are sampled.
+// Reports ms per frame and the draws, instances, vertices, buffer commits and commands per frame.
+class FHeadlessFrameBenchmarkSample
+{
+public:
+	explicit FHeadlessFrameBenchmarkSample(const string& scene);
+	~FHeadlessFrameBenchmarkSample();
+};
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "MathBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+typedef TMatrixNonVectorized<float> FScalarMatrix;
+typedef FMatrixVectorized FVectorMatrix;
+
+static const int32 SNumItems = 4096;
+static const int32 SNumLoops = 64;
+
+// Keeps the results from being optimized away.
+static volatile float SSink = 0.f;
+
+static FQuatNonVectorized RandomQuat()
+{
+	FQuatNonVectorized quat(RandomFloat(1.f), RandomFloat(1.f), RandomFloat(1.f), RandomFloat(1.f));
+	return quat.Normalize();
+}
+
+// Rotation, translation and a positive scale, always invertible.
+template <typename TMatrix>
+static void RandomMatrices(vector<TMatrix>& output)
+{
+	output.resize(SNumItems);
+	for (auto& matrix : output)
+	{
+		FQuatNonVectorized quat(RandomQuat());
+		matrix.SetRotateAndOrigin(FQuat(quat.X, quat.Y, quat.Z, quat.W), RandomFloat3(100.f));
+		matrix.Scale(FFloat3(1.5f + RandomFloat(1.f), 1.5f + RandomFloat(1.f), 1.5f + RandomFloat(1.f)));
+	}
+}
+
+// ns per item of func(index) over SNumLoops passes.
+template <typename TFunc>
+static double Measure(TFunc func)
+{
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 loop = 0; loop < SNumLoops; ++loop)
+	{
+		for (int32 i = 0; i < SNumItems; ++i)
+		{
+			func(i);
+		}
+	}
+
+	return FPerformanceCounter::GetSeconds(start) * 1e9 / ((double)SNumLoops * SNumItems);
+}
+
+static void Report(const char* name, double scalar, double vectorized, float error)
+{
+	ReportComparison(name, scalar / vectorized, error, scalar, vectorized);
+}
+
+template <typename TMatrix1, typename TMatrix2>
+static float GetMaxError(const vector<TMatrix1>& m1, const vector<TMatrix2>& m2)
+{
+	float error = 0.f;
+	for (int32 i = 0; i < SNumItems; ++i)
+	{
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (int32 col = 0; col < 4; ++col)
+			{
+				error = Max(error, std::abs(m1[i].M[row][col] - m2[i].M[row][col]));
+			}
+		}
+	}
+
+	return error;
+}
+
+static float GetMaxError(const vector<FFloat3>& v1, const vector<FFloat3>& v2)
+{
+	float error = 0.f;
+	for (int32 i = 0; i < SNumItems; ++i)
+	{
+		error = Max(error, Max(std::abs(v1[i].X - v2[i].X), Max(std::abs(v1[i].Y - v2[i].Y), std::abs(v1[i].Z - v2[i].Z))));
+	}
+
+	return error;
+}
+
+FMathBenchmarkSample::FMathBenchmarkSample()
+{
+	srand(0);
+
+	cout << "op\tscalar(ns/op)\tvectorized(ns/op)\tspeedup\tmax error" << endl;
+	RunMultiply();
+	RunInverse();
+	RunMatrixPoints();
+	RunTransformPoints();
+	RunSlerp();
+}
+
+FMathBenchmarkSample::~FMathBenchmarkSample()
+{
+}
+
+void FMathBenchmarkSample::RunMultiply()
+{
+	vector<FScalarMatrix> scalarA, scalarB, scalarOut(SNumItems);
+	RandomMatrices(scalarA);
+	RandomMatrices(scalarB);
+
+	vector<FVectorMatrix> vectorA(SNumItems), vectorB(SNumItems), vectorOut(SNumItems);
+	memcpy(vectorA.data(), scalarA.data(), sizeof(FScalarMatrix) * SNumItems);
+	memcpy(vectorB.data(), scalarB.data(), sizeof(FScalarMatrix) * SNumItems);
+
+	double scalar = Measure([&](int32 i) { scalarOut[i] = scalarA[i] * scalarB[i]; });
+	double vectorized = Measure([&](int32 i) { vectorOut[i] = vectorA[i] * vectorB[i]; });
+	SSink = SSink + scalarOut[0].M[3][0] + vectorOut[0].M[3][0];
+
+	Report("multiply", scalar, vectorized, GetMaxError(scalarOut, vectorOut));
+}
+
+void FMathBenchmarkSample::RunInverse()
+{
+	vector<FScalarMatrix> scalarIn, scalarOut(SNumItems);
+	RandomMatrices(scalarIn);
+
+	vector<FVectorMatrix> vectorIn(SNumItems), vectorOut(SNumItems);
+	memcpy(vectorIn.data(), scalarIn.data(), sizeof(FScalarMatrix) * SNumItems);
+
+	double scalar = Measure([&](int32 i) { scalarOut[i] = scalarIn[i].GetInvert(); });
+	double vectorized = Measure([&](int32 i) { vectorOut[i] = vectorIn[i].GetInvert(); });
+	SSink = SSink + scalarOut[0].M[3][0] + vectorOut[0].M[3][0];
+
+	Report("inverse", scalar, vectorized, GetMaxError(scalarOut, vectorOut));
+
+	scalar = Measure([&](int32 i) { scalarOut[i] = scalarIn[i]; scalarOut[i].Invert34(); });
+	vectorized = Measure([&](int32 i) { vectorOut[i] = vectorIn[i]; vectorOut[i].Invert34(); });
+	SSink = SSink + scalarOut[0].M[3][0] + vectorOut[0].M[3][0];
+
+	Report("inverse34", scalar, vectorized, GetMaxError(scalarOut, vectorOut));
+}
+
+void FMathBenchmarkSample::RunMatrixPoints()
+{
+	vector<FScalarMatrix> scalarMatrix;
+	RandomMatrices(scalarMatrix);
+
+	FVectorMatrix vectorMatrix;
+	memcpy(&vectorMatrix, &scalarMatrix[0], sizeof(FScalarMatrix));
+
+	vector<FFloat3> points(SNumItems), scalarOut(SNumItems), vectorOut(SNumItems);
+	for (auto& point : points)
+	{
+		point = RandomFloat3(100.f);
+	}
+
+	double scalar = Measure([&](int32 i) { scalarMatrix[0].ApplyPoint(scalarOut[i], points[i]); });
+	double vectorized = Measure([&](int32 i) { vectorMatrix.ApplyPoint(vectorOut[i], points[i]); });
+	SSink = SSink + scalarOut[0].X + vectorOut[0].X;
+
+	Report("matrix point", scalar, vectorized, GetMaxError(scalarOut, vectorOut));
+}
+
+void FMathBenchmarkSample::RunTransformPoints()
+{
+	FQuatNonVectorized quat(RandomQuat());
+	FFloat3 translation(RandomFloat3(100.f));
+	FFloat3 scale(1.5f, 2.f, 0.5f);
+
+	FTransformNonVectorized scalarTransform(FQuat(quat.X, quat.Y, quat.Z, quat.W), translation, scale);
+	FTransformVectorized vectorTransform(FQuat(quat.X, quat.Y, quat.Z, quat.W), translation, scale);
+
+	vector<FFloat3> points(SNumItems), scalarOut(SNumItems), vectorOut(SNumItems);
+	for (auto& point : points)
+	{
+		point = RandomFloat3(100.f);
+	}
+
+	double scalar = Measure([&](int32 i) { scalarOut[i] = scalarTransform.TransformPosition(points[i]); });
+	double vectorized = Measure([&](int32 i) { vectorOut[i] = vectorTransform.TransformPosition(points[i]); });
+	SSink = SSink + scalarOut[0].X + vectorOut[0].X;
+
+	Report("transform point", scalar, vectorized, GetMaxError(scalarOut, vectorOut));
+}
+
+void FMathBenchmarkSample::RunSlerp()
+{
+	vector<FQuatNonVectorized> scalarA(SNumItems), scalarB(SNumItems), scalarOut(SNumItems);
+	vector<FQuatVectorized> vectorA(SNumItems), vectorB(SNumItems), vectorOut(SNumItems);
+	vector<float> alpha(SNumItems);
+	for (int32 i = 0; i < SNumItems; ++i)
+	{
+		scalarA[i] = RandomQuat();
+		scalarB[i] = RandomQuat();
+		vectorA[i] = FQuatVectorized(scalarA[i].X, scalarA[i].Y, scalarA[i].Z, scalarA[i].W);
+		vectorB[i] = FQuatVectorized(scalarB[i].X, scalarB[i].Y, scalarB[i].Z, scalarB[i].W);
+		alpha[i] = RandomFloat(0.5f) + 0.5f;
+	}
+
+	double scalar = Measure([&](int32 i) { scalarOut[i] = FQuatNonVectorized::Slerp(scalarA[i], scalarB[i], alpha[i]); });
+	double vectorized = Measure([&](int32 i) { vectorOut[i] = FQuatVectorized::Slerp(vectorA[i], vectorB[i], alpha[i]); });
+	SSink = SSink + scalarOut[0].X + vectorOut[0].X;
+
+	float error = 0.f;
+	for (int32 i = 0; i < SNumItems; ++i)
+	{
+		error = Max(error, Max(Max(std::abs(scalarOut[i].X - vectorOut[i].X), std::abs(scalarOut[i].Y - vectorOut[i].Y)),
+			Max(std::abs(scalarOut[i].Z - vectorOut[i].Z), std::abs(scalarOut[i].W - vectorOut[i].W))));
+	}
+
+	Report("slerp", scalar, vectorized, error);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Cost of the *NonVectorized math classes against the *Vectorized ones, whatever MATH_VECTORIZED is.
+// Matrix multiply and inverse, point batches through FFloat4x4 and FTransform, quaternion slerp.
+class FMathBenchmarkSample
+{
+public:
+	FMathBenchmarkSample();
+	~FMathBenchmarkSample();
+
+private:
+	void RunMultiply();
+	void RunInverse();
+	void RunMatrixPoints();
+	void RunTransformPoints();
+	void RunSlerp();
+};
@@ -0,0 +1,108 @@
+#include "stdafx.h"
+#include "MemoryCounterBenchmark.h"
+
+using namespace LostCore;
+
+namespace
+{
+	struct FPlainObject
+	{
+		uint8 Payload[48];
+	};
+
+	struct FTaggedObject
+	{
+		MEMORY_ALLOC(Untagged);
+
+		uint8 Payload[48];
+	};
+
+	// A few live objects per thread, the allocator does not hand the same block back every time.
+	const int32 SNumLive = 16;
+}
+
+FMemoryCounterBenchmarkSample::FMemoryCounterBenchmarkSample(int32 numIterations)
+	: NumIterations(numIterations)
+{
+	FProcessUnique::StaticInitialize();
+
+	cout << "iterations per thread: " << NumIterations << endl;
+	cout << "threads\tnone\tcounted\tcounted, stacks" << endl;
+	for (int32 numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		cout << numThreads << "\t" << Run<FPlainObject>(numThreads)
+			<< "\t" << Run<FTaggedObject>(numThreads);
+
+		FMemoryCounterManager::Get()->SetStackSampling(64);
+		cout << "\t" << Run<FTaggedObject>(numThreads) << endl;
+		FMemoryCounterManager::Get()->SetStackSampling(0);
+	}
+
+	auto usage = FMemoryCounterManager::Get()->Sample();
+	auto header = FMemoryCounterManager::GetInfoHeader();
+	for (auto& item : header)
+	{
+		cout << item << "\t";
+	}
+	cout << endl;
+
+	for (auto& item : FMemoryCounterManager::GetDescs(EMemoryTag::Untagged, usage[(int32)EMemoryTag::Untagged]))
+	{
+		cout << item << "\t";
+	}
+	cout << endl;
+
+	cout << "sampled stacks: " << FMemoryCounterManager::Get()->GetAllocStacks().size() << endl;
+
+	FProcessUnique::StaticDestroy();
+}
+
+FMemoryCounterBenchmarkSample::~FMemoryCounterBenchmarkSample()
+{
+}
+
+template <typename T>
+double FMemoryCounterBenchmarkSample::Run(int32 numThreads)
+{
+	atomic<int32> numReady(0);
+	vector<double> seconds(numThreads, 0.0);
+	vector<thread> threads;
+	for (int32 t = 0; t < numThreads; ++t)
+	{
+		threads.push_back(thread([this, t, numThreads, &numReady, &seconds]()
+		{
+			array<T*, SNumLive> live;
+			live.fill(nullptr);
+
+			numReady++;
+			while (numReady.load() < numThreads)
+			{
+				YieldProcessor();
+			}
+
+			auto start = FPerformanceCounter::GetTimeStamp();
+			for (int32 i = 0; i < NumIterations; ++i)
+			{
+				auto& slot = live[i % SNumLive];
+				delete slot;
+				slot = new T;
+			}
+
+			for (auto& slot : live)
+			{
+				delete slot;
+			}
+
+			seconds[t] = FPerformanceCounter::GetSeconds(start);
+		}));
+	}
+
+	double sec = 0.0;
+	for (int32 t = 0; t < numThreads; ++t)
+	{
+		threads[t].join();
+		sec += seconds[t];
+	}
+
+	return sec * 1e9 / ((double)NumIterations * numThreads);
+}
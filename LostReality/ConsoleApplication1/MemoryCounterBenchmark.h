@@ -0,0 +1,18 @@
+#pragma once
+
+// Cost of a new and delete of a class declaring MEMORY_ALLOC, on 1 to 4 threads at once,
+// against the same class without it. Then again with a call stack captured every 64 allocations.
+// Reports ns per new and delete, and the counters merged by FMemoryCounterManager::Sample.
+class FMemoryCounterBenchmarkSample
+{
+public:
+	explicit FMemoryCounterBenchmarkSample(int32 numIterations = 1000000);
+	~FMemoryCounterBenchmarkSample();
+
+private:
+	// ns per new and delete, averaged over the threads.
+	template <typename T>
+	double Run(int32 numThreads);
+
+	int32 NumIterations;
+};
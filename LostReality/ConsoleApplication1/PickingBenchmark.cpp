@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "PickingBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+static const uint32 SNumObjects = 50000;
+static const int32 SNumQueries = 1000;
+static const int32 SNumMoveFrames = 60;
+static const float SSceneRange = 1000.f;
+
+FPickingBenchmarkSample::FPickingBenchmarkSample()
+{
+	srand(0);
+
+	// Unit-ish meshes scattered over a flat scene, the local boxes are off center as the assets are.
+	Objects.resize(SNumObjects);
+	for (auto& object : Objects)
+	{
+		const FFloat3 size(1.f + (rand() % 100) * 0.05f, 1.f + (rand() % 100) * 0.05f, 1.f + (rand() % 100) * 0.05f);
+		object.Bounds.Set(FFloat3(-0.5f, 0.f, -0.5f) * size, FFloat3(0.5f, 1.f, 0.5f) * size);
+		object.World.SetRotateAndOrigin(FQuat().FromEuler(RandomFloat3(180.f)),
+			FFloat3(RandomFloat(SSceneRange), RandomFloat(SSceneRange * 0.05f), RandomFloat(SSceneRange)));
+		object.WorldInvert = object.World.GetInvert();
+		object.Proxy = FTree::SNull;
+	}
+
+	Rays.resize(SNumQueries);
+	for (int32 query = 0; query < SNumQueries; ++query)
+	{
+		Rays[query] = GetRay(query);
+	}
+
+	cout << "objects: " << SNumObjects << ", queries: " << SNumQueries << endl;
+	cout << "picking\tus/query\thits\tspeedup\tdiffers" << endl;
+
+	vector<int32> reference, nearest;
+	uint32 referenceHits = 0, numHits = 0;
+	const double loop = RunLoop(reference, referenceHits);
+	Report("loop", loop, referenceHits, reference, reference, loop);
+
+	FTree tree;
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 index = 0; index < (int32)SNumObjects; ++index)
+	{
+		Objects[index].Proxy = tree.Insert(GetTransformedBoundingBox(Objects[index].Bounds, Objects[index].World), index);
+	}
+
+	const double insert = FPerformanceCounter::GetSeconds(start);
+	const double inserted = RunTree(tree, nearest, numHits);
+	Report("insert", inserted, numHits, nearest, reference, loop);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	tree.Rebuild();
+	const double rebuild = FPerformanceCounter::GetSeconds(start);
+	const double rebuilt = RunTree(tree, nearest, numHits);
+	Report("rebuild", rebuilt, numHits, nearest, reference, loop);
+
+	uint32 numReinserted = 0;
+	const double moves = RunMoves(tree, numReinserted);
+
+	// The objects moved, the loop runs again for the reference.
+	RunLoop(reference, referenceHits);
+	const double moved = RunTree(tree, nearest, numHits);
+	Report("moved", moved, numHits, nearest, reference, loop);
+
+	cout << "insert all: " << insert * 1000.0 << "ms, rebuild: " << rebuild * 1000.0 << "ms, height: " << tree.GetHeight() << endl;
+	cout << "move " << SNumObjects / 10 << " objects: " << moves * 1000.0 / SNumMoveFrames << "ms/frame, reinserted "
+		<< numReinserted / SNumMoveFrames << "/frame" << endl;
+}
+
+FPickingBenchmarkSample::~FPickingBenchmarkSample()
+{
+}
+
+// A camera above the scene looking down at 30 degrees, the rays go through random points of the screen, fov 90, 16:9.
+FRay FPickingBenchmarkSample::GetRay(int32 query) const
+{
+	FFloat4x4 view;
+	view.SetRotateAndOrigin(FQuat().FromEuler(FFloat3(30.f, query * 360.f / SNumQueries, 0.f)), FFloat3(0.f, 100.f, 0.f));
+
+	const float x = RandomFloat(16.f / 9.f), y = RandomFloat(1.f);
+	return FRay(view.ApplyPoint(FFloat3()), view.ApplyVector(FFloat3(x, y, 1.f)), 10000.f);
+}
+
+// As FBasicScene::RayTest was, every object inverts its world matrix and tests its box.
+double FPickingBenchmarkSample::RunLoop(vector<int32>& nearest, uint32& numHits)
+{
+	nearest.assign(SNumQueries, FTree::SNull);
+	numHits = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 query = 0; query < SNumQueries; ++query)
+	{
+		const FRay& ray = Rays[query];
+		FRay::FT best = ray.Distance, dist;
+		for (int32 index = 0; index < (int32)SNumObjects; ++index)
+		{
+			const FObject& object = Objects[index];
+			if (RayBoxIntersect(ray, object.Bounds, object.World.GetInvert(), dist) && dist < best)
+			{
+				best = dist;
+				nearest[query] = index;
+			}
+		}
+
+		numHits += nearest[query] != FTree::SNull ? 1 : 0;
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
+
+// As FBasicScene::RayTest, the tree gives the candidates and they test with the cached inverse.
+double FPickingBenchmarkSample::RunTree(const FTree& tree, vector<int32>& nearest, uint32& numHits)
+{
+	nearest.assign(SNumQueries, FTree::SNull);
+	numHits = 0;
+
+	auto test = [this](int32 index, const FRay& ray, FRay::FT& dist)
+	{
+		const FObject& object = Objects[index];
+		return RayBoxIntersect(ray, object.Bounds, object.WorldInvert, dist);
+	};
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 query = 0; query < SNumQueries; ++query)
+	{
+		FRay::FT dist;
+		numHits += tree.RayCast(Rays[query], test, nearest[query], dist) ? 1 : 0;
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
+
+// A tenth of the objects moves up to a unit and turns every frame, as a gizmo drag of a selection would.
+double FPickingBenchmarkSample::RunMoves(FTree& tree, uint32& numReinserted)
+{
+	numReinserted = 0;
+
+	double sec = 0.0;
+	for (int32 frame = 0; frame < SNumMoveFrames; ++frame)
+	{
+		for (uint32 index = frame % 10; index < SNumObjects; index += 10)
+		{
+			FObject& object = Objects[index];
+			object.World.SetRotateAndOrigin(FQuat().FromEuler(RandomFloat3(180.f)), object.World.GetOrigin() + RandomFloat3(1.f));
+		}
+
+		auto start = FPerformanceCounter::GetTimeStamp();
+		for (uint32 index = frame % 10; index < SNumObjects; index += 10)
+		{
+			FObject& object = Objects[index];
+			object.WorldInvert = object.World.GetInvert();
+			numReinserted += tree.Move(object.Proxy, GetTransformedBoundingBox(object.Bounds, object.World)) ? 1 : 0;
+		}
+
+		sec += FPerformanceCounter::GetSeconds(start);
+	}
+
+	return sec;
+}
+
+void FPickingBenchmarkSample::Report(const char* name, double sec, uint32 numHits, const vector<int32>& nearest, const vector<int32>& reference, double loop)
+{
+	uint32 differs = 0;
+	for (int32 query = 0; query < SNumQueries; ++query)
+	{
+		differs += nearest[query] != reference[query] ? 1 : 0;
+	}
+
+	ReportComparison(name, loop / sec, differs, sec * 1000000.0 / SNumQueries, numHits);
+}
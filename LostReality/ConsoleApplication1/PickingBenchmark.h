@@ -0,0 +1,33 @@
+#pragma once
+
+// Hover picking in a 50k object scene, no renderer.
+// Rays from a camera through random screen points, the nearest hit of the loop of FBasicScene::RayTest
+// (world inverse per test) against TDynamicBVH filled one at a time and rebuilt with SAH,
+// then the objects move a little every frame and the tree follows them.
+// Reports us per query, hits and the results differing from the loop.
+class FPickingBenchmarkSample
+{
+public:
+	FPickingBenchmarkSample();
+	~FPickingBenchmarkSample();
+
+private:
+	struct FObject
+	{
+		LostCore::FFloat4x4 World;
+		LostCore::FFloat4x4 WorldInvert;
+		LostCore::FAABoundingBox Bounds;
+		int32 Proxy;
+	};
+
+	typedef LostCore::TDynamicBVH<int32> FTree;
+
+	LostCore::FRay GetRay(int32 query) const;
+	double RunLoop(vector<int32>& nearest, uint32& numHits);
+	double RunTree(const FTree& tree, vector<int32>& nearest, uint32& numHits);
+	double RunMoves(FTree& tree, uint32& numReinserted);
+	void Report(const char* name, double sec, uint32 numHits, const vector<int32>& nearest, const vector<int32>& reference, double loop);
+
+	vector<FObject> Objects;
+	vector<LostCore::FRay> Rays;
+};
@@ -0,0 +1,125 @@
+#include "stdafx.h"
+#include "PrimeCountBenchmark.h"
+
+using namespace LostCore;
+
+FPrimeCountBenchmarkSample::FPrimeCountBenchmarkSample(int32 rangeEnd, int32 batchSize)
+	: RangeEnd(rangeEnd)
+	, BatchSize(batchSize)
+{
+	FProcessUnique::StaticInitialize();
+
+	FJobSystem* jobs = FJobSystem::Get();
+	const uint32 maxThreads = jobs->GetMaxConcurrency();
+
+	// 1, 2, 4 ... and the whole pool.
+	vector<uint32> threadCounts;
+	for (uint32 threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	threadCounts.push_back(maxThreads);
+
+	cout << "job system threads: " << maxThreads << ", range: [0, " << RangeEnd << "), batch: " << BatchSize << endl;
+	cout << "threads\tParallelFor ms\tspeedup\tjobs ms\tspeedup\tprimes" << endl;
+
+	double referenceParallelFor = 0.0;
+	double referenceJobs = 0.0;
+	for (auto threads : threadCounts)
+	{
+		jobs->SetConcurrency(threads);
+
+		int32 resultParallelFor = 0;
+		int32 resultJobs = 0;
+		const double secParallelFor = RunParallelFor(resultParallelFor);
+		const double secJobs = RunJobs(resultJobs);
+		if (threads == 1)
+		{
+			referenceParallelFor = secParallelFor;
+			referenceJobs = secJobs;
+		}
+
+		cout << threads << "\t" << secParallelFor * 1000.0 << "\t" << referenceParallelFor / secParallelFor << "\t"
+			<< secJobs * 1000.0 << "\t" << referenceJobs / secJobs << "\t" << resultParallelFor
+			<< (resultParallelFor == resultJobs ? "" : " MISMATCH") << endl;
+	}
+
+	jobs->SetConcurrency(maxThreads);
+}
+
+FPrimeCountBenchmarkSample::~FPrimeCountBenchmarkSample()
+{
+	FProcessUnique::StaticDestroy();
+}
+
+int32 FPrimeCountBenchmarkSample::CountPrimeNums(int32 rangeBegin, int32 rangeEnd)
+{
+	int32 count = 0;
+	for (int32 n = rangeBegin < 2 ? 2 : rangeBegin; n < rangeEnd; n++)
+	{
+		bool prime = true;
+		for (int32 i = 2; i < n; i++)
+		{
+			if ((n%i) == 0)
+			{
+				prime = false;
+				break;
+			}
+		}
+
+		count += prime ? 1 : 0;
+	}
+
+	return count;
+}
+
+double FPrimeCountBenchmarkSample::RunParallelFor(int32& result)
+{
+	atomic<int32> count(0);
+	auto start = FPerformanceCounter::GetTimeStamp();
+	FJobSystem::Get()->ParallelFor((uint32)RangeEnd, (uint32)BatchSize, [&](uint32 begin, uint32 end)
+	{
+		count += CountPrimeNums((int32)begin, (int32)end);
+	});
+
+	result = count;
+	return FPerformanceCounter::GetSeconds(start);
+}
+
+double FPrimeCountBenchmarkSample::RunJobs(int32& result)
+{
+	FJobSystem* jobSystem = FJobSystem::Get();
+	const int32 numBatches = (RangeEnd + BatchSize - 1) / BatchSize;
+	vector<int32> counts(numBatches, 0);
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+
+	vector<FJob> jobs(numBatches);
+	for (int32 batch = 0; batch < numBatches; ++batch)
+	{
+		jobs[batch].Func = [&, batch]()
+		{
+			const int32 begin = batch * BatchSize;
+			counts[batch] = CountPrimeNums(begin, begin + BatchSize < RangeEnd ? begin + BatchSize : RangeEnd);
+		};
+	}
+
+	// The reduce job starts once every count is done.
+	FJob reduce([&]()
+	{
+		result = 0;
+		for (auto count : counts)
+		{
+			result += count;
+		}
+	});
+
+	FJobCounter countCounter;
+	FJobCounter reduceCounter;
+	jobSystem->Run(jobs.data(), (uint32)numBatches, &countCounter);
+	jobSystem->RunAfter(&countCounter, &reduce, 1, &reduceCounter);
+	jobSystem->Wait(&reduceCounter);
+
+	return FPerformanceCounter::GetSeconds(start);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Scaling of FJobSystem with uneven jobs, the prime counting of the old FThreadSynchronizerSample.
+// Trial division up to n, the cost of a number grows with it, late batches are the slow ones.
+// ParallelFor, and Run with a dependent reduce job, from 1 to N threads.
+class FPrimeCountBenchmarkSample
+{
+public:
+	explicit FPrimeCountBenchmarkSample(int32 rangeEnd = 60000, int32 batchSize = 500);
+	~FPrimeCountBenchmarkSample();
+
+private:
+	static int32 CountPrimeNums(int32 rangeBegin, int32 rangeEnd);
+
+	double RunParallelFor(int32& result);
+	double RunJobs(int32& result);
+
+	int32 RangeEnd;
+	int32 BatchSize;
+};
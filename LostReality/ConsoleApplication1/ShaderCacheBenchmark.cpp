@@ -0,0 +1,41 @@
+#include "stdafx.h"
+#include "LostCore-D3D11.h"
+#include "ShaderCacheBenchmark.h"
+
+using namespace LostCore;
+
+static void Output(const char* pass, const D3D11::FShaderCacheStats& stats)
+{
+	const uint32 numResolved = max(stats.NumLoaded + stats.NumCompiled + stats.NumFailed, 1u);
+	cout << pass << "\t"
+		<< stats.NumPermutations << "\t"
+		<< stats.NumLoaded << "\t"
+		<< stats.NumCompiled << "\t"
+		<< stats.NumFailed << "\t"
+		<< stats.NumWorkers << "\t"
+		<< stats.Sec * 1000.0 << "\t"
+		<< stats.ResolveSec * 1000.0 / numResolved << endl;
+}
+
+FShaderCacheBenchmarkSample::FShaderCacheBenchmarkSample()
+{
+	D3D11::WrappedInitializeProcessUnique();
+
+	D3D11::FShaderCacheStats first, second;
+	if (D3D11::WrappedPrecompileShaders(&first) != SSuccess && first.NumPermutations == 0)
+	{
+		cout << "precompile failed, LostCore-D3D11.dll, paths.json and res/ShaderCode next to the exe?" << endl;
+		return;
+	}
+
+	D3D11::WrappedPrecompileShaders(&second);
+
+	cout << "pass\tpermutations\tloaded\tcompiled\tfailed\tworkers\tms\tms/permutation" << endl;
+	Output("first", first);
+	Output("second", second);
+}
+
+FShaderCacheBenchmarkSample::~FShaderCacheBenchmarkSample()
+{
+	D3D11::WrappedDestroyProcessUnique();
+}
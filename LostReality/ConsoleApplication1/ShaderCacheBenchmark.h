@@ -0,0 +1,11 @@
+#pragma once
+
+// The offline precompile of LostCore-D3D11.dll, every shader permutation into res/ShaderBlob, twice.
+// The first pass compiles what the cache misses and writes one file per permutation,
+// the second one only loads them, the difference is the stall a new permutation costs the render thread.
+class FShaderCacheBenchmarkSample
+{
+public:
+	FShaderCacheBenchmarkSample();
+	~FShaderCacheBenchmarkSample();
+};
@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "SingletonBenchmark.h"
+
+using namespace LostCore;
+
+namespace
+{
+	// TTlsSingleton::Get before the slot tables, the members are the ones of FProcessUnique and FThread then.
+	class FMapLookup
+	{
+	public:
+		FMapLookup()
+			: Index(FStackCounterManager::SClassIndex)
+		{
+			ThreadMap[this_thread::get_id()] = FProcessUnique::Get()->GetCurrentThread();
+			IndexedSingletonMap[Index] = FStackCounterManager::Get();
+		}
+
+		FStackCounterManager* Get()
+		{
+			// FProcessUnique::GetCurrentThread.
+			FThread* t = nullptr;
+			{
+				lock_guard<mutex> lck(ThreadMapMutex);
+				auto id = this_thread::get_id();
+				assert(ThreadMap.find(id) != ThreadMap.end());
+				t = ThreadMap.find(this_thread::get_id())->second;
+			}
+
+			// FThread::GetSingleton, TTlsSingleton::Get.
+			assert(t != nullptr);
+			auto it = IndexedSingletonMap.find(Index);
+			ITickable* p = it != IndexedSingletonMap.end() ? it->second : nullptr;
+			return dynamic_cast<FStackCounterManager*>(p);
+		}
+
+	private:
+		int32 Index;
+		map<thread::id, FThread*> ThreadMap;
+		mutex ThreadMapMutex;
+		map<int32, ITickable*> IndexedSingletonMap;
+	};
+
+	class FBenchmarkTask : public ITask
+	{
+	public:
+		explicit FBenchmarkTask(const function<void()>& func) : Func(func) {}
+
+		// Inherited via ITask
+		virtual bool Initialize() override { return true; }
+		virtual void Tick() override { Func(); }
+		virtual void Destroy() override {}
+		virtual bool IsThreadPrivate() const override { return false; }
+		virtual bool IsLoop() const override { return false; }
+
+	private:
+		function<void()> Func;
+	};
+}
+
+FSingletonBenchmarkSample::FSingletonBenchmarkSample(int32 numIterations)
+	: NumIterations(numIterations)
+{
+	FProcessUnique::StaticInitialize();
+
+	{
+		FBenchmarkTask task([this]() { Run(); });
+		FThread worker(&task, "Singleton benchmark");
+	}
+
+	FProcessUnique::StaticDestroy();
+}
+
+FSingletonBenchmarkSample::~FSingletonBenchmarkSample()
+{
+}
+
+void FSingletonBenchmarkSample::Run()
+{
+	// Scopes between two Finish, the counter tree of a frame stays small.
+	const int32 scopesPerFrame = 1000;
+
+	FMapLookup mapLookup;
+	FStackCounterManager* expected = FStackCounterManager::Get();
+	int32 mismatches = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < NumIterations; ++i)
+	{
+		mismatches += mapLookup.Get() != expected ? 1 : 0;
+	}
+
+	const double secMap = FPerformanceCounter::GetSeconds(start);
+
+	start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < NumIterations; ++i)
+	{
+		mismatches += FStackCounterManager::Get() != expected ? 1 : 0;
+	}
+
+	const double secSlot = FPerformanceCounter::GetSeconds(start);
+
+	// Not static, the request id belongs to the manager of this thread.
+	FStackCounterRequest counter("FSingletonBenchmarkSample::Run");
+	double secScopes = 0.0;
+	for (int32 done = 0; done < NumIterations; done += scopesPerFrame)
+	{
+		start = FPerformanceCounter::GetTimeStamp();
+		for (int32 i = 0; i < scopesPerFrame; ++i)
+		{
+			FScopedStackCounterRequest scopedCounter(counter);
+		}
+
+		secScopes += FPerformanceCounter::GetSeconds(start);
+		FStackCounterManager::Get()->Finish();
+	}
+
+	const double nsMap = secMap * 1e9 / NumIterations;
+	const double nsSlot = secSlot * 1e9 / NumIterations;
+	const double nsScope = secScopes * 1e9 / NumIterations;
+
+	cout << "iterations: " << NumIterations << (mismatches == 0 ? "" : ", MISMATCH") << endl;
+	cout << "lookup\tns per Get" << endl;
+	cout << "map and mutex\t" << nsMap << endl;
+	cout << "thread local slot\t" << nsSlot << endl;
+
+	// A scope is one Get in Start and one in Stop, the baseline is estimated from the difference of both.
+	cout << "scope\tns per scope" << endl;
+	cout << "with map and mutex, estimated\t" << nsScope + 2.0 * (nsMap - nsSlot) << endl;
+	cout << "with thread local slot\t" << nsScope << endl;
+}
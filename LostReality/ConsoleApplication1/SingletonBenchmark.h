@@ -0,0 +1,18 @@
+#pragma once
+
+// Cost of TTlsSingleton::Get and of a FScopedStackCounterRequest, which calls it twice.
+// The baseline is the lookup the slot tables replaced, kept as it was: FProcessUnique::GetCurrentThread
+// finds the FThread under a mutex in a map of thread ids, FThread::GetSingleton finds the singleton
+// in the map of the thread, then TTlsSingleton::Get does a dynamic_cast.
+// Runs in a FThread, reports ns per call of both lookups and ns per scope.
+class FSingletonBenchmarkSample
+{
+public:
+	explicit FSingletonBenchmarkSample(int32 numIterations = 1000000);
+	~FSingletonBenchmarkSample();
+
+private:
+	void Run();
+
+	int32 NumIterations;
+};
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "StackCounterBenchmark.h"
+
+using namespace LostCore;
+
+namespace
+{
+	class FBenchmarkTask : public ITask
+	{
+	public:
+		explicit FBenchmarkTask(const function<void()>& func) : Func(func) {}
+
+		// Inherited via ITask
+		virtual bool Initialize() override { return true; }
+		virtual void Tick() override { Func(); }
+		virtual void Destroy() override {}
+		virtual bool IsThreadPrivate() const override { return false; }
+		virtual bool IsLoop() const override { return false; }
+
+	private:
+		function<void()> Func;
+	};
+}
+
+FStackCounterBenchmarkSample::FStackCounterBenchmarkSample(int32 numFrames)
+	: NumFrames(numFrames)
+{
+	FProcessUnique::StaticInitialize();
+
+	{
+		FBenchmarkTask task([this]() { Run(); });
+		FThread worker(&task, "Stack counter benchmark");
+	}
+
+	FProcessUnique::StaticDestroy();
+}
+
+FStackCounterBenchmarkSample::~FStackCounterBenchmarkSample()
+{
+}
+
+void FStackCounterBenchmarkSample::Run()
+{
+	const int32 numOuter = 100;
+	const int32 numMiddle = 10;
+	const int32 numInner = 99;
+	const int32 scopesPerFrame = numOuter * (1 + numMiddle * (1 + numInner));
+
+	// Not static, the request ids belong to the manager of this thread.
+	FStackCounterRequest outer("FStackCounterBenchmarkSample::Outer");
+	FStackCounterRequest middle("FStackCounterBenchmarkSample::Middle");
+	FStackCounterRequest inner("FStackCounterBenchmarkSample::Inner");
+
+	// Warm up, the first frames grow the counter storage.
+	double secScopes = 0.0;
+	double secFinish = 0.0;
+	for (int32 frame = -2; frame < NumFrames; ++frame)
+	{
+		auto start = FPerformanceCounter::GetTimeStamp();
+		for (int32 i = 0; i < numOuter; ++i)
+		{
+			FScopedStackCounterRequest scopedOuter(outer);
+			for (int32 j = 0; j < numMiddle; ++j)
+			{
+				FScopedStackCounterRequest scopedMiddle(middle);
+				for (int32 k = 0; k < numInner; ++k)
+				{
+					FScopedStackCounterRequest scopedInner(inner);
+				}
+			}
+		}
+
+		const double sec = FPerformanceCounter::GetSeconds(start);
+
+		start = FPerformanceCounter::GetTimeStamp();
+		FStackCounterManager::Get()->Finish();
+		if (frame >= 0)
+		{
+			secScopes += sec;
+			secFinish += FPerformanceCounter::GetSeconds(start);
+		}
+	}
+
+	cout << "frames: " << NumFrames << ", scopes per frame: " << scopesPerFrame << endl;
+	cout << "ns per scope\t" << secScopes * 1e9 / ((double)NumFrames * scopesPerFrame) << endl;
+	cout << "ms per Finish\t" << secFinish * 1e3 / NumFrames << endl;
+	cout << "ms per frame\t" << (secScopes + secFinish) * 1e3 / NumFrames << endl;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Cost of FScopedStackCounterRequest and of FStackCounterManager::Finish with ~100k nested scopes per frame,
+// 100 outer scopes of 10 scopes of 99 leaves, the leaves of one request merge into one row.
+// Runs in a FThread with the trace profiler stopped, reports ns per scope and ms per Finish.
+class FStackCounterBenchmarkSample
+{
+public:
+	explicit FStackCounterBenchmarkSample(int32 numFrames = 20);
+	~FStackCounterBenchmarkSample();
+
+private:
+	void Run();
+
+	int32 NumFrames;
+};
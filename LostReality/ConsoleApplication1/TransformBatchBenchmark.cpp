@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include "TransformBatchBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+static const uint32 SNumItems = 16384;
+static const int32 SNumLoops = 256;
+
+// Keeps the results from being optimized away.
+static volatile float SSink = 0.f;
+
+static FFloat4x4 RandomMatrix()
+{
+	FFloat4x4 matrix;
+	matrix.SetRotateAndOrigin(FQuat().FromEuler(RandomFloat3(180.f)), RandomFloat3(100.f), FFloat3(1.5f, 2.f, 0.5f));
+	return matrix;
+}
+
+// Items per second of func() over SNumLoops passes, func handles SNumItems items per call.
+template <typename TFunc>
+static double Measure(TFunc func)
+{
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 loop = 0; loop < SNumLoops; ++loop)
+	{
+		func();
+	}
+
+	return (double)SNumLoops * SNumItems / FPerformanceCounter::GetSeconds(start);
+}
+
+// One line per kernel, millions of items per second, loop/SSE2/AVX2 and the speedup of the best one.
+template <typename TLoop, typename TBatch>
+static void Run(const char* name, TLoop loop, TBatch batch)
+{
+	const ESIMDLevel detected = DetectSIMDLevel();
+	const double scalar = Measure(loop);
+
+	SetSIMDLevel(ESIMDLevel::SSE2);
+	const double sse2 = Measure(batch);
+
+	double avx2 = 0.0;
+	if (detected == ESIMDLevel::AVX2)
+	{
+		SetSIMDLevel(ESIMDLevel::AVX2);
+		avx2 = Measure(batch);
+	}
+
+	SetSIMDLevel(detected);
+	cout << name << "\t" << scalar * 1e-6 << "\t" << sse2 * 1e-6 << "\t";
+	if (avx2 > 0.0)
+	{
+		cout << avx2 * 1e-6;
+	}
+	else
+	{
+		cout << "n/a";
+	}
+
+	cout << "\t" << (avx2 > sse2 ? avx2 : sse2) / scalar << endl;
+}
+
+// SoA copy of points.
+struct FPointStreams
+{
+	vector<float> X, Y, Z;
+
+	explicit FPointStreams(const vector<FFloat3>& points)
+		: X(points.size()), Y(points.size()), Z(points.size())
+	{
+		for (uint32 i = 0; i < points.size(); ++i)
+		{
+			X[i] = points[i].X;
+			Y[i] = points[i].Y;
+			Z[i] = points[i].Z;
+		}
+	}
+
+	FFloat3SoA Get()
+	{
+		return FFloat3SoA(X.data(), Y.data(), Z.data());
+	}
+};
+
+FTransformBatchBenchmarkSample::FTransformBatchBenchmarkSample()
+{
+	srand(0);
+
+	cout << "detected simd level: " << GetSIMDLevelName(DetectSIMDLevel()) << endl;
+	cout << "op\tloop(M/s)\tsse2(M/s)\tavx2(M/s)\tspeedup" << endl;
+	RunPoints();
+	RunVectors();
+	RunMatrices();
+	RunBounds();
+}
+
+FTransformBatchBenchmarkSample::~FTransformBatchBenchmarkSample()
+{
+}
+
+void FTransformBatchBenchmarkSample::RunPoints()
+{
+	const FFloat4x4 matrix(RandomMatrix());
+	vector<FFloat3> points(SNumItems), output(SNumItems);
+	for (auto& point : points)
+	{
+		point = RandomFloat3(100.f);
+	}
+
+	FPointStreams input(points), streams(points);
+
+	Run("points aos",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) matrix.ApplyPoint(output[i], points[i]); },
+		[&]() { FTransformBatch::TransformPoints(matrix, points.data(), output.data(), SNumItems); });
+	Run("points soa",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) matrix.ApplyPoint(output[i], points[i]); },
+		[&]() { FTransformBatch::TransformPoints(matrix, input.Get(), streams.Get(), SNumItems); });
+	SSink = SSink + output[0].X + streams.X[0];
+}
+
+void FTransformBatchBenchmarkSample::RunVectors()
+{
+	const FFloat4x4 matrix(RandomMatrix());
+	vector<FFloat3> normals(SNumItems), output(SNumItems);
+	for (auto& normal : normals)
+	{
+		normal = RandomFloat3(1.f).GetNormal();
+	}
+
+	FPointStreams input(normals), streams(normals);
+
+	Run("normals aos",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) matrix.ApplyVector(output[i], normals[i]); },
+		[&]() { FTransformBatch::TransformVectors(matrix, normals.data(), output.data(), SNumItems); });
+	Run("normals soa",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) matrix.ApplyVector(output[i], normals[i]); },
+		[&]() { FTransformBatch::TransformVectors(matrix, input.Get(), streams.Get(), SNumItems); });
+	SSink = SSink + output[0].X + streams.X[0];
+}
+
+void FTransformBatchBenchmarkSample::RunMatrices()
+{
+	const FFloat4x4 parent(RandomMatrix());
+	vector<FFloat4x4> matrices(SNumItems), output(SNumItems);
+	for (auto& matrix : matrices)
+	{
+		matrix = RandomMatrix();
+	}
+
+	// Streams 64KB apart would all map to the same cache sets, pad them by a cache line.
+	const uint32 stride = SNumItems + 16;
+	vector<float> input(stride * 16), streams(stride * 16);
+	FConstFloat4x4SoA inputSoA;
+	FFloat4x4SoA outputSoA;
+	for (int32 row = 0; row < 4; ++row)
+	{
+		for (int32 col = 0; col < 4; ++col)
+		{
+			float* stream = &input[(row * 4 + col) * stride];
+			for (uint32 i = 0; i < SNumItems; ++i)
+			{
+				stream[i] = matrices[i].M[row][col];
+			}
+
+			inputSoA.M[row][col] = stream;
+			outputSoA.M[row][col] = &streams[(row * 4 + col) * stride];
+		}
+	}
+
+	Run("matrices aos",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) output[i] = matrices[i] * parent; },
+		[&]() { FTransformBatch::ConcatenateMatrices(matrices.data(), parent, output.data(), SNumItems); });
+	Run("matrices soa",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) output[i] = matrices[i] * parent; },
+		[&]() { FTransformBatch::ConcatenateMatrices(inputSoA, parent, outputSoA, SNumItems); });
+	SSink = SSink + output[0].M[3][0] + streams[0];
+}
+
+void FTransformBatchBenchmarkSample::RunBounds()
+{
+	const FFloat4x4 matrix(RandomMatrix());
+	vector<FFloat3> points(SNumItems);
+	for (auto& point : points)
+	{
+		point = RandomFloat3(100.f);
+	}
+
+	FPointStreams input(points);
+	FAABoundingBox bounds;
+
+	Run("bounds",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) bounds.AddPoint(points[i]); },
+		[&]() { FTransformBatch::AddPoints(bounds, points.data(), SNumItems); });
+	Run("transformed bounds aos",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) bounds.AddPoint(matrix.ApplyPoint(points[i])); },
+		[&]() { FTransformBatch::AddTransformedPoints(bounds, matrix, points.data(), SNumItems); });
+	Run("transformed bounds soa",
+		[&]() { for (uint32 i = 0; i < SNumItems; ++i) bounds.AddPoint(matrix.ApplyPoint(points[i])); },
+		[&]() { FTransformBatch::AddTransformedPoints(bounds, matrix, input.Get(), SNumItems); });
+	SSink = SSink + bounds.Min.X;
+}
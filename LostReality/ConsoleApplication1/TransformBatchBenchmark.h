@@ -0,0 +1,16 @@
+#pragma once
+
+// Points per second of the FTransformBatch kernels at each SIMD level against the per element loop.
+// AoS and SoA points and normals, matrix concatenation and bounds.
+class FTransformBatchBenchmarkSample
+{
+public:
+	FTransformBatchBenchmarkSample();
+	~FTransformBatchBenchmarkSample();
+
+private:
+	void RunPoints();
+	void RunVectors();
+	void RunMatrices();
+	void RunBounds();
+};
@@ -0,0 +1,128 @@
+#include "stdafx.h"
+#include "TrianglePickingBenchmark.h"
+#include "BenchmarkHelpers.h"
+
+using namespace LostCore;
+
+static const int32 SNumRays = 10000;
+
+// The loop takes seconds per thousand rays on a big mesh, it runs on a part of them.
+static const int32 SNumLoopRays = 500;
+
+FTrianglePickingBenchmarkSample::FTrianglePickingBenchmarkSample(const string& url)
+{
+	srand(0);
+
+	FMeshData data;
+	data.Load(url);
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	data.BuildTriangleBVH(BVH);
+	const double build = FPerformanceCounter::GetSeconds(start);
+
+	FAABoundingBox bounds;
+	Triangles.resize(data.Triangles.size());
+	for (uint32 i = 0; i < data.Triangles.size(); ++i)
+	{
+		for (uint32 corner = 0; corner < 3; ++corner)
+		{
+			Triangles[i].P[corner] = data.Coordinates[data.Triangles[i].Vertices[corner].Index];
+			bounds.AddPoint(Triangles[i].P[corner]);
+		}
+	}
+
+	if (Triangles.empty())
+	{
+		cout << "no triangles: " << url << endl;
+		return;
+	}
+
+	const FFloat3 center((bounds.Min + bounds.Max) * 0.5f);
+	const FFloat3 size(bounds.Max - bounds.Min);
+	const float radius = size.Size();
+	Rays.resize(SNumRays);
+	for (auto& ray : Rays)
+	{
+		const FFloat3 origin(center + FFloat3(RandomFloat(1.f), RandomFloat(1.f), RandomFloat(1.f)).GetNormal() * radius);
+		const FFloat3 target(center + FFloat3(RandomFloat(0.5f), RandomFloat(0.5f), RandomFloat(0.5f)) * size);
+		ray = FRay(origin, target - origin, radius * 4.f);
+	}
+
+	cout << "mesh: " << url << ", triangles: " << Triangles.size() << ", nodes: " << BVH.GetNodes().size()
+		<< ", build: " << build * 1000.0 << "ms" << endl;
+	cout << "picking\trays/s\thits\tspeedup\tdiffers" << endl;
+
+	vector<float> reference, dists;
+	uint32 referenceHits = 0, numHits = 0;
+	const double loop = RunLoop(reference, referenceHits) / SNumLoopRays;
+	ReportComparison("loop", 1.0, 0, 1.0 / loop, to_string(referenceHits) + "/" + to_string(SNumLoopRays));
+
+	const ESIMDLevel detected = DetectSIMDLevel();
+	ESIMDLevel levels[] = { ESIMDLevel::SSE2, ESIMDLevel::AVX2 };
+	for (auto level : levels)
+	{
+		if ((uint8)level > (uint8)detected)
+		{
+			continue;
+		}
+
+		SetSIMDLevel(level);
+		const double bvh = RunBVH(dists, numHits) / SNumRays;
+
+		// The same nearest distance, fma may move a ray grazing an edge to the neighbour triangle.
+		uint32 differs = 0;
+		for (int32 i = 0; i < SNumLoopRays; ++i)
+		{
+			differs += std::abs(dists[i] - reference[i]) > 1e-3f * (1.f + reference[i]) ? 1 : 0;
+		}
+
+		ReportComparison(string("bvh ") + GetSIMDLevelName(level), loop / bvh, differs, 1.0 / bvh, to_string(numHits) + "/" + to_string(SNumRays));
+	}
+
+	SetSIMDLevel(detected);
+}
+
+FTrianglePickingBenchmarkSample::~FTrianglePickingBenchmarkSample()
+{
+}
+
+// Every triangle of the mesh, as FBasicModel::RayTest would without the bvh. A miss is -1.
+double FTrianglePickingBenchmarkSample::RunLoop(vector<float>& dists, uint32& numHits)
+{
+	dists.assign(SNumLoopRays, -1.f);
+	numHits = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumLoopRays; ++i)
+	{
+		const FRay& ray = Rays[i];
+		FRay::FT nearest = ray.Distance, dist;
+		for (const auto& tri : Triangles)
+		{
+			if (RayTriangleIntersect(ray, tri, dist) && dist < nearest)
+			{
+				nearest = dist;
+				dists[i] = dist;
+			}
+		}
+
+		numHits += dists[i] >= 0.f ? 1 : 0;
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
+
+double FTrianglePickingBenchmarkSample::RunBVH(vector<float>& dists, uint32& numHits)
+{
+	dists.assign(SNumRays, -1.f);
+	numHits = 0;
+
+	auto start = FPerformanceCounter::GetTimeStamp();
+	for (int32 i = 0; i < SNumRays; ++i)
+	{
+		uint32 triangle;
+		numHits += BVH.RayCast(Rays[i], dists[i], triangle) ? 1 : 0;
+	}
+
+	return FPerformanceCounter::GetSeconds(start);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Precise ray picking against the triangles of one mesh (HeroTPP.iv), no renderer.
+// Rays from a sphere around the mesh aim at random points of its bounding box, every triangle
+// with RayTriangleIntersect against FTriangleBVH at each SIMD level.
+// Reports the build time, rays per second, hits and the results differing from the loop.
+class FTrianglePickingBenchmarkSample
+{
+public:
+	explicit FTrianglePickingBenchmarkSample(const string& url);
+	~FTrianglePickingBenchmarkSample();
+
+private:
+	double RunLoop(vector<float>& dists, uint32& numHits);
+	double RunBVH(vector<float>& dists, uint32& numHits);
+
+	vector<LostCore::FTriangle> Triangles;
+	vector<LostCore::FRay> Rays;
+	LostCore::FTriangleBVH BVH;
+};
@@ -1112,12 +1112,13 @@ bool FFbxImporter2::ImportSceneMeshes()
 		mesh.ExtractVertex();
 	}
 
-	for (const auto& mesh : TempMeshArray)
+	for (auto& mesh : TempMeshArray)
 	{
 		meshSection.push_back(FJson());
 		FJson& meshJson = *(meshSection.end() - 1);
 		meshJson[K_PATH] = mesh.MeshData.Save(DestDirectory);
 		meshJson[K_VERTEX_ELEMENT] = mesh.MeshData.VertexFlags;
+		FMappedMeshData::Save(mesh.MeshData, DestDirectory);
 
 		FMeshDataAlias tm;
 		tm.Load(meshJson[K_PATH]);
@@ -1143,6 +1144,9 @@ bool FFbxImporter2::ImportSceneMeshes()
 			FJson& animJson = *(animSection.end() - 1);
 			animJson[K_PATH] = anim.AnimData.Save(DestDirectory);
 			animJson[K_NAME] = anim.AnimData.Name;
+#if !IMPORT_ANIM_CURVE
+			FMappedAnimKeyFrameData::Save(anim.AnimData, DestDirectory);
+#endif
 		}
 	}
 
@@ -64,12 +64,11 @@ void D3D11::FConstantBuffer::UpdateBuffer(const FBuf& buf)
 {
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecUpdateBuffer(this, buf);
+		ExecUpdateBuffer(this, buf.data(), buf.size());
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, bind(&ExecUpdateBuffer, placeholders::_1, buf)));
+		FRenderContext::Get()->GetCommandArena().Push(&ExecUpdateBuffer, this, buf.data(), buf.size());
 	}
 }
 
@@ -93,8 +92,14 @@ int32 D3D11::FConstantBuffer::GetShaderFlags() const
 	return ShaderFlags;
 }
 
-void D3D11::FConstantBuffer::Bind()
+void D3D11::FConstantBuffer::Bind(const FConstantBufferSlice& slice)
 {
+	if (slice.Size > 0)
+	{
+		FRenderContext::Get()->GetConstantBufferRing().Bind(slice, ShaderSlot, ShaderFlags);
+		return;
+	}
+
 	const char* head = "FConstantBuffer::Bind";
 	auto cxt = FRenderContext::GetDeviceContext(head);
 	if (!cxt.IsValid())
@@ -134,6 +139,11 @@ void D3D11::FConstantBuffer::Bind()
 	}
 }
 
+const FBuf& D3D11::FConstantBuffer::GetData() const
+{
+	return Data;
+}
+
 inline int32 D3D11::FConstantBuffer::GetByteWidth() const
 {
 	return ByteWidth;
@@ -146,30 +156,51 @@ inline TRefCountPtr<ID3D11Buffer> D3D11::FConstantBuffer::GetBufferRHI()
 
 bool D3D11::FConstantBuffer::IsValid() const
 {
-	return Buffer.IsValid();
+	return Buffer.IsValid() || !Data.empty();
 }
 
 void D3D11::FConstantBuffer::ExecCommit(void * p)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	auto pthis = (FConstantBuffer*)p;
-	FRenderContext::Get()->CommitBuffer(pthis);
+	auto& ring = FRenderContext::Get()->GetConstantBufferRing();
+
+	FConstantBufferSlice slice;
+	if (ring.IsEnabled())
+	{
+		if (pthis->Data.empty())
+		{
+			return;
+		}
+
+		slice = ring.Allocate(pthis->Data.data(), (uint32)pthis->Data.size());
+	}
+
+	FRenderContext::Get()->CommitBuffer(pthis, slice);
 }
 
-void D3D11::FConstantBuffer::ExecUpdateBuffer(void* p, const FBuf & buf)
+void D3D11::FConstantBuffer::ExecUpdateBuffer(void* p, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FConstantBuffer::ExecUpdateBuffer";
 	auto cxt = FRenderContext::GetDeviceContext(head);
 	auto pthis = (FConstantBuffer*)p;
+	pthis->Data.resize(sz);
+	memcpy(pthis->Data.data(), buf, sz);
+
+	// No gpu object of its own, the content goes to the ring when committed.
+	if (FRenderContext::Get()->GetConstantBufferRing().IsEnabled())
+	{
+		pthis->ByteWidth = LostCore::GetAlignedSize(sz, 16);
+		return;
+	}
 
-	auto sz = buf.size();
 	if (pthis->ByteWidth != LostCore::GetAlignedSize(sz, 16) && !pthis->Initialize(sz, false))
 	{
 		return;
 	}
 
-	cxt->UpdateSubresource(pthis->Buffer.GetReference(), 0, nullptr, buf.data(), 0, 0);
+	cxt->UpdateSubresource(pthis->Buffer.GetReference(), 0, nullptr, buf, 0, 0);
 }
 
 void D3D11::FConstantBuffer::Commit()
@@ -180,6 +211,6 @@ void D3D11::FConstantBuffer::Commit()
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(this, &ExecCommit));
+		FRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this);
 	}
 }
@@ -18,7 +18,7 @@ namespace D3D11
 	class FConstantBuffer : public LostCore::IConstantBuffer
 	{
 	public:
-		MEMORY_ALLOC(FConstantBuffer);
+		MEMORY_ALLOC(ConstantBuffer);
 
 		FConstantBuffer();
 		FConstantBuffer(const FConstantBuffer& rhs);
@@ -35,7 +35,11 @@ namespace D3D11
 		virtual void SetShaderFlags(int32 flags) override;
 		virtual int32 GetShaderFlags() const override;
 
-		void Bind();
+		// Size 0 binds the buffer of this object, a ring slice otherwise.
+		void Bind(const FConstantBufferSlice& slice);
+
+		// Render thread, the latest content.
+		const FBuf& GetData() const;
 
 		int32 GetByteWidth() const;
 		TRefCountPtr<ID3D11Buffer> GetBufferRHI();
@@ -48,8 +52,11 @@ namespace D3D11
 		int32		ShaderSlot;
 		int32		ShaderFlags;
 
+		// Latest content, with the ring enabled a slice of it is allocated on every Commit.
+		FBuf		Data;
+
 	private:
-		static void ExecUpdateBuffer(void* p, const FBuf& buf);
+		static void ExecUpdateBuffer(void* p, const void* buf, uint32 sz);
 		static void ExecCommit(void* p);
 	};
 
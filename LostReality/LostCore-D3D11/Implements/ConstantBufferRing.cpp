@@ -0,0 +1,219 @@
+/*
+* file ConstantBufferRing.cpp
+*
+* author luoxw
+* date 2018/03/24
+*
+*
+*/
+
+#include "stdafx.h"
+#include "ConstantBufferRing.h"
+
+D3D11::FConstantBufferRing::FConstantBufferRing()
+	: Context(nullptr)
+	, Capacity(0)
+	, FrameIndex(0)
+	, Used(0)
+	, FlushedBytes(0)
+{
+}
+
+D3D11::FConstantBufferRing::~FConstantBufferRing()
+{
+	Destroy();
+}
+
+bool D3D11::FConstantBufferRing::Initialize(uint32 capacity)
+{
+	assert(FRenderContext::Get()->InRenderThread());
+	const char* head = "FConstantBufferRing::Initialize";
+
+	auto device = FRenderContext::GetDevice(head);
+	auto cxt = FRenderContext::GetDeviceContext(head);
+	if (!device.IsValid() || !cxt.IsValid())
+	{
+		return false;
+	}
+
+	// Offsets need the 11.1 runtime and driver support, per-object buffers are used otherwise.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	memset(&options, 0, sizeof(options));
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+		!options.ConstantBufferOffsetting)
+	{
+		LVMSG(head, "constant buffer offsetting is not supported, ring disabled.");
+		return false;
+	}
+
+	if (FAILED(cxt->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)Context.GetInitReference())))
+	{
+		LVMSG(head, "no ID3D11DeviceContext1, ring disabled.");
+		return false;
+	}
+
+	if (!CreateBuffers(LostCore::GetAlignedSize(capacity, SAlignment)))
+	{
+		Destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void D3D11::FConstantBufferRing::Destroy()
+{
+	for (auto& buffer : Buffers)
+	{
+		buffer = nullptr;
+	}
+
+	Context = nullptr;
+	Capacity = 0;
+	FrameIndex = 0;
+	Shadow.clear();
+	Used = 0;
+	FlushedBytes = 0;
+}
+
+bool D3D11::FConstantBufferRing::IsEnabled() const
+{
+	return Capacity > 0;
+}
+
+D3D11::FConstantBufferSlice D3D11::FConstantBufferRing::Allocate(const void* data, uint32 sz)
+{
+	assert(IsEnabled() && sz > 0 && sz <= SMaxSliceSize);
+
+	FConstantBufferSlice slice;
+	slice.Offset = Used;
+	slice.Size = LostCore::GetAlignedSize(sz, SAlignment);
+
+	Used += slice.Size;
+	if (Shadow.size() < Used)
+	{
+		Shadow.resize(Used > Shadow.size() * 2 ? Used : Shadow.size() * 2);
+	}
+
+	memcpy(Shadow.data() + slice.Offset, data, sz);
+	return slice;
+}
+
+void D3D11::FConstantBufferRing::Flush()
+{
+	assert(FRenderContext::Get()->InRenderThread());
+	const char* head = "FConstantBufferRing::Flush";
+
+	FlushedBytes = Used;
+	if (!IsEnabled() || Used == 0)
+	{
+		return;
+	}
+
+	if (Used > Capacity)
+	{
+		uint32 capacity = Capacity;
+		while (capacity < Used)
+		{
+			capacity *= 2;
+		}
+
+		if (!CreateBuffers(capacity))
+		{
+			Used = 0;
+			return;
+		}
+	}
+
+	// Buffers of the previous frames may still be read by the gpu.
+	FrameIndex = (FrameIndex + 1) % SNumFrames;
+	auto buffer = Buffers[FrameIndex].GetReference();
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	auto hr = Context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (FAILED(hr))
+	{
+		LVERR(head, "map buffer(%d) failed: 0x%08x(%d).", Capacity, hr, hr);
+		Used = 0;
+		return;
+	}
+
+	memcpy(mapped.pData, Shadow.data(), Used);
+	Context->Unmap(buffer, 0);
+	Used = 0;
+}
+
+void D3D11::FConstantBufferRing::Bind(const FConstantBufferSlice& slice, int32 slot, int32 flags)
+{
+	assert(IsEnabled() && slice.Size > 0);
+
+	auto ref = Buffers[FrameIndex].GetReference();
+	UINT first = slice.Offset / 16;
+	UINT num = slice.Size / 16;
+
+	if (HAS_FLAGS(SHADER_FLAG_VS, flags))
+	{
+		Context->VSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+
+	if (HAS_FLAGS(SHADER_FLAG_PS, flags))
+	{
+		Context->PSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+
+	if (HAS_FLAGS(SHADER_FLAG_GS, flags))
+	{
+		Context->GSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+
+	if (HAS_FLAGS(SHADER_FLAG_HS, flags))
+	{
+		Context->HSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+
+	if (HAS_FLAGS(SHADER_FLAG_DS, flags))
+	{
+		Context->DSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+
+	if (HAS_FLAGS(SHADER_FLAG_CS, flags))
+	{
+		Context->CSSetConstantBuffers1(slot, 1, &ref, &first, &num);
+	}
+}
+
+uint32 D3D11::FConstantBufferRing::GetCapacity() const
+{
+	return Capacity;
+}
+
+uint32 D3D11::FConstantBufferRing::GetFlushedBytes() const
+{
+	return FlushedBytes;
+}
+
+bool D3D11::FConstantBufferRing::CreateBuffers(uint32 capacity)
+{
+	const char* head = "FConstantBufferRing::CreateBuffers";
+	auto device = FRenderContext::GetDevice(head);
+
+	D3D11_BUFFER_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.ByteWidth = capacity;
+
+	for (auto& buffer : Buffers)
+	{
+		auto hr = device->CreateBuffer(&desc, nullptr, buffer.GetInitReference());
+		if (FAILED(hr))
+		{
+			LVERR(head, "create buffer(%d) failed: 0x%08x(%d).", capacity, hr, hr);
+			return false;
+		}
+	}
+
+	Capacity = capacity;
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+* file ConstantBufferRing.h
+*
+* author luoxw
+* date 2018/03/24
+*
+* 1. One dynamic constant buffer per frame in flight, per-object constants are 256 bytes aligned slices of it.
+* 2. Allocate copies into a cpu shadow, Flush uploads the whole frame with a single Map/Unmap before the draws.
+* 3. Slices are bound by *SetConstantBuffers1, disabled when the runtime can not offset constant buffers.
+*/
+
+#pragma once
+
+namespace D3D11
+{
+	// Bytes in the ring, Size 0 for the buffers bound as a whole.
+	struct FConstantBufferSlice
+	{
+		uint32 Offset;
+		uint32 Size;
+
+		FConstantBufferSlice() : Offset(0), Size(0) {}
+	};
+
+	class FConstantBufferRing
+	{
+	public:
+		static const uint32 SAlignment = 256;
+		static const uint32 SMaxSliceSize = 4096 * 16;
+		static const uint32 SNumFrames = 3;
+		static const uint32 SDefaultCapacity = 1024 * 1024;
+
+		FConstantBufferRing();
+		~FConstantBufferRing();
+
+		bool Initialize(uint32 capacity = SDefaultCapacity);
+		void Destroy();
+
+		bool IsEnabled() const;
+
+		// Render thread, the slice is valid from the next Flush to the one after.
+		FConstantBufferSlice Allocate(const void* data, uint32 sz);
+		void Flush();
+
+		void Bind(const FConstantBufferSlice& slice, int32 slot, int32 flags);
+
+		uint32 GetCapacity() const;
+		uint32 GetFlushedBytes() const;
+
+	private:
+		bool CreateBuffers(uint32 capacity);
+
+		TRefCountPtr<ID3D11DeviceContext1>	Context;
+		TRefCountPtr<ID3D11Buffer>			Buffers[SNumFrames];
+		uint32								Capacity;
+		uint32								FrameIndex;
+		vector<uint8>						Shadow;
+		uint32								Used;
+		uint32								FlushedBytes;
+	};
+}
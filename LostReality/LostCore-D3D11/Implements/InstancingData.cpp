@@ -39,19 +39,19 @@ void D3D11::FInstancingData::Commit()
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(this, &ExecCommit));
+		FRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this);
 	}
 }
 
-void D3D11::FInstancingData::ExecConstructBuffer(void* p, const FBuf& buf)
+void D3D11::FInstancingData::ExecConstructBuffer(void* p, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FInstancingData::ExecConstructBuffer";
 	auto pthis = (FInstancingData*)p;
 	auto device = FRenderContext::GetDevice(head);
-	auto result = ConstructBuffer(device, buf.data(), buf.size(), true, D3D11_BIND_VERTEX_BUFFER, pthis->Buffer);
+	auto result = ConstructBuffer(device, buf, sz, true, D3D11_BIND_VERTEX_BUFFER, pthis->Buffer);
 	assert(result == SSuccess);
-	pthis->BufferSize = buf.size();
+	pthis->BufferSize = sz;
 }
 
 void D3D11::FInstancingData::ExecCommit(void* p)
@@ -67,28 +67,28 @@ void D3D11::FInstancingData::ExecSetVertexElement(void* p, uint32 flags)
 	pthis->Flags = flags;
 }
 
-void D3D11::FInstancingData::ExecUpdate(void* p, const FBuf& buf, uint32 numInstances)
+void D3D11::FInstancingData::ExecUpdate(void* p, const uint32& numInstances, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FInstancingData::ExecUpdate";
 	auto pthis = (FInstancingData*)p;
 	auto cxt = FRenderContext::GetDeviceContext(head);
-	if (buf.size() > pthis->BufferSize)
+	if (sz > pthis->BufferSize)
 	{
-		ExecConstructBuffer(p, buf);
+		ExecConstructBuffer(p, buf, sz);
 	}
 	else
 	{
 		D3D11_MAPPED_SUBRESOURCE mapped;
 		cxt->Map(pthis->Buffer.GetReference(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-		memcpy(mapped.pData, buf.data(), buf.size());
+		memcpy(mapped.pData, buf, sz);
 		cxt->Unmap(pthis->Buffer.GetReference(), 0);
 	}
 
 	pthis->NumInstances = numInstances;
 	if (numInstances != 0)
 	{
-		pthis->Stride = buf.size() / numInstances;
+		pthis->Stride = sz / numInstances;
 	}
 }
 
@@ -107,16 +107,13 @@ void D3D11::FInstancingData::SetVertexElement(uint32 flags)
 
 void D3D11::FInstancingData::Update(const void* buf, uint32 sz, uint32 numInstances)
 {
-	FBuf dst(sz);
-	memcpy(dst.data(), buf, sz);
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecUpdate(this, dst, numInstances);
+		ExecUpdate(this, numInstances, buf, sz);
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, bind(&ExecUpdate, placeholders::_1, dst, numInstances)));
+		FRenderContext::Get()->GetCommandArena().PushArgs(&ExecUpdate, this, numInstances, buf, sz);
 	}
 }
 
@@ -14,7 +14,7 @@ namespace D3D11
 	class FInstancingData : public LostCore::IInstancingData
 	{
 	public:
-		MEMORY_ALLOC(FInstancingData);
+		MEMORY_ALLOC(InstancingData);
 
 		FInstancingData();
 		FInstancingData(const FInstancingData& rhs) = delete;
@@ -39,9 +39,9 @@ namespace D3D11
 		uint32 Stride;
 
 	private:
-		static void ExecConstructBuffer(void* p, const FBuf& buf);
+		static void ExecConstructBuffer(void* p, const void* buf, uint32 sz);
 		static void ExecCommit(void* p);
 		static void ExecSetVertexElement(void* p, uint32 flags);
-		static void ExecUpdate(void* p, const FBuf& buf, uint32 numInstances);
+		static void ExecUpdate(void* p, const uint32& numInstances, const void* buf, uint32 sz);
 	};
 }
\ No newline at end of file
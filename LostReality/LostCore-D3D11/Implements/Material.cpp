@@ -11,7 +11,7 @@
 #include "Material.h"
 #include "Implements/Texture.h"
 #include "Buffers/VertexDef.h"
-#include "States/DepthStencilStateDef.h"
+#include "States/StateObjectCache.h"
 
 using namespace D3D11;
 using namespace LostCore;
@@ -21,6 +21,8 @@ D3D11::FPrimitiveGroup::FPrimitiveGroup()
 	, IndexCount(0)
 	, Topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
 	, RenderOrder(ERenderOrder::Opacity)
+	, SortDepth(0.f)
+	, InstancingKey(0)
 {
 }
 
@@ -42,12 +44,11 @@ void D3D11::FPrimitiveGroup::Commit()
 {
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecCommit(this);
+		ExecCommit(this, &SortDepth, sizeof(SortDepth));
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, &ExecCommit));
+		FRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this, &SortDepth, sizeof(SortDepth));
 	}
 }
 
@@ -75,29 +76,27 @@ void D3D11::FPrimitiveGroup::ConstructVB(const void* buf, uint32 sz, uint32 stri
 {
 	assert(this->VertexBuffer.GetReference() == nullptr);
 
-	FBuf dst(sz);
-	memcpy(dst.data(), buf, sz);
+	const FBufferArgs args = { stride, dynamic };
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecConstructVB(this, dst, stride, dynamic);
+		ExecConstructVB(this, args, buf, sz);
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, bind(&ExecConstructVB, placeholders::_1, dst, stride, dynamic)));
+		FRenderContext::Get()->GetCommandArena().PushArgs(&ExecConstructVB, this, args, buf, sz);
 	}
 }
 
 void D3D11::FPrimitiveGroup::ConstructIB(const FBuf& buf, uint32 stride, bool dynamic)
 {
+	const FBufferArgs args = { stride, dynamic };
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecConstructIB(this, buf, stride, dynamic);
+		ExecConstructIB(this, args, buf.data(), buf.size());
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, bind(&ExecConstructIB, placeholders::_1, buf, stride, dynamic)));
+		FRenderContext::Get()->GetCommandArena().PushArgs(&ExecConstructIB, this, args, buf.data(), (uint32)buf.size());
 	}
 }
 
@@ -121,20 +120,61 @@ void D3D11::FPrimitiveGroup::SetTopology(EPrimitiveTopology topo)
 
 void D3D11::FPrimitiveGroup::UpdateVB(const void* buf, uint32 sz, uint32 stride)
 {
-	FBuf dst(sz);
-	memcpy(dst.data(), buf, sz);
+	const FBufferArgs args = { stride, true };
 	if (FRenderContext::Get()->InRenderThread())
 	{
-		ExecUpdateVB(this, dst, stride);
+		ExecUpdateVB(this, args, buf, sz);
 	}
 	else
 	{
-		FRenderContext::Get()->PushCommand(FContextCommand(
-			this, bind(&ExecUpdateVB, placeholders::_1, dst, stride)));
+		FRenderContext::Get()->GetCommandArena().PushArgs(&ExecUpdateVB, this, args, buf, sz);
 	}
 }
 
-void D3D11::FPrimitiveGroup::Draw(const vector<FInstancingData*>& batch)
+void D3D11::FPrimitiveGroup::SetSortDepth(float depth)
+{
+	SortDepth = depth;
+}
+
+void D3D11::FPrimitiveGroup::SetInstancingKey(uint32 key)
+{
+	InstancingKey = key;
+}
+
+uint32 D3D11::FPrimitiveGroup::GetInstancingKey() const
+{
+	return InstancingKey;
+}
+
+void D3D11::FPrimitiveGroup::DrawInstanced(ID3D11Buffer* instances, uint32 stride, uint32 offset, uint32 numInstances)
+{
+	assert(FRenderContext::Get()->InRenderThread());
+	const char* head = "D3D11::FPrimitiveGroup::DrawInstanced";
+	TRefCountPtr<ID3D11DeviceContext> cxt = FRenderContext::GetDeviceContext(head);
+	if (!cxt.IsValid() || numInstances == 0)
+	{
+		return;
+	}
+
+	ID3D11Buffer* vbs[] = { VertexBuffer.GetReference(), instances };
+	UINT strides[] = { Stride, stride };
+	UINT offsets[] = { 0, offset };
+
+	cxt->IASetVertexBuffers(0, 2, vbs, strides, offsets);
+	cxt->IASetIndexBuffer(IndexBuffer.GetReference(), IndexFormat, 0);
+	cxt->IASetPrimitiveTopology(Topology);
+
+	if (IndexBuffer.IsValid())
+	{
+		cxt->DrawIndexedInstanced(IndexCount, numInstances, 0, 0, 0);
+	}
+	else
+	{
+		cxt->DrawInstanced(Count, numInstances, 0, 0);
+	}
+}
+
+void D3D11::FPrimitiveGroup::Draw(FInstancingData* const* batch, uint32 num)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "D3D11::FPrimitiveGroup::Draw";
@@ -146,34 +186,36 @@ void D3D11::FPrimitiveGroup::Draw(const vector<FInstancingData*>& batch)
 
 	uint32 instanceCount = 0;
 
-	vector<ID3D11Buffer*> vbs;
-	vector<uint32> strides, offsets;
-	vbs.push_back(VertexBuffer.GetReference());
-	strides.push_back(Stride);
-	offsets.push_back(0);
-	for (auto& buf : batch)
+	ID3D11Buffer* vbs[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	UINT strides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	UINT offsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = { 0 };
+	assert(num < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+	vbs[0] = VertexBuffer.GetReference();
+	strides[0] = Stride;
+	for (uint32 index = 0; index < num; ++index)
 	{
+		auto buf = batch[index];
 		if (instanceCount == 0)
 		{
 			instanceCount = buf->GetNumInstances();
 		}
 
 		assert(instanceCount == buf->GetNumInstances());
-		vbs.push_back(buf->GetBuffer());
-		strides.push_back(buf->GetStride());
-		offsets.push_back(0);
+		vbs[index + 1] = buf->GetBuffer().GetReference();
+		strides[index + 1] = buf->GetStride();
 	}
 
-	if (!batch.empty() && instanceCount == 0)
+	if (num > 0 && instanceCount == 0)
 	{
 		return;
 	}
 
-	cxt->IASetVertexBuffers(0, vbs.size(), vbs.data(), strides.data(), offsets.data());
+	cxt->IASetVertexBuffers(0, num + 1, vbs, strides, offsets);
 	cxt->IASetIndexBuffer(IndexBuffer.GetReference(), IndexFormat, 0);
 	cxt->IASetPrimitiveTopology(Topology);
 
-	if (batch.empty())
+	if (num == 0)
 	{
 		if (IndexBuffer.IsValid())
 		{
@@ -202,42 +244,42 @@ TRefCountPtr<ID3D11Buffer> D3D11::FPrimitiveGroup::GetVertexBuffer()
 	return VertexBuffer;
 }
 
-void D3D11::FPrimitiveGroup::ExecCommit(void * p)
+void D3D11::FPrimitiveGroup::ExecCommit(void * p, const void* depth, uint32 sz)
 {
-	assert(FRenderContext::Get()->InRenderThread());
-	FRenderContext::Get()->CommitPrimitiveGroup((FPrimitiveGroup*)p);
+	assert(FRenderContext::Get()->InRenderThread() && sz == sizeof(float));
+	FRenderContext::Get()->CommitPrimitiveGroup((FPrimitiveGroup*)p, *(const float*)depth);
 }
 
-void D3D11::FPrimitiveGroup::ExecConstructVB(void* p, const FBuf& buf, uint32 stride, bool bDynamic)
+void D3D11::FPrimitiveGroup::ExecConstructVB(void* p, const FBufferArgs& args, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FPrimitiveGroup::ExecConstructVB";
 	TRefCountPtr<ID3D11Device> device = FRenderContext::GetDevice(head);
 	auto pthis = (FPrimitiveGroup*)p;
-	pthis->Stride = stride;
-	if (stride != 0)
+	pthis->Stride = args.Stride;
+	if (args.Stride != 0)
 	{
-		pthis->Count = buf.size() / stride;
+		pthis->Count = sz / args.Stride;
 	}
 	else
 	{
 		pthis->Count = 0;
 	}
 
-	pthis->bIsVBDynamic = bDynamic;
+	pthis->bIsVBDynamic = args.bDynamic;
 	auto pvb = pthis->VertexBuffer.GetReference();
 	assert(pthis->VertexBuffer.GetReference() == nullptr);
-	ConstructBuffer(device.GetReference(), buf.data(), buf.size(), pthis->bIsVBDynamic, D3D11_BIND_VERTEX_BUFFER, pthis->VertexBuffer);
+	ConstructBuffer(device.GetReference(), buf, sz, pthis->bIsVBDynamic, D3D11_BIND_VERTEX_BUFFER, pthis->VertexBuffer);
 }
 
-void D3D11::FPrimitiveGroup::ExecConstructIB(void* p, const FBuf & buf, uint32 stride, bool bDynamic)
+void D3D11::FPrimitiveGroup::ExecConstructIB(void* p, const FBufferArgs& args, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FPrimitiveGroup::ExecConstructIB";
 	TRefCountPtr<ID3D11Device> device = FRenderContext::GetDevice(head);
 	auto pthis = (FPrimitiveGroup*)p;
 
-	switch (stride)
+	switch (args.Stride)
 	{
 	case 2:
 		pthis->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -249,12 +291,12 @@ void D3D11::FPrimitiveGroup::ExecConstructIB(void* p, const FBuf & buf, uint32 s
 		break;
 	}
 
-	pthis->IndexCount = buf.size() / stride;
-	pthis->bIsIBDynamic = bDynamic;
-	CreatePrimitiveIndex(device.GetReference(), buf, pthis->bIsIBDynamic, pthis->IndexBuffer);
+	pthis->IndexCount = sz / args.Stride;
+	pthis->bIsIBDynamic = args.bDynamic;
+	CreatePrimitiveIndex(device.GetReference(), buf, sz, pthis->bIsIBDynamic, pthis->IndexBuffer);
 }
 
-void D3D11::FPrimitiveGroup::ExecUpdateVB(void* p, const FBuf& buf, uint32 stride)
+void D3D11::FPrimitiveGroup::ExecUpdateVB(void* p, const FBufferArgs& args, const void* buf, uint32 sz)
 {
 	assert(FRenderContext::Get()->InRenderThread());
 	const char* head = "FPrimitiveGroup::ExecUpdateVB";
@@ -265,10 +307,10 @@ void D3D11::FPrimitiveGroup::ExecUpdateVB(void* p, const FBuf& buf, uint32 strid
 	pthis->IndexBuffer = nullptr;
 
 	// µbytesvertex buffer´
-	if (!pthis->VertexBuffer.IsValid() || buf.size() > (pthis->Count * pthis->Stride))
+	if (!pthis->VertexBuffer.IsValid() || sz > (pthis->Count * pthis->Stride))
 	{
 		pthis->VertexBuffer = nullptr;
-		ExecConstructVB(pthis, buf, stride, true);
+		ExecConstructVB(pthis, args, buf, sz);
 	}
 	else
 	{
@@ -276,20 +318,20 @@ void D3D11::FPrimitiveGroup::ExecUpdateVB(void* p, const FBuf& buf, uint32 strid
 		{
 			D3D11_MAPPED_SUBRESOURCE mapped;
 			cxt->Map(pthis->VertexBuffer.GetReference(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-			memcpy(mapped.pData, buf.data(), buf.size());
+			memcpy(mapped.pData, buf, sz);
 			cxt->Unmap(pthis->VertexBuffer.GetReference(), 0);
 		}
 		else
 		{
-			pthis->Count = buf.size() / pthis->Stride;
+			pthis->Count = sz / pthis->Stride;
 			D3D11_BOX destRegion;
 			destRegion.left = 0;
-			destRegion.right = buf.size();
+			destRegion.right = sz;
 			destRegion.top = 0;
 			destRegion.bottom = 1;
 			destRegion.front = 0;
 			destRegion.back = 1;
-			cxt->UpdateSubresource(pthis->VertexBuffer.GetReference(), 0, &destRegion, buf.data(), 0, 0);
+			cxt->UpdateSubresource(pthis->VertexBuffer.GetReference(), 0, &destRegion, buf, 0, 0);
 		}
 	}
 }
\ No newline at end of file
@@ -14,7 +14,7 @@ namespace D3D11
 	class FPrimitiveGroup : public LostCore::IPrimitive
 	{
 	public:
-		MEMORY_ALLOC(FPrimitiveGroup);
+		MEMORY_ALLOC(PrimitiveGroup);
 
 		FPrimitiveGroup();
 		FPrimitiveGroup(const FPrimitiveGroup& rhs);
@@ -31,8 +31,15 @@ namespace D3D11
 		virtual void ConstructIB(const FBuf& buf, uint32 stride, bool dynamic) override;
 		virtual void SetTopology(LostCore::EPrimitiveTopology topo) override;
 		virtual void UpdateVB(const void* buf, uint32 sz, uint32 stride) override;
+		virtual void SetSortDepth(float depth) override;
+		virtual void SetInstancingKey(uint32 key) override;
 
-		void Draw(const vector<FInstancingData*>& batch);
+		uint32 GetInstancingKey() const;
+
+		void Draw(FInstancingData* const* batch, uint32 num);
+
+		// Instance stream in slot 1 from offset, world matrices of the merged draws.
+		void DrawInstanced(ID3D11Buffer* instances, uint32 stride, uint32 offset, uint32 numInstances);
 
 		TRefCountPtr<ID3D11Buffer> GetVertexBuffer();
 
@@ -52,10 +59,21 @@ namespace D3D11
 		ERenderOrder RenderOrder;
 		D3D11_PRIMITIVE_TOPOLOGY Topology;
 
+		// Caller thread, copied into the commit.
+		float SortDepth;
+		uint32 InstancingKey;
+
 	private:
-		static void ExecCommit(void* p);
-		static void ExecConstructVB(void* p, const FBuf& buf, uint32 stride, bool bDynamic);
-		static void ExecConstructIB(void* p, const FBuf& buf, uint32 stride, bool bDynamic);
-		static void ExecUpdateVB(void* p, const FBuf& buf, uint32 stride);
+		// Arguments of the buffer commands, the bytes follow them in the command arena.
+		struct FBufferArgs
+		{
+			uint32 Stride;
+			bool bDynamic;
+		};
+
+		static void ExecCommit(void* p, const void* depth, uint32 sz);
+		static void ExecConstructVB(void* p, const FBufferArgs& args, const void* buf, uint32 sz);
+		static void ExecConstructIB(void* p, const FBufferArgs& args, const void* buf, uint32 sz);
+		static void ExecUpdateVB(void* p, const FBufferArgs& args, const void* buf, uint32 sz);
 	};
 }
\ No newline at end of file
@@ -10,14 +10,13 @@
 #include "stdafx.h"
 #include "RenderContext.h"
 
-#include "States/BlendStateDef.h"
-#include "States/RasterizerStateDef.h"
-#include "States/DepthStencilStateDef.h"
-#include "States/SamplerStateDef.h"
+#include "States/StateObjectCache.h"
 
 #include "Pipelines/ForwardPipeline.h"
 #include "Pipelines/DeferredPipeline.h"
 
+#include "Src/ShaderManager.h"
+
 using namespace LostCore;
 
 D3D11::FRenderContext::FRenderContext()
@@ -28,7 +27,6 @@ D3D11::FRenderContext::FRenderContext()
 	, DepthStencil(nullptr)
 	, GlobalConstantBuffer(new FConstantBuffer)
 	, ActivedPipeline(nullptr)
-	, Commands(true)
 	, Initializer(nullptr)
 	, bIsThreadRunning(true)
 	, Thread(new FThread(this, "Render Context"))
@@ -61,20 +59,29 @@ void D3D11::FRenderContext::Tick()
 		return;
 	}
 
-	FCommandQueue<FContextCommand> cmds(false);
+	FCommandArena* cmds = nullptr;
 
 	{
 		static FStackCounterRequest SCounter("Sync reading");
 		FScopedStackCounterRequest scopedCounter(SCounter);
-		Commands.SyncRead(&cmds);
+		cmds = Commands.Read();
 	}
 
-	FContextCommand cmd;
-	while (cmds.Pop(cmd))
+	// Nothing committed yet, back to FThread so it can quit.
+	if (cmds == nullptr)
 	{
-		cmd.Exec();
+		return;
 	}
 
+	// Emptied here, the arena goes back to the game thread on the next Read.
+	cmds->Execute();
+
+	static FStackCounterRequest SCommands("Commands executed");
+	static FStackCounterRequest SCommandBytes("Command bytes");
+	SCommands.AddCount(cmds->GetStats().NumCommands);
+	SCommandBytes.AddCount(cmds->GetStats().NumBytes);
+	cmds->Reset();
+
 	BeginFrame();
 	RenderFrame();
 	EndFrame();
@@ -91,10 +98,12 @@ void D3D11::FRenderContext::Destroy()
 {
 	DestroyPipelines();
 	DestroyStateObjects();
+	FShaderManager::Get()->Destroy();
 
 	SAFE_DELETE(RenderTarget);
 	SAFE_DELETE(DepthStencil);
 	SAFE_DELETE(GlobalConstantBuffer);
+	ConstantBufferRing.Destroy();
 
 	SwapChain = nullptr;
 	Context = nullptr;
@@ -140,12 +149,36 @@ void D3D11::FRenderContext::FinishCommit()
 {
 	static FStackCounterRequest SCounter("Sync committing");
 	FScopedStackCounterRequest scopedCounter(SCounter);
-	Commands.SyncCommit();
+	Commands.Commit();
+}
+
+FCommandArena& D3D11::FRenderContext::GetCommandArena()
+{
+	return Commands.Ref();
+}
+
+D3D11::FConstantBufferRing& D3D11::FRenderContext::GetConstantBufferRing()
+{
+	return ConstantBufferRing;
+}
+
+D3D11::FDrawStats D3D11::FRenderContext::GetDrawStats() const
+{
+	return ActivedPipeline != nullptr ? ActivedPipeline->GetDrawStats() : FDrawStats();
 }
 
 void D3D11::FRenderContext::PushCommand(const FContextCommand & cmd)
 {
-	Commands.Ref().Push(cmd);
+	// Not POD, constructed in place and destructed once executed.
+	void* payload = Commands.Ref().Push(&ExecContextCommand, nullptr, sizeof(FContextCommand));
+	new (payload) FContextCommand(cmd);
+}
+
+void D3D11::FRenderContext::ExecContextCommand(void* p, const void* payload, uint32 size)
+{
+	auto cmd = (FContextCommand*)payload;
+	cmd->Exec();
+	cmd->~FContextCommand();
 }
 
 void D3D11::FRenderContext::ExecInitializeDevice(LostCore::EContextID id, HWND wnd, bool bWindowed, int32 width, int32 height)
@@ -154,6 +187,7 @@ void D3D11::FRenderContext::ExecInitializeDevice(LostCore::EContextID id, HWND w
 
 	ContextID = id;
 	D3D11::CreateDevice(ContextID, Device, Context);
+	ConstantBufferRing.Initialize();
 	GlobalConstantBuffer->SetShaderSlot(SHADER_SLOT_GLOBAL);
 	GlobalConstantBuffer->SetShaderFlags(SHADER_FLAG_VS | SHADER_FLAG_PS);
 	InitializeStateObjects();
@@ -210,6 +244,8 @@ void D3D11::FRenderContext::BeginFrame()
 
 void D3D11::FRenderContext::RenderFrame()
 {
+	// Slices committed since the last frame, one upload before any draw.
+	ConstantBufferRing.Flush();
 	ActivedPipeline->RenderFrame();
 }
 
@@ -219,16 +255,16 @@ void D3D11::FRenderContext::EndFrame()
 	SwapChain->Present(0, 0);
 }
 
-void D3D11::FRenderContext::CommitPrimitiveGroup(FPrimitiveGroup* pg)
+void D3D11::FRenderContext::CommitPrimitiveGroup(FPrimitiveGroup* pg, float sortDepth)
 {
 	assert(ActivedPipeline != nullptr);
-	ActivedPipeline->CommitPrimitiveGroup(pg);
+	ActivedPipeline->CommitPrimitiveGroup(pg, sortDepth);
 }
 
-void D3D11::FRenderContext::CommitBuffer(FConstantBuffer* buf)
+void D3D11::FRenderContext::CommitBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice)
 {
 	assert(ActivedPipeline != nullptr);
-	ActivedPipeline->CommitBuffer(buf);
+	ActivedPipeline->CommitBuffer(buf, slice);
 }
 
 void D3D11::FRenderContext::CommitShaderResource(FTexture2D* srv)
@@ -368,22 +404,15 @@ void D3D11::FRenderContext::ReportLiveObjects()
 
 void D3D11::FRenderContext::InitializeStateObjects()
 {
-	// Ҫʽĳʼ
-	//if (Device.IsValid())
-	//{
-	//	FBlendStateMap::Get()->Initialize();
-	//	FRasterizerStateMap::Get()->Initialize();
-	//	FDepthStencilStateMap::Get()->Initialize();
-	//	FSamplerStateMap::Get()->Initialize();
-	//}
+	if (Device.IsValid())
+	{
+		FStateObjectCache::Get()->Initialize();
+	}
 }
 
 void D3D11::FRenderContext::DestroyStateObjects()
 {
-	FBlendStateMap::Get()->ReleaseComObjects();
-	FRasterizerStateMap::Get()->ReleaseComObjects();
-	FDepthStencilStateMap::Get()->ReleaseComObjects();
-	FSamplerStateMap::Get()->ReleaseComObjects();
+	FStateObjectCache::Get()->ReleaseComObjects();
 }
 
 void D3D11::FRenderContext::InitializePipelines()
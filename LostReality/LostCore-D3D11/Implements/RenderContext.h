@@ -12,11 +12,13 @@
 //#include "Texture.h"
 //#include "ConstantBuffer.h"
 
+#include "ConstantBufferRing.h"
 #include "ConstantBuffer.h"
 #include "InstancingData.h"
 #include "PrimitiveGroup.h"
 #include "Texture.h"
 #include "GdiFont.h"
+#include "Pipelines/DrawList.h"
 
 namespace D3D11
 {
@@ -161,14 +163,23 @@ namespace D3D11
 			_mm_free(p);
 		}
 
-		void CommitPrimitiveGroup(FPrimitiveGroup* pg);
-		void CommitBuffer(FConstantBuffer* buf);
+		void CommitPrimitiveGroup(FPrimitiveGroup* pg, float sortDepth);
+		void CommitBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice);
 		void CommitShaderResource(FTexture2D* srv);
 		void CommitInstancingData(FInstancingData* buf);
 
 		thread::id GetThreadId() const;
 		bool InRenderThread() const;
 
+		// Producer side, the arena of the frame being built, executed and reset by the render thread.
+		LostCore::FCommandArena& GetCommandArena();
+
+		// Render thread, backs the constant buffers when offsets are supported.
+		FConstantBufferRing& GetConstantBufferRing();
+
+		// Render thread, draws and redundant binds of the last frame.
+		FDrawStats GetDrawStats() const;
+
 		void PushCommand(const FContextCommand& cmd);
 		void DeallocPrimitiveGroup(LostCore::IPrimitive* pg);
 		void DeallocInstancingData(LostCore::IInstancingData* data);
@@ -186,6 +197,8 @@ namespace D3D11
 		void InitializePipelines();
 		void DestroyPipelines();
 
+		static void ExecContextCommand(void* p, const void* payload, uint32 size);
+
 		LostCore::EContextID					ContextID;
 		TRefCountPtr<ID3D11Device>				Device;
 		TRefCountPtr<ID3D11DeviceContext>		Context;
@@ -195,6 +208,7 @@ namespace D3D11
 		D3D11_VIEWPORT							Viewport;
 		LostCore::FGlobalParameter				Param;
 		FConstantBuffer*						GlobalConstantBuffer;
+		FConstantBufferRing						ConstantBufferRing;
 
 		vector<FContextCommand>					UpdateGroup;
 
@@ -207,7 +221,7 @@ namespace D3D11
 		vector<LostCore::IFont*>				DeallocatingFonts;
 
 		function<void()>						Initializer;
-		LostCore::TSynchronizer<LostCore::FCommandQueue<FContextCommand>> Commands;
+		LostCore::TFramePipeline<LostCore::FCommandArena> Commands;
 		LostCore::FThread*						Thread;
 
 		atomic<bool>							bIsThreadRunning;
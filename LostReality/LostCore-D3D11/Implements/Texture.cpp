@@ -9,7 +9,7 @@
 
 #include "stdafx.h"
 #include "Texture.h"
-#include "States/SamplerStateDef.h"
+#include "States/StateObjectCache.h"
 
 using namespace LostCore;
 
@@ -121,7 +121,7 @@ bool D3D11::FTexture2D::Construct(
 	if (bIsShaderResource)
 	{
 		BindFlags |= D3D11_BIND_SHADER_RESOURCE;
-		Sampler = FSamplerStateMap::Get()->GetState(0);
+		Sampler = FStateObjectCache::Get()->GetSamplerState(0);
 	}
 
 	AccessFlags = 0x0;
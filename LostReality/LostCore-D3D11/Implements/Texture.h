@@ -14,7 +14,7 @@ namespace D3D11
 	class FTexture2D
 	{
 	public:
-		MEMORY_ALLOC(FTexture2D);
+		MEMORY_ALLOC(Texture);
 
 		FTexture2D();
 		~FTexture2D();
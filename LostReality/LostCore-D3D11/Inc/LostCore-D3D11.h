@@ -66,11 +66,55 @@ namespace D3D11 {
 		return SModuleHandle;
 	}
 
+	// Counters of the last frame of the null render context, written by its render thread as the frame ends.
+	struct FNullFrameStats
+	{
+		uint32 Frame;
+		uint32 NumCommands;
+		uint32 CommandBytes;
+		uint32 NumDraws;
+		uint32 NumInstances;
+		uint32 NumVertices;
+		uint32 NumIndices;
+		uint32 NumBufferCommits;
+		uint32 BufferBytes;
+		uint32 NumInstancingCommits;
+		uint32 NumTextureCommits;
+		uint32 UploadBytes;
+		uint32 NumFontUpdates;
+		double FrameSec;
+
+		FNullFrameStats() { memset(this, 0, sizeof(*this)); }
+	};
+
+	// Counters of the shader blob cache, PrecompileShaders adds the permutations and the seconds it took.
+	struct FShaderCacheStats
+	{
+		uint32 NumPermutations;
+		uint32 NumLoaded;
+		uint32 NumCompiled;
+		uint32 NumFailed;
+		uint32 NumWorkers;
+
+		// Preprocessing, loading and compiling, summed over the threads.
+		double ResolveSec;
+		double Sec;
+
+		FShaderCacheStats() { memset(this, 0, sizeof(*this)); }
+	};
+
 	EXPORT_WRAP_0_DCL(InitializeProcessUnique);
 	EXPORT_WRAP_0_DCL(DestroyProcessUnique);
 	EXPORT_WRAP_1_DCL(SetProcessUnique, void*);
 	EXPORT_WRAP_1_DCL(CreateRenderContext, LostCore::IRenderContext**);
 	EXPORT_WRAP_1_DCL(DestroyRenderContext, LostCore::IRenderContext*);
+
+	// Same resources and render thread without a device, created instead of CreateRenderContext.
+	EXPORT_WRAP_1_DCL(CreateNullRenderContext, LostCore::IRenderContext**);
+	EXPORT_WRAP_1_DCL(GetNullFrameStats, D3D11::FNullFrameStats*);
+
+	// Offline, without a render context, every shader permutation into the blob cache.
+	EXPORT_WRAP_1_DCL(PrecompileShaders, D3D11::FShaderCacheStats*);
 	EXPORT_WRAP_1_DCL(CreatePrimitiveGroup, LostCore::IPrimitive**);
 	EXPORT_WRAP_1_DCL(DestroyPrimitiveGroup, LostCore::IPrimitive*);
 	EXPORT_WRAP_1_DCL(CreateInstancingData, LostCore::IInstancingData**);
@@ -0,0 +1,518 @@
+/*
+* file NullImplements.cpp
+*
+* author luoxw
+* date 2018/03/28
+*
+*
+*/
+
+#include "stdafx.h"
+#include "NullRenderContext.h"
+
+using namespace LostCore;
+
+/********************************************************
+Primitive group
+*/
+
+D3D11::FNullPrimitiveGroup::FNullPrimitiveGroup()
+	: Flags(0)
+	, RenderOrder(ERenderOrder::Opacity)
+	, Topology(EPrimitiveTopology::TriangleList)
+	, Stride(0)
+	, Count(0)
+	, IndexStride(0)
+	, IndexCount(0)
+	, SortDepth(0.f)
+	, InstancingKey(0)
+{
+}
+
+D3D11::FNullPrimitiveGroup::~FNullPrimitiveGroup()
+{
+}
+
+void D3D11::FNullPrimitiveGroup::Commit()
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecCommit(this, &SortDepth, sizeof(SortDepth));
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this, &SortDepth, sizeof(SortDepth));
+	}
+}
+
+void D3D11::FNullPrimitiveGroup::SetVertexElement(uint32 flags)
+{
+	Flags = flags;
+}
+
+uint32 D3D11::FNullPrimitiveGroup::GetFlags() const
+{
+	return Flags;
+}
+
+void D3D11::FNullPrimitiveGroup::SetRenderOrder(ERenderOrder ro)
+{
+	RenderOrder = ro;
+}
+
+ERenderOrder D3D11::FNullPrimitiveGroup::GetRenderOrder() const
+{
+	return RenderOrder;
+}
+
+void D3D11::FNullPrimitiveGroup::ConstructVB(const void* buf, uint32 sz, uint32 stride, bool dynamic)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecConstructVB(this, stride, buf, sz);
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().PushArgs(&ExecConstructVB, this, stride, buf, sz);
+	}
+}
+
+void D3D11::FNullPrimitiveGroup::ConstructIB(const FBuf& buf, uint32 stride, bool dynamic)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecConstructIB(this, stride, buf.data(), (uint32)buf.size());
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().PushArgs(&ExecConstructIB, this, stride, buf.data(), (uint32)buf.size());
+	}
+}
+
+void D3D11::FNullPrimitiveGroup::SetTopology(EPrimitiveTopology topo)
+{
+	Topology = topo;
+}
+
+void D3D11::FNullPrimitiveGroup::UpdateVB(const void* buf, uint32 sz, uint32 stride)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecUpdateVB(this, stride, buf, sz);
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().PushArgs(&ExecUpdateVB, this, stride, buf, sz);
+	}
+}
+
+void D3D11::FNullPrimitiveGroup::SetSortDepth(float depth)
+{
+	SortDepth = depth;
+}
+
+void D3D11::FNullPrimitiveGroup::SetInstancingKey(uint32 key)
+{
+	InstancingKey = key;
+}
+
+uint32 D3D11::FNullPrimitiveGroup::GetInstancingKey() const
+{
+	return InstancingKey;
+}
+
+EPrimitiveTopology D3D11::FNullPrimitiveGroup::GetTopology() const
+{
+	return Topology;
+}
+
+const FBuf& D3D11::FNullPrimitiveGroup::GetVertices() const
+{
+	return Vertices;
+}
+
+const FBuf& D3D11::FNullPrimitiveGroup::GetIndices() const
+{
+	return Indices;
+}
+
+uint32 D3D11::FNullPrimitiveGroup::GetVertexCount() const
+{
+	return Count;
+}
+
+uint32 D3D11::FNullPrimitiveGroup::GetIndexCount() const
+{
+	return IndexCount;
+}
+
+void D3D11::FNullPrimitiveGroup::ExecCommit(void* p, const void* depth, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread() && sz == sizeof(float));
+	FNullRenderContext::Get()->CommitPrimitiveGroup((FNullPrimitiveGroup*)p, *(const float*)depth);
+}
+
+void D3D11::FNullPrimitiveGroup::ExecConstructVB(void* p, const uint32& stride, const void* buf, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullPrimitiveGroup*)p;
+	pthis->Stride = stride;
+	pthis->Count = stride != 0 ? sz / stride : 0;
+	pthis->Vertices.assign((const uint8*)buf, (const uint8*)buf + sz);
+	FNullRenderContext::Get()->AddUploadBytes(sz);
+}
+
+void D3D11::FNullPrimitiveGroup::ExecConstructIB(void* p, const uint32& stride, const void* buf, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullPrimitiveGroup*)p;
+	pthis->IndexStride = stride;
+	pthis->IndexCount = stride != 0 ? sz / stride : 0;
+	pthis->Indices.assign((const uint8*)buf, (const uint8*)buf + sz);
+	FNullRenderContext::Get()->AddUploadBytes(sz);
+}
+
+void D3D11::FNullPrimitiveGroup::ExecUpdateVB(void* p, const uint32& stride, const void* buf, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullPrimitiveGroup*)p;
+
+	// As FPrimitiveGroup, the indices are released.
+	pthis->Indices.clear();
+	pthis->IndexStride = 0;
+	pthis->IndexCount = 0;
+
+	ExecConstructVB(p, stride, buf, sz);
+}
+
+/********************************************************
+Constant buffer
+*/
+
+D3D11::FNullConstantBuffer::FNullConstantBuffer()
+	: ByteWidth(0)
+	, ShaderSlot(0)
+	, ShaderFlags(0)
+{
+}
+
+D3D11::FNullConstantBuffer::~FNullConstantBuffer()
+{
+}
+
+bool D3D11::FNullConstantBuffer::Initialize(int32 byteWidth, bool dynamic)
+{
+	ByteWidth = LostCore::GetAlignedSize(byteWidth, 16);
+	return true;
+}
+
+void D3D11::FNullConstantBuffer::UpdateBuffer(const FBuf& buf)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecUpdateBuffer(this, buf.data(), (uint32)buf.size());
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().Push(&ExecUpdateBuffer, this, buf.data(), (uint32)buf.size());
+	}
+}
+
+void D3D11::FNullConstantBuffer::Commit()
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecCommit(this);
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this);
+	}
+}
+
+void D3D11::FNullConstantBuffer::SetShaderSlot(int32 slot)
+{
+	ShaderSlot = slot;
+}
+
+int32 D3D11::FNullConstantBuffer::GetShaderSlot() const
+{
+	return ShaderSlot;
+}
+
+void D3D11::FNullConstantBuffer::SetShaderFlags(int32 flags)
+{
+	ShaderFlags = flags;
+}
+
+int32 D3D11::FNullConstantBuffer::GetShaderFlags() const
+{
+	return ShaderFlags;
+}
+
+const FBuf& D3D11::FNullConstantBuffer::GetData() const
+{
+	return Data;
+}
+
+void D3D11::FNullConstantBuffer::ExecUpdateBuffer(void* p, const void* buf, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullConstantBuffer*)p;
+	pthis->ByteWidth = LostCore::GetAlignedSize(sz, 16);
+	pthis->Data.assign((const uint8*)buf, (const uint8*)buf + sz);
+}
+
+void D3D11::FNullConstantBuffer::ExecCommit(void* p)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	FNullRenderContext::Get()->CommitBuffer((FNullConstantBuffer*)p);
+}
+
+/********************************************************
+Instancing data
+*/
+
+D3D11::FNullInstancingData::FNullInstancingData()
+	: Flags(0)
+	, NumInstances(0)
+	, Stride(0)
+{
+}
+
+D3D11::FNullInstancingData::~FNullInstancingData()
+{
+}
+
+void D3D11::FNullInstancingData::Commit()
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecCommit(this);
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().Push(&ExecCommit, this);
+	}
+}
+
+void D3D11::FNullInstancingData::SetVertexElement(uint32 flags)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecSetVertexElement(this, flags);
+	}
+	else
+	{
+		FNullRenderContext::Get()->PushCommand(FContextCommand(
+			this, bind(&ExecSetVertexElement, placeholders::_1, flags)));
+	}
+}
+
+void D3D11::FNullInstancingData::Update(const void* buf, uint32 sz, uint32 numInstances)
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecUpdate(this, numInstances, buf, sz);
+	}
+	else
+	{
+		FNullRenderContext::Get()->GetCommandArena().PushArgs(&ExecUpdate, this, numInstances, buf, sz);
+	}
+}
+
+uint32 D3D11::FNullInstancingData::GetFlags() const
+{
+	return Flags;
+}
+
+const FBuf& D3D11::FNullInstancingData::GetData() const
+{
+	return Data;
+}
+
+uint32 D3D11::FNullInstancingData::GetNumInstances() const
+{
+	return NumInstances;
+}
+
+uint32 D3D11::FNullInstancingData::GetStride() const
+{
+	return Stride;
+}
+
+void D3D11::FNullInstancingData::ExecCommit(void* p)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	FNullRenderContext::Get()->CommitInstancingData((FNullInstancingData*)p);
+}
+
+void D3D11::FNullInstancingData::ExecSetVertexElement(void* p, uint32 flags)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	((FNullInstancingData*)p)->Flags = flags;
+}
+
+void D3D11::FNullInstancingData::ExecUpdate(void* p, const uint32& numInstances, const void* buf, uint32 sz)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullInstancingData*)p;
+	pthis->Data.assign((const uint8*)buf, (const uint8*)buf + sz);
+	pthis->NumInstances = numInstances;
+	if (numInstances != 0)
+	{
+		pthis->Stride = sz / numInstances;
+	}
+
+	FNullRenderContext::Get()->AddUploadBytes(sz);
+}
+
+/********************************************************
+Font
+*/
+
+D3D11::FNullFont::FNullFont()
+	: PendingConfig(nullptr)
+{
+	assert(!FNullRenderContext::Get()->InRenderThread());
+	FNullRenderContext::Get()->AddUpdateCommand(FContextCommand(this, &ExecUpdate));
+}
+
+D3D11::FNullFont::~FNullFont()
+{
+	Destroy();
+}
+
+void D3D11::FNullFont::SetConfig(const LostCore::FFontConfig & config)
+{
+	assert(!FNullRenderContext::Get()->InRenderThread());
+	lock_guard<mutex> lck(Mutex);
+	SAFE_DELETE(PendingConfig);
+	PendingConfig = new FFontConfig(config);
+}
+
+void D3D11::FNullFont::RequestCharacters(const wstring characters)
+{
+	assert(!FNullRenderContext::Get()->InRenderThread());
+	lock_guard<mutex> lck(Mutex);
+	PendingCharacters.append(characters);
+}
+
+void D3D11::FNullFont::AddClient(IFontClient * client)
+{
+	assert(!FNullRenderContext::Get()->InRenderThread());
+	lock_guard<mutex> lck(Mutex);
+	Clients.push_back(client);
+}
+
+void D3D11::FNullFont::RemoveClient(IFontClient * client)
+{
+	assert(!FNullRenderContext::Get()->InRenderThread());
+	lock_guard<mutex> lck(Mutex);
+	auto it = find(Clients.begin(), Clients.end(), client);
+	if (it != Clients.end())
+	{
+		Clients.erase(it);
+	}
+}
+
+void D3D11::FNullFont::CommitShaderResource()
+{
+	if (FNullRenderContext::Get()->InRenderThread())
+	{
+		ExecCommitShaderResource(this);
+	}
+	else
+	{
+		FNullRenderContext::Get()->PushCommand(FContextCommand(this, &FNullFont::ExecCommitShaderResource));
+	}
+}
+
+void D3D11::FNullFont::Destroy()
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	FNullRenderContext::Get()->RemoveUpdateCommand(FContextCommand(this, &FNullFont::ExecUpdate));
+	SAFE_DELETE(PendingConfig);
+}
+
+void D3D11::FNullFont::ExecUpdate(void* p)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	auto pthis = (FNullFont*)p;
+	if (pthis->Reload())
+	{
+		FNullRenderContext::Get()->AddFontUpdate();
+	}
+
+	// Every frame as FGdiFont, FFontProvider swaps the descriptions on each commit.
+	for (auto& client : pthis->Clients)
+	{
+		client->OnFontUpdated(pthis->TextureDescription, pthis->CharacterDescriptions);
+	}
+}
+
+void D3D11::FNullFont::ExecCommitShaderResource(void* p)
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+	FNullRenderContext::Get()->CommitShaderResource();
+}
+
+// True when the characters or the config changed, rows of cells half as wide as high.
+bool D3D11::FNullFont::Reload()
+{
+	assert(FNullRenderContext::Get()->InRenderThread());
+
+	bool dirtConfig = false;
+	set<WCHAR> inputChars;
+	{
+		lock_guard<mutex> lck(Mutex);
+		inputChars.insert(PendingCharacters.begin(), PendingCharacters.end());
+		PendingCharacters.clear();
+		if (PendingConfig != nullptr)
+		{
+			Config = *PendingConfig;
+			SAFE_DELETE(PendingConfig);
+			dirtConfig = true;
+		}
+	}
+
+	inputChars.insert(Characters.begin(), Characters.end());
+	if (!dirtConfig && Characters == inputChars)
+	{
+		return false;
+	}
+
+	const int32 charHeight = max((int32)Config.Height, 1);
+	const int32 charWidth = max(charHeight / 2, 1);
+
+	auto& td = TextureDescription;
+	td.TextureWidth = STexWidth;
+	td.SpaceWidth = charWidth;
+
+	Characters.swap(inputChars);
+	CharacterDescriptions.clear();
+
+	int32 currX = 0;
+	int32 currY = 0;
+	for (auto wc : Characters)
+	{
+		if (wc == ' ')
+		{
+			continue;
+		}
+
+		if (currX + charWidth >= td.TextureWidth)
+		{
+			currX = 0;
+			currY += charHeight + 1;
+		}
+
+		CharacterDescriptions.insert(FCharacterDescription(wc, currX, currY, charWidth, charHeight));
+		currX += charWidth + 1;
+	}
+
+	CharacterDescriptions.insert(FCharacterDescription(' ', 0, 0, charWidth, charHeight));
+	td.TextureHeight = currY + charHeight + 1;
+	FNullRenderContext::Get()->AddUploadBytes(td.TextureWidth * td.TextureHeight * 4);
+	return true;
+}
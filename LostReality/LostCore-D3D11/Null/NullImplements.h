@@ -0,0 +1,173 @@
+/*
+* file NullImplements.h
+*
+* author luoxw
+* date 2018/03/28
+*
+* Resources of FNullRenderContext, the interfaces of the device objects over plain memory.
+* Calls go to the render thread through the command arena as the device objects do,
+* the contents are kept so the recorded frame can be inspected.
+*/
+
+#pragma once
+
+namespace D3D11
+{
+	class FNullPrimitiveGroup : public LostCore::IPrimitive
+	{
+	public:
+		MEMORY_ALLOC(PrimitiveGroup);
+
+		FNullPrimitiveGroup();
+		FNullPrimitiveGroup(const FNullPrimitiveGroup& rhs) = delete;
+		FNullPrimitiveGroup(FNullPrimitiveGroup&& rhs) = delete;
+		virtual ~FNullPrimitiveGroup() override;
+
+		// Inherited via IPrimitive
+		virtual void Commit() override;
+		virtual void SetVertexElement(uint32 flags) override;
+		virtual uint32 GetFlags() const override;
+		virtual void SetRenderOrder(ERenderOrder ro) override;
+		virtual ERenderOrder GetRenderOrder() const override;
+		virtual void ConstructVB(const void* buf, uint32 sz, uint32 stride, bool dynamic) override;
+		virtual void ConstructIB(const FBuf& buf, uint32 stride, bool dynamic) override;
+		virtual void SetTopology(LostCore::EPrimitiveTopology topo) override;
+		virtual void UpdateVB(const void* buf, uint32 sz, uint32 stride) override;
+		virtual void SetSortDepth(float depth) override;
+		virtual void SetInstancingKey(uint32 key) override;
+
+		uint32 GetInstancingKey() const;
+		LostCore::EPrimitiveTopology GetTopology() const;
+
+		// Render thread.
+		const FBuf& GetVertices() const;
+		const FBuf& GetIndices() const;
+		uint32 GetVertexCount() const;
+		uint32 GetIndexCount() const;
+
+	private:
+		uint32 Flags;
+		ERenderOrder RenderOrder;
+		LostCore::EPrimitiveTopology Topology;
+
+		FBuf Vertices;
+		uint32 Stride;
+		uint32 Count;
+
+		FBuf Indices;
+		uint32 IndexStride;
+		uint32 IndexCount;
+
+		// Caller thread, copied into the commit.
+		float SortDepth;
+		uint32 InstancingKey;
+
+	private:
+		static void ExecCommit(void* p, const void* depth, uint32 sz);
+		static void ExecConstructVB(void* p, const uint32& stride, const void* buf, uint32 sz);
+		static void ExecConstructIB(void* p, const uint32& stride, const void* buf, uint32 sz);
+		static void ExecUpdateVB(void* p, const uint32& stride, const void* buf, uint32 sz);
+	};
+
+	class FNullConstantBuffer : public LostCore::IConstantBuffer
+	{
+	public:
+		MEMORY_ALLOC(ConstantBuffer);
+
+		FNullConstantBuffer();
+		FNullConstantBuffer(const FNullConstantBuffer& rhs) = delete;
+		FNullConstantBuffer(FNullConstantBuffer&& rhs) = delete;
+		virtual ~FNullConstantBuffer() override;
+
+		// Inherited via IConstantBuffer
+		virtual bool Initialize(int32 byteWidth, bool dynamic) override;
+		virtual void UpdateBuffer(const FBuf& buf) override;
+		virtual void Commit() override;
+
+		virtual void SetShaderSlot(int32 slot) override;
+		virtual int32 GetShaderSlot() const override;
+
+		virtual void SetShaderFlags(int32 flags) override;
+		virtual int32 GetShaderFlags() const override;
+
+		// Render thread, the latest content.
+		const FBuf& GetData() const;
+
+	private:
+		int32		ByteWidth;
+		int32		ShaderSlot;
+		int32		ShaderFlags;
+		FBuf		Data;
+
+	private:
+		static void ExecUpdateBuffer(void* p, const void* buf, uint32 sz);
+		static void ExecCommit(void* p);
+	};
+
+	class FNullInstancingData : public LostCore::IInstancingData
+	{
+	public:
+		MEMORY_ALLOC(InstancingData);
+
+		FNullInstancingData();
+		FNullInstancingData(const FNullInstancingData& rhs) = delete;
+		FNullInstancingData(FNullInstancingData&& rhs) = delete;
+		virtual ~FNullInstancingData() override;
+
+		// Inherited via IInstancingData
+		virtual void Commit() override;
+		virtual void SetVertexElement(uint32 flags) override;
+		virtual void Update(const void* buf, uint32 sz, uint32 numInstances) override;
+
+		// Render thread.
+		uint32 GetFlags() const;
+		const FBuf& GetData() const;
+		uint32 GetNumInstances() const;
+		uint32 GetStride() const;
+
+	private:
+		uint32 Flags;
+		FBuf Data;
+		uint32 NumInstances;
+		uint32 Stride;
+
+	private:
+		static void ExecCommit(void* p);
+		static void ExecSetVertexElement(void* p, uint32 flags);
+		static void ExecUpdate(void* p, const uint32& numInstances, const void* buf, uint32 sz);
+	};
+
+	// Glyphs laid out as fixed cells in the tile texture of FGdiFont, no gdi and no texture.
+	class FNullFont : public LostCore::IFont
+	{
+	public:
+		FNullFont();
+		virtual ~FNullFont() override;
+
+		// Inherited via IFont
+		virtual void SetConfig(const LostCore::FFontConfig& config) override;
+		virtual void RequestCharacters(const wstring characters) override;
+		virtual void AddClient(LostCore::IFontClient* client) override;
+		virtual void RemoveClient(LostCore::IFontClient* client) override;
+		virtual void CommitShaderResource() override;
+
+	private:
+		bool Reload();
+		void Destroy();
+
+		static void ExecUpdate(void* p);
+		static void ExecCommitShaderResource(void* p);
+
+	private:
+		LostCore::FFontConfig Config;
+		set<WCHAR> Characters;
+		set<LostCore::FCharacterDescription> CharacterDescriptions;
+		LostCore::FFontTextureDescription TextureDescription;
+
+		LostCore::FFontConfig* PendingConfig;
+		wstring PendingCharacters;
+		mutex Mutex;
+
+		vector<LostCore::IFontClient*> Clients;
+	};
+}
@@ -0,0 +1,443 @@
+/*
+* file NullRenderContext.cpp
+*
+* author luoxw
+* date 2018/03/28
+*
+*
+*/
+
+#include "stdafx.h"
+#include "NullRenderContext.h"
+
+using namespace LostCore;
+
+D3D11::FNullRenderContext::FNullRenderContext()
+	: ContextID(EContextID::Undefined)
+	, GlobalConstantBuffer(new FNullConstantBuffer)
+	, bIsInitialized(false)
+	, NumPendingInstancings(0)
+	, Initializer(nullptr)
+	, LastFrameStamp(FPerformanceCounter::GetTimeStamp())
+	, bIsThreadRunning(true)
+	, Thread(new FThread(this, "Null Render Context"))
+{
+}
+
+D3D11::FNullRenderContext::~FNullRenderContext()
+{
+	if (bIsThreadRunning)
+	{
+		SAFE_DELETE(Thread);
+	}
+
+	// Deleted through the interface as well as by DestroyRenderContext.
+	if (Get() == this)
+	{
+		Get() = nullptr;
+	}
+}
+
+bool D3D11::FNullRenderContext::Initialize()
+{
+	return true;
+}
+
+void D3D11::FNullRenderContext::Tick()
+{
+	if (Initializer != nullptr)
+	{
+		Initializer();
+		Initializer = nullptr;
+	}
+
+	if (!bIsInitialized)
+	{
+		return;
+	}
+
+	FCommandArena* cmds = nullptr;
+
+	{
+		static FStackCounterRequest SCounter("Sync reading");
+		FScopedStackCounterRequest scopedCounter(SCounter);
+		cmds = Commands.Read();
+	}
+
+	// Nothing committed yet, back to FThread so it can quit.
+	if (cmds == nullptr)
+	{
+		return;
+	}
+
+	// The records are cleared before the commands of the frame fill them.
+	BeginFrame();
+
+	cmds->Execute();
+	Stats.NumCommands = cmds->GetStats().NumCommands;
+	Stats.CommandBytes = cmds->GetStats().NumBytes;
+	cmds->Reset();
+
+	RenderFrame();
+	EndFrame();
+
+	for (auto& item : UpdateGroup)
+	{
+		item.Exec();
+	}
+
+	FlushDeallocating();
+}
+
+void D3D11::FNullRenderContext::Destroy()
+{
+	FlushDeallocating();
+	SAFE_DELETE(GlobalConstantBuffer);
+
+	Draws.clear();
+	BufferCommits.clear();
+	BufferData.clear();
+	DrawBuffers.clear();
+	Instancings.clear();
+	StickyBuffers.clear();
+
+	bIsInitialized = false;
+	bIsThreadRunning = false;
+}
+
+bool D3D11::FNullRenderContext::IsThreadPrivate() const
+{
+	return false;
+}
+
+bool D3D11::FNullRenderContext::IsLoop() const
+{
+	return true;
+}
+
+void D3D11::FNullRenderContext::InitializeDevice(LostCore::EContextID id, HWND wnd, bool bWindowed, int32 width, int32 height)
+{
+	Initializer = [=]()
+	{
+		ExecInitializeDevice(id, width, height);
+	};
+}
+
+void D3D11::FNullRenderContext::SetViewProjectMatrix(const FFloat4x4 & vp)
+{
+	Param.ViewProject = vp;
+}
+
+void D3D11::FNullRenderContext::FirstCommit()
+{
+	FBuf buf;
+	Param.GetBuffer(buf);
+	GlobalConstantBuffer->UpdateBuffer(buf);
+	GlobalConstantBuffer->Commit();
+}
+
+void D3D11::FNullRenderContext::FinishCommit()
+{
+	static FStackCounterRequest SCounter("Sync committing");
+	FScopedStackCounterRequest scopedCounter(SCounter);
+	Commands.Commit();
+}
+
+void D3D11::FNullRenderContext::CommitPrimitiveGroup(FNullPrimitiveGroup* pg, float sortDepth)
+{
+	assert(InRenderThread());
+
+	FNullDraw draw;
+	draw.Primitive = pg;
+	draw.SortDepth = sortDepth;
+	draw.InstancingKey = pg->GetInstancingKey();
+	draw.NumVertices = pg->GetVertexCount();
+	draw.NumIndices = pg->GetIndexCount();
+	draw.NumInstances = 1;
+	draw.FirstBuffer = (uint32)DrawBuffers.size();
+	draw.NumBuffers = (uint32)StickyBuffers.size();
+	draw.FirstInstancing = (uint32)Instancings.size() - NumPendingInstancings;
+	draw.NumInstancings = NumPendingInstancings;
+	draw.RenderOrder = pg->GetRenderOrder();
+	NumPendingInstancings = 0;
+
+	// As FPrimitiveGroup::Draw, the instance count comes from the streams bound with it.
+	if (draw.NumInstancings > 0)
+	{
+		draw.NumInstances = Instancings[draw.FirstInstancing]->GetNumInstances();
+	}
+
+	for (auto& item : StickyBuffers)
+	{
+		DrawBuffers.push_back(item.second);
+	}
+
+	Draws.push_back(draw);
+}
+
+void D3D11::FNullRenderContext::CommitBuffer(FNullConstantBuffer* buf)
+{
+	assert(InRenderThread());
+
+	const FBuf& data = buf->GetData();
+
+	FNullBufferCommit commit;
+	commit.Buffer = buf;
+	commit.ShaderSlot = buf->GetShaderSlot();
+	commit.Offset = (uint32)BufferData.size();
+	commit.Size = (uint32)data.size();
+
+	BufferData.insert(BufferData.end(), data.begin(), data.end());
+	StickyBuffers[commit.ShaderSlot] = (uint32)BufferCommits.size();
+	BufferCommits.push_back(commit);
+
+	Stats.NumBufferCommits++;
+	Stats.BufferBytes += commit.Size;
+}
+
+void D3D11::FNullRenderContext::CommitInstancingData(FNullInstancingData* data)
+{
+	assert(InRenderThread());
+	Instancings.push_back(data);
+	NumPendingInstancings++;
+	Stats.NumInstancingCommits++;
+}
+
+void D3D11::FNullRenderContext::CommitShaderResource()
+{
+	assert(InRenderThread());
+	Stats.NumTextureCommits++;
+}
+
+void D3D11::FNullRenderContext::AddUploadBytes(uint32 sz)
+{
+	Stats.UploadBytes += sz;
+}
+
+void D3D11::FNullRenderContext::AddFontUpdate()
+{
+	Stats.NumFontUpdates++;
+}
+
+thread::id D3D11::FNullRenderContext::GetThreadId() const
+{
+	return Thread->GetId();
+}
+
+bool D3D11::FNullRenderContext::InRenderThread() const
+{
+	return this_thread::get_id() == GetThreadId();
+}
+
+FCommandArena& D3D11::FNullRenderContext::GetCommandArena()
+{
+	return Commands.Ref();
+}
+
+const vector<D3D11::FNullDraw>& D3D11::FNullRenderContext::GetDraws() const
+{
+	return Draws;
+}
+
+const vector<D3D11::FNullBufferCommit>& D3D11::FNullRenderContext::GetBufferCommits() const
+{
+	return BufferCommits;
+}
+
+const vector<uint32>& D3D11::FNullRenderContext::GetDrawBuffers() const
+{
+	return DrawBuffers;
+}
+
+const FBuf& D3D11::FNullRenderContext::GetBufferData() const
+{
+	return BufferData;
+}
+
+D3D11::FNullFrameStats D3D11::FNullRenderContext::GetFrameStats() const
+{
+	lock_guard<mutex> lck(StatsMutex);
+	return LastStats;
+}
+
+void D3D11::FNullRenderContext::PushCommand(const FContextCommand & cmd)
+{
+	// Not POD, constructed in place and destructed once executed.
+	void* payload = Commands.Ref().Push(&ExecContextCommand, nullptr, sizeof(FContextCommand));
+	new (payload) FContextCommand(cmd);
+}
+
+void D3D11::FNullRenderContext::ExecContextCommand(void* p, const void* payload, uint32 size)
+{
+	auto cmd = (FContextCommand*)payload;
+	cmd->Exec();
+	cmd->~FContextCommand();
+}
+
+void D3D11::FNullRenderContext::ExecInitializeDevice(LostCore::EContextID id, int32 width, int32 height)
+{
+	assert(InRenderThread());
+
+	ContextID = id;
+	GlobalConstantBuffer->SetShaderSlot(SHADER_SLOT_GLOBAL);
+	GlobalConstantBuffer->SetShaderFlags(SHADER_FLAG_VS | SHADER_FLAG_PS);
+
+	Param.ScreenWidth = (float)width;
+	Param.ScreenHeight = (float)height;
+	Param.ScreenWidthRcp = (float)1.f / width;
+	Param.ScreenHeightRcp = (float)1.f / height;
+
+	bIsInitialized = true;
+}
+
+void D3D11::FNullRenderContext::BeginFrame()
+{
+	Draws.clear();
+	BufferCommits.clear();
+	BufferData.clear();
+	DrawBuffers.clear();
+	Instancings.clear();
+	NumPendingInstancings = 0;
+
+	// Bindings stay in effect across frames on a device, the recorded contents do not.
+	StickyBuffers.clear();
+}
+
+// Counts the committed primitives, one draw each. The forward pipeline merges instanced primitives
+// through FDrawList and issues fewer draws than this.
+void D3D11::FNullRenderContext::RenderFrame()
+{
+	static FStackCounterRequest SCounter("FNullRenderContext::RenderFrame");
+	FScopedStackCounterRequest scopedCounter(SCounter);
+
+	for (auto& draw : Draws)
+	{
+		Stats.NumDraws++;
+		Stats.NumInstances += draw.NumInstances;
+		Stats.NumVertices += draw.NumVertices * draw.NumInstances;
+		Stats.NumIndices += draw.NumIndices * draw.NumInstances;
+	}
+
+	static FStackCounterRequest SCommitted("Draws committed");
+	SCommitted.AddCount(Stats.NumDraws);
+}
+
+void D3D11::FNullRenderContext::EndFrame()
+{
+	Stats.FrameSec = FPerformanceCounter::GetSeconds(LastFrameStamp);
+	LastFrameStamp = FPerformanceCounter::GetTimeStamp();
+
+	{
+		lock_guard<mutex> lck(StatsMutex);
+		Stats.Frame = LastStats.Frame + 1;
+		LastStats = Stats;
+	}
+
+	Stats = FNullFrameStats();
+}
+
+void D3D11::FNullRenderContext::DeallocPrimitiveGroup(LostCore::IPrimitive* pg)
+{
+	if (InRenderThread())
+	{
+		DeallocatingPrimitiveGroups.push_back(pg);
+	}
+	else
+	{
+		PushCommand(FContextCommand(this, [=](void* p) {
+			((FNullRenderContext*)p)->DeallocatingPrimitiveGroups.push_back(pg);
+		}));
+	}
+}
+
+void D3D11::FNullRenderContext::DeallocInstancingData(LostCore::IInstancingData* data)
+{
+	if (InRenderThread())
+	{
+		DeallocatingInstancingDatas.push_back(data);
+	}
+	else
+	{
+		PushCommand(FContextCommand(this, [=](void* p) {
+			((FNullRenderContext*)p)->DeallocatingInstancingDatas.push_back(data);
+		}));
+	}
+}
+
+void D3D11::FNullRenderContext::DeallocConstantBuffer(LostCore::IConstantBuffer * cb)
+{
+	if (InRenderThread())
+	{
+		DeallocatingConstantBuffers.push_back(cb);
+	}
+	else
+	{
+		PushCommand(FContextCommand(this, [=](void* p) {
+			((FNullRenderContext*)p)->DeallocatingConstantBuffers.push_back(cb);
+		}));
+	}
+}
+
+void D3D11::FNullRenderContext::DeallocFont(LostCore::IFont * font)
+{
+	if (InRenderThread())
+	{
+		DeallocatingFonts.push_back(font);
+	}
+	else
+	{
+		PushCommand(FContextCommand(this, [=](void* p) {
+			((FNullRenderContext*)p)->DeallocatingFonts.push_back(font);
+		}));
+	}
+}
+
+void D3D11::FNullRenderContext::FlushDeallocating()
+{
+	for (auto item : DeallocatingPrimitiveGroups)
+	{
+		SAFE_DELETE(item);
+	}
+	DeallocatingPrimitiveGroups.clear();
+
+	for (auto item : DeallocatingInstancingDatas)
+	{
+		SAFE_DELETE(item);
+	}
+	DeallocatingInstancingDatas.clear();
+
+	for (auto item : DeallocatingConstantBuffers)
+	{
+		SAFE_DELETE(item);
+	}
+	DeallocatingConstantBuffers.clear();
+
+	for (auto item : DeallocatingFonts)
+	{
+		SAFE_DELETE(item);
+	}
+	DeallocatingFonts.clear();
+}
+
+void D3D11::FNullRenderContext::AddUpdateCommand(const FContextCommand & obj)
+{
+	if (InRenderThread())
+	{
+		UpdateGroup.push_back(obj);
+	}
+	else
+	{
+		PushCommand(FContextCommand(this, [=](void* p) {
+			((FNullRenderContext*)p)->UpdateGroup.push_back(obj);
+		}));
+	}
+}
+
+void D3D11::FNullRenderContext::RemoveUpdateCommand(const FContextCommand & obj)
+{
+	auto it = find(UpdateGroup.begin(), UpdateGroup.end(), obj);
+	if (it != UpdateGroup.end())
+	{
+		UpdateGroup.erase(it);
+	}
+}
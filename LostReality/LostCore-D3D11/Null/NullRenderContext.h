@@ -0,0 +1,157 @@
+/*
+* file NullRenderContext.h
+*
+* author luoxw
+* date 2018/03/28
+*
+* Render context without a device, a swap chain or a window.
+* The same commands go through the same frame pipeline to a render thread, which records the
+* committed primitives, buffers and instancing data as draws instead of issuing them.
+* Benchmarks the whole frame above IRenderContext on machines without graphics hardware.
+*/
+
+#pragma once
+
+#include "NullImplements.h"
+
+namespace D3D11
+{
+	// One committed primitive with the bindings in effect, recorded before FDrawList merges instanced primitives.
+	struct FNullDraw
+	{
+		const FNullPrimitiveGroup* Primitive;
+		float SortDepth;
+		uint32 InstancingKey;
+		uint32 NumVertices;
+		uint32 NumIndices;
+		uint32 NumInstances;
+		uint32 FirstBuffer;
+		uint32 NumBuffers;
+		uint32 FirstInstancing;
+		uint32 NumInstancings;
+		ERenderOrder RenderOrder;
+	};
+
+	// A constant buffer commit, its content is copied into the frame at Offset.
+	struct FNullBufferCommit
+	{
+		const FNullConstantBuffer* Buffer;
+		int32 ShaderSlot;
+		uint32 Offset;
+		uint32 Size;
+	};
+
+	class FNullRenderContext : public LostCore::IRenderContext
+	{
+	public:
+
+		FORCEINLINE static FNullRenderContext*& Get()
+		{
+			static FNullRenderContext* SPtr = nullptr;
+			return SPtr;
+		}
+
+	public:
+		FNullRenderContext();
+
+		// Inherited via IRenderContext
+		virtual ~FNullRenderContext() override;
+		virtual bool Initialize() override;
+		virtual void Tick() override;
+		virtual void Destroy() override;
+		virtual bool IsThreadPrivate() const override;
+		virtual bool IsLoop() const override;
+		virtual void InitializeDevice(LostCore::EContextID id, HWND wnd, bool bWindowed, int32 width, int32 height) override;
+		virtual void SetViewProjectMatrix(const LostCore::FFloat4x4 & vp) override;
+		virtual void FirstCommit() override;
+		virtual void FinishCommit() override;
+
+		void* operator new(size_t i)
+		{
+			return _mm_malloc(i, 16);
+		}
+
+		void operator delete(void* p)
+		{
+			_mm_free(p);
+		}
+
+		// Render thread, from the null objects as the device objects call FRenderContext.
+		void CommitPrimitiveGroup(FNullPrimitiveGroup* pg, float sortDepth);
+		void CommitBuffer(FNullConstantBuffer* buf);
+		void CommitInstancingData(FNullInstancingData* data);
+		void CommitShaderResource();
+		void AddUploadBytes(uint32 sz);
+		void AddFontUpdate();
+
+		thread::id GetThreadId() const;
+		bool InRenderThread() const;
+
+		// Producer side, the arena of the frame being built.
+		LostCore::FCommandArena& GetCommandArena();
+
+		// Render thread, the records of the last frame, kept until the next one begins.
+		const vector<FNullDraw>& GetDraws() const;
+		const vector<FNullBufferCommit>& GetBufferCommits() const;
+		const vector<uint32>& GetDrawBuffers() const;
+		const FBuf& GetBufferData() const;
+
+		// Any thread, the counters of the last finished frame.
+		FNullFrameStats GetFrameStats() const;
+
+		void PushCommand(const FContextCommand& cmd);
+		void DeallocPrimitiveGroup(LostCore::IPrimitive* pg);
+		void DeallocInstancingData(LostCore::IInstancingData* data);
+		void DeallocConstantBuffer(LostCore::IConstantBuffer* cb);
+		void DeallocFont(LostCore::IFont* font);
+		void FlushDeallocating();
+
+		void AddUpdateCommand(const FContextCommand& obj);
+		void RemoveUpdateCommand(const FContextCommand& obj);
+
+	private:
+		void ExecInitializeDevice(LostCore::EContextID id, int32 width, int32 height);
+
+		void BeginFrame();
+		void RenderFrame();
+		void EndFrame();
+
+		static void ExecContextCommand(void* p, const void* payload, uint32 size);
+
+		LostCore::EContextID					ContextID;
+		LostCore::FGlobalParameter				Param;
+		FNullConstantBuffer*					GlobalConstantBuffer;
+		bool									bIsInitialized;
+
+		vector<FContextCommand>					UpdateGroup;
+
+		// Records of the frame, in commit order.
+		vector<FNullDraw>						Draws;
+		vector<FNullBufferCommit>				BufferCommits;
+		FBuf									BufferData;
+		vector<uint32>							DrawBuffers;
+		vector<FNullInstancingData*>			Instancings;
+		uint32									NumPendingInstancings;
+
+		// Buffer commits bound by slot, a draw copies the ones in effect into DrawBuffers.
+		map<int32, uint32>						StickyBuffers;
+
+		vector<LostCore::IPrimitive*>			DeallocatingPrimitiveGroups;
+		vector<LostCore::IInstancingData*>		DeallocatingInstancingDatas;
+		vector<LostCore::IConstantBuffer*>		DeallocatingConstantBuffers;
+		vector<LostCore::IFont*>				DeallocatingFonts;
+
+		function<void()>						Initializer;
+		LostCore::TFramePipeline<LostCore::FCommandArena> Commands;
+
+		// Counted by the render thread during the frame, copied into LastStats as it ends.
+		FNullFrameStats							Stats;
+		FNullFrameStats							LastStats;
+		FTimeStamp								LastFrameStamp;
+		mutable mutex							StatsMutex;
+
+		// Last, the thread starts ticking as it is constructed.
+		atomic<bool>							bIsThreadRunning;
+		LostCore::FThread*						Thread;
+	};
+}
@@ -0,0 +1,648 @@
+/*
+* file DrawList.cpp
+*
+* author luoxw
+* date 2018/03/25
+*
+*
+*/
+
+#include "stdafx.h"
+#include "DrawList.h"
+
+#include "Implements/ConstantBuffer.h"
+#include "Implements/PrimitiveGroup.h"
+#include "Implements/Texture.h"
+#include "States/StateObjectCache.h"
+#include "Src/ShaderManager.h"
+
+using namespace LostCore;
+
+// Bits of the sort key, from the highest.
+static const uint32 SOrderBits = 3;
+static const uint32 SShaderBits = 10;
+static const uint32 SMaterialBits = 13;
+static const uint32 SDepthBits = 18;
+
+static const uint32 SOrderShift = 64 - SOrderBits;
+
+static FORCEINLINE uint64 HashPointer(const void* p, uint32 bits)
+{
+	return (uint64)(((uint32)((uintptr_t)p >> 4) * 2654435761u) >> (32 - bits));
+}
+
+// Bits of a positive float keep its order, the sign is always 0 here.
+static FORCEINLINE uint64 QuantizeDepth(float depth)
+{
+	if (!(depth > 0.f))
+	{
+		return 0;
+	}
+
+	uint32 bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - 1 - SDepthBits);
+}
+
+D3D11::FDrawList::FDrawList()
+	: NumPendingInstancings(0)
+	, InstanceCapacity(0)
+	, NumCommitted(0)
+	, NumMerged(0)
+{
+	Clear();
+}
+
+void D3D11::FDrawList::AddBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice)
+{
+	FConstantBufferBinding binding;
+	binding.Buffer = buf;
+	binding.Slice = slice;
+
+	for (auto& item : StickyBuffers)
+	{
+		if (item.Buffer->GetShaderSlot() == buf->GetShaderSlot())
+		{
+			item = binding;
+			return;
+		}
+	}
+
+	StickyBuffers.push_back(binding);
+}
+
+void D3D11::FDrawList::AddTexture(FTexture2D* tex)
+{
+	for (auto& item : StickyTextures)
+	{
+		if (item->GetShaderResourceSlot() == tex->GetShaderResourceSlot())
+		{
+			item = tex;
+			return;
+		}
+	}
+
+	StickyTextures.push_back(tex);
+}
+
+void D3D11::FDrawList::AddInstancing(FInstancingData* data)
+{
+	Instancings.push_back(data);
+	NumPendingInstancings++;
+}
+
+void D3D11::FDrawList::AddDraw(FPrimitiveGroup* pg, float sortDepth)
+{
+	const char* head = "FDrawList::AddDraw";
+	if (Objects.size() >= SMaxDraws)
+	{
+		LVERR(head, "more than %d draws in a frame, dropped.", SMaxDraws);
+		Instancings.resize(Instancings.size() - NumPendingInstancings);
+		NumPendingInstancings = 0;
+		return;
+	}
+
+	NumCommitted++;
+
+	FShaderKey key;
+	key.LitMode = ELightingMode::Phong;
+	key.VertexElement = pg->GetFlags();
+	for (uint32 index = (uint32)Instancings.size() - NumPendingInstancings; index < Instancings.size(); ++index)
+	{
+		key.VertexElement |= Instancings[index]->GetFlags();
+	}
+
+	auto shader = FShaderManager::Get()->GetShader(key);
+	const ERenderOrder order = pg->GetRenderOrder();
+
+	// Explicitly instanced draws, skinned and 2d primitives keep their own draw.
+	const FConstantBufferBinding* world = nullptr;
+	if (pg->GetInstancingKey() != 0 &&
+		NumPendingInstancings == 0 &&
+		(order == ERenderOrder::Opacity || order == ERenderOrder::Masked) &&
+		!HAS_FLAGS(VERTEX_SKIN, key.VertexElement) &&
+		!HAS_FLAGS(VERTEX_COORDINATE2D, key.VertexElement))
+	{
+		world = FindWorldMatrix();
+	}
+
+	uint64 signature = 0;
+	if (world != nullptr)
+	{
+		signature = GetBatchSignature(pg, order, shader);
+		auto it = Batches.find(signature);
+		if (it != Batches.end())
+		{
+			// A colliding signature keeps its own draw.
+			if (IsSameBatch(Objects[it->second], pg, shader))
+			{
+				AddInstance(it->second, *world, sortDepth);
+				NumMerged++;
+				return;
+			}
+
+			world = nullptr;
+		}
+	}
+
+	FRenderObject obj;
+	obj.PrimitiveGroup = pg;
+	obj.Shader = shader;
+	obj.SortDepth = sortDepth;
+	obj.FirstBuffer = (uint32)Buffers.size();
+	obj.NumBuffers = (uint32)StickyBuffers.size();
+	obj.FirstTexture = (uint32)Textures.size();
+	obj.NumTextures = (uint32)StickyTextures.size();
+	obj.FirstInstancing = (uint32)Instancings.size() - NumPendingInstancings;
+	obj.NumInstancings = NumPendingInstancings;
+	NumPendingInstancings = 0;
+
+	Buffers.insert(Buffers.end(), StickyBuffers.begin(), StickyBuffers.end());
+	Textures.insert(Textures.end(), StickyTextures.begin(), StickyTextures.end());
+
+	const uint32 index = (uint32)Objects.size();
+	Keys.push_back(GetSortKey(obj, order) | index);
+	Objects.push_back(obj);
+
+	if (world != nullptr)
+	{
+		Batches[signature] = index;
+		AddInstance(index, *world, sortDepth);
+	}
+}
+
+void D3D11::FDrawList::Submit()
+{
+	static FStackCounterRequest SCounter("FDrawList::Submit");
+	FScopedStackCounterRequest scopedCounter(SCounter);
+
+	Stats = FDrawStats();
+	BoundShader = nullptr;
+	for (auto& item : BoundBuffers)
+	{
+		item = FConstantBufferBinding();
+	}
+
+	memset(BoundTextures, 0, sizeof(BoundTextures));
+	BoundDepthStencil = nullptr;
+	BoundBlend = nullptr;
+	BoundRasterizer = nullptr;
+
+	Stats.NumCommitted = NumCommitted;
+	Stats.NumMerged = NumMerged;
+	const bool instanced = UploadInstances();
+
+	SortScratch.resize(Keys.size());
+	RadixSort64(Keys.data(), SortScratch.data(), (uint32)Keys.size());
+
+	uint32 lastOrder = ~0u;
+	for (auto key : Keys)
+	{
+		const FRenderObject& obj = Objects[(uint32)(key & (SMaxDraws - 1))];
+		const uint32 order = (uint32)(key >> SOrderShift);
+		if (order != lastOrder)
+		{
+			BindStates((ERenderOrder)order);
+			lastOrder = order;
+		}
+
+		BindShader(obj.Shader);
+
+		for (uint32 index = 0; index < obj.NumBuffers; ++index)
+		{
+			BindBuffer(Buffers[obj.FirstBuffer + index]);
+		}
+
+		for (uint32 index = 0; index < obj.NumTextures; ++index)
+		{
+			BindTexture(Textures[obj.FirstTexture + index]);
+		}
+
+		if (instanced && obj.NumInstances > 1)
+		{
+			obj.PrimitiveGroup->DrawInstanced(InstanceBuffer, SInstanceStride, obj.InstanceOffset, obj.NumInstances);
+			Stats.NumInstancedDraws++;
+		}
+		else if (obj.NumInstances > 1)
+		{
+			// Each merged draw with its own world matrix, as if it had not been merged.
+			uint32 instance = obj.FirstInstance;
+			for (uint32 count = 0; count < obj.NumInstances; ++count)
+			{
+				BindBuffer(Instances[instance].World);
+				obj.PrimitiveGroup->Draw(nullptr, 0);
+				instance = Instances[instance].Next;
+			}
+
+			Stats.NumDraws += obj.NumInstances - 1;
+			Stats.NumUninstancedBatches++;
+		}
+		else
+		{
+			obj.PrimitiveGroup->Draw(obj.NumInstancings > 0 ? &Instancings[obj.FirstInstancing] : nullptr, obj.NumInstancings);
+		}
+
+		Stats.NumDraws++;
+	}
+
+	static FStackCounterRequest SCommitted("Draws committed");
+	static FStackCounterRequest SIssued("Draws issued");
+	static FStackCounterRequest SMerged("Draws merged by instancing");
+	SCommitted.AddCount(Stats.NumCommitted);
+	SIssued.AddCount(Stats.NumDraws);
+	SMerged.AddCount(Stats.NumMerged);
+
+	Clear();
+}
+
+D3D11::FDrawStats D3D11::FDrawList::GetStats() const
+{
+	return Stats;
+}
+
+uint64 D3D11::FDrawList::GetSortKey(const FRenderObject& obj, ERenderOrder order) const
+{
+	uint64 key = (uint64)order << SOrderShift;
+
+	// UI is drawn without depth test, the commit order is kept by the index bits.
+	if (order == ERenderOrder::UI)
+	{
+		return key;
+	}
+
+	uint64 material = 0;
+	for (uint32 index = 0; index < obj.NumTextures; ++index)
+	{
+		material = material * 31 + HashPointer(Textures[obj.FirstTexture + index], SMaterialBits);
+	}
+
+	const uint64 shader = HashPointer(obj.Shader, SShaderBits);
+	material &= (1 << SMaterialBits) - 1;
+	uint64 depth = QuantizeDepth(obj.SortDepth);
+
+	if (order == ERenderOrder::Translucent)
+	{
+		// Back to front.
+		depth = ((1 << SDepthBits) - 1) - depth;
+		key |= depth << (SOrderShift - SDepthBits);
+		key |= shader << (SOrderShift - SDepthBits - SShaderBits);
+		key |= material << SIndexBits;
+	}
+	else
+	{
+		key |= shader << (SOrderShift - SShaderBits);
+		key |= material << (SOrderShift - SShaderBits - SMaterialBits);
+		key |= depth << SIndexBits;
+	}
+
+	return key;
+}
+
+const D3D11::FConstantBufferBinding* D3D11::FDrawList::FindWorldMatrix() const
+{
+	for (auto& item : StickyBuffers)
+	{
+		if (item.Buffer->GetShaderSlot() == SHADER_SLOT_MATRICES)
+		{
+			return item.Buffer->GetData().size() == SInstanceStride ? &item : nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+uint64 D3D11::FDrawList::GetBatchSignature(FPrimitiveGroup* pg, ERenderOrder order, FShaderObject* shader) const
+{
+	const uint32 instancingKey = pg->GetInstancingKey();
+	uint64 signature = HashBytes64(&instancingKey, sizeof(instancingKey));
+	signature = HashBytes64(&order, sizeof(order), signature);
+	signature = HashBytes64(&shader, sizeof(shader), signature);
+
+	for (auto tex : StickyTextures)
+	{
+		signature = HashBytes64(&tex, sizeof(tex), signature);
+	}
+
+	for (auto& item : StickyBuffers)
+	{
+		const int32 slot = item.Buffer->GetShaderSlot();
+		signature = HashBytes64(&slot, sizeof(slot), signature);
+		if (slot != SHADER_SLOT_MATRICES)
+		{
+			const int32 flags = item.Buffer->GetShaderFlags();
+			const FBuf& data = item.Buffer->GetData();
+			signature = HashBytes64(&flags, sizeof(flags), signature);
+			signature = HashBytes64(data.data(), (uint32)data.size(), signature);
+		}
+	}
+
+	return signature;
+}
+
+bool D3D11::FDrawList::IsSameBatch(const FRenderObject& obj, FPrimitiveGroup* pg, FShaderObject* shader) const
+{
+	if (obj.NumInstances == 0 ||
+		obj.Shader != shader ||
+		obj.PrimitiveGroup->GetInstancingKey() != pg->GetInstancingKey() ||
+		obj.PrimitiveGroup->GetRenderOrder() != pg->GetRenderOrder() ||
+		obj.NumTextures != StickyTextures.size() ||
+		obj.NumBuffers != StickyBuffers.size())
+	{
+		return false;
+	}
+
+	for (uint32 index = 0; index < obj.NumTextures; ++index)
+	{
+		if (Textures[obj.FirstTexture + index] != StickyTextures[index])
+		{
+			return false;
+		}
+	}
+
+	// Equal constants are enough, the batch binds the buffers of its first object.
+	for (uint32 index = 0; index < obj.NumBuffers; ++index)
+	{
+		auto buf = Buffers[obj.FirstBuffer + index].Buffer;
+		auto other = StickyBuffers[index].Buffer;
+		if (buf->GetShaderSlot() != other->GetShaderSlot())
+		{
+			return false;
+		}
+
+		if (buf->GetShaderSlot() != SHADER_SLOT_MATRICES && buf != other &&
+			(buf->GetShaderFlags() != other->GetShaderFlags() || buf->GetData() != other->GetData()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void D3D11::FDrawList::AddInstance(uint32 index, const FConstantBufferBinding& world, float sortDepth)
+{
+	FRenderObject& obj = Objects[index];
+	const uint32 instance = (uint32)Instances.size();
+
+	FInstanceTransform transform;
+	memcpy(transform.Matrix, world.Buffer->GetData().data(), SInstanceStride);
+	transform.World = world;
+	transform.Next = 0;
+	Instances.push_back(transform);
+
+	if (obj.NumInstances == 0)
+	{
+		obj.FirstInstance = instance;
+	}
+	else
+	{
+		Instances[obj.LastInstance].Next = instance;
+	}
+
+	obj.LastInstance = instance;
+	obj.NumInstances++;
+
+	// The batch sorts by its nearest instance.
+	if (sortDepth < obj.SortDepth)
+	{
+		obj.SortDepth = sortDepth;
+		Keys[index] = GetSortKey(obj, obj.PrimitiveGroup->GetRenderOrder()) | index;
+	}
+}
+
+bool D3D11::FDrawList::UploadInstances()
+{
+	const char* head = "FDrawList::UploadInstances";
+
+	uint32 numInstances = 0;
+	for (auto& obj : Objects)
+	{
+		if (obj.NumInstances > 1)
+		{
+			numInstances += obj.NumInstances;
+		}
+	}
+
+	if (numInstances == 0)
+	{
+		return false;
+	}
+
+	auto device = FRenderContext::GetDevice(head);
+	auto cxt = FRenderContext::GetDeviceContext(head);
+	if (!device.IsValid() || !cxt.IsValid())
+	{
+		return false;
+	}
+
+	const uint32 sz = numInstances * SInstanceStride;
+	if (sz > InstanceCapacity)
+	{
+		uint32 capacity = InstanceCapacity > 0 ? InstanceCapacity : SInstanceStride * 1024;
+		while (capacity < sz)
+		{
+			capacity *= 2;
+		}
+
+		D3D11_BUFFER_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.ByteWidth = capacity;
+
+		auto hr = device->CreateBuffer(&desc, nullptr, InstanceBuffer.GetInitReference());
+		if (FAILED(hr))
+		{
+			LVERR(head, "create instance buffer(%d) failed: 0x%08x(%d).", capacity, hr, hr);
+			InstanceCapacity = 0;
+			return false;
+		}
+
+		InstanceCapacity = capacity;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	auto hr = cxt->Map(InstanceBuffer.GetReference(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (FAILED(hr))
+	{
+		LVERR(head, "map instance buffer(%d) failed: 0x%08x(%d).", InstanceCapacity, hr, hr);
+		return false;
+	}
+
+	// Rows of the world matrix per instance, the buffer copies are transposed.
+	float* dst = (float*)mapped.pData;
+	uint32 offset = 0;
+	for (auto& obj : Objects)
+	{
+		if (obj.NumInstances < 2)
+		{
+			continue;
+		}
+
+		obj.InstanceOffset = offset;
+		uint32 instance = obj.FirstInstance;
+		for (uint32 count = 0; count < obj.NumInstances; ++count)
+		{
+			const float* src = Instances[instance].Matrix;
+			for (uint32 row = 0; row < 4; ++row)
+			{
+				for (uint32 col = 0; col < 4; ++col)
+				{
+					*dst++ = src[col * 4 + row];
+				}
+			}
+
+			instance = Instances[instance].Next;
+			offset += SInstanceStride;
+		}
+
+		FShaderKey key;
+		key.LitMode = ELightingMode::Phong;
+		key.VertexElement = obj.PrimitiveGroup->GetFlags() | INSTANCE_TRANSFORM3D;
+		obj.Shader = FShaderManager::Get()->GetShader(key);
+	}
+
+	cxt->Unmap(InstanceBuffer.GetReference(), 0);
+	return true;
+}
+
+void D3D11::FDrawList::BindStates(ERenderOrder order)
+{
+	uint32 dsFlags, rsFlags = RAS_CULL_BACK;
+	EBlendMode blendMode;
+	EBlendWrite blendWrite;
+
+	if (order == ERenderOrder::Opacity)
+	{
+		dsFlags = DS_DEPTH_READ | DS_DEPTH_WRITE;
+		blendMode = EBlendMode::None;
+		blendWrite = EBlendWrite::RGB;
+	}
+	else if (order == ERenderOrder::Translucent)
+	{
+		dsFlags = DS_DEPTH_READ;
+		blendMode = EBlendMode::AlphaBlend;
+		blendWrite = EBlendWrite::RGBA;
+	}
+	else if (order == ERenderOrder::UI)
+	{
+		dsFlags = 0;
+		blendMode = EBlendMode::AlphaBlend;
+		blendWrite = EBlendWrite::RGBA;
+	}
+	else
+	{
+		return;
+	}
+
+	auto cxt = FRenderContext::GetDeviceContext("FDrawList::BindStates");
+
+	auto ds = FStateObjectCache::Get()->GetDepthStencilState(dsFlags);
+	if (ds != BoundDepthStencil)
+	{
+		BoundDepthStencil = ds;
+		cxt->OMSetDepthStencilState(BoundDepthStencil, 0);
+		Stats.NumStateBinds++;
+	}
+	else
+	{
+		Stats.NumStateSkips++;
+	}
+
+	uint32 blendFlags = (uint8(blendMode) << BLEND_MODE_OFFSET) | (uint8(blendWrite) << BLEND_WRITE_OFFSET);
+	auto blend = FStateObjectCache::Get()->GetBlendState(blendFlags);
+	if (blend != BoundBlend)
+	{
+		BoundBlend = blend;
+		cxt->OMSetBlendState(BoundBlend, nullptr, ~0);
+		Stats.NumStateBinds++;
+	}
+	else
+	{
+		Stats.NumStateSkips++;
+	}
+
+	auto rs = FStateObjectCache::Get()->GetRasterizerState(rsFlags);
+	if (rs != BoundRasterizer)
+	{
+		BoundRasterizer = rs;
+		cxt->RSSetState(BoundRasterizer);
+		Stats.NumStateBinds++;
+	}
+	else
+	{
+		Stats.NumStateSkips++;
+	}
+}
+
+void D3D11::FDrawList::BindShader(FShaderObject* shader)
+{
+	if (shader == BoundShader)
+	{
+		Stats.NumShaderSkips++;
+		return;
+	}
+
+	BoundShader = shader;
+	FShaderManager::Get()->Bind(shader);
+	Stats.NumShaderBinds++;
+}
+
+void D3D11::FDrawList::BindBuffer(const FConstantBufferBinding& binding)
+{
+	const uint32 slot = (uint32)binding.Buffer->GetShaderSlot();
+	if (slot < SMaxBufferSlots)
+	{
+		const FConstantBufferBinding& bound = BoundBuffers[slot];
+		if (bound.Buffer != nullptr &&
+			bound.Buffer->GetShaderFlags() == binding.Buffer->GetShaderFlags() &&
+			bound.Slice.Offset == binding.Slice.Offset &&
+			bound.Slice.Size == binding.Slice.Size &&
+			(binding.Slice.Size > 0 || bound.Buffer == binding.Buffer))
+		{
+			Stats.NumBufferSkips++;
+			return;
+		}
+
+		BoundBuffers[slot] = binding;
+	}
+
+	binding.Buffer->Bind(binding.Slice);
+	Stats.NumBufferBinds++;
+}
+
+void D3D11::FDrawList::BindTexture(FTexture2D* tex)
+{
+	const uint32 slot = (uint32)tex->GetShaderResourceSlot();
+	if (slot < SMaxTextureSlots)
+	{
+		if (BoundTextures[slot] == tex)
+		{
+			Stats.NumTextureSkips++;
+			return;
+		}
+
+		BoundTextures[slot] = tex;
+	}
+
+	auto cxt = FRenderContext::GetDeviceContext("FDrawList::BindTexture");
+	tex->BindShaderResource(cxt);
+	Stats.NumTextureBinds++;
+}
+
+void D3D11::FDrawList::Clear()
+{
+	StickyBuffers.clear();
+	StickyTextures.clear();
+	Objects.clear();
+	Buffers.clear();
+	Textures.clear();
+	Instancings.clear();
+	NumPendingInstancings = 0;
+	Keys.clear();
+	Batches.clear();
+	Instances.clear();
+	NumCommitted = 0;
+	NumMerged = 0;
+}
@@ -0,0 +1,122 @@
+/*
+* file DrawList.h
+*
+* author luoxw
+* date 2018/03/25
+*
+* 1. Draws of a frame in flat arrays, 64-bit sort keys radix sorted before the submission.
+* 2. Key: render order, then shader, material and front-to-back depth, translucent
+*    objects go back to front first, UI keeps the commit order.
+* 3. Buffers and textures stay bound until replaced, as the device does, every draw
+*    keeps the bindings in effect when it is committed so the sorted order draws the same.
+* 4. Shader, constant buffer, texture and state binds equal to the bound ones are skipped.
+* 5. Opaque draws of primitives with the same instancing key and the same shader, textures
+*    and constants but the world matrix are merged, one instanced draw per batch reads the
+*    world matrices from a dynamic vertex buffer written once per frame.
+*/
+
+#pragma once
+
+#include "RenderObject.h"
+
+namespace D3D11
+{
+	struct FShaderObject;
+
+	struct FDrawStats
+	{
+		uint32 NumDraws;
+		uint32 NumShaderBinds;
+		uint32 NumShaderSkips;
+		uint32 NumBufferBinds;
+		uint32 NumBufferSkips;
+		uint32 NumTextureBinds;
+		uint32 NumTextureSkips;
+		uint32 NumStateBinds;
+		uint32 NumStateSkips;
+		uint32 NumCommitted;
+		uint32 NumMerged;
+		uint32 NumInstancedDraws;
+
+		// Merged draws issued one by one, the instance buffer could not be written.
+		uint32 NumUninstancedBatches;
+
+		FDrawStats() { memset(this, 0, sizeof(*this)); }
+	};
+
+	class FDrawList
+	{
+	public:
+		static const uint32 SIndexBits = 20;
+		static const uint32 SMaxDraws = 1 << SIndexBits;
+		static const uint32 SMaxBufferSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+		static const uint32 SMaxTextureSlots = 16;
+		static const uint32 SInstanceStride = sizeof(float) * 16;
+
+		FDrawList();
+
+		// Render thread, in commit order.
+		void AddBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice);
+		void AddTexture(FTexture2D* tex);
+		void AddInstancing(FInstancingData* data);
+		void AddDraw(FPrimitiveGroup* pg, float sortDepth);
+
+		// Draws the sorted list and clears it, the arrays keep their capacity.
+		void Submit();
+
+		FDrawStats GetStats() const;
+
+	private:
+		struct FInstanceTransform
+		{
+			// As in the matrices buffer, transposed.
+			float Matrix[16];
+
+			// Bound instead when the batch is drawn one instance at a time.
+			FConstantBufferBinding World;
+			uint32 Next;
+		};
+
+		uint64 GetSortKey(const FRenderObject& obj, ERenderOrder order) const;
+		const FConstantBufferBinding* FindWorldMatrix() const;
+		uint64 GetBatchSignature(FPrimitiveGroup* pg, ERenderOrder order, FShaderObject* shader) const;
+		bool IsSameBatch(const FRenderObject& obj, FPrimitiveGroup* pg, FShaderObject* shader) const;
+		void AddInstance(uint32 index, const FConstantBufferBinding& world, float sortDepth);
+		bool UploadInstances();
+		void BindStates(ERenderOrder order);
+		void BindShader(FShaderObject* shader);
+		void BindBuffer(const FConstantBufferBinding& binding);
+		void BindTexture(FTexture2D* tex);
+		void Clear();
+
+		// Bindings in effect, by slot.
+		vector<FConstantBufferBinding> StickyBuffers;
+		vector<FTexture2D*> StickyTextures;
+
+		vector<FRenderObject> Objects;
+		vector<FConstantBufferBinding> Buffers;
+		vector<FTexture2D*> Textures;
+		vector<FInstancingData*> Instancings;
+		uint32 NumPendingInstancings;
+		vector<uint64> Keys;
+		vector<uint64> SortScratch;
+
+		// Instancing batches by signature, the value is the first object of the batch.
+		map<uint64, uint32> Batches;
+		vector<FInstanceTransform> Instances;
+		TRefCountPtr<ID3D11Buffer> InstanceBuffer;
+		uint32 InstanceCapacity;
+		uint32 NumCommitted;
+		uint32 NumMerged;
+
+		// Bound while submitting.
+		FShaderObject* BoundShader;
+		FConstantBufferBinding BoundBuffers[SMaxBufferSlots];
+		FTexture2D* BoundTextures[SMaxTextureSlots];
+		ID3D11DepthStencilState* BoundDepthStencil;
+		ID3D11BlendState* BoundBlend;
+		ID3D11RasterizerState* BoundRasterizer;
+
+		FDrawStats Stats;
+	};
+}
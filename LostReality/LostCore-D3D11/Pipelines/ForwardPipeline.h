@@ -24,19 +24,16 @@ namespace D3D11
 		virtual void Initialize() override;
 		virtual void Destroy() override;
 		virtual EPipeline GetEnum() const override;
-		virtual void CommitPrimitiveGroup(FPrimitiveGroup* pg) override;
-		virtual void CommitBuffer(FConstantBuffer* buf) override;
+		virtual void CommitPrimitiveGroup(FPrimitiveGroup* pg, float sortDepth) override;
+		virtual void CommitBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice) override;
 		virtual void CommitShaderResource(FTexture2D* tex) override;
 		virtual void CommitInstancingData(FInstancingData* buf) override;
 		virtual void BeginFrame() override;
 		virtual void RenderFrame() override;
 		virtual void EndFrame() override;
+		virtual FDrawStats GetDrawStats() const override;
 
 	protected:
-
-		FRenderObject Committing;
-
-		typedef map<ERenderOrder, vector<FRenderObject>, FRenderOrderComparison> FMap;
-		FMap RenderObjects;
+		FDrawList DrawList;
 	};
 }
\ No newline at end of file
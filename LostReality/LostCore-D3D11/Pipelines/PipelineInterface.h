@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include "RenderObject.h"
+#include "DrawList.h"
 
 namespace D3D11
 {
@@ -25,13 +25,15 @@ namespace D3D11
 
 		virtual EPipeline GetEnum() const = 0;
 
-		virtual void CommitPrimitiveGroup(FPrimitiveGroup* pg) = 0;
-		virtual void CommitBuffer(FConstantBuffer* buf) = 0;
+		virtual void CommitPrimitiveGroup(FPrimitiveGroup* pg, float sortDepth) = 0;
+		virtual void CommitBuffer(FConstantBuffer* buf, const FConstantBufferSlice& slice) = 0;
 		virtual void CommitShaderResource(FTexture2D* tex) = 0;
 		virtual void CommitInstancingData(FInstancingData* buf) = 0;
 
 		virtual void BeginFrame() = 0;
 		virtual void RenderFrame() = 0;
 		virtual void EndFrame() = 0;
+
+		virtual FDrawStats GetDrawStats() const = 0;
 	};
 }
\ No newline at end of file
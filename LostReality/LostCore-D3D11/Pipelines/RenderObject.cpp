@@ -11,25 +11,18 @@
 #include "RenderObject.h"
 
 D3D11::FRenderObject::FRenderObject()
+	: PrimitiveGroup(nullptr)
+	, Shader(nullptr)
+	, SortDepth(0.f)
+	, FirstBuffer(0)
+	, NumBuffers(0)
+	, FirstTexture(0)
+	, NumTextures(0)
+	, FirstInstancing(0)
+	, NumInstancings(0)
+	, FirstInstance(0)
+	, LastInstance(0)
+	, NumInstances(0)
+	, InstanceOffset(0)
 {
-	Reset();
-}
-
-void D3D11::FRenderObject::Reset()
-{
-	PrimitiveGroup = nullptr;
-	ConstantBuffers.clear();
-	ShaderResources.clear();
-	InstancingDatas.clear();
-}
-
-uint32 D3D11::FRenderObject::GetVertexFlags() const
-{
-	uint32 flags = PrimitiveGroup->GetFlags();
-	for (auto item : InstancingDatas)
-	{
-		flags |= item->GetFlags();
-	}
-
-	return flags;
-}
+}
\ No newline at end of file
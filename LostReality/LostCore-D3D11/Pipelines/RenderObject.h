@@ -7,18 +7,39 @@
 *
 */
 
+#pragma once
+
 namespace D3D11
 {
+	struct FShaderObject;
+
+	struct FConstantBufferBinding
+	{
+		FConstantBuffer* Buffer;
+		FConstantBufferSlice Slice;
+
+		FConstantBufferBinding() : Buffer(nullptr) {}
+	};
+
+	// Ranges in the arrays of the draw list, nothing is allocated per object.
 	struct FRenderObject
 	{
 		FPrimitiveGroup* PrimitiveGroup;
-		vector<FConstantBuffer*> ConstantBuffers;
-		vector<FTexture2D*> ShaderResources;
-		vector<FInstancingData*> InstancingDatas;
+		FShaderObject* Shader;
+		float SortDepth;
+		uint32 FirstBuffer;
+		uint32 NumBuffers;
+		uint32 FirstTexture;
+		uint32 NumTextures;
+		uint32 FirstInstancing;
+		uint32 NumInstancings;
 
-		FRenderObject();
+		// Draws merged into this one, world matrices chained from FirstInstance.
+		uint32 FirstInstance;
+		uint32 LastInstance;
+		uint32 NumInstances;
+		uint32 InstanceOffset;
 
-		void Reset();
-		uint32 GetVertexFlags() const;
+		FRenderObject();
 	};
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 #include "Implements/PrimitiveGroup.h"
 #include "Implements/Material.h"
 #include "Implements/GdiFont.h"
+#include "Null/NullRenderContext.h"
+#include "Src/ShaderManager.h"
 
 
 using namespace D3D11;
@@ -22,6 +24,7 @@ LostCore::FProcessUnique* LostCore::FProcessUnique::SInstance = nullptr;
 
 EReturnCode D3D11::InitializeProcessUnique()
 {
+	LostCore::FAsyncLog::InstallCrashHandler();
 	LostCore::FProcessUnique::StaticInitialize();
 	return SSuccess;
 }
@@ -29,13 +32,22 @@ EReturnCode D3D11::InitializeProcessUnique()
 EReturnCode D3D11::DestroyProcessUnique()
 {
 	LostCore::FProcessUnique::StaticDestroy();
+	LostCore::FAsyncLog::Get()->Shutdown();
 	return SSuccess;
 }
 
 EReturnCode D3D11::SetProcessUnique(void* p)
 {
+	LostCore::FAsyncLog::InstallCrashHandler();
 	LVMSG("D3D11::SetProcessUnique", "ProcessUnique: 0x%08x", p);
 	LostCore::FProcessUnique::SetInstance((LostCore::FProcessUnique*)p);
+
+	// nullptr detaches the dll before the owner destroys the instance, the writer can't be joined in DllMain.
+	if (p == nullptr)
+	{
+		LostCore::FAsyncLog::Get()->Shutdown();
+	}
+
 	return SSuccess;
 }
 
@@ -54,43 +66,132 @@ EReturnCode D3D11::CreateRenderContext(LostCore::IRenderContext** context)
 
 EReturnCode D3D11::DestroyRenderContext(LostCore::IRenderContext * context)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		SAFE_DELETE(FNullRenderContext::Get());
+		return SSuccess;
+	}
+
 	assert(FRenderContext::Get() != nullptr);
 	SAFE_DELETE(FRenderContext::Get());
 	return SSuccess;
 }
 
+EReturnCode D3D11::CreateNullRenderContext(LostCore::IRenderContext** context)
+{
+	if (context == nullptr)
+	{
+		return SErrorInvalidParameters;
+	}
+
+	assert(FRenderContext::Get() == nullptr && FNullRenderContext::Get() == nullptr);
+	FNullRenderContext::Get() = new FNullRenderContext;
+	*context = FNullRenderContext::Get();
+	return SSuccess;
+}
+
+EReturnCode D3D11::GetNullFrameStats(FNullFrameStats* stats)
+{
+	if (stats == nullptr)
+	{
+		return SErrorInvalidParameters;
+	}
+
+	if (FNullRenderContext::Get() == nullptr)
+	{
+		return SErrorInternalError;
+	}
+
+	*stats = FNullRenderContext::Get()->GetFrameStats();
+	return SSuccess;
+}
+
+EReturnCode D3D11::PrecompileShaders(FShaderCacheStats* stats)
+{
+	if (stats == nullptr)
+	{
+		return SErrorInvalidParameters;
+	}
+
+	// The objects of a render context would be released with the workers.
+	if (FRenderContext::Get() != nullptr)
+	{
+		return SErrorInternalError;
+	}
+
+	FShaderManager::Get()->Precompile(*stats);
+	FShaderManager::Get()->Destroy();
+	return stats->NumFailed == 0 ? SSuccess : SErrorInternalError;
+}
+
 EReturnCode D3D11::CreatePrimitiveGroup(IPrimitive** pg)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		*pg = (new FNullPrimitiveGroup);
+		return SSuccess;
+	}
+
 	*pg = (new FPrimitiveGroup);
 	return SSuccess;
 }
 
 EReturnCode D3D11::DestroyPrimitiveGroup(IPrimitive* pg)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		FNullRenderContext::Get()->DeallocPrimitiveGroup(pg);
+		return SSuccess;
+	}
+
 	FRenderContext::Get()->DeallocPrimitiveGroup(pg);
 	return SSuccess;
 }
 
 EReturnCode D3D11::CreateInstancingData(IInstancingData** data)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		*data = new FNullInstancingData;
+		return SSuccess;
+	}
+
 	*data = new FInstancingData;
 	return SSuccess;
 }
 
 EReturnCode D3D11::DestroyInstancingData(IInstancingData* data)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		FNullRenderContext::Get()->DeallocInstancingData(data);
+		return SSuccess;
+	}
+
 	FRenderContext::Get()->DeallocInstancingData(data);
 	return SSuccess;
 }
 
 EReturnCode D3D11::CreateConstantBuffer(IConstantBuffer** cb)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		*cb = (new FNullConstantBuffer);
+		return SSuccess;
+	}
+
 	*cb = (new FConstantBuffer);
 	return SSuccess;
 }
 
 EReturnCode D3D11::DestroyConstantBuffer(IConstantBuffer* cb)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		FNullRenderContext::Get()->DeallocConstantBuffer(cb);
+		return SSuccess;
+	}
+
 	FRenderContext::Get()->DeallocConstantBuffer(cb);
 	return SSuccess;
 }
@@ -126,12 +227,24 @@ EReturnCode D3D11::DestroyMaterial(LostCore::IMaterial * material)
 
 EReturnCode D3D11::CreateGdiFont(LostCore::IFont** font)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		*font = (new FNullFont);
+		return SSuccess;
+	}
+
 	*font = (new FGdiFont);
 	return SSuccess;
 }
 
 EReturnCode D3D11::DestroyGdiFont(LostCore::IFont* font)
 {
+	if (FNullRenderContext::Get() != nullptr)
+	{
+		FNullRenderContext::Get()->DeallocFont(font);
+		return SSuccess;
+	}
+
 	FRenderContext::Get()->DeallocGdiFont(font);
 	return SSuccess;
 }
\ No newline at end of file
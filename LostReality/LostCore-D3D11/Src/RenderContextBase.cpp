@@ -159,7 +159,7 @@ EReturnCode D3D11::CompileShader(LPCWSTR file, LPCSTR entry, LPCSTR target, TRef
 		blob.GetInitReference(), errorBlob.GetInitReference());
 	if (FAILED(Res))
 	{
-		LVERR(head, "Compile %ls(%s, %s) failed: %s", file, entry, target, errorBlob.IsValid() ? errorBlob->GetBufferPointer() : "");
+		LVERR(head, "Compile %ls(%s, %s) failed: %s", file, entry, target, errorBlob.IsValid() ? (const char*)errorBlob->GetBufferPointer() : "");
 		return SErrorInternalError;
 	}
 	else
@@ -381,7 +381,7 @@ extern EReturnCode D3D11::ConstructBuffer(
 
 EReturnCode D3D11::CreatePrimitiveIndex(
 	const TRefCountPtr<ID3D11Device>& device,
-	const FBuf& buf, bool bDynamic,
+	const void* buf, uint32 sz, bool bDynamic,
 	TRefCountPtr<ID3D11Buffer>& ib)
 {
 	const CHAR* head = "D3D11::CreatePrimitiveIndex";
@@ -392,15 +392,15 @@ EReturnCode D3D11::CreatePrimitiveIndex(
 		return SErrorInvalidParameters;
 	}
 
-	if (buf.empty())
+	if (buf == nullptr || sz == 0)
 	{
 		LVERR(head, "Invalid input buf");
 		return SErrorInvalidParameters;
 	}
 
 	// Vertex Buffer
-	D3D11_BUFFER_DESC desc{ buf.size(), bDynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER, 0, 0, 0 };
-	D3D11_SUBRESOURCE_DATA data{ buf.data(), 0, 0 };
+	D3D11_BUFFER_DESC desc{ sz, bDynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER, 0, 0, 0 };
+	D3D11_SUBRESOURCE_DATA data{ buf, 0, 0 };
 	HRESULT hr = device->CreateBuffer(&desc, &data, ib.GetInitReference());
 	if (FAILED(hr))
 	{
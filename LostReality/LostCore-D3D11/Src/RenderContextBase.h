@@ -61,7 +61,7 @@ namespace D3D11 {
 
 	extern EReturnCode CreatePrimitiveIndex(
 		const TRefCountPtr<ID3D11Device>& device, 
-		const FBuf& buf, bool bDynamic,
+		const void* buf, uint32 sz, bool bDynamic,
 		TRefCountPtr<ID3D11Buffer>& ib);
 
 	extern EReturnCode CreateMesh_Rect(
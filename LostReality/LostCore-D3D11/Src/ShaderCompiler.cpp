@@ -0,0 +1,439 @@
+/*
+* file ShaderCompiler.cpp
+*
+* author luoxw
+* date 2018/03/29
+*
+*
+*/
+
+#include "stdafx.h"
+#include "ShaderCompiler.h"
+
+using namespace D3D11;
+using namespace LostCore;
+
+static const string SShaderMainFX = "Main.fx";
+static const string SShaderVsMain = "VsMain";
+static const string SShaderPsMain = "PsMain";
+static const string SShaderVsProfile = "vs_5_0";
+static const string SShaderPsProfile = "ps_5_0";
+
+// Bumped when the file layout changes, the files of other versions are compiled again.
+static const uint32 SBlobVersion = 1;
+
+#ifdef _DEBUG
+static const UINT SCompileFlags = D3DCOMPILE_DEBUG;
+#else
+static const UINT SCompileFlags = 0;
+#endif
+
+// Milliseconds an idle worker waits for a key before its FThread ticks.
+static const int32 SParkMilliseconds = 16;
+
+// Version, hash, payload size and payload hash.
+static const uint32 SBlobHeaderSize = sizeof(uint32) + sizeof(uint64) + sizeof(uint32) + sizeof(uint64);
+
+typedef vector<pair<string, string>> FShaderMacros;
+
+static void GetMacros(const FShaderKey& key, FShaderMacros& output)
+{
+	output.clear();
+	output.push_back(make_pair(NAME_VERTEX_TEXCOORD0, to_string(VERTEX_TEXCOORD0)));
+	output.push_back(make_pair(NAME_VERTEX_NORMAL, to_string(VERTEX_NORMAL)));
+	output.push_back(make_pair(NAME_VERTEX_TANGENT, to_string(VERTEX_TANGENT)));
+	output.push_back(make_pair(NAME_VERTEX_COLOR, to_string(VERTEX_COLOR)));
+	output.push_back(make_pair(NAME_VERTEX_SKIN, to_string(VERTEX_SKIN)));
+	output.push_back(make_pair(NAME_VERTEX_TEXCOORD1, to_string(VERTEX_TEXCOORD1)));
+	output.push_back(make_pair(NAME_VERTEX_COORDINATE3D, to_string(VERTEX_COORDINATE3D)));
+	output.push_back(make_pair(NAME_VERTEX_COORDINATE2D, to_string(VERTEX_COORDINATE2D)));
+	output.push_back(make_pair(NAME_MAX_BONES, to_string(MAX_BONES_PER_BATCH)));
+	output.push_back(make_pair(NAME_INSTANCE_TRANSFORM3D, to_string(INSTANCE_TRANSFORM3D)));
+	output.push_back(make_pair(NAME_INSTANCE_TRANSFORM2D, to_string(INSTANCE_TRANSFORM2D)));
+	output.push_back(make_pair(NAME_INSTANCE_TEXTILE, to_string(INSTANCE_TEXTILE)));
+	output.push_back(make_pair(NAME_LIT_MODE, to_string((uint8)key.LitMode)));
+	output.push_back(make_pair(NAME_VERTEX_FLAGS, to_string(key.VertexElement)));
+	output.push_back(make_pair(NAME_CUSTOM_BUFFER, to_string(key.CustomBufferVersion)));
+}
+
+static bool ReadText(const string& url, string& output)
+{
+	ifstream file;
+	file.open(url, ios::in | ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	output.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	file.close();
+	return true;
+}
+
+static string GetBlobFileName(uint64 hash)
+{
+	char name[32];
+	memset(name, 0, 32);
+	snprintf(name, 31, "%016llx.fxb", hash);
+	return name;
+}
+
+static void AddPermutations(FShaderKey key, uint32 position, const uint32* elements, uint32 numElements, vector<FShaderKey>& output)
+{
+	// Skinned primitives keep their own draw, never instanced.
+	const uint32 skinnedInstance = VERTEX_SKIN | INSTANCE_TRANSFORM3D;
+	for (uint32 mask = 0; mask < (1u << numElements); ++mask)
+	{
+		key.VertexElement = position;
+		for (uint32 index = 0; index < numElements; ++index)
+		{
+			if ((mask & (1u << index)) != 0)
+			{
+				key.VertexElement |= elements[index];
+			}
+		}
+
+		if (!HAS_FLAGS(skinnedInstance, key.VertexElement))
+		{
+			output.push_back(key);
+		}
+	}
+}
+
+// Includes found next to Main.fx, the sources stay alive as long as the include.
+class FShaderInclude : public ID3DInclude
+{
+public:
+	explicit FShaderInclude(const string& directory) : Directory(directory) {}
+
+	virtual HRESULT __stdcall Open(D3D_INCLUDE_TYPE type, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+	{
+		Sources.push_back(string());
+		if (!ReadText(Directory + fileName, Sources.back()))
+		{
+			LVERR("FShaderInclude::Open", "cant find shader file: %s", fileName);
+			Sources.pop_back();
+			return E_FAIL;
+		}
+
+		*data = Sources.back().data();
+		*bytes = (UINT)Sources.back().size();
+		return S_OK;
+	}
+
+	virtual HRESULT __stdcall Close(LPCVOID data) override
+	{
+		return S_OK;
+	}
+
+private:
+	string Directory;
+	deque<string> Sources;
+};
+
+void D3D11::FShaderCompiler::FWorkerTask::Tick()
+{
+	Compiler->WorkerTick();
+}
+
+D3D11::FShaderCompiler::FShaderCompiler(uint32 numWorkers)
+	: NumPending(0)
+	, NumLoaded(0)
+	, NumCompiled(0)
+	, NumFailed(0)
+	, ResolveMicroseconds(0)
+	, bQuit(false)
+{
+	const char* head = "FShaderCompiler";
+	if (!FDirectoryHelper::Get()->GetShaderCodeAbsolutePath("", CodeDirectory))
+	{
+		LVERR(head, "cant find the shader code directory: %s", CodeDirectory.c_str());
+	}
+
+	if (!FDirectoryHelper::Get()->GetShaderBlobAbsolutePath("", BlobDirectory))
+	{
+		LVERR(head, "cant find the shader blob directory: %s", BlobDirectory.c_str());
+	}
+
+	if (numWorkers == 0)
+	{
+		const uint32 hardware = thread::hardware_concurrency();
+		numWorkers = hardware > 3 ? hardware / 2 : 1;
+	}
+
+	for (uint32 index = 0; index < numWorkers; ++index)
+	{
+		Tasks.push_back(new FWorkerTask(this));
+		Workers.push_back(new FThread(Tasks.back(), string("Shader Compiler") + to_string(index)));
+	}
+}
+
+D3D11::FShaderCompiler::~FShaderCompiler()
+{
+	{
+		lock_guard<mutex> lck(RequestMutex);
+		bQuit = true;
+		Requests.clear();
+		RequestReady.notify_all();
+	}
+
+	for (auto& worker : Workers)
+	{
+		SAFE_DELETE(worker);
+	}
+
+	for (auto& task : Tasks)
+	{
+		SAFE_DELETE(task);
+	}
+
+	Workers.clear();
+	Tasks.clear();
+}
+
+void D3D11::FShaderCompiler::GetPermutations(vector<FShaderKey>& output)
+{
+	static const uint32 SElements3D[] = {
+		VERTEX_TEXCOORD0,
+		VERTEX_TEXCOORD1,
+		VERTEX_NORMAL,
+		VERTEX_TANGENT,
+		VERTEX_COLOR,
+		VERTEX_SKIN,
+		INSTANCE_TRANSFORM3D, };
+
+	static const uint32 SElements2D[] = {
+		VERTEX_TEXCOORD0,
+		VERTEX_COLOR, };
+
+	static const ELightingMode SLitModes[] = {
+		ELightingMode::UnLit,
+		ELightingMode::Phong, };
+
+	output.clear();
+	for (auto litMode : SLitModes)
+	{
+		FShaderKey key;
+		key.LitMode = litMode;
+		AddPermutations(key, VERTEX_COORDINATE3D, SElements3D, ARRAYSIZE(SElements3D), output);
+		AddPermutations(key, VERTEX_COORDINATE2D, SElements2D, ARRAYSIZE(SElements2D), output);
+	}
+}
+
+bool D3D11::FShaderCompiler::Resolve(const FShaderKey& key, FShaderKeyBlobs& output)
+{
+	const char* head = "FShaderCompiler::Resolve";
+	const FTimeStamp start = FPerformanceCounter::GetTimeStamp();
+
+	output = FShaderKeyBlobs(key);
+
+	string source;
+	uint64 hash = 0;
+	bool result = Preprocess(key, source, hash);
+	if (result && LoadBlobs(hash, key, output))
+	{
+		++NumLoaded;
+	}
+	else if (result &&
+		Compile(source, SShaderVsMain, SShaderVsProfile, output.Blobs[EShaderID::Vertex]) &&
+		Compile(source, SShaderPsMain, SShaderPsProfile, output.Blobs[EShaderID::Pixel]))
+	{
+		SaveBlobs(hash, output);
+		++NumCompiled;
+		LVMSG(head, "compiled %s into %s.", output.ToString().c_str(), GetBlobFileName(hash).c_str());
+	}
+	else
+	{
+		LVERR(head, "%s failed.", key.ToString().c_str());
+		output = FShaderKeyBlobs(key);
+		result = false;
+		++NumFailed;
+	}
+
+	ResolveMicroseconds += (uint64)(FPerformanceCounter::GetSeconds(start) * 1000000.0);
+	return result;
+}
+
+void D3D11::FShaderCompiler::Submit(const FShaderKey& key)
+{
+	++NumPending;
+
+	lock_guard<mutex> lck(RequestMutex);
+	Requests.push_back(key);
+	RequestReady.notify_one();
+}
+
+void D3D11::FShaderCompiler::Fetch(vector<FShaderKeyBlobs>& output)
+{
+	lock_guard<mutex> lck(FinishedMutex);
+	output.insert(output.end(), Finished.begin(), Finished.end());
+	Finished.clear();
+}
+
+uint32 D3D11::FShaderCompiler::GetNumPending() const
+{
+	return NumPending.load();
+}
+
+FShaderCacheStats D3D11::FShaderCompiler::GetStats() const
+{
+	FShaderCacheStats stats;
+	stats.NumLoaded = NumLoaded.load();
+	stats.NumCompiled = NumCompiled.load();
+	stats.NumFailed = NumFailed.load();
+	stats.NumWorkers = (uint32)Workers.size();
+	stats.ResolveSec = ResolveMicroseconds.load() * 0.000001;
+	return stats;
+}
+
+void D3D11::FShaderCompiler::WorkerTick()
+{
+	FShaderKey key;
+
+	{
+		unique_lock<mutex> lck(RequestMutex);
+		if (!RequestReady.wait_for(lck, chrono::milliseconds(SParkMilliseconds),
+			[this]() { return bQuit.load() || !Requests.empty(); }) || bQuit)
+		{
+			return;
+		}
+
+		key = Requests.front();
+		Requests.pop_front();
+	}
+
+	// Empty blobs tell the render thread to keep the fallback.
+	FShaderKeyBlobs blobs;
+	Resolve(key, blobs);
+
+	{
+		lock_guard<mutex> lck(FinishedMutex);
+		Finished.push_back(blobs);
+	}
+
+	--NumPending;
+}
+
+bool D3D11::FShaderCompiler::Preprocess(const FShaderKey& key, string& source, uint64& hash) const
+{
+	const char* head = "FShaderCompiler::Preprocess";
+
+	string mainSource;
+	if (!ReadText(CodeDirectory + SShaderMainFX, mainSource))
+	{
+		LVERR(head, "cant find shader file: %s", SShaderMainFX.c_str());
+		return false;
+	}
+
+	FShaderMacros macros;
+	GetMacros(key, macros);
+
+	vector<D3D_SHADER_MACRO> defines;
+	string macroString;
+	for (auto& item : macros)
+	{
+		defines.push_back({ item.first.c_str(), item.second.c_str() });
+		macroString.append(item.first).append("=").append(item.second).append(";");
+	}
+
+	defines.push_back({ nullptr, nullptr });
+
+	FShaderInclude include(CodeDirectory);
+	TRefCountPtr<ID3DBlob> textBlob;
+	TRefCountPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DPreprocess(mainSource.data(), mainSource.size(), SShaderMainFX.c_str(), defines.data(), &include,
+		textBlob.GetInitReference(), errorBlob.GetInitReference());
+
+	if (FAILED(hr) || !textBlob.IsValid())
+	{
+		LVERR(head, "preprocess %s failed: macro: %s, %s", SShaderMainFX.c_str(), macroString.c_str(),
+			errorBlob.IsValid() ? (const char*)errorBlob->GetBufferPointer() : "[empty]");
+		return false;
+	}
+
+	// Null terminated text, the #line directives name the files as included, not where they are.
+	const char* text = (const char*)textBlob->GetBufferPointer();
+	source.assign(text, strnlen(text, textBlob->GetBufferSize()));
+
+	const uint32 compiler = D3D_COMPILER_VERSION;
+	hash = HashBytes64(&SBlobVersion, sizeof(SBlobVersion));
+	hash = HashBytes64(&compiler, sizeof(compiler), hash);
+	hash = HashBytes64(&SCompileFlags, sizeof(SCompileFlags), hash);
+	hash = HashBytes64(macroString.data(), (uint32)macroString.size(), hash);
+	hash = HashBytes64(source.data(), (uint32)source.size(), hash);
+	return true;
+}
+
+bool D3D11::FShaderCompiler::Compile(const string& source, const string& entry, const string& profile, FBuf& output) const
+{
+	const char* head = "FShaderCompiler::Compile";
+
+	TRefCountPtr<ID3DBlob> shaderBlob;
+	TRefCountPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DCompile(source.data(), source.size(), SShaderMainFX.c_str(), nullptr, nullptr,
+		entry.c_str(), profile.c_str(), SCompileFlags, 0, shaderBlob.GetInitReference(), errorBlob.GetInitReference());
+
+	if (FAILED(hr) || !shaderBlob.IsValid())
+	{
+		LVERR(head, "compile %s(%s, %s) failed: %s", SShaderMainFX.c_str(), entry.c_str(), profile.c_str(),
+			errorBlob.IsValid() ? (const char*)errorBlob->GetBufferPointer() : "[empty]");
+		return false;
+	}
+
+	output.resize(shaderBlob->GetBufferSize());
+	memcpy(output.data(), shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+	return true;
+}
+
+bool D3D11::FShaderCompiler::LoadBlobs(uint64 hash, const FShaderKey& key, FShaderKeyBlobs& output) const
+{
+	FBinaryIO stream;
+	if (!stream.ReadFromFile(BlobDirectory + GetBlobFileName(hash)) || stream.RemainingSize() < SBlobHeaderSize)
+	{
+		return false;
+	}
+
+	// Another version, another content or cut short, compiled again and overwritten.
+	uint32 version = 0, size = 0;
+	uint64 storedHash = 0, payloadHash = 0;
+	stream >> version >> storedHash >> size >> payloadHash;
+	if (version != SBlobVersion || storedHash != hash || size != stream.RemainingSize() ||
+		payloadHash != HashBytes64((const uint8*)stream.Data() + SBlobHeaderSize, size))
+	{
+		LVWARN("FShaderCompiler::LoadBlobs", "%s of %s is stale.", GetBlobFileName(hash).c_str(), key.ToString().c_str());
+		return false;
+	}
+
+	FShaderKeyBlobs blobs;
+	stream >> blobs;
+	if (!blobs.IsValid())
+	{
+		return false;
+	}
+
+	// CodeVersion is not in the macros, keys differing by it share the file.
+	blobs.Key = key;
+	output = blobs;
+	return true;
+}
+
+void D3D11::FShaderCompiler::SaveBlobs(uint64 hash, const FShaderKeyBlobs& blobs) const
+{
+	FBinaryIO payload;
+	payload << blobs;
+
+	const uint32 size = payload.RemainingSize();
+	FBinaryIO stream;
+	stream << SBlobVersion << hash << size << HashBytes64(payload.Data(), size);
+	memcpy(stream.Reserve(size), payload.Data(), size);
+
+	// Written aside and renamed, a file is never read half written, by another process either.
+	const string url = BlobDirectory + GetBlobFileName(hash);
+	const string tempUrl = url + "." + to_string(GetCurrentThreadId());
+	stream.WriteToFile(tempUrl);
+	if (FALSE == MoveFileExA(tempUrl.c_str(), url.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		LVERR("FShaderCompiler::SaveBlobs", "failed to write %s: %d", url.c_str(), GetLastError());
+		DeleteFileA(tempUrl.c_str());
+	}
+}
@@ -0,0 +1,95 @@
+/*
+* file ShaderCompiler.h
+*
+* author luoxw
+* date 2018/03/29
+*
+* 1. The blobs of a FShaderKey are found by a hash of its macros and of Main.fx preprocessed with them,
+*    editing an included .fx only changes the hashes of the keys it gets into.
+* 2. One file per hash in ShaderBlob, written as soon as its blobs are compiled.
+* 3. Keys submitted are resolved by a pool of worker threads, the render thread fetches the finished blobs.
+*/
+
+#pragma once
+
+#include "ShaderManager.h"
+
+namespace D3D11
+{
+	class FShaderCompiler
+	{
+	public:
+		// Half of the hardware threads, the render, game and job threads keep theirs.
+		explicit FShaderCompiler(uint32 numWorkers = 0);
+
+		// Waits for the keys being compiled, the ones still queued are dropped.
+		~FShaderCompiler();
+
+		// Every key Main.fx is drawn with: 2d or 3d positions, the other vertex elements,
+		// the instance transform (not with skins) and both lighting modes.
+		static void GetPermutations(vector<FShaderKey>& output);
+
+		// Calling thread, loaded from the file of its hash, compiled and written if there is none.
+		bool Resolve(const FShaderKey& key, FShaderKeyBlobs& output);
+
+		// Any thread, resolved by a worker.
+		void Submit(const FShaderKey& key);
+
+		// Resolved since the last call, a failed key comes back without blobs.
+		void Fetch(vector<FShaderKeyBlobs>& output);
+
+		// Submitted and not fetchable yet.
+		uint32 GetNumPending() const;
+
+		FShaderCacheStats GetStats() const;
+
+	private:
+		class FWorkerTask : public LostCore::ITask
+		{
+		public:
+			FWorkerTask(FShaderCompiler* compiler) : Compiler(compiler) {}
+
+			// Inherited via ITask
+			virtual bool Initialize() override { return true; }
+			virtual void Tick() override;
+			virtual void Destroy() override {}
+			virtual bool IsThreadPrivate() const override { return false; }
+			virtual bool IsLoop() const override { return true; }
+
+		private:
+			FShaderCompiler* Compiler;
+		};
+
+		void WorkerTick();
+
+		// The preprocessed source, self contained, and the hash it is stored by.
+		bool Preprocess(const FShaderKey& key, string& source, uint64& hash) const;
+		bool Compile(const string& source, const string& entry, const string& profile, FBuf& output) const;
+
+		bool LoadBlobs(uint64 hash, const FShaderKey& key, FShaderKeyBlobs& output) const;
+		void SaveBlobs(uint64 hash, const FShaderKeyBlobs& blobs) const;
+
+		// Resolved once, FDirectoryHelper is not safe to call from the workers.
+		string CodeDirectory;
+		string BlobDirectory;
+
+		deque<FShaderKey> Requests;
+		mutex RequestMutex;
+		condition_variable RequestReady;
+
+		vector<FShaderKeyBlobs> Finished;
+		mutex FinishedMutex;
+
+		atomic<uint32> NumPending;
+		atomic<uint32> NumLoaded;
+		atomic<uint32> NumCompiled;
+		atomic<uint32> NumFailed;
+
+		// Microseconds spent preprocessing, loading and compiling, summed over the threads.
+		atomic<uint64> ResolveMicroseconds;
+
+		atomic<bool> bQuit;
+		vector<FWorkerTask*> Tasks;
+		vector<LostCore::FThread*> Workers;
+	};
+}
@@ -9,37 +9,53 @@
 
 #include "stdafx.h"
 #include "ShaderManager.h"
+#include "ShaderCompiler.h"
 #include "Buffers/VertexDef.h"
 
 using namespace D3D11;
 using namespace LostCore;
 
-static const string SShaderBlobs = "blobs.fxb";
-static const string SShaderMainFX = "Main.fx";
-static const string SShaderConstantFX = "Constants.fx";
-static const string SShaderVsMain = "VsMain";
-static const string SShaderPsMain = "PsMain";
+// Positions only, its vertex shader takes a subset of the layout of every key with the same positions.
+static FShaderKey GetFallbackKey(const FShaderKey& key)
+{
+	FShaderKey fallbackKey;
+	fallbackKey.LitMode = ELightingMode::UnLit;
+	fallbackKey.VertexElement = key.VertexElement & (VERTEX_COORDINATE2D | VERTEX_COORDINATE3D | VERTEX_SKIN | INSTANCE_TRANSFORM3D);
+	fallbackKey.CustomBufferVersion = key.CustomBufferVersion;
+	fallbackKey.CodeVersion = key.CodeVersion;
+	return fallbackKey;
+}
 
 D3D11::FShaderManager::FShaderManager()
+	: Compiler(nullptr)
 {
-	Load();
 }
 
 D3D11::FShaderManager::~FShaderManager()
 {
-	Save();
 	Destroy();
 }
 
 void D3D11::FShaderManager::Destroy()
 {
+	// Joined first, the workers must not outlive the process unique threads.
+	SAFE_DELETE(Compiler);
+
 	for (auto it : ShaderMap)
 	{
 		SAFE_DELETE(it.second);
 	}
 
-	KeyBlobs.clear();
+	for (auto it : FallbackMap)
+	{
+		SAFE_DELETE(it.second);
+	}
+
 	ShaderMap.clear();
+	FallbackMap.clear();
+	FallbackBlobs.clear();
+	Pending.clear();
+	Failed.clear();
 }
 
 FShaderObject * D3D11::FShaderManager::GetShader(const FShaderKey & key)
@@ -50,21 +66,61 @@ FShaderObject * D3D11::FShaderManager::GetShader(const FShaderKey & key)
 		return it->second;
 	}
 
-	return CreateShaderObject(GetBlobs(key));
+	FetchCompiled();
+	it = ShaderMap.find(key);
+	if (it != ShaderMap.end())
+	{
+		return it->second;
+	}
+
+	// Nothing to stand in for a fallback key, it is resolved as the fallbacks are.
+	const FShaderKey fallbackKey = GetFallbackKey(key);
+	if (!(fallbackKey < key) && !(key < fallbackKey))
+	{
+		auto blobs = GetFallbackBlobs(fallbackKey);
+		auto obj = blobs != nullptr ? CreateShaderObject(*blobs, key) : nullptr;
+		if (obj != nullptr)
+		{
+			ShaderMap[key] = obj;
+		}
+
+		return obj;
+	}
+
+	if (Pending.find(key) == Pending.end() && Failed.find(key) == Failed.end())
+	{
+		Pending.insert(key);
+		GetCompiler()->Submit(key);
+	}
+
+	static FStackCounterRequest SCounter("Shader fallbacks");
+	SCounter.AddCount(1);
+
+	return GetFallback(key);
 }
 
 void D3D11::FShaderManager::Bind(const FShaderKey & key)
 {
-	const char* head = "FShaderManager::Bind";
-	auto cxt = FRenderContext::GetDeviceContext(head);
-
 	auto obj = GetShader(key);
 	if (obj == nullptr)
 	{
-		LVERR(head, "GetShader(%s) failed.", key.ToString().c_str());
+		LVERR("FShaderManager::Bind", "GetShader(%s) failed.", key.ToString().c_str());
 		return;
 	}
 
+	Bind(obj);
+}
+
+void D3D11::FShaderManager::Bind(FShaderObject* obj)
+{
+	const char* head = "FShaderManager::Bind";
+	if (obj == nullptr)
+	{
+		LVERR(head, "null shader object.");
+		return;
+	}
+
+	auto cxt = FRenderContext::GetDeviceContext(head);
 	if (obj->VS.IsValid() && obj->IL.IsValid())
 	{
 		cxt->VSSetShader(obj->VS.GetReference(), nullptr, 0);
@@ -77,181 +133,133 @@ void D3D11::FShaderManager::Bind(const FShaderKey & key)
 	}
 }
 
-void D3D11::FShaderManager::Save()
+void D3D11::FShaderManager::Precompile(FShaderCacheStats& stats)
 {
-	// ݸǾбҪģ⻹ҪֹSaveٺĵõ¿ݸмֵ.
-	if (KeyBlobs.empty())
-	{
-		return;
-	}
+	const FTimeStamp start = FPerformanceCounter::GetTimeStamp();
 
-	string blobsUrl;
-	FDirectoryHelper::Get()->GetShaderBlobAbsolutePath(SShaderBlobs, blobsUrl);
+	vector<FShaderKey> keys;
+	FShaderCompiler::GetPermutations(keys);
 
-	FBinaryIO stream;
-	stream << KeyBlobs;
-	stream.WriteToFile(blobsUrl);
-}
-
-void D3D11::FShaderManager::Load()
-{
-	string blobsUrl;
-	FDirectoryHelper::Get()->GetShaderBlobAbsolutePath(SShaderBlobs, blobsUrl);
-
-	FBinaryIO stream;
-	if (stream.ReadFromFile(blobsUrl))
+	auto compiler = GetCompiler();
+	for (auto& key : keys)
 	{
-		stream >> KeyBlobs;
+		compiler->Submit(key);
 	}
-}
 
-set<FShaderKeyBlobs>::const_iterator D3D11::FShaderManager::GetBlobs(const FShaderKey & key)
-{
-	auto blobIt = KeyBlobs.find(FShaderKeyBlobs(key));
-	if (blobIt == KeyBlobs.end())
+	while (compiler->GetNumPending() > 0)
 	{
-		blobIt = Compile(key);
+		this_thread::sleep_for(chrono::milliseconds(10));
 	}
 
-	return blobIt;
+	// Only the files are wanted, there is no device to create the objects with.
+	vector<FShaderKeyBlobs> finished;
+	compiler->Fetch(finished);
+
+	stats = compiler->GetStats();
+	stats.NumPermutations = (uint32)keys.size();
+	stats.Sec = FPerformanceCounter::GetSeconds(start);
 }
 
-set<FShaderKeyBlobs>::const_iterator D3D11::FShaderManager::Compile(const FShaderKey & key)
+FShaderCompiler* D3D11::FShaderManager::GetCompiler()
 {
-	const char* head = "FShaderManager::Compile";
-	TRefCountPtr<ID3D11Device> device = FRenderContext::GetDevice(head);
-	if (!device.IsValid())
+	if (Compiler == nullptr)
 	{
-		return KeyBlobs.end();
+		Compiler = new FShaderCompiler;
 	}
 
-	FShaderKeyBlobs keyBlobs;
-	keyBlobs.Key = key;
-
-	UINT flag1 = 0;
-	UINT flag2 = 0;
-	TRefCountPtr<ID3DBlob> shaderBlob;
-	TRefCountPtr<ID3DBlob> errorBlob;
-
-#ifdef _DEBUG
-	flag1 |= D3DCOMPILE_DEBUG;
-#endif
+	return Compiler;
+}
 
-	static vector<string> temp(20);
-	static vector<D3D_SHADER_MACRO> SConstMacros;
-	if (SConstMacros.size() == 0)
+void D3D11::FShaderManager::FetchCompiled()
+{
+	const char* head = "FShaderManager::FetchCompiled";
+	if (Pending.empty())
 	{
-		SConstMacros.push_back({ NAME_VERTEX_TEXCOORD0, (temp[0] = to_string(VERTEX_TEXCOORD0)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_NORMAL, (temp[1] = to_string(VERTEX_NORMAL)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_TANGENT, (temp[2] = to_string(VERTEX_TANGENT)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_COLOR, (temp[3] = to_string(VERTEX_COLOR)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_SKIN, (temp[4] = to_string(VERTEX_SKIN)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_TEXCOORD1, (temp[5] = to_string(VERTEX_TEXCOORD1)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_COORDINATE3D, (temp[6] = to_string(VERTEX_COORDINATE3D)).c_str() });
-		SConstMacros.push_back({ NAME_VERTEX_COORDINATE2D, (temp[7] = to_string(VERTEX_COORDINATE2D)).c_str() });
-		SConstMacros.push_back({ NAME_MAX_BONES, (temp[8] = to_string(MAX_BONES_PER_BATCH)).c_str() });
-		SConstMacros.push_back({ NAME_INSTANCE_TRANSFORM3D, (temp[9] = to_string(INSTANCE_TRANSFORM3D)).c_str() });
-		SConstMacros.push_back({ NAME_INSTANCE_TRANSFORM2D, (temp[10] = to_string(INSTANCE_TRANSFORM2D)).c_str() });
-		SConstMacros.push_back({ NAME_INSTANCE_TEXTILE, (temp[11] = to_string(INSTANCE_TEXTILE)).c_str() });
+		return;
 	}
 
-	vector<D3D_SHADER_MACRO> macros;
-	vector<string> temp2(10);
-	// Vertex & Pixel
+	vector<FShaderKeyBlobs> finished;
+	GetCompiler()->Fetch(finished);
+	for (auto& blobs : finished)
 	{
-		std::string url;
-		if (!FDirectoryHelper::Get()->GetShaderCodeAbsolutePath(SShaderMainFX, url))
-		{
-			LVERR(head, "cant find shader file: %s", SShaderMainFX.c_str());
-			return KeyBlobs.end();
-		}
-
-		macros = SConstMacros;
-		macros.push_back({ NAME_LIT_MODE, (temp2[0] = to_string((uint8)key.LitMode)).c_str() });
-		macros.push_back({ NAME_VERTEX_FLAGS, (temp2[1] = to_string(key.VertexElement)).c_str() });
-		macros.push_back({ NAME_CUSTOM_BUFFER, (temp2[2] = to_string(key.CustomBufferVersion)).c_str() });
-		macros.push_back({ nullptr, nullptr });
+		Pending.erase(blobs.Key);
 
-		auto urlw = UTF8ToWide(url);
-		HRESULT hr = D3DCompileFromFile(urlw.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
-			SShaderVsMain.c_str(), "vs_5_0", flag1, flag2, shaderBlob.GetInitReference(), errorBlob.GetInitReference());
-
-		if (FAILED(hr) || !shaderBlob.IsValid())
+		auto obj = blobs.IsValid() ? CreateShaderObject(blobs, blobs.Key) : nullptr;
+		if (obj == nullptr)
 		{
-			string macroString;
-			for (auto item : macros)
-			{
-				if (item.Name != nullptr)
-				{
-					macroString.append(item.Name).append(":").append(item.Definition).append(", ");
-				}
-			}
-
-			LVERR(head, "compile %s(%s, %s) failed: macro: %s, %s.", SShaderMainFX.c_str(), SShaderVsMain.c_str(),
-				"vs_5_0", macroString.c_str(), errorBlob.IsValid() ? errorBlob->GetBufferPointer() : "[empty]");
-			return KeyBlobs.end();
+			LVERR(head, "%s keeps its fallback.", blobs.Key.ToString().c_str());
+			Failed.insert(blobs.Key);
+			continue;
 		}
-		
-		auto& vsBlob = keyBlobs.Blobs[EShaderID::Vertex];
-		vsBlob.resize(shaderBlob->GetBufferSize());
-		memcpy(vsBlob.data(), shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
 
-		if (FAILED(hr = D3DCompileFromFile(urlw.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
-			SShaderPsMain.c_str(), "ps_5_0", flag1, flag2, shaderBlob.GetInitReference(), errorBlob.GetInitReference())))
-		{
-			LVERR(head, "compile %s(%s, %s) failed: %s", SShaderMainFX.c_str(), SShaderPsMain.c_str(),
-				"ps_5_0", errorBlob.IsValid() ? errorBlob->GetBufferPointer() : "[empty]");
-			return KeyBlobs.end();
-		}
+		ShaderMap[blobs.Key] = obj;
+	}
+}
 
-		auto& psBlob = keyBlobs.Blobs[EShaderID::Pixel];
-		psBlob.resize(shaderBlob->GetBufferSize());
-		memcpy(psBlob.data(), shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+const FShaderKeyBlobs* D3D11::FShaderManager::GetFallbackBlobs(const FShaderKey& fallbackKey)
+{
+	auto it = FallbackBlobs.find(fallbackKey);
+	if (it == FallbackBlobs.end())
+	{
+		// A few small permutations, compiled here once and loaded from their files afterwards.
+		FShaderKeyBlobs blobs;
+		GetCompiler()->Resolve(fallbackKey, blobs);
+		it = FallbackBlobs.insert(make_pair(fallbackKey, blobs)).first;
+	}
 
-		pair<set<FShaderKeyBlobs>::iterator, bool> it = KeyBlobs.insert(keyBlobs);
-		LVMSG(head, "insert new compiled blob %s%s", keyBlobs.ToString().c_str(), it.second ? "." : " failed!");
-		return it.first;
+	return it->second.IsValid() ? &it->second : nullptr;
+}
+
+FShaderObject* D3D11::FShaderManager::GetFallback(const FShaderKey& key)
+{
+	auto it = FallbackMap.find(key);
+	if (it != FallbackMap.end())
+	{
+		return it->second;
 	}
 
-	return KeyBlobs.end();
+	// Kept even if null, a failed fallback is not tried again every draw.
+	auto blobs = GetFallbackBlobs(GetFallbackKey(key));
+	auto obj = blobs != nullptr ? CreateShaderObject(*blobs, key) : nullptr;
+	FallbackMap[key] = obj;
+	return obj;
 }
 
-FShaderObject* D3D11::FShaderManager::CreateShaderObject(set<FShaderKeyBlobs>::const_iterator blobIt)
+FShaderObject* D3D11::FShaderManager::CreateShaderObject(const FShaderKeyBlobs& blobs, const FShaderKey& layoutKey)
 {
 	const char* head = "FShaderManager::CreateShaderObject";
 	TRefCountPtr<ID3D11Device> device = FRenderContext::GetDevice(head);
-
-	if (blobIt == KeyBlobs.end())
+	if (!device.IsValid() || !blobs.IsValid())
 	{
 		return nullptr;
 	}
 
 	auto shaderObj = new FShaderObject;
 
-	auto& vsBlob = blobIt->Blobs.find(EShaderID::Vertex)->second;
+	auto& vsBlob = blobs.Blobs.find(EShaderID::Vertex)->second;
 	if (FAILED(device->CreateVertexShader(vsBlob.data(), vsBlob.size(), nullptr, shaderObj->VS.GetInitReference())))
 	{
-		LVERR(head, "Failed to create verter shader with %s", blobIt->ToString().c_str());
+		LVERR(head, "Failed to create verter shader with %s", blobs.ToString().c_str());
 		SAFE_DELETE(shaderObj);
 		return nullptr;
 	}
 
-	shaderObj->IL = CreateInputLayout(vsBlob, blobIt->Key);
+	shaderObj->IL = CreateInputLayout(vsBlob, layoutKey);
 	if (!shaderObj->IL.IsValid())
 	{
-		LVERR(head, "Failed to create input layout with %s", blobIt->ToString().c_str());
+		LVERR(head, "Failed to create input layout of %s with %s", layoutKey.ToString().c_str(), blobs.ToString().c_str());
+		SAFE_DELETE(shaderObj);
 		return nullptr;
 	}
 
-	auto& psBlob = blobIt->Blobs.find(EShaderID::Pixel)->second;
+	auto& psBlob = blobs.Blobs.find(EShaderID::Pixel)->second;
 	if (FAILED(device->CreatePixelShader(psBlob.data(), psBlob.size(), nullptr, shaderObj->PS.GetInitReference())))
 	{
-		LVERR(head, "Failed to create pixel shader with %s", blobIt->ToString().c_str());
+		LVERR(head, "Failed to create pixel shader with %s", blobs.ToString().c_str());
 		SAFE_DELETE(shaderObj);
 		return nullptr;
 	}
 
-	ShaderMap[blobIt->Key] = shaderObj;
 	return shaderObj;
 }
 
@@ -351,6 +359,13 @@ bool D3D11::FShaderKeyBlobs::operator<(const FShaderKeyBlobs& rhs) const
 	return Key < rhs.Key;
 }
 
+bool D3D11::FShaderKeyBlobs::IsValid() const
+{
+	auto vs = Blobs.find(EShaderID::Vertex);
+	auto ps = Blobs.find(EShaderID::Pixel);
+	return vs != Blobs.end() && !vs->second.empty() && ps != Blobs.end() && !ps->second.empty();
+}
+
 string D3D11::FShaderKeyBlobs::ToString() const
 {
 	static const char* SShaderString[] = {
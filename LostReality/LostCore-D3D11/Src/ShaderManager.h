@@ -79,6 +79,9 @@ namespace D3D11
 
 		bool operator<(const FShaderKeyBlobs& rhs) const;
 		string ToString() const;
+
+		// Vertex and pixel shaders, a failed key has neither.
+		bool IsValid() const;
 	};
 
 	FORCEINLINE LostCore::FBinaryIO& operator<<(LostCore::FBinaryIO& stream, const FShaderKeyBlobs& data)
@@ -95,7 +98,7 @@ namespace D3D11
 
 	struct FShaderObject
 	{
-		MEMORY_ALLOC(FShaderObject);
+		MEMORY_ALLOC(Shader);
 
 		TRefCountPtr<ID3D11VertexShader> VS;
 		TRefCountPtr<ID3D11PixelShader> PS;
@@ -116,6 +119,8 @@ namespace D3D11
 		}
 	};
 
+	class FShaderCompiler;
+
 	class FShaderManager
 	{
 	public:
@@ -128,23 +133,40 @@ namespace D3D11
 		FShaderManager();
 		~FShaderManager();
 
-		void Save();
-		void Load();
-
 		// ǰȷshader objectٱʹ.
 		void Destroy();
 
+		// Render thread, a key seen for the first time is compiled in the background,
+		// drawn meanwhile by a fallback with the same positions, unlit and without the other vertex elements.
+		// nullptr if even the fallback failed.
 		FShaderObject* GetShader(const FShaderKey& key);
 		void Bind(const FShaderKey& key);
+		void Bind(FShaderObject* obj);
+
+		// Offline, before any render context, every permutation of Main.fx into the blob cache.
+		// Waits for the workers, no shader object is created.
+		void Precompile(FShaderCacheStats& stats);
 
 	private:
-		set<FShaderKeyBlobs>::const_iterator Compile(const FShaderKey& key);
-		set<FShaderKeyBlobs>::const_iterator GetBlobs(const FShaderKey& key);
-		FShaderObject* CreateShaderObject(set<FShaderKeyBlobs>::const_iterator blobIt);
+		FShaderCompiler* GetCompiler();
+		void FetchCompiled();
 
+		const FShaderKeyBlobs* GetFallbackBlobs(const FShaderKey& fallbackKey);
+		FShaderObject* GetFallback(const FShaderKey& key);
+
+		// Input layout of layoutKey, a fallback is created with the layout of the key it stands in for.
+		FShaderObject* CreateShaderObject(const FShaderKeyBlobs& blobs, const FShaderKey& layoutKey);
 		TRefCountPtr<ID3D11InputLayout> CreateInputLayout(const FBuf& vsBlob, const FShaderKey& key);
 
-		set<FShaderKeyBlobs> KeyBlobs;
+		FShaderCompiler* Compiler;
 		map<FShaderKey, FShaderObject*> ShaderMap;
+
+		// Keys in the compiler and keys it failed, both drawn with their fallback.
+		set<FShaderKey> Pending;
+		set<FShaderKey> Failed;
+
+		// Resolved on the render thread, the objects are kept until Destroy as a draw of the frame may hold one.
+		map<FShaderKey, FShaderKeyBlobs> FallbackBlobs;
+		map<FShaderKey, FShaderObject*> FallbackMap;
 	};
 }
\ No newline at end of file
@@ -13,26 +13,10 @@
 using namespace LostCore;
 using namespace D3D11;
 
-D3D11::FBlendStateMap::FBlendStateMap() : bInitialized(false)
+ID3D11BlendState* D3D11::FBlendStateDef::Create(ID3D11Device* device, uint32 flags)
 {
-
-}
-
-D3D11::FBlendStateMap::~FBlendStateMap()
-{
-	ReleaseComObjects();
-}
-
-void D3D11::FBlendStateMap::InitializeState(uint32 flags)
-{
-	const char* head = "FBlendStateMap::InitializeState";
-	auto device = FRenderContext::GetDevice(head);
-	if (!device.IsValid())
-	{
-		return;
-	}
-
-	TRefCountPtr<ID3D11BlendState> state;
+	const char* head = "FBlendStateDef::Create";
+	ID3D11BlendState* state = nullptr;
 
 	D3D11_BLEND_DESC desc;
 	ZeroMemory(&desc, sizeof(D3D11_BLEND_DESC));
@@ -110,74 +94,12 @@ void D3D11::FBlendStateMap::InitializeState(uint32 flags)
 		desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 	}
 
-	HRESULT hr = device->CreateBlendState(&desc, state.GetInitReference());
+	HRESULT hr = device->CreateBlendState(&desc, &state);
 	if (FAILED(hr))
 	{
 		LVERR(head, "create blend state failed: 0x%08x(%d)", hr, hr);
 	}
 
-	StateMap[flags] = state;
 	LVMSG(head, "Created blend state for 0x%08x.", flags);
-}
-
-void D3D11::FBlendStateMap::Initialize()
-{
-	const char* head = "FBlendStateMap::Initialize";
-
-	if (bInitialized)
-	{
-		return;
-	}
-
-	InitializeState(
-		((uint32)EBlendMode::None<<BLEND_MODE_OFFSET) |
-		((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
-
-	InitializeState(
-		((uint32)EBlendMode::Add << BLEND_MODE_OFFSET) |
-		((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
-
-	InitializeState(
-		((uint32)EBlendMode::AlphaBlend << BLEND_MODE_OFFSET) |
-		((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
-
-	bInitialized = true;
-}
-
-void D3D11::FBlendStateMap::ReleaseComObjects()
-{
-	if (!bInitialized)
-	{
-		return;
-	}
-
-	for (auto it = StateMap.begin(); it != StateMap.end(); ++it)
-	{
-		it->second = nullptr;
-	}
-
-	StateMap.clear();
-	bInitialized = false;
-}
-
-TRefCountPtr<ID3D11BlendState> D3D11::FBlendStateMap::GetState(uint32 flags)
-{
-	if (!bInitialized)
-	{
-		Initialize();
-	}
-
-	auto it = StateMap.find(flags);
-	if (it != StateMap.end())
-	{
-		return it->second;
-	}
-
-	InitializeState(flags);
-	if ((it = StateMap.find(flags)) != StateMap.end())
-	{
-		return it->second;
-	}
-
-	return TRefCountPtr<ID3D11BlendState>();
+	return state;
 }
@@ -11,23 +11,9 @@
 
 namespace D3D11
 {
-	struct FBlendStateMap
+	// Blend mode and write mask at BLEND_MODE_OFFSET and BLEND_WRITE_OFFSET, BS_ flags above them.
+	struct FBlendStateDef
 	{
-		static FBlendStateMap* Get()
-		{
-			static FBlendStateMap Inst;
-			return &Inst;
-		}
-
-		bool bInitialized;
-		std::map<uint32, TRefCountPtr<ID3D11BlendState>> StateMap;
-
-		FBlendStateMap();
-		~FBlendStateMap();
-
-		void InitializeState(uint32 flags);
-		void Initialize();
-		void ReleaseComObjects();
-		TRefCountPtr<ID3D11BlendState> GetState(uint32 flags);
+		static ID3D11BlendState* Create(ID3D11Device* device, uint32 flags);
 	};
 }
\ No newline at end of file
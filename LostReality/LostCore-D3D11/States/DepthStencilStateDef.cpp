@@ -10,26 +10,11 @@
 #include "stdafx.h"
 #include "DepthStencilStateDef.h"
 
-D3D11::FDepthStencilStateMap::FDepthStencilStateMap() : bInitialized(false)
+ID3D11DepthStencilState* D3D11::FDepthStencilStateDef::Create(ID3D11Device* device, uint32 flags)
 {
-}
+	const char* head = "FDepthStencilStateDef::Create";
 
-D3D11::FDepthStencilStateMap::~FDepthStencilStateMap()
-{
-	ReleaseComObjects();
-}
-
-void D3D11::FDepthStencilStateMap::InitializeState(uint32 flags)
-{
-	const char* head = "FDepthStencilState::InitializeState";
-
-	TRefCountPtr<ID3D11DepthStencilState> state;
-
-	auto device = FRenderContext::GetDevice(head);
-	if (!device.IsValid())
-	{
-		return;
-	}
+	ID3D11DepthStencilState* state = nullptr;
 
 	const D3D11_DEPTH_STENCILOP_DESC opNever = {
 		D3D11_STENCIL_OP_KEEP,
@@ -53,63 +38,13 @@ void D3D11::FDepthStencilStateMap::InitializeState(uint32 flags)
 	desc.FrontFace = opNever;
 	desc.BackFace = opNever;
 
-	HRESULT hr = device->CreateDepthStencilState(&desc, state.GetInitReference());
+	HRESULT hr = device->CreateDepthStencilState(&desc, &state);
 	if (FAILED(hr))
 	{
 		LVERR(head, "Create depth stencil state failed: 0x%08x(%d)", hr, hr);
-		return;
+		return nullptr;
 	}
 
-	StateMap[flags] = state;
 	LVMSG(head, "Created depth stencil state for 0x%08x", flags);
-}
-
-void D3D11::FDepthStencilStateMap::Initialize()
-{
-	if (bInitialized)
-	{
-		return;
-	}
-
-	InitializeState(0);
-	InitializeState(DS_DEPTH_READ | DS_DEPTH_WRITE);
-	bInitialized = true;
-}
-
-void D3D11::FDepthStencilStateMap::ReleaseComObjects()
-{
-	if (!bInitialized)
-	{
-		return;
-	}
-
-	for (auto& elem : StateMap)
-	{
-		elem.second = nullptr;
-	}
-
-	StateMap.clear();
-	bInitialized = false;
-}
-
-TRefCountPtr<ID3D11DepthStencilState> D3D11::FDepthStencilStateMap::GetState(uint32 flags)
-{
-	if (!bInitialized)
-	{
-		Initialize();
-	}
-
-	auto it = StateMap.find(flags);
-	if (it != StateMap.end())
-	{
-		return it->second;
-	}
-
-	InitializeState(flags);
-	if ((it = StateMap.find(flags)) != StateMap.end())
-	{
-		return it->second;
-	}
-
-	return TRefCountPtr<ID3D11DepthStencilState>();
+	return state;
 }
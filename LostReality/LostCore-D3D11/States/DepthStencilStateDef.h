@@ -11,23 +11,9 @@
 
 namespace D3D11
 {
-	struct FDepthStencilStateMap
+	// DS_ flags, depth test and write, stencil read and write.
+	struct FDepthStencilStateDef
 	{
-		static FDepthStencilStateMap* Get()
-		{
-			static FDepthStencilStateMap Inst;
-			return &Inst;
-		}
-
-		bool bInitialized;
-		map<uint32, TRefCountPtr<ID3D11DepthStencilState>> StateMap;
-
-		FDepthStencilStateMap();
-		~FDepthStencilStateMap();
-
-		void InitializeState(uint32 flags);
-		void Initialize();
-		void ReleaseComObjects();
-		TRefCountPtr<ID3D11DepthStencilState> GetState(uint32 flags);
+		static ID3D11DepthStencilState* Create(ID3D11Device* device, uint32 flags);
 	};
 }
\ No newline at end of file
@@ -10,25 +10,10 @@
 #include "stdafx.h"
 #include "RasterizerStateDef.h"
 
-D3D11::FRasterizerStateMap::FRasterizerStateMap() : bInitialized(false)
+ID3D11RasterizerState* D3D11::FRasterizerStateDef::Create(ID3D11Device* device, uint32 flags)
 {
-}
-
-D3D11::FRasterizerStateMap::~FRasterizerStateMap()
-{
-	ReleaseComObjects();
-}
-
-void D3D11::FRasterizerStateMap::InitializeState(uint32 flags)
-{
-	const char* head = "FRasterizerStateMap::InitializeState";
-	auto device = FRenderContext::GetDevice(head);
-	if (!device.IsValid())
-	{
-		return;
-	}
-
-	TRefCountPtr<ID3D11RasterizerState> state;
+	const char* head = "FRasterizerStateDef::Create";
+	ID3D11RasterizerState* state = nullptr;
 
 	D3D11_RASTERIZER_DESC desc;
 	ZeroMemory(&desc, sizeof(desc));
@@ -55,62 +40,12 @@ void D3D11::FRasterizerStateMap::InitializeState(uint32 flags)
 	desc.MultisampleEnable = FALSE;
 	desc.ScissorEnable = FALSE;
 	desc.SlopeScaledDepthBias = 0.0f;
-	HRESULT hr = device->CreateRasterizerState(&desc, state.GetInitReference());
+	HRESULT hr = device->CreateRasterizerState(&desc, &state);
 	if (FAILED(hr))
 	{
 		LVERR(head, "Create rasterizer state failed: 0x%08x(%d)", hr, hr);
 	}
 
-	StateMap[flags] = state;
 	LVMSG(head, "Created rasterizer for 0x%08x.", flags);
-}
-
-void D3D11::FRasterizerStateMap::Initialize()
-{
-	if (bInitialized)
-	{
-		return;
-	}
-
-	InitializeState(0);
-	InitializeState(RAS_FILL_WIREFRAME);
-	bInitialized = true;
-}
-
-void D3D11::FRasterizerStateMap::ReleaseComObjects()
-{
-	if (!bInitialized)
-	{
-		return;
-	}
-
-	for (auto& elem : StateMap)
-	{
-		elem.second = nullptr;
-	}
-
-	StateMap.clear();
-	bInitialized = false;
-}
-
-TRefCountPtr<ID3D11RasterizerState> D3D11::FRasterizerStateMap::GetState(uint32 flags)
-{
-	if (!bInitialized)
-	{
-		Initialize();
-	}
-
-	auto it = StateMap.find(flags);
-	if (it != StateMap.end())
-	{
-		return it->second;
-	}
-
-	InitializeState(flags);
-	if ((it = StateMap.find(flags)) != StateMap.end())
-	{
-		return it->second;
-	}
-
-	return TRefCountPtr<ID3D11RasterizerState>();
+	return state;
 }
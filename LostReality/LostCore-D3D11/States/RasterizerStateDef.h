@@ -11,23 +11,9 @@
 
 namespace D3D11
 {
-	struct FRasterizerStateMap
+	// RAS_ flags, solid unless wireframe, no culling unless asked.
+	struct FRasterizerStateDef
 	{
-		static FRasterizerStateMap* Get()
-		{
-			static FRasterizerStateMap Inst;
-			return &Inst;
-		}
-
-		bool bInitialized;
-		map<uint32, TRefCountPtr<ID3D11RasterizerState>> StateMap;
-
-		FRasterizerStateMap();
-		~FRasterizerStateMap();
-
-		void InitializeState(uint32 flags);
-		void Initialize();
-		void ReleaseComObjects();
-		TRefCountPtr<ID3D11RasterizerState> GetState(uint32 flags);
+		static ID3D11RasterizerState* Create(ID3D11Device* device, uint32 flags);
 	};
 }
\ No newline at end of file
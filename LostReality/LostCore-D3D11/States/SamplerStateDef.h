@@ -39,23 +39,9 @@ namespace D3D11
 		}
 	};
 
-	struct FSamplerStateMap
+	// The flags are not read yet, every sampler is the default one.
+	struct FSamplerStateDef
 	{
-		static FSamplerStateMap* Get()
-		{
-			static FSamplerStateMap Inst;
-			return &Inst;
-		}
-
-		bool bInitialized;
-		std::map<uint32, TRefCountPtr<ID3D11SamplerState>> StateMap;
-
-		FSamplerStateMap();
-		~FSamplerStateMap();
-
-		void InitializeState(uint32 flags);
-		void Initialize();
-		void ReleaseComObjects();
-		TRefCountPtr<ID3D11SamplerState> GetState(uint32 flags);
+		static ID3D11SamplerState* Create(ID3D11Device* device, uint32 flags);
 	};
 }
\ No newline at end of file
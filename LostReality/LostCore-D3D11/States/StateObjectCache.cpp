@@ -0,0 +1,157 @@
+/*
+* file StateObjectCache.cpp
+*
+* author luoxw
+* date 2018/03/30
+*
+*
+*/
+
+#include "stdafx.h"
+#include "StateObjectCache.h"
+#include "BlendStateDef.h"
+#include "RasterizerStateDef.h"
+#include "DepthStencilStateDef.h"
+#include "SamplerStateDef.h"
+
+using namespace LostCore;
+
+// Fibonacci hashing, the flags are few low bits and the kind is at the top.
+// The top capacityBits bits of the product index a table of 1 << capacityBits slots.
+static FORCEINLINE uint32 GetSlotIndex(uint32 key, uint32 capacityBits)
+{
+	return (key * 2654435769u) >> (32 - capacityBits);
+}
+
+D3D11::FStateObjectCache::FStateObjectCache()
+	: NumStates(0)
+{
+	for (auto& slot : Slots)
+	{
+		slot.Key = SEmptyKey;
+		slot.State = nullptr;
+	}
+}
+
+D3D11::FStateObjectCache::~FStateObjectCache()
+{
+	ReleaseComObjects();
+}
+
+void D3D11::FStateObjectCache::Initialize()
+{
+	// FDrawList::BindStates, opacity and masked, translucent, ui.
+	GetDepthStencilState(DS_DEPTH_READ | DS_DEPTH_WRITE);
+	GetDepthStencilState(DS_DEPTH_READ);
+	GetDepthStencilState(0);
+
+	GetBlendState(((uint32)EBlendMode::None << BLEND_MODE_OFFSET) | ((uint32)EBlendWrite::RGB << BLEND_WRITE_OFFSET));
+	GetBlendState(((uint32)EBlendMode::None << BLEND_MODE_OFFSET) | ((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
+	GetBlendState(((uint32)EBlendMode::Add << BLEND_MODE_OFFSET) | ((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
+	GetBlendState(((uint32)EBlendMode::AlphaBlend << BLEND_MODE_OFFSET) | ((uint32)EBlendWrite::RGBA << BLEND_WRITE_OFFSET));
+
+	GetRasterizerState(RAS_CULL_BACK);
+	GetRasterizerState(0);
+
+	GetSamplerState(0);
+}
+
+void D3D11::FStateObjectCache::ReleaseComObjects()
+{
+	for (auto& slot : Slots)
+	{
+		if (slot.State != nullptr)
+		{
+			slot.State->Release();
+		}
+
+		slot.Key = SEmptyKey;
+		slot.State = nullptr;
+	}
+
+	NumStates = 0;
+}
+
+ID3D11BlendState* D3D11::FStateObjectCache::GetBlendState(uint32 flags)
+{
+	return static_cast<ID3D11BlendState*>(GetState(EStateObject::Blend, flags));
+}
+
+ID3D11RasterizerState* D3D11::FStateObjectCache::GetRasterizerState(uint32 flags)
+{
+	return static_cast<ID3D11RasterizerState*>(GetState(EStateObject::Rasterizer, flags));
+}
+
+ID3D11DepthStencilState* D3D11::FStateObjectCache::GetDepthStencilState(uint32 flags)
+{
+	return static_cast<ID3D11DepthStencilState*>(GetState(EStateObject::DepthStencil, flags));
+}
+
+ID3D11SamplerState* D3D11::FStateObjectCache::GetSamplerState(uint32 flags)
+{
+	return static_cast<ID3D11SamplerState*>(GetState(EStateObject::Sampler, flags));
+}
+
+uint32 D3D11::FStateObjectCache::GetNumStates() const
+{
+	return NumStates;
+}
+
+ID3D11DeviceChild* D3D11::FStateObjectCache::GetState(EStateObject kind, uint32 flags)
+{
+	static FStackCounterRequest SCounter("FStateObjectCache::GetState");
+	FScopedStackCounterRequest scopedCounter(SCounter);
+
+	assert(flags < (1u << SKindShift));
+	const uint32 key = ((uint32)kind << SKindShift) | flags;
+
+	uint32 index = GetSlotIndex(key, SCapacityBits);
+	for (uint32 probe = 0; probe < SCapacity; ++probe)
+	{
+		FSlot& slot = Slots[index];
+		if (slot.Key == key)
+		{
+			return slot.State;
+		}
+
+		if (slot.Key == SEmptyKey)
+		{
+			slot.Key = key;
+			slot.State = CreateState(kind, flags);
+			++NumStates;
+			return slot.State;
+		}
+
+		index = (index + 1) & (SCapacity - 1);
+	}
+
+	LVERR("FStateObjectCache::GetState", "more than %d states, 0x%08x dropped.", SCapacity, key);
+	return nullptr;
+}
+
+ID3D11DeviceChild* D3D11::FStateObjectCache::CreateState(EStateObject kind, uint32 flags)
+{
+	const char* head = "FStateObjectCache::CreateState";
+	auto device = FRenderContext::GetDevice(head);
+	if (!device.IsValid())
+	{
+		return nullptr;
+	}
+
+	static FStackCounterRequest SCreated("State objects created");
+	SCreated.AddCount(1);
+
+	switch (kind)
+	{
+	case EStateObject::Blend:
+		return FBlendStateDef::Create(device.GetReference(), flags);
+	case EStateObject::Rasterizer:
+		return FRasterizerStateDef::Create(device.GetReference(), flags);
+	case EStateObject::DepthStencil:
+		return FDepthStencilStateDef::Create(device.GetReference(), flags);
+	case EStateObject::Sampler:
+		return FSamplerStateDef::Create(device.GetReference(), flags);
+	default:
+		return nullptr;
+	}
+}
@@ -0,0 +1,69 @@
+/*
+* file StateObjectCache.h
+*
+* author luoxw
+* date 2018/03/30
+*
+* Blend, rasterizer, depth stencil and sampler states in one flat table,
+* open addressing with linear probing, keyed by the kind and the flags packed in one word.
+* Render thread only, states are created on first use and never removed before the device goes.
+*/
+
+#pragma once
+
+namespace D3D11
+{
+	enum class EStateObject : uint8
+	{
+		Blend = 0,
+		Rasterizer,
+		DepthStencil,
+		Sampler,
+	};
+
+	class FStateObjectCache
+	{
+	public:
+		static FStateObjectCache* Get()
+		{
+			static FStateObjectCache Inst;
+			return &Inst;
+		}
+
+		FStateObjectCache();
+		~FStateObjectCache();
+
+		// With the device, the states of every render order of FDrawList and the default sampler.
+		void Initialize();
+		void ReleaseComObjects();
+
+		// Borrowed, no reference taken, valid until ReleaseComObjects.
+		ID3D11BlendState* GetBlendState(uint32 flags);
+		ID3D11RasterizerState* GetRasterizerState(uint32 flags);
+		ID3D11DepthStencilState* GetDepthStencilState(uint32 flags);
+		ID3D11SamplerState* GetSamplerState(uint32 flags);
+
+		uint32 GetNumStates() const;
+
+	private:
+		// A few dozen states are ever created.
+		static const uint32 SCapacityBits = 8;
+		static const uint32 SCapacity = 1u << SCapacityBits;
+		static const uint32 SKindShift = 28;
+		static const uint32 SEmptyKey = ~0u;
+
+		struct FSlot
+		{
+			uint32 Key;
+
+			// Null if the device failed, not created again on every lookup.
+			ID3D11DeviceChild* State;
+		};
+
+		ID3D11DeviceChild* GetState(EStateObject kind, uint32 flags);
+		ID3D11DeviceChild* CreateState(EStateObject kind, uint32 flags);
+
+		array<FSlot, SCapacity> Slots;
+		uint32 NumStates;
+	};
+}
@@ -5,6 +5,7 @@
 #include <windows.h>
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #pragma comment(lib, "d3d11.lib")
 #include <dxgi.h>
 #pragma comment(lib, "dxgi.lib")
@@ -0,0 +1,129 @@
+/*
+* file MappedFile.h
+*
+* author luoxw
+* date 2018/03/16
+*
+* Read-only file mapping. Pages are faulted in by the OS on first touch,
+* nothing is read up front.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	class FMappedFile
+	{
+	public:
+		FMappedFile();
+		~FMappedFile();
+
+		FMappedFile(const FMappedFile&) = delete;
+		FMappedFile& operator=(const FMappedFile&) = delete;
+
+		bool Open(const string& url);
+		void Close();
+
+		bool IsOpen() const;
+		const uint8* GetData() const;
+		uint32 GetSize() const;
+
+	private:
+		HANDLE File;
+		HANDLE Mapping;
+		const uint8* Data;
+		uint32 Size;
+	};
+
+	FORCEINLINE FMappedFile::FMappedFile()
+		: File(INVALID_HANDLE_VALUE)
+		, Mapping(nullptr)
+		, Data(nullptr)
+		, Size(0)
+	{
+	}
+
+	FORCEINLINE FMappedFile::~FMappedFile()
+	{
+		Close();
+	}
+
+	FORCEINLINE bool FMappedFile::Open(const string& url)
+	{
+		const char* head = "FMappedFile::Open";
+
+		Close();
+
+		File = CreateFileA(url.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER sz;
+		if (!GetFileSizeEx(File, &sz) || sz.QuadPart == 0 || sz.HighPart != 0)
+		{
+			LVERR(head, "invalid file size: %s", url.c_str());
+			Close();
+			return false;
+		}
+
+		Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (Mapping == nullptr)
+		{
+			LVERR(head, "CreateFileMapping failed[%d]: %s", GetLastError(), url.c_str());
+			Close();
+			return false;
+		}
+
+		Data = (const uint8*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+		if (Data == nullptr)
+		{
+			LVERR(head, "MapViewOfFile failed[%d]: %s", GetLastError(), url.c_str());
+			Close();
+			return false;
+		}
+
+		Size = sz.LowPart;
+		return true;
+	}
+
+	FORCEINLINE void FMappedFile::Close()
+	{
+		if (Data != nullptr)
+		{
+			UnmapViewOfFile(Data);
+			Data = nullptr;
+		}
+
+		if (Mapping != nullptr)
+		{
+			CloseHandle(Mapping);
+			Mapping = nullptr;
+		}
+
+		if (File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(File);
+			File = INVALID_HANDLE_VALUE;
+		}
+
+		Size = 0;
+	}
+
+	FORCEINLINE bool FMappedFile::IsOpen() const
+	{
+		return Data != nullptr;
+	}
+
+	FORCEINLINE const uint8* FMappedFile::GetData() const
+	{
+		return Data;
+	}
+
+	FORCEINLINE uint32 FMappedFile::GetSize() const
+	{
+		return Size;
+	}
+}
@@ -14,7 +14,7 @@ namespace LostCore
 	class FFontConfig
 	{
 	public:
-		MEMORY_ALLOC(FFontConfig);
+		MEMORY_ALLOC(Font);
 
 		std::wstring	FontName;
 		float			Height;
@@ -45,5 +45,12 @@ namespace LostCore
 		// bytesVertexCount*VertexStrideUpdateVBڻ´VB.
 		// UpdateVBͷIndexBuffer
 		virtual void UpdateVB(const void* buf, uint32 sz, uint32 stride) = 0;
+
+		// View space depth of the next commits, translucent primitives are drawn back to front by it.
+		virtual void SetSortDepth(float depth) = 0;
+
+		// Primitives with the same non-zero key hold the same vertices and indices,
+		// their draws are merged into instanced ones when the rest of the state matches.
+		virtual void SetInstancingKey(uint32 key) = 0;
 	};
 }
\ No newline at end of file
@@ -19,6 +19,9 @@ namespace LostCore
 		Undefined,
 		D3D11_DXGI0,
 		D3D11_DXGI1,
+
+		// No device and no window, primitives, buffers and draws are only recorded.
+		Null,
 	};
 
 	enum class EShadeModel : uint8
@@ -35,6 +38,8 @@ namespace LostCore
 			return "d3d11 dxgi 0";
 		case EContextID::D3D11_DXGI1:
 			return "d3d11 dxgi 1";
+		case EContextID::Null:
+			return "null";
 		default:
 			return "[unknown]";
 		}
@@ -16,15 +16,21 @@
 #include "Misc/Macros.h"
 #include "Misc/Export.h"
 #include "Misc/Pointers.h"
+#include "Misc/ArrayView.h"
 #include "Misc/StringUtils.h"
+#include "Misc/Hash.h"
 #include "Misc/IDAllocator.h"
+#include "Misc/PerformanceCounters.h"
 #include "Misc/Log.h"
 #include "Misc/CommandQueue.h"
+#include "Misc/CommandArena.h"
+#include "Misc/RadixSort.h"
 #include "Misc/Tls.h"
-#include "Misc/PerformanceCounters.h"
 #include "Misc/Thread.h"
+#include "Misc/TraceProfiler.h"
 #include "Misc/MemoryCounters.h"
 #include "Misc/StackCounters.h"
+#include "Misc/JobSystem.h"
 
 #include "VertexTypes.h"
 
@@ -41,11 +47,20 @@ using FJson = nlohmann::json;
 #include "Math/Matrix.h"
 #include "Math/Transform2.h"
 #include "Math/AABB.h"
+#include "Math/TransformBatch.h"
 #include "Math/Color.h"
 #include "Math/Curves.h"
+#include "Math/BakedCurves.h"
 #include "Math/Line.h"
 #include "Math/Plane.h"
+#include "Math/Frustum.h"
+#include "Math/DynamicBVH.h"
 #include "Math/Intersect.h"
+#include "Math/TriangleBVH.h"
+#include "Math/VertexCacheOptimizer.h"
+
+#include "File/MappedFile.h"
+#include "Serialize/MappedAsset.h"
 
 #include "ConstantBuffers.h"
 
@@ -61,3 +76,4 @@ using FJson = nlohmann::json;
 #include "Interface/RenderContextInterface.h"
 
 #include "Serialize/StructSerialize.h"
+#include "Serialize/MappedStructSerialize.h"
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "MathBase.h"
+#include "Matrix.h"
 
 namespace LostCore
 {
@@ -112,5 +113,41 @@ namespace LostCore
 			AddPoint(b.Min);
 			AddPoint(b.Max);
 		}
+
+		bool Contains(const FAABoundingBox& b) const
+		{
+			return Min.X <= b.Min.X && Min.Y <= b.Min.Y && Min.Z <= b.Min.Z &&
+				b.Max.X <= Max.X && b.Max.Y <= Max.Y && b.Max.Z <= Max.Z;
+		}
+
+		// Half of the surface area, the SAH cost only compares areas.
+		FFloat3::FT GetHalfArea() const
+		{
+			const FFloat3 size(Max - Min);
+			return size.X * size.Y + size.Y * size.Z + size.Z * size.X;
+		}
 	};
+
+	// Smallest box holding box under m, the local half sizes are projected on the axes.
+	// Invalid boxes stay invalid.
+	inline FAABoundingBox GetTransformedBoundingBox(const FAABoundingBox& box, const FFloat4x4& m)
+	{
+		if (!box.IsValid())
+		{
+			return box;
+		}
+
+		const FFloat3 center(m.ApplyPoint((box.Min + box.Max) * 0.5f));
+		const FFloat3 extent((box.Max - box.Min) * 0.5f);
+		FFloat3 worldExtent;
+		for (int32 col = 0; col < 3; ++col)
+		{
+			worldExtent[col] =
+				std::abs(m.M[0][col]) * extent.X +
+				std::abs(m.M[1][col]) * extent.Y +
+				std::abs(m.M[2][col]) * extent.Z;
+		}
+
+		return FAABoundingBox(center - worldExtent, center + worldExtent);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,379 @@
+/*
+* file BakedCurves.h
+*
+* author luoxw
+* date 2018/03/12
+*
+* TCurve keeps its keys in a set, which is fine for editing but walks the keys on
+* every evaluation. TBakedCurve stores times and values in contiguous arrays:
+* 1. Eval(keyTime) binary searches the segment, O(log n).
+* 2. Eval(keyTime, cursor) starts from the segment cached in the caller's cursor,
+*    monotonic playback is amortized O(1), seeks fall back to binary search.
+* Results are identical to TCurve::Eval for the same keys and modes.
+* Keys are either owned (Bake, operator>>) or borrowed from external storage
+* such as a mapped asset (Attach), which then has to outlive the curve.
+*/
+
+#pragma once
+
+#include "Curves.h"
+
+namespace LostCore
+{
+	// Evaluation state of one curve instance, owned by the caller (e.g. a bone).
+	struct FCurveCursor
+	{
+		int32 Segment;
+
+		FCurveCursor() : Segment(-1) {}
+		void Reset() { Segment = -1; }
+	};
+
+	template <typename XType, typename YType>
+	class TBakedCurve
+	{
+	public:
+		typedef TCurve<XType, YType> FSourceCurve;
+		typedef typename FSourceCurve::KeyPair KeyPair;
+		typedef typename FSourceCurve::EWrap EWrap;
+		typedef typename FSourceCurve::EInterpolation EInterpolation;
+
+		template <typename XT, typename YT>
+		friend FBinaryIO& operator>>(FBinaryIO& stream, TBakedCurve<XT, YT>& data);
+
+		TBakedCurve();
+		explicit TBakedCurve(const FSourceCurve& curve);
+		TBakedCurve(const TBakedCurve& rhs);
+		TBakedCurve& operator=(const TBakedCurve& rhs);
+
+		void Bake(const FSourceCurve& curve);
+		void Attach(TArrayView<XType> times, TArrayView<YType> values, EWrap wrap, EInterpolation interp);
+		void Reset();
+
+		YType Eval(const XType& keyTime) const;
+		YType Eval(const XType& keyTime, FCurveCursor& cursor) const;
+
+		XType GetRangeMin() const;
+		XType GetRangeMax() const;
+		XType GetRange() const;
+		uint32 GetNumKeys() const;
+
+	private:
+		XType GetValidKeyTime(const XType& keyTime) const;
+
+		// Segment is the index of the first key later than keyTime, [0, NumKeys].
+		bool IsInSegment(const XType& keyTime, int32 segment) const;
+		int32 FindSegment(const XType& keyTime) const;
+		int32 FindSegment(const XType& keyTime, FCurveCursor& cursor) const;
+
+		// Same index remapping as TCurve::Get.
+		int32 GetValidIndex(int32 index) const;
+		YType Interpolate(const XType& keyTime, int32 segment) const;
+
+		// Points the views at the owned arrays.
+		void BindOwnedKeys();
+
+		vector<XType> OwnedTimes;
+		vector<YType> OwnedValues;
+		bool bAttached;
+
+		TArrayView<XType> Times;
+		TArrayView<YType> Values;
+
+		EWrap WrapMode;
+		EInterpolation InterpolationMode;
+	};
+
+	template<typename XType, typename YType>
+	FORCEINLINE TBakedCurve<XType, YType>::TBakedCurve()
+		: bAttached(false)
+		, WrapMode(EWrap::Clamp)
+		, InterpolationMode(EInterpolation::Linear)
+	{
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE TBakedCurve<XType, YType>::TBakedCurve(const FSourceCurve& curve)
+		: bAttached(false)
+		, WrapMode(EWrap::Clamp)
+		, InterpolationMode(EInterpolation::Linear)
+	{
+		Bake(curve);
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE TBakedCurve<XType, YType>::TBakedCurve(const TBakedCurve& rhs)
+		: bAttached(false)
+	{
+		*this = rhs;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE TBakedCurve<XType, YType>& TBakedCurve<XType, YType>::operator=(const TBakedCurve& rhs)
+	{
+		if (this != &rhs)
+		{
+			OwnedTimes = rhs.OwnedTimes;
+			OwnedValues = rhs.OwnedValues;
+			WrapMode = rhs.WrapMode;
+			InterpolationMode = rhs.InterpolationMode;
+
+			if (rhs.bAttached)
+			{
+				bAttached = true;
+				Times = rhs.Times;
+				Values = rhs.Values;
+			}
+			else
+			{
+				BindOwnedKeys();
+			}
+		}
+
+		return *this;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE void TBakedCurve<XType, YType>::Bake(const FSourceCurve& curve)
+	{
+		Reset();
+
+		WrapMode = curve.GetWrapMode();
+		InterpolationMode = curve.GetInterpolationMode();
+
+		const auto& keys = curve.GetKeys();
+		OwnedTimes.reserve(keys.size());
+		OwnedValues.reserve(keys.size());
+		for (const auto& key : keys)
+		{
+			OwnedTimes.push_back(key.first);
+			OwnedValues.push_back(key.second);
+		}
+
+		BindOwnedKeys();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE void TBakedCurve<XType, YType>::Attach(TArrayView<XType> times, TArrayView<YType> values, EWrap wrap, EInterpolation interp)
+	{
+		assert(times.Num() == values.Num());
+
+		Reset();
+		bAttached = true;
+		Times = times;
+		Values = values;
+		WrapMode = wrap;
+		InterpolationMode = interp;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE void TBakedCurve<XType, YType>::Reset()
+	{
+		OwnedTimes.clear();
+		OwnedValues.clear();
+		BindOwnedKeys();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE void TBakedCurve<XType, YType>::BindOwnedKeys()
+	{
+		bAttached = false;
+		Times = TArrayView<XType>(OwnedTimes);
+		Values = TArrayView<YType>(OwnedValues);
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE YType TBakedCurve<XType, YType>::Eval(const XType& keyTime) const
+	{
+		assert(GetNumKeys() > 1);
+
+		auto validKeyTime = GetValidKeyTime(keyTime);
+		return Interpolate(validKeyTime, FindSegment(validKeyTime));
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE YType TBakedCurve<XType, YType>::Eval(const XType& keyTime, FCurveCursor& cursor) const
+	{
+		assert(GetNumKeys() > 1);
+
+		auto validKeyTime = GetValidKeyTime(keyTime);
+		return Interpolate(validKeyTime, FindSegment(validKeyTime, cursor));
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE XType TBakedCurve<XType, YType>::GetRangeMin() const
+	{
+		assert(GetNumKeys() > 0);
+		return Times.Front();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE XType TBakedCurve<XType, YType>::GetRangeMax() const
+	{
+		assert(GetNumKeys() > 0);
+		return Times.Back();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE XType TBakedCurve<XType, YType>::GetRange() const
+	{
+		if (Times.Num() == 0)
+		{
+			return static_cast<XType>(0);
+		}
+
+		return GetRangeMax() - GetRangeMin();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE uint32 TBakedCurve<XType, YType>::GetNumKeys() const
+	{
+		return Times.Num();
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE XType TBakedCurve<XType, YType>::GetValidKeyTime(const XType& keyTime) const
+	{
+		if (WrapMode == EWrap::Wrap)
+		{
+			return InRange(keyTime, GetRangeMin(), GetRangeMax());
+		}
+		else if (keyTime < Times.Front())
+		{
+			return Times.Front();
+		}
+		else if (keyTime > Times.Back())
+		{
+			return Times.Back();
+		}
+
+		return keyTime;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE bool TBakedCurve<XType, YType>::IsInSegment(const XType& keyTime, int32 segment) const
+	{
+		int32 numKeys = Times.Num();
+		return (segment == 0 || !(keyTime < Times[segment - 1]))
+			&& (segment == numKeys || keyTime < Times[segment]);
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE int32 TBakedCurve<XType, YType>::FindSegment(const XType& keyTime) const
+	{
+		return static_cast<int32>(std::upper_bound(Times.begin(), Times.end(), keyTime) - Times.begin());
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE int32 TBakedCurve<XType, YType>::FindSegment(const XType& keyTime, FCurveCursor& cursor) const
+	{
+		int32 numKeys = Times.Num();
+		int32 segment = cursor.Segment;
+		if (segment >= 0 && segment <= numKeys)
+		{
+			if (IsInSegment(keyTime, segment))
+			{
+				return segment;
+			}
+
+			// Playing forward rarely crosses more than one key per frame.
+			if (segment < numKeys && IsInSegment(keyTime, segment + 1))
+			{
+				cursor.Segment = segment + 1;
+				return cursor.Segment;
+			}
+		}
+
+		cursor.Segment = FindSegment(keyTime);
+		return cursor.Segment;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE int32 TBakedCurve<XType, YType>::GetValidIndex(int32 index) const
+	{
+		int32 numKeys = Times.Num();
+		int32 maxIndex = numKeys - 1;
+		if (index >= 0 && index <= maxIndex)
+		{
+			return index;
+		}
+
+		if (WrapMode == EWrap::Wrap)
+		{
+			return InCycle(index, numKeys);
+		}
+
+		return index < 0 ? 0 : maxIndex;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE YType TBakedCurve<XType, YType>::Interpolate(const XType& keyTime, int32 segment) const
+	{
+		YType result;
+
+		if (InterpolationMode == EInterpolation::CatmullRom)
+		{
+			int32 i0 = GetValidIndex(segment - 2);
+			int32 i1 = GetValidIndex(segment - 1);
+			int32 i2 = GetValidIndex(segment);
+			int32 i3 = GetValidIndex(segment + 1);
+
+			auto m1 = SafeBy(Values[i2] - Values[i0], Times[i2] - Times[i0]);
+			auto m2 = SafeBy(Values[i3] - Values[i1], Times[i3] - Times[i1]);
+			auto p1 = Values[i1];
+			auto p2 = Values[i2];
+
+			auto t = SafeBy(keyTime - Times[i1], Times[i2] - Times[i1]);
+			auto t2 = t * t;
+			auto t3 = t2 * t;
+
+			result = p1 * (t3 * 2.0 - t2 * 3.0 + 1.0) + m1 * (t3 - t2 * 2.0 + t) + p2 * (t3 * -2.0 + t2 * 3.0) + m2 * (t3 - t2);
+		}
+		else if (InterpolationMode == EInterpolation::Constant)
+		{
+			result = Values[GetValidIndex(segment - 1)];
+		}
+		else if (InterpolationMode == EInterpolation::Linear)
+		{
+			int32 i1 = GetValidIndex(segment - 1);
+			int32 i2 = GetValidIndex(segment);
+			auto t = SafeBy(keyTime - Times[i1], Times[i2] - Times[i1]);
+			result = Values[i1] + (Values[i2] - Values[i1]) * t;
+		}
+		else
+		{
+			assert(0);
+		}
+
+		return result;
+	}
+
+	// Reads the stream written by TCurve's operator<<, keys are already sorted there.
+	template <typename XType, typename YType>
+	FORCEINLINE FBinaryIO& operator >> (FBinaryIO& stream, TBakedCurve<XType, YType>& data)
+	{
+		uint32 wrap, interp, numKeys;
+		stream >> wrap >> interp >> numKeys;
+		data.WrapMode = (typename TBakedCurve<XType, YType>::EWrap)wrap;
+		data.InterpolationMode = (typename TBakedCurve<XType, YType>::EInterpolation)interp;
+
+		data.Reset();
+		data.OwnedTimes.reserve(numKeys);
+		data.OwnedValues.reserve(numKeys);
+		for (uint32 i = 0; i < numKeys; ++i)
+		{
+			typename TBakedCurve<XType, YType>::KeyPair key;
+			stream >> key;
+			data.OwnedTimes.push_back(key.first);
+			data.OwnedValues.push_back(key.second);
+		}
+
+		data.BindOwnedKeys();
+
+		return stream;
+	}
+
+	typedef TBakedCurve<float, float> FBakedRealCurve;
+	typedef TBakedCurve<float, FFloat3> FBakedVec3Curve;
+	typedef TBakedCurve<float, FFloat4x4> FBakedMatrixCurve;
+}
@@ -64,6 +64,10 @@ namespace LostCore
 		XType GetRange() const;
 		uint32 GetNumKeys() const;
 
+		const KeyFrames& GetKeys() const;
+		EWrap GetWrapMode() const;
+		EInterpolation GetInterpolationMode() const;
+
 	protected:
 		typename KeyFramesConstIter Get(int32 index) const;
 
@@ -200,6 +204,24 @@ namespace LostCore
 		return Keys.size();
 	}
 
+	template<typename XType, typename YType>
+	FORCEINLINE const typename TCurve<XType, YType>::KeyFrames& TCurve<XType, YType>::GetKeys() const
+	{
+		return Keys;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE typename TCurve<XType, YType>::EWrap TCurve<XType, YType>::GetWrapMode() const
+	{
+		return WrapMode;
+	}
+
+	template<typename XType, typename YType>
+	FORCEINLINE typename TCurve<XType, YType>::EInterpolation TCurve<XType, YType>::GetInterpolationMode() const
+	{
+		return InterpolationMode;
+	}
+
 	template<typename XType, typename YType>
 	FORCEINLINE typename TCurve<XType, YType>::KeyFramesConstIter LostCore::TCurve<XType, YType>::Get(int32 index) const
 	{
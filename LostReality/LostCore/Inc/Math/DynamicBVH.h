@@ -0,0 +1,606 @@
+/*
+* file DynamicBVH.h
+*
+* author luoxw
+* date 2018/03/27
+*
+* Bounding volume hierarchy over moving objects, for ray picking.
+* 1. Leaves keep a box fattened by SFatRatio of its size, moves inside it cost nothing,
+*    the others remove the leaf and insert it again.
+* 2. Insertion walks down to the sibling of least SAH cost, the ancestors are refit
+*    and rotated on the way up to keep the tree balanced.
+* 3. Rebuild makes the whole tree again top-down with binned SAH, after bulk loads.
+* 4. RayCast visits the nearer child first and skips the nodes beyond the nearest hit.
+* Proxies are node indices, they stay valid until removed, Rebuild included.
+*/
+
+#pragma once
+
+#include "AABB.h"
+#include "Line.h"
+
+namespace LostCore
+{
+	template <typename T>
+	class TDynamicBVH
+	{
+	public:
+		static const int32 SNull = -1;
+		static const int32 SMaxDepth = 128;
+
+		TDynamicBVH();
+
+		int32 Insert(const FAABoundingBox& bounds, const T& data);
+		void Remove(int32 proxy);
+
+		// Returns true when the leaf left its fat box and was inserted again.
+		bool Move(int32 proxy, const FAABoundingBox& bounds);
+
+		void Rebuild();
+		void Clear();
+
+		const T& GetData(int32 proxy) const;
+		const FAABoundingBox& GetFatBounds(int32 proxy) const;
+		uint32 GetNum() const;
+		int32 GetHeight() const;
+
+		// test(data, ray, dist) returns true and the distance when the object is hit.
+		// result and dist are the nearest hit, left unchanged when nothing is hit.
+		template <typename TTest>
+		bool RayCast(const FRay& ray, TTest test, T& result, FRay::FT& dist) const;
+
+	private:
+		static const float SFatRatio;
+		static const int32 SNumBins = 16;
+		static const int32 SMaxSAHDepth = 48;
+
+		struct FNode
+		{
+			FAABoundingBox Bounds;
+			T Data;
+
+			// Next free node in the free list.
+			int32 Parent;
+			int32 Children[2];
+
+			// 0 for leaves, -1 for free nodes.
+			int32 Height;
+
+			bool IsLeaf() const { return Children[0] == SNull; }
+		};
+
+		int32 AllocNode();
+		void FreeNode(int32 index);
+
+		void InsertLeaf(int32 leaf);
+		void RemoveLeaf(int32 leaf);
+		void RefitUpwards(int32 index);
+		int32 Balance(int32 index);
+		void UpdateNode(int32 index);
+
+		int32 BuildRange(int32* leaves, int32 num, int32 depth);
+
+		static FAABoundingBox Union(const FAABoundingBox& a, const FAABoundingBox& b);
+		static bool RayBox(const FRay& ray, const FAABoundingBox& box, FRay::FT maxDist, FRay::FT& enter);
+
+		vector<FNode> Nodes;
+		vector<int32> BuildLeaves;
+		int32 Root;
+		int32 FreeList;
+		uint32 NumLeaves;
+	};
+
+	template <typename T>
+	const int32 TDynamicBVH<T>::SNull;
+
+	template <typename T>
+	const float TDynamicBVH<T>::SFatRatio = 0.1f;
+
+	template <typename T>
+	TDynamicBVH<T>::TDynamicBVH()
+		: Root(SNull)
+		, FreeList(SNull)
+		, NumLeaves(0)
+	{
+	}
+
+	template <typename T>
+	int32 TDynamicBVH<T>::Insert(const FAABoundingBox& bounds, const T& data)
+	{
+		const FFloat3 margin((bounds.Max - bounds.Min) * SFatRatio);
+		const int32 leaf = AllocNode();
+		Nodes[leaf].Bounds.Set(bounds.Min - margin, bounds.Max + margin);
+		Nodes[leaf].Data = data;
+		Nodes[leaf].Height = 0;
+		InsertLeaf(leaf);
+		NumLeaves++;
+		return leaf;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::Remove(int32 proxy)
+	{
+		assert(proxy >= 0 && proxy < (int32)Nodes.size() && Nodes[proxy].IsLeaf());
+		RemoveLeaf(proxy);
+		FreeNode(proxy);
+		NumLeaves--;
+	}
+
+	template <typename T>
+	bool TDynamicBVH<T>::Move(int32 proxy, const FAABoundingBox& bounds)
+	{
+		assert(proxy >= 0 && proxy < (int32)Nodes.size() && Nodes[proxy].IsLeaf());
+		if (Nodes[proxy].Bounds.Contains(bounds))
+		{
+			return false;
+		}
+
+		RemoveLeaf(proxy);
+		const FFloat3 margin((bounds.Max - bounds.Min) * SFatRatio);
+		Nodes[proxy].Bounds.Set(bounds.Min - margin, bounds.Max + margin);
+		InsertLeaf(proxy);
+		return true;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::Rebuild()
+	{
+		BuildLeaves.clear();
+		for (int32 index = 0; index < (int32)Nodes.size(); ++index)
+		{
+			FNode& node = Nodes[index];
+			if (node.Height < 0)
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				BuildLeaves.push_back(index);
+			}
+			else
+			{
+				FreeNode(index);
+			}
+		}
+
+		Root = BuildLeaves.empty() ? SNull : BuildRange(BuildLeaves.data(), (int32)BuildLeaves.size(), 0);
+		if (Root != SNull)
+		{
+			Nodes[Root].Parent = SNull;
+		}
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::Clear()
+	{
+		Nodes.clear();
+		Root = SNull;
+		FreeList = SNull;
+		NumLeaves = 0;
+	}
+
+	template <typename T>
+	const T& TDynamicBVH<T>::GetData(int32 proxy) const
+	{
+		return Nodes[proxy].Data;
+	}
+
+	template <typename T>
+	const FAABoundingBox& TDynamicBVH<T>::GetFatBounds(int32 proxy) const
+	{
+		return Nodes[proxy].Bounds;
+	}
+
+	template <typename T>
+	uint32 TDynamicBVH<T>::GetNum() const
+	{
+		return NumLeaves;
+	}
+
+	template <typename T>
+	int32 TDynamicBVH<T>::GetHeight() const
+	{
+		return Root == SNull ? 0 : Nodes[Root].Height;
+	}
+
+	template <typename T>
+	template <typename TTest>
+	bool TDynamicBVH<T>::RayCast(const FRay& ray, TTest test, T& result, FRay::FT& dist) const
+	{
+		if (Root == SNull)
+		{
+			return false;
+		}
+
+		FRay::FT nearest = ray.Distance;
+		bool hit = false;
+
+		FRay::FT enter;
+		int32 stack[SMaxDepth];
+		int32 top = 0;
+		if (RayBox(ray, Nodes[Root].Bounds, nearest, enter))
+		{
+			stack[top++] = Root;
+		}
+
+		while (top > 0)
+		{
+			const FNode& node = Nodes[stack[--top]];
+			if (node.IsLeaf())
+			{
+				FRay::FT leafDist;
+				if (test(node.Data, ray, leafDist) && leafDist < nearest)
+				{
+					nearest = leafDist;
+					result = node.Data;
+					hit = true;
+				}
+
+				continue;
+			}
+
+			// The nearer child goes on the top, it shrinks the range of the other one.
+			FRay::FT enter0, enter1;
+			const int32 child0 = node.Children[0], child1 = node.Children[1];
+			const bool hit0 = RayBox(ray, Nodes[child0].Bounds, nearest, enter0);
+			const bool hit1 = RayBox(ray, Nodes[child1].Bounds, nearest, enter1);
+			assert(top + 2 <= SMaxDepth);
+			if (hit0 && hit1)
+			{
+				stack[top++] = enter0 < enter1 ? child1 : child0;
+				stack[top++] = enter0 < enter1 ? child0 : child1;
+			}
+			else if (hit0)
+			{
+				stack[top++] = child0;
+			}
+			else if (hit1)
+			{
+				stack[top++] = child1;
+			}
+		}
+
+		if (hit)
+		{
+			dist = nearest;
+		}
+
+		return hit;
+	}
+
+	template <typename T>
+	int32 TDynamicBVH<T>::AllocNode()
+	{
+		int32 index;
+		if (FreeList != SNull)
+		{
+			index = FreeList;
+			FreeList = Nodes[index].Parent;
+		}
+		else
+		{
+			index = (int32)Nodes.size();
+			Nodes.push_back(FNode());
+		}
+
+		FNode& node = Nodes[index];
+		node.Parent = SNull;
+		node.Children[0] = node.Children[1] = SNull;
+		node.Height = 0;
+		return index;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::FreeNode(int32 index)
+	{
+		FNode& node = Nodes[index];
+		node.Data = T();
+		node.Children[0] = node.Children[1] = SNull;
+		node.Height = -1;
+		node.Parent = FreeList;
+		FreeList = index;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::InsertLeaf(int32 leaf)
+	{
+		if (Root == SNull)
+		{
+			Root = leaf;
+			Nodes[leaf].Parent = SNull;
+			return;
+		}
+
+		// Down to the sibling of least cost, a new parent there costs its area,
+		// every ancestor grows by the area the leaf adds to it.
+		const FAABoundingBox bounds = Nodes[leaf].Bounds;
+		int32 index = Root;
+		while (!Nodes[index].IsLeaf())
+		{
+			const FNode& node = Nodes[index];
+			const FRay::FT area = node.Bounds.GetHalfArea();
+			const FRay::FT combinedArea = Union(node.Bounds, bounds).GetHalfArea();
+			const FRay::FT cost = 2.f * combinedArea;
+			const FRay::FT inheritance = 2.f * (combinedArea - area);
+
+			FRay::FT childCosts[2];
+			for (int32 i = 0; i < 2; ++i)
+			{
+				const FNode& child = Nodes[node.Children[i]];
+				const FRay::FT grown = Union(child.Bounds, bounds).GetHalfArea();
+				childCosts[i] = (child.IsLeaf() ? grown : grown - child.Bounds.GetHalfArea()) + inheritance;
+			}
+
+			if (cost < childCosts[0] && cost < childCosts[1])
+			{
+				break;
+			}
+
+			index = node.Children[childCosts[0] < childCosts[1] ? 0 : 1];
+		}
+
+		const int32 sibling = index;
+		const int32 oldParent = Nodes[sibling].Parent;
+		const int32 newParent = AllocNode();
+		FNode& parent = Nodes[newParent];
+		parent.Parent = oldParent;
+		parent.Bounds = Union(bounds, Nodes[sibling].Bounds);
+		parent.Height = Nodes[sibling].Height + 1;
+		parent.Children[0] = sibling;
+		parent.Children[1] = leaf;
+		Nodes[sibling].Parent = newParent;
+		Nodes[leaf].Parent = newParent;
+
+		if (oldParent != SNull)
+		{
+			FNode& grand = Nodes[oldParent];
+			grand.Children[grand.Children[0] == sibling ? 0 : 1] = newParent;
+		}
+		else
+		{
+			Root = newParent;
+		}
+
+		RefitUpwards(Nodes[leaf].Parent);
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::RemoveLeaf(int32 leaf)
+	{
+		if (leaf == Root)
+		{
+			Root = SNull;
+			return;
+		}
+
+		const int32 parent = Nodes[leaf].Parent;
+		const int32 grand = Nodes[parent].Parent;
+		const int32 sibling = Nodes[parent].Children[Nodes[parent].Children[0] == leaf ? 1 : 0];
+
+		if (grand != SNull)
+		{
+			FNode& node = Nodes[grand];
+			node.Children[node.Children[0] == parent ? 0 : 1] = sibling;
+			Nodes[sibling].Parent = grand;
+			FreeNode(parent);
+			RefitUpwards(grand);
+		}
+		else
+		{
+			Root = sibling;
+			Nodes[sibling].Parent = SNull;
+			FreeNode(parent);
+		}
+
+		Nodes[leaf].Parent = SNull;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::RefitUpwards(int32 index)
+	{
+		while (index != SNull)
+		{
+			index = Balance(index);
+			UpdateNode(index);
+			index = Nodes[index].Parent;
+		}
+	}
+
+	// Rotates a grandchild up when the children heights differ by more than one,
+	// returns the node now at the place of index.
+	template <typename T>
+	int32 TDynamicBVH<T>::Balance(int32 index)
+	{
+		FNode& a = Nodes[index];
+		if (a.IsLeaf() || a.Height < 2)
+		{
+			return index;
+		}
+
+		const int32 ib = a.Children[0];
+		const int32 ic = a.Children[1];
+		const int32 balance = Nodes[ic].Height - Nodes[ib].Height;
+		if (balance >= -1 && balance <= 1)
+		{
+			return index;
+		}
+
+		// The higher child takes the place of a, a takes its lower child.
+		const int32 up = balance > 1 ? ic : ib;
+		const int32 stay = balance > 1 ? ib : ic;
+		FNode& u = Nodes[up];
+		const int32 i0 = u.Children[0];
+		const int32 i1 = u.Children[1];
+
+		u.Children[0] = index;
+		u.Parent = a.Parent;
+		a.Parent = up;
+
+		if (u.Parent != SNull)
+		{
+			FNode& parent = Nodes[u.Parent];
+			parent.Children[parent.Children[0] == index ? 0 : 1] = up;
+		}
+		else
+		{
+			Root = up;
+		}
+
+		const int32 high = Nodes[i0].Height > Nodes[i1].Height ? i0 : i1;
+		const int32 low = high == i0 ? i1 : i0;
+		u.Children[1] = high;
+		a.Children[0] = stay;
+		a.Children[1] = low;
+		Nodes[low].Parent = index;
+
+		UpdateNode(index);
+		UpdateNode(up);
+		return up;
+	}
+
+	template <typename T>
+	void TDynamicBVH<T>::UpdateNode(int32 index)
+	{
+		FNode& node = Nodes[index];
+		const FNode& child0 = Nodes[node.Children[0]];
+		const FNode& child1 = Nodes[node.Children[1]];
+		node.Bounds = Union(child0.Bounds, child1.Bounds);
+		node.Height = 1 + (child0.Height > child1.Height ? child0.Height : child1.Height);
+	}
+
+	// Splits at the bin boundary of least SAH cost along the widest axis of the centers,
+	// deep ranges and ranges with one center fall back to halving the count.
+	template <typename T>
+	int32 TDynamicBVH<T>::BuildRange(int32* leaves, int32 num, int32 depth)
+	{
+		if (num == 1)
+		{
+			return leaves[0];
+		}
+
+		FAABoundingBox centers;
+		for (int32 i = 0; i < num; ++i)
+		{
+			const FAABoundingBox& bounds = Nodes[leaves[i]].Bounds;
+			centers.AddPoint((bounds.Min + bounds.Max) * 0.5f);
+		}
+
+		const FFloat3 size(centers.Max - centers.Min);
+		const int32 axis = size.X > size.Y ? (size.X > size.Z ? 0 : 2) : (size.Y > size.Z ? 1 : 2);
+		const float lo = centers.Min[axis];
+		const float extent = size[axis];
+
+		int32 split = num / 2;
+		if (extent > 0.f && depth < SMaxSAHDepth)
+		{
+			FAABoundingBox binBounds[SNumBins];
+			int32 binCounts[SNumBins] = { 0 };
+			const float scale = SNumBins * 0.9999f / extent;
+			auto binOf = [&](int32 leaf)
+			{
+				const FAABoundingBox& bounds = Nodes[leaf].Bounds;
+				return (int32)(((bounds.Min[axis] + bounds.Max[axis]) * 0.5f - lo) * scale);
+			};
+
+			for (int32 i = 0; i < num; ++i)
+			{
+				const int32 bin = binOf(leaves[i]);
+				binBounds[bin].AddBound(Nodes[leaves[i]].Bounds);
+				binCounts[bin]++;
+			}
+
+			// Cost of the left side of every boundary, then the right side from the other end.
+			FRay::FT leftCosts[SNumBins - 1];
+			FAABoundingBox accum;
+			int32 count = 0;
+			for (int32 bin = 0; bin < SNumBins - 1; ++bin)
+			{
+				if (binCounts[bin] > 0)
+				{
+					accum.AddBound(binBounds[bin]);
+					count += binCounts[bin];
+				}
+
+				leftCosts[bin] = count > 0 ? accum.GetHalfArea() * count : 0.f;
+			}
+
+			FRay::FT bestCost = FLT_MAX;
+			int32 bestBin = -1;
+			accum = FAABoundingBox();
+			count = 0;
+			for (int32 bin = SNumBins - 1; bin > 0; --bin)
+			{
+				if (binCounts[bin] > 0)
+				{
+					accum.AddBound(binBounds[bin]);
+					count += binCounts[bin];
+				}
+
+				const int32 left = num - count;
+				if (count > 0 && left > 0)
+				{
+					const FRay::FT cost = leftCosts[bin - 1] + accum.GetHalfArea() * count;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestBin = bin;
+					}
+				}
+			}
+
+			if (bestBin > 0)
+			{
+				int32* mid = std::partition(leaves, leaves + num, [&](int32 leaf) { return binOf(leaf) < bestBin; });
+				split = (int32)(mid - leaves);
+			}
+		}
+
+		if (split <= 0 || split >= num)
+		{
+			split = num / 2;
+			std::nth_element(leaves, leaves + split, leaves + num, [&](int32 l, int32 r)
+			{
+				return Nodes[l].Bounds.Min[axis] + Nodes[l].Bounds.Max[axis] < Nodes[r].Bounds.Min[axis] + Nodes[r].Bounds.Max[axis];
+			});
+		}
+
+		const int32 child0 = BuildRange(leaves, split, depth + 1);
+		const int32 child1 = BuildRange(leaves + split, num - split, depth + 1);
+		const int32 index = AllocNode();
+		FNode& node = Nodes[index];
+		node.Children[0] = child0;
+		node.Children[1] = child1;
+		Nodes[child0].Parent = index;
+		Nodes[child1].Parent = index;
+		UpdateNode(index);
+		return index;
+	}
+
+	template <typename T>
+	FAABoundingBox TDynamicBVH<T>::Union(const FAABoundingBox& a, const FAABoundingBox& b)
+	{
+		return FAABoundingBox(
+			FFloat3(a.Min.X < b.Min.X ? a.Min.X : b.Min.X, a.Min.Y < b.Min.Y ? a.Min.Y : b.Min.Y, a.Min.Z < b.Min.Z ? a.Min.Z : b.Min.Z),
+			FFloat3(a.Max.X > b.Max.X ? a.Max.X : b.Max.X, a.Max.Y > b.Max.Y ? a.Max.Y : b.Max.Y, a.Max.Z > b.Max.Z ? a.Max.Z : b.Max.Z));
+	}
+
+	// Slabs with the reciprocal direction, a NaN of a ray inside a slab plane leaves that axis open.
+	template <typename T>
+	bool TDynamicBVH<T>::RayBox(const FRay& ray, const FAABoundingBox& box, FRay::FT maxDist, FRay::FT& enter)
+	{
+		FRay::FT tmin = 0.f, tmax = maxDist;
+		for (int32 axis = 0; axis < 3; ++axis)
+		{
+			const FRay::FT t0 = (box.Min[axis] - ray.P0[axis]) * ray.RcpNormal[axis];
+			const FRay::FT t1 = (box.Max[axis] - ray.P0[axis]) * ray.RcpNormal[axis];
+			const FRay::FT slabNear = t0 < t1 ? t0 : t1;
+			const FRay::FT slabFar = t0 < t1 ? t1 : t0;
+			tmin = slabNear > tmin ? slabNear : tmin;
+			tmax = slabFar < tmax ? slabFar : tmax;
+		}
+
+		enter = tmin;
+		return tmin <= tmax;
+	}
+}
@@ -0,0 +1,318 @@
+/*
+* file Frustum.h
+*
+* author luoxw
+* date 2018/03/26
+*
+* View frustum as six FPlane, extracted from a view-project matrix (row vectors, D3D clip z in [0, w]).
+* Boxes are tested as center and half size against every plane, conservative: boxes crossing
+* a plane or the frustum corners count as visible.
+* CullBoxes tests SoA batches, 4 boxes per SSE2 step or 8 per AVX2 step by GetSIMDLevel.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Matrix.h"
+#include "AABB.h"
+#include "Plane.h"
+#include "TransformBatch.h"
+
+namespace LostCore
+{
+	// Boxes in SoA streams of centers and half sizes, CenterX[i]... is the i-th box.
+	class FBoxStreams
+	{
+	public:
+		FORCEINLINE void Clear();
+		FORCEINLINE void Reserve(uint32 num);
+		FORCEINLINE void Add(const FFloat3& center, const FFloat3& extent);
+
+		// World space bounds of a local box, invalid boxes are infinite.
+		FORCEINLINE void AddTransformed(const FAABoundingBox& box, const FFloat4x4& world);
+
+		FORCEINLINE uint32 Num() const;
+		FORCEINLINE FConstFloat3SoA GetCenters() const;
+		FORCEINLINE FConstFloat3SoA GetExtents() const;
+
+	private:
+		vector<float> CenterX, CenterY, CenterZ;
+		vector<float> ExtentX, ExtentY, ExtentZ;
+	};
+
+	class FFrustum
+	{
+	public:
+		enum EPlane
+		{
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			NumPlanes,
+		};
+
+		// Normals point inside, p is on the inner side when Dot(p, Normal) >= Distance.
+		FPlane Planes[NumPlanes];
+
+	public:
+		FFrustum();
+		explicit FFrustum(const FFloat4x4& viewProject);
+
+		FORCEINLINE void Construct(const FFloat4x4& viewProject);
+
+		FORCEINLINE bool IsVisible(const FFloat3& center, const FFloat3& extent) const;
+		FORCEINLINE bool IsVisible(const FAABoundingBox& box) const;
+
+		// visible[i] is 1 for the boxes inside or crossing the frustum, 0 for the others.
+		// Returns the number of visible boxes.
+		FORCEINLINE uint32 CullBoxes(const FBoxStreams& boxes, uint8* visible) const;
+		FORCEINLINE uint32 CullBoxes(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count) const;
+
+	private:
+		uint32 ScalarCull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 begin, uint32 count) const;
+		uint32 SSE2Cull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count, uint32& numVisible) const;
+		uint32 AVX2Cull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count, uint32& numVisible) const;
+	};
+
+	FORCEINLINE void FBoxStreams::Clear()
+	{
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		ExtentX.clear();
+		ExtentY.clear();
+		ExtentZ.clear();
+	}
+
+	FORCEINLINE void FBoxStreams::Reserve(uint32 num)
+	{
+		CenterX.reserve(num);
+		CenterY.reserve(num);
+		CenterZ.reserve(num);
+		ExtentX.reserve(num);
+		ExtentY.reserve(num);
+		ExtentZ.reserve(num);
+	}
+
+	FORCEINLINE void FBoxStreams::Add(const FFloat3& center, const FFloat3& extent)
+	{
+		CenterX.push_back(center.X);
+		CenterY.push_back(center.Y);
+		CenterZ.push_back(center.Z);
+		ExtentX.push_back(extent.X);
+		ExtentY.push_back(extent.Y);
+		ExtentZ.push_back(extent.Z);
+	}
+
+	FORCEINLINE void FBoxStreams::AddTransformed(const FAABoundingBox& box, const FFloat4x4& world)
+	{
+		if (!box.IsValid())
+		{
+			Add(FFloat3::GetZero(), FFloat3(FLT_MAX, FLT_MAX, FLT_MAX));
+			return;
+		}
+
+		const FAABoundingBox bounds(GetTransformedBoundingBox(box, world));
+		Add((bounds.Min + bounds.Max) * 0.5f, (bounds.Max - bounds.Min) * 0.5f);
+	}
+
+	FORCEINLINE uint32 FBoxStreams::Num() const
+	{
+		return (uint32)CenterX.size();
+	}
+
+	FORCEINLINE FConstFloat3SoA FBoxStreams::GetCenters() const
+	{
+		return FConstFloat3SoA(CenterX.data(), CenterY.data(), CenterZ.data());
+	}
+
+	FORCEINLINE FConstFloat3SoA FBoxStreams::GetExtents() const
+	{
+		return FConstFloat3SoA(ExtentX.data(), ExtentY.data(), ExtentZ.data());
+	}
+
+	inline FFrustum::FFrustum()
+	{
+	}
+
+	inline FFrustum::FFrustum(const FFloat4x4& viewProject)
+	{
+		Construct(viewProject);
+	}
+
+	FORCEINLINE void FFrustum::Construct(const FFloat4x4& viewProject)
+	{
+		// Clip = p * m, a plane is a sum of the columns: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+		const auto& m = viewProject.M;
+		const float coefs[NumPlanes][4] =
+		{
+			{ m[0][3] + m[0][0], m[1][3] + m[1][0], m[2][3] + m[2][0], m[3][3] + m[3][0] },
+			{ m[0][3] - m[0][0], m[1][3] - m[1][0], m[2][3] - m[2][0], m[3][3] - m[3][0] },
+			{ m[0][3] + m[0][1], m[1][3] + m[1][1], m[2][3] + m[2][1], m[3][3] + m[3][1] },
+			{ m[0][3] - m[0][1], m[1][3] - m[1][1], m[2][3] - m[2][1], m[3][3] - m[3][1] },
+			{ m[0][2], m[1][2], m[2][2], m[3][2] },
+			{ m[0][3] - m[0][2], m[1][3] - m[1][2], m[2][3] - m[2][2], m[3][3] - m[3][2] },
+		};
+
+		for (int32 index = 0; index < NumPlanes; ++index)
+		{
+			const FFloat3 normal(coefs[index][0], coefs[index][1], coefs[index][2]);
+			const float size = normal.Size();
+			Planes[index] = FPlane(normal, size > 0.f ? -coefs[index][3] / size : 0.f);
+		}
+	}
+
+	FORCEINLINE bool FFrustum::IsVisible(const FFloat3& center, const FFloat3& extent) const
+	{
+		for (const auto& plane : Planes)
+		{
+			const FFloat3& n = plane.Normal;
+			const float radius = std::abs(n.X) * extent.X + std::abs(n.Y) * extent.Y + std::abs(n.Z) * extent.Z;
+			if (n.Dot(center) - plane.Distance + radius < 0.f)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	FORCEINLINE bool FFrustum::IsVisible(const FAABoundingBox& box) const
+	{
+		if (!box.IsValid())
+		{
+			return true;
+		}
+
+		return IsVisible((box.Min + box.Max) * 0.5f, (box.Max - box.Min) * 0.5f);
+	}
+
+	FORCEINLINE uint32 FFrustum::CullBoxes(const FBoxStreams& boxes, uint8* visible) const
+	{
+		return CullBoxes(boxes.GetCenters(), boxes.GetExtents(), visible, boxes.Num());
+	}
+
+	FORCEINLINE uint32 FFrustum::CullBoxes(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count) const
+	{
+		uint32 numVisible = 0;
+		const uint32 done = GetSIMDLevel() == ESIMDLevel::AVX2
+			? AVX2Cull(centers, extents, visible, count, numVisible)
+			: SSE2Cull(centers, extents, visible, count, numVisible);
+		return numVisible + ScalarCull(centers, extents, visible, done, count);
+	}
+
+	inline uint32 FFrustum::ScalarCull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 begin, uint32 count) const
+	{
+		uint32 numVisible = 0;
+		for (uint32 i = begin; i < count; ++i)
+		{
+			visible[i] = IsVisible(
+				FFloat3(centers.X[i], centers.Y[i], centers.Z[i]),
+				FFloat3(extents.X[i], extents.Y[i], extents.Z[i])) ? 1 : 0;
+			numVisible += visible[i];
+		}
+
+		return numVisible;
+	}
+
+	// Returns the number of boxes done, the rest is left to the scalar code.
+	inline uint32 FFrustum::SSE2Cull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count, uint32& numVisible) const
+	{
+		FVectorRegister nx[NumPlanes], ny[NumPlanes], nz[NumPlanes];
+		FVectorRegister ax[NumPlanes], ay[NumPlanes], az[NumPlanes], d[NumPlanes];
+		for (int32 index = 0; index < NumPlanes; ++index)
+		{
+			const FPlane& plane = Planes[index];
+			nx[index] = _mm_set1_ps(plane.Normal.X);
+			ny[index] = _mm_set1_ps(plane.Normal.Y);
+			nz[index] = _mm_set1_ps(plane.Normal.Z);
+			ax[index] = _mm_set1_ps(std::abs(plane.Normal.X));
+			ay[index] = _mm_set1_ps(std::abs(plane.Normal.Y));
+			az[index] = _mm_set1_ps(std::abs(plane.Normal.Z));
+			d[index] = _mm_set1_ps(plane.Distance);
+		}
+
+		const FVectorRegister zero = _mm_setzero_ps();
+		const uint32 num = count & ~3u;
+		for (uint32 i = 0; i < num; i += 4)
+		{
+			const FVectorRegister cx = _mm_loadu_ps(centers.X + i);
+			const FVectorRegister cy = _mm_loadu_ps(centers.Y + i);
+			const FVectorRegister cz = _mm_loadu_ps(centers.Z + i);
+			const FVectorRegister ex = _mm_loadu_ps(extents.X + i);
+			const FVectorRegister ey = _mm_loadu_ps(extents.Y + i);
+			const FVectorRegister ez = _mm_loadu_ps(extents.Z + i);
+
+			// Lanes stay set while the box reaches the inner side of every plane.
+			FVectorRegister inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int32 index = 0; index < NumPlanes; ++index)
+			{
+				FVectorRegister dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, nx[index]), _mm_mul_ps(cy, ny[index])), _mm_mul_ps(cz, nz[index]));
+				FVectorRegister radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ax[index]), _mm_mul_ps(ey, ay[index])), _mm_mul_ps(ez, az[index]));
+				dist = _mm_add_ps(_mm_sub_ps(dist, d[index]), radius);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+			}
+
+			const int32 mask = _mm_movemask_ps(inside);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				visible[i + lane] = (uint8)((mask >> lane) & 1);
+			}
+
+			numVisible += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+		}
+
+		return num;
+	}
+
+	inline uint32 FFrustum::AVX2Cull(const FConstFloat3SoA& centers, const FConstFloat3SoA& extents, uint8* visible, uint32 count, uint32& numVisible) const
+	{
+		__m256 nx[NumPlanes], ny[NumPlanes], nz[NumPlanes];
+		__m256 ax[NumPlanes], ay[NumPlanes], az[NumPlanes], d[NumPlanes];
+		for (int32 index = 0; index < NumPlanes; ++index)
+		{
+			const FPlane& plane = Planes[index];
+			nx[index] = _mm256_set1_ps(plane.Normal.X);
+			ny[index] = _mm256_set1_ps(plane.Normal.Y);
+			nz[index] = _mm256_set1_ps(plane.Normal.Z);
+			ax[index] = _mm256_set1_ps(std::abs(plane.Normal.X));
+			ay[index] = _mm256_set1_ps(std::abs(plane.Normal.Y));
+			az[index] = _mm256_set1_ps(std::abs(plane.Normal.Z));
+			d[index] = _mm256_set1_ps(plane.Distance);
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		const uint32 num = count & ~7u;
+		for (uint32 i = 0; i < num; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(centers.X + i);
+			const __m256 cy = _mm256_loadu_ps(centers.Y + i);
+			const __m256 cz = _mm256_loadu_ps(centers.Z + i);
+			const __m256 ex = _mm256_loadu_ps(extents.X + i);
+			const __m256 ey = _mm256_loadu_ps(extents.Y + i);
+			const __m256 ez = _mm256_loadu_ps(extents.Z + i);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int32 index = 0; index < NumPlanes; ++index)
+			{
+				const __m256 dist = _mm256_fmadd_ps(cx, nx[index], _mm256_fmadd_ps(cy, ny[index], _mm256_fmsub_ps(cz, nz[index], d[index])));
+				const __m256 radius = _mm256_fmadd_ps(ex, ax[index], _mm256_fmadd_ps(ey, ay[index], _mm256_mul_ps(ez, az[index])));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero, _CMP_GE_OQ));
+			}
+
+			const int32 mask = _mm256_movemask_ps(inside);
+			for (int32 lane = 0; lane < 8; ++lane)
+			{
+				visible[i + lane] = (uint8)((mask >> lane) & 1);
+			}
+
+			numVisible += (uint32)_mm_popcnt_u32((uint32)mask);
+		}
+
+		_mm256_zeroupper();
+		return num;
+	}
+}
@@ -42,9 +42,41 @@ namespace LostCore
 	}
 
 	// ߺཻ
+	// Moller-Trumbore, both sides hit, distance is along the ray in (0, ray.Distance).
 	static bool RayTriangleIntersect(const FRay& ray, const FTriangle& tri, FRay::FT& distance)
 	{
-		return false;
+		const FFloat3 e1(tri.P[1] - tri.P[0]);
+		const FFloat3 e2(tri.P[2] - tri.P[0]);
+		const FFloat3 p(ray.Normal.Cross(e2));
+		const FRay::FT det = e1.Dot(p);
+		if (det == (FRay::FT)0)
+		{
+			return false;
+		}
+
+		const FRay::FT inv = (FRay::FT)1 / det;
+		const FFloat3 s(ray.P0 - tri.P[0]);
+		const FRay::FT u = s.Dot(p) * inv;
+		if (u < (FRay::FT)0 || u > (FRay::FT)1)
+		{
+			return false;
+		}
+
+		const FFloat3 q(s.Cross(e1));
+		const FRay::FT v = ray.Normal.Dot(q) * inv;
+		if (v < (FRay::FT)0 || u + v > (FRay::FT)1)
+		{
+			return false;
+		}
+
+		const FRay::FT t = e2.Dot(q) * inv;
+		if (t <= (FRay::FT)0 || t >= ray.Distance)
+		{
+			return false;
+		}
+
+		distance = t;
+		return true;
 	}
 
 	// ߺAABBཻ,Գɹtruedistanceཻ.
@@ -0,0 +1,220 @@
+/*
+* file MathSIMD.h
+*
+* author luoxw
+* date 2018/03/18
+*
+* SSE helpers of the *Vectorized math classes.
+* MATH_VECTORIZED picks which implementation FFloat4, FQuat, FFloat4x4 and FTransform
+* stand for, 1 for the *Vectorized classes, 0 for the *NonVectorized ones.
+* Both keep the same public members and memory layout, serialized data and
+* constant buffers do not depend on the switch.
+* Only SSE2 is required, __AVX__ (/arch:AVX) enables the 256-bit paths.
+* Batch kernels (TransformBatch.h) pick SSE2 or AVX2 at runtime by GetSIMDLevel.
+*/
+
+#pragma once
+
+#include "MathBase.h"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <intrin.h>
+
+#ifndef MATH_VECTORIZED
+#define MATH_VECTORIZED 1
+#endif
+
+#define VECTOR_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+
+// Result lanes are (v[x], v[y], v[z], v[w]).
+#define VectorSwizzle(v, x, y, z, w) _mm_shuffle_ps((v), (v), VECTOR_SHUFFLE_MASK(x, y, z, w))
+
+// Result lanes are (v1[x], v1[y], v2[z], v2[w]).
+#define VectorShuffle(v1, v2, x, y, z, w) _mm_shuffle_ps((v1), (v2), VECTOR_SHUFFLE_MASK(x, y, z, w))
+
+#define VectorReplicate(v, i) VectorSwizzle(v, i, i, i, i)
+
+namespace LostCore
+{
+	typedef __m128 FVectorRegister;
+
+	enum class ESIMDLevel : uint8
+	{
+		SSE2,
+		AVX2,	// with FMA3
+	};
+
+	// Highest level supported by both the cpu and the os.
+	FORCEINLINE ESIMDLevel DetectSIMDLevel()
+	{
+		int32 info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return ESIMDLevel::SSE2;
+		}
+
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		if (!osxsave || !avx || !fma || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return ESIMDLevel::SSE2;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0 ? ESIMDLevel::AVX2 : ESIMDLevel::SSE2;
+	}
+
+	FORCEINLINE ESIMDLevel& GetSIMDLevelRef()
+	{
+		static ESIMDLevel SLevel = DetectSIMDLevel();
+		return SLevel;
+	}
+
+	FORCEINLINE ESIMDLevel GetSIMDLevel()
+	{
+		return GetSIMDLevelRef();
+	}
+
+	// Benchmarks lower the level to compare the kernels, it never goes above the detected one.
+	FORCEINLINE void SetSIMDLevel(ESIMDLevel level)
+	{
+		GetSIMDLevelRef() = (uint8)level <= (uint8)DetectSIMDLevel() ? level : DetectSIMDLevel();
+	}
+
+	// Unaligned loads and stores, as fast as the aligned ones when the data is aligned.
+	FORCEINLINE FVectorRegister VectorLoad(const float* ptr)
+	{
+		return _mm_loadu_ps(ptr);
+	}
+
+	FORCEINLINE FVectorRegister VectorLoadFloat3(const float* ptr, float w = 0.f)
+	{
+		return _mm_setr_ps(ptr[0], ptr[1], ptr[2], w);
+	}
+
+	FORCEINLINE void VectorStore(float* ptr, FVectorRegister v)
+	{
+		_mm_storeu_ps(ptr, v);
+	}
+
+	FORCEINLINE void VectorStoreFloat3(float* ptr, FVectorRegister v)
+	{
+		_mm_storel_pi((__m64*)ptr, v);
+		_mm_store_ss(ptr + 2, VectorReplicate(v, 2));
+	}
+
+	FORCEINLINE FVectorRegister VectorSet(float x, float y, float z, float w)
+	{
+		return _mm_setr_ps(x, y, z, w);
+	}
+
+	FORCEINLINE FVectorRegister VectorSetFloat1(float value)
+	{
+		return _mm_set1_ps(value);
+	}
+
+	FORCEINLINE FVectorRegister VectorZero()
+	{
+		return _mm_setzero_ps();
+	}
+
+	FORCEINLINE float VectorGetX(FVectorRegister v)
+	{
+		return _mm_cvtss_f32(v);
+	}
+
+	FORCEINLINE FVectorRegister VectorAdd(FVectorRegister v1, FVectorRegister v2)
+	{
+		return _mm_add_ps(v1, v2);
+	}
+
+	FORCEINLINE FVectorRegister VectorSubtract(FVectorRegister v1, FVectorRegister v2)
+	{
+		return _mm_sub_ps(v1, v2);
+	}
+
+	FORCEINLINE FVectorRegister VectorMultiply(FVectorRegister v1, FVectorRegister v2)
+	{
+		return _mm_mul_ps(v1, v2);
+	}
+
+	// v1 * v2 + v3
+	FORCEINLINE FVectorRegister VectorMultiplyAdd(FVectorRegister v1, FVectorRegister v2, FVectorRegister v3)
+	{
+		return _mm_add_ps(_mm_mul_ps(v1, v2), v3);
+	}
+
+	FORCEINLINE FVectorRegister VectorNegate(FVectorRegister v)
+	{
+		return _mm_sub_ps(_mm_setzero_ps(), v);
+	}
+
+	// Dot product replicated to all lanes.
+	FORCEINLINE FVectorRegister VectorDot4(FVectorRegister v1, FVectorRegister v2)
+	{
+		FVectorRegister t = _mm_mul_ps(v1, v2);
+		t = _mm_add_ps(t, VectorSwizzle(t, 1, 0, 3, 2));
+		return _mm_add_ps(t, VectorSwizzle(t, 2, 3, 0, 1));
+	}
+
+	FORCEINLINE FVectorRegister VectorDot3(FVectorRegister v1, FVectorRegister v2)
+	{
+		FVectorRegister t = _mm_mul_ps(v1, v2);
+		return _mm_add_ps(VectorReplicate(t, 0), _mm_add_ps(VectorReplicate(t, 1), VectorReplicate(t, 2)));
+	}
+
+	// W is 0 for any input.
+	FORCEINLINE FVectorRegister VectorCross(FVectorRegister v1, FVectorRegister v2)
+	{
+		FVectorRegister t = _mm_sub_ps(
+			_mm_mul_ps(v1, VectorSwizzle(v2, 1, 2, 0, 3)),
+			_mm_mul_ps(VectorSwizzle(v1, 1, 2, 0, 3), v2));
+		return VectorSwizzle(t, 1, 2, 0, 3);
+	}
+
+	FORCEINLINE FVectorRegister VectorAbs(FVectorRegister v)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+	}
+
+	// Bit 0..3 set for the equal lanes.
+	FORCEINLINE int32 VectorMaskEqual(FVectorRegister v1, FVectorRegister v2)
+	{
+		return _mm_movemask_ps(_mm_cmpeq_ps(v1, v2));
+	}
+
+	// Same test as IsEqual, bit 0..3 set for the lanes within tolerance.
+	FORCEINLINE int32 VectorMaskNearlyEqual(FVectorRegister v1, FVectorRegister v2, float tolerance = SSmallFloat)
+	{
+		return _mm_movemask_ps(_mm_cmplt_ps(VectorAbs(_mm_sub_ps(v1, v2)), _mm_set1_ps(tolerance)));
+	}
+
+	// Quaternions as (x, y, z, w), same product as FQuatNonVectorized::operator*.
+	FORCEINLINE FVectorRegister VectorQuaternionMultiply(FVectorRegister q1, FVectorRegister q2)
+	{
+		FVectorRegister result = VectorMultiply(VectorReplicate(q1, 3), q2);
+		result = VectorMultiplyAdd(VectorMultiply(VectorReplicate(q1, 0), VectorSet(1.f, -1.f, 1.f, -1.f)), VectorSwizzle(q2, 3, 2, 1, 0), result);
+		result = VectorMultiplyAdd(VectorMultiply(VectorReplicate(q1, 1), VectorSet(1.f, 1.f, -1.f, -1.f)), VectorSwizzle(q2, 2, 3, 0, 1), result);
+		result = VectorMultiplyAdd(VectorMultiply(VectorReplicate(q1, 2), VectorSet(-1.f, 1.f, 1.f, -1.f)), VectorSwizzle(q2, 1, 0, 3, 2), result);
+		return result;
+	}
+
+	// Identity for a degenerated quaternion, as FQuatNonVectorized::Normalize.
+	FORCEINLINE FVectorRegister VectorQuaternionNormalize(FVectorRegister q)
+	{
+		FVectorRegister squared = VectorDot4(q, q);
+		if (VectorGetX(squared) > SSmallFloat)
+		{
+			return _mm_div_ps(q, _mm_sqrt_ps(squared));
+		}
+		else
+		{
+			return VectorSet(0.f, 0.f, 0.f, 1.f);
+		}
+	}
+}
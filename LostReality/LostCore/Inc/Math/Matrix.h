@@ -13,6 +13,7 @@
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Quat.h"
+#include "MatrixVectorized.h"
 
 namespace LostCore
 {
@@ -585,7 +586,7 @@ namespace LostCore
 			result.M[3][1] += rhs.M[3][1];
 			result.M[3][2] += rhs.M[3][2];
 			result.M[3][3] += rhs.M[3][3];
-			return TMatrixNonVectorized<T>;
+			return result;
 		}
 
 		template <typename T2>
@@ -712,7 +713,11 @@ namespace LostCore
 #error "TYPEDEF_DECL_MATRIX already defined somewhere else"
 #endif
 
+#if MATH_VECTORIZED
+typedef FMatrixVectorized FFloat4x4;
+#else
 typedef TMatrixNonVectorized<float> FFloat4x4;
+#endif
 typedef TMatrixNonVectorized<double> FDouble4x4;
 
 #define TYPEDEF_DECL_MATRIX
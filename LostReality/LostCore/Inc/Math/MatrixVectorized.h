@@ -0,0 +1,633 @@
+/*
+* file MatrixVectorized.h
+*
+* author luoxw
+* date 2018/03/18
+*
+* SSE version of TMatrixNonVectorized<float>, same members and layout(row vector, row major).
+* Multiply, inverse, transpose and point/vector transformation run on the rows as
+* FVectorRegister, the rest is the same scalar code as TMatrixNonVectorized.
+* 4x4 inverse is the 2x2 block matrix method described by Eric Zhang,
+* https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Quat.h"
+
+namespace LostCore
+{
+	class FMatrixVectorized
+	{
+
+	public:
+		typedef float FT;
+		float M[4][4];
+
+		FMatrixVectorized()
+		{
+			SetIdentity();
+		}
+
+		FORCEINLINE FVectorRegister LoadRow(int32 row) const
+		{
+			return VectorLoad(M[row]);
+		}
+
+		FORCEINLINE void StoreRow(int32 row, FVectorRegister vec)
+		{
+			VectorStore(M[row], vec);
+		}
+
+		void SetRow(int32 row, const FFloat4& vec)
+		{
+			StoreRow(row, VectorLoad(&vec.X));
+		}
+
+		FFloat4 GetRow(int32 row) const
+		{
+			FFloat4 vec;
+			VectorStore(&vec.X, LoadRow(row));
+			return vec;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetZero()
+		{
+			const FVectorRegister zero = VectorZero();
+			StoreRow(0, zero);
+			StoreRow(1, zero);
+			StoreRow(2, zero);
+			StoreRow(3, zero);
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetIdentity()
+		{
+			StoreRow(0, VectorSet(1.f, 0.f, 0.f, 0.f));
+			StoreRow(1, VectorSet(0.f, 1.f, 0.f, 0.f));
+			StoreRow(2, VectorSet(0.f, 0.f, 1.f, 0.f));
+			StoreRow(3, VectorSet(0.f, 0.f, 0.f, 1.f));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetScale(const float x, const float y, const float z)
+		{
+			StoreRow(0, VectorSet(x, 0.f, 0.f, 0.f));
+			StoreRow(1, VectorSet(0.f, y, 0.f, 0.f));
+			StoreRow(2, VectorSet(0.f, 0.f, z, 0.f));
+			StoreRow(3, VectorSet(0.f, 0.f, 0.f, 1.f));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetScale(const FFloat3& scale)
+		{
+			return SetScale(scale.X, scale.Y, scale.Z);
+		}
+
+		FORCEINLINE FMatrixVectorized& SetTranslate(const float x, const float y, const float z)
+		{
+			StoreRow(0, VectorSet(1.f, 0.f, 0.f, 0.f));
+			StoreRow(1, VectorSet(0.f, 1.f, 0.f, 0.f));
+			StoreRow(2, VectorSet(0.f, 0.f, 1.f, 0.f));
+			StoreRow(3, VectorSet(x, y, z, 1.f));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetTranslate(const FFloat3& translate)
+		{
+			return SetTranslate(translate.X, translate.Y, translate.Z);
+		}
+
+		FORCEINLINE FMatrixVectorized& AddTranslate(const FFloat3& delta)
+		{
+			return SetTranslate(M[3][0] + delta.X, M[3][1] + delta.Y, M[3][2] + delta.Z);
+		}
+
+		FORCEINLINE FMatrixVectorized& SetRotateAndOrigin(const FQuat& q, const FFloat3& origin, const FFloat3& scale = FFloat3(1.f, 1.f, 1.f))
+		{
+			SetRotate(q);
+			StoreRow(3, VectorSet(origin.X, origin.Y, origin.Z, 1.f));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetRotate(const FQuat& q)
+		{
+			const float xx = q.X * q.X * 2.f;
+			const float xy = q.X * q.Y * 2.f;
+			const float xz = q.X * q.Z * 2.f;
+
+			const float yy = q.Y * q.Y * 2.f;
+			const float yz = q.Y * q.Z * 2.f;
+
+			const float zz = q.Z * q.Z * 2.f;
+
+			const float wx = q.W * q.X * 2.f;
+			const float wy = q.W * q.Y * 2.f;
+			const float wz = q.W * q.Z * 2.f;
+
+			StoreRow(0, VectorSet(1.f - (yy + zz), xy + wz, xz - wy, 0.f));
+			StoreRow(1, VectorSet(xy - wz, 1.f - (xx + zz), yz + wx, 0.f));
+			StoreRow(2, VectorSet(xz + wy, yz - wx, 1.f - (xx + yy), 0.f));
+			StoreRow(3, VectorSet(0.f, 0.f, 0.f, 1.f));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& SetRotate(const FFloat3& euler)
+		{
+			return SetRotate(FQuat().FromEuler(euler));
+		}
+
+		// this = m1 * m2
+		FORCEINLINE FMatrixVectorized& Multiply(const FMatrixVectorized& m1, const FMatrixVectorized& m2)
+		{
+			*this = m1 * m2;
+			return *this;
+		}
+
+		// this = m * this
+		FORCEINLINE FMatrixVectorized& PreMultiply(const FMatrixVectorized& m)
+		{
+			*this = m * (*this);
+			return *this;
+		}
+
+		// this = this * m
+		FORCEINLINE FMatrixVectorized& PostMultiply(const FMatrixVectorized& m)
+		{
+			*this = (*this) * m;
+			return *this;
+		}
+
+		// Inverse of the 3x4 part, column 3 is left untouched as TMatrixNonVectorized::Invert34.
+		FORCEINLINE FMatrixVectorized& Invert34()
+		{
+			const FVectorRegister r0 = LoadRow(0);
+			const FVectorRegister r1 = LoadRow(1);
+			const FVectorRegister r2 = LoadRow(2);
+			const FVectorRegister r3 = LoadRow(3);
+
+			// Columns of the adjugate, w is 0.
+			FVectorRegister c0 = VectorCross(r1, r2);
+			FVectorRegister c1 = VectorCross(r2, r0);
+			FVectorRegister c2 = VectorCross(r0, r1);
+			FVectorRegister c3 = VectorZero();
+
+			const FVectorRegister det = VectorDot3(r0, c0);
+			assert(!IsZero(VectorGetX(det)) && "the matrix is not invertible 34");
+
+			const FVectorRegister rcp = _mm_div_ps(VectorSetFloat1(1.f), det);
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			c0 = VectorMultiply(c0, rcp);
+			c1 = VectorMultiply(c1, rcp);
+			c2 = VectorMultiply(c2, rcp);
+
+			FVectorRegister t = VectorMultiply(VectorReplicate(r3, 0), c0);
+			t = VectorMultiplyAdd(VectorReplicate(r3, 1), c1, t);
+			t = VectorMultiplyAdd(VectorReplicate(r3, 2), c2, t);
+			t = VectorNegate(t);
+
+			const FVectorRegister mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+			StoreRow(0, _mm_or_ps(_mm_and_ps(mask, c0), _mm_andnot_ps(mask, r0)));
+			StoreRow(1, _mm_or_ps(_mm_and_ps(mask, c1), _mm_andnot_ps(mask, r1)));
+			StoreRow(2, _mm_or_ps(_mm_and_ps(mask, c2), _mm_andnot_ps(mask, r2)));
+			StoreRow(3, _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, r3)));
+			return *this;
+		}
+
+		FORCEINLINE float GetDeterminant34() const
+		{
+			return VectorGetX(VectorDot3(LoadRow(0), VectorCross(LoadRow(1), LoadRow(2))));
+		}
+
+		FORCEINLINE FMatrixVectorized& Invert()
+		{
+			const FVectorRegister r0 = LoadRow(0);
+			const FVectorRegister r1 = LoadRow(1);
+			const FVectorRegister r2 = LoadRow(2);
+			const FVectorRegister r3 = LoadRow(3);
+
+			// 2x2 sub matrices, | A B |
+			//                   | C D |
+			const FVectorRegister a = _mm_movelh_ps(r0, r1);
+			const FVectorRegister b = _mm_movehl_ps(r1, r0);
+			const FVectorRegister c = _mm_movelh_ps(r2, r3);
+			const FVectorRegister d = _mm_movehl_ps(r3, r2);
+
+			// (|A|, |B|, |C|, |D|)
+			const FVectorRegister detSub = VectorSubtract(
+				VectorMultiply(VectorShuffle(r0, r2, 0, 2, 0, 2), VectorShuffle(r1, r3, 1, 3, 1, 3)),
+				VectorMultiply(VectorShuffle(r0, r2, 1, 3, 1, 3), VectorShuffle(r1, r3, 0, 2, 0, 2)));
+			const FVectorRegister detA = VectorReplicate(detSub, 0);
+			const FVectorRegister detB = VectorReplicate(detSub, 1);
+			const FVectorRegister detC = VectorReplicate(detSub, 2);
+			const FVectorRegister detD = VectorReplicate(detSub, 3);
+
+			// D#C and A#B, # for adjugate
+			const FVectorRegister dc = Mat2AdjMul(d, c);
+			const FVectorRegister ab = Mat2AdjMul(a, b);
+
+			// inverse = 1/|M| * | X Y |
+			//                   | Z W |
+			FVectorRegister x = VectorSubtract(VectorMultiply(detD, a), Mat2Mul(b, dc));
+			FVectorRegister w = VectorSubtract(VectorMultiply(detA, d), Mat2Mul(c, ab));
+			FVectorRegister y = VectorSubtract(VectorMultiply(detB, c), Mat2MulAdj(d, ab));
+			FVectorRegister z = VectorSubtract(VectorMultiply(detC, b), Mat2MulAdj(a, dc));
+
+			// |M| = |A|*|D| + |B|*|C| - tr((A#B)(D#C))
+			FVectorRegister tr = VectorMultiply(ab, VectorSwizzle(dc, 0, 2, 1, 3));
+			tr = VectorAdd(tr, VectorSwizzle(tr, 2, 3, 0, 1));
+			tr = VectorAdd(tr, VectorSwizzle(tr, 1, 0, 3, 2));
+			const FVectorRegister det = VectorSubtract(VectorAdd(VectorMultiply(detA, detD), VectorMultiply(detB, detC)), tr);
+			assert(!IsZero(VectorGetX(det)) && "the matrix is not invertible");
+
+			const FVectorRegister rcp = _mm_div_ps(VectorSet(1.f, -1.f, -1.f, 1.f), det);
+			x = VectorMultiply(x, rcp);
+			y = VectorMultiply(y, rcp);
+			z = VectorMultiply(z, rcp);
+			w = VectorMultiply(w, rcp);
+
+			// Adjugate the blocks and store.
+			StoreRow(0, VectorShuffle(x, y, 3, 1, 3, 1));
+			StoreRow(1, VectorShuffle(x, y, 2, 0, 2, 0));
+			StoreRow(2, VectorShuffle(z, w, 3, 1, 3, 1));
+			StoreRow(3, VectorShuffle(z, w, 2, 0, 2, 0));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized GetInvert() const
+		{
+			FMatrixVectorized result(*this);
+			return result.Invert();
+		}
+
+		FORCEINLINE float GetDeterminant() const
+		{
+			float a0 = M[0][0] * M[1][1] - M[0][1] * M[1][0];
+			float a1 = M[0][0] * M[1][2] - M[0][2] * M[1][0];
+			float a2 = M[0][0] * M[1][3] - M[0][3] * M[1][0];
+			float a3 = M[0][1] * M[1][2] - M[0][2] * M[1][1];
+			float a4 = M[0][1] * M[1][3] - M[0][3] * M[1][1];
+			float a5 = M[0][2] * M[1][3] - M[0][3] * M[1][2];
+
+			float b0 = M[2][0] * M[3][1] - M[2][1] * M[3][0];
+			float b1 = M[2][0] * M[3][2] - M[2][2] * M[3][0];
+			float b2 = M[2][0] * M[3][3] - M[2][3] * M[3][0];
+			float b3 = M[2][1] * M[3][2] - M[2][2] * M[3][1];
+			float b4 = M[2][1] * M[3][3] - M[2][3] * M[3][1];
+			float b5 = M[2][2] * M[3][3] - M[2][3] * M[3][2];
+
+			return a0*b5 - a1*b4 + a2*b3 + a3*b2 - a4*b1 + a5*b0;
+		}
+
+		// NOTE: view matrix
+		FORCEINLINE FMatrixVectorized& LookAt(const FFloat3& pos, const FFloat3& dir, const FFloat3& up)
+		{
+			FFloat3 u, d, r;
+
+			u = up.GetNormal();
+			d = dir.GetNormal();
+			r = u.Cross(d);
+			r.Normalize();
+			u = d.Cross(r);
+			u.Normalize();
+
+			M[0][0] = r.X; M[0][1] = u.X; M[0][2] = d.X; M[0][3] = 0.f;
+			M[1][0] = r.Y; M[1][1] = u.Y; M[1][2] = d.Y; M[1][3] = 0.f;
+			M[2][0] = r.Z; M[2][1] = u.Z; M[2][2] = d.Z; M[2][3] = 0.f;
+			M[3][0] = -pos.Dot(r);
+			M[3][1] = -pos.Dot(u);
+			M[3][2] = -pos.Dot(d);
+			M[3][3] = 1.f;
+
+			return *this;
+		}
+
+		// Row vector times the matrix.
+		FORCEINLINE FVectorRegister ApplyVector4(FVectorRegister p) const
+		{
+			FVectorRegister ret = VectorMultiply(VectorReplicate(p, 0), LoadRow(0));
+			ret = VectorMultiplyAdd(VectorReplicate(p, 1), LoadRow(1), ret);
+			ret = VectorMultiplyAdd(VectorReplicate(p, 2), LoadRow(2), ret);
+			ret = VectorMultiplyAdd(VectorReplicate(p, 3), LoadRow(3), ret);
+			return ret;
+		}
+
+		FORCEINLINE void ApplyVector4(FFloat4& ret, const FFloat4& p) const
+		{
+			VectorStore(&ret.X, ApplyVector4(VectorLoad(&p.X)));
+		}
+
+		FORCEINLINE void ApplyPoint(FFloat3& ret, const FFloat3& p) const
+		{
+			FVectorRegister ret4 = VectorMultiplyAdd(VectorSetFloat1(p.X), LoadRow(0), LoadRow(3));
+			ret4 = VectorMultiplyAdd(VectorSetFloat1(p.Y), LoadRow(1), ret4);
+			ret4 = VectorMultiplyAdd(VectorSetFloat1(p.Z), LoadRow(2), ret4);
+			VectorStoreFloat3(&ret.X, ret4);
+		}
+
+		FORCEINLINE FFloat3 ApplyPoint(const FFloat3& p) const
+		{
+			FFloat3 ret;
+			ApplyPoint(ret, p);
+			return ret;
+		}
+
+		FORCEINLINE void ApplyVector(FFloat3& ret, const FFloat3& v) const
+		{
+			FVectorRegister ret4 = VectorMultiply(VectorSetFloat1(v.X), LoadRow(0));
+			ret4 = VectorMultiplyAdd(VectorSetFloat1(v.Y), LoadRow(1), ret4);
+			ret4 = VectorMultiplyAdd(VectorSetFloat1(v.Z), LoadRow(2), ret4);
+			VectorStoreFloat3(&ret.X, ret4);
+		}
+
+		FORCEINLINE FFloat3 ApplyVector(const FFloat3& v) const
+		{
+			FFloat3 ret;
+			ApplyVector(ret, v);
+			return ret;
+		}
+
+		FORCEINLINE FFloat3 GetScale() const
+		{
+			FFloat3 scale(FFloat3::GetZero());
+
+			const float squared0 = M[0][0] * M[0][0] + M[0][1] * M[0][1] + M[0][2] * M[0][2];
+			const float squared1 = M[1][0] * M[1][0] + M[1][1] * M[1][1] + M[1][2] * M[1][2];
+			const float squared2 = M[2][0] * M[2][0] + M[2][1] * M[2][1] + M[2][2] * M[2][2];
+
+			if (squared0 > SSmallFloat)
+			{
+				scale.X = LostCore::Sqrt(squared0);
+			}
+
+			if (squared1 > SSmallFloat)
+			{
+				scale.Y = LostCore::Sqrt(squared1);
+			}
+
+			if (squared2 > SSmallFloat)
+			{
+				scale.Z = LostCore::Sqrt(squared2);
+			}
+
+			return scale;
+		}
+
+		FORCEINLINE FQuat GetOrientation() const
+		{
+			FQuat quat;
+			const float tr = M[0][0] + M[1][1] + M[2][2];
+			if (tr > 0.f)
+			{
+				float invsqrt = LostCore::InvSqrt(tr + 1.f);
+				float s = 0.5f * invsqrt;
+				quat.X = (M[1][2] - M[2][1]) * s;
+				quat.Y = (M[2][0] - M[0][2]) * s;
+				quat.Z = (M[0][1] - M[1][0]) * s;
+				quat.W = 0.5f * (1.f / invsqrt);
+			}
+			else
+			{
+				int32 i = 0;
+				if (M[1][1] > M[0][0])
+				{
+					i = 1;
+				}
+
+				if (M[2][2] > M[i][i])
+				{
+					i = 2;
+				}
+
+				static const int32 nxt[3] = { 1,2,0 };
+				const int32 j = nxt[i];
+				const int32 k = nxt[j];
+				float s = M[i][i] - M[j][j] - M[k][k] + 1.f;
+				float invsqrt = LostCore::InvSqrt(s);
+				float qt[4];
+				qt[i] = 0.5f*(1.f / invsqrt);
+				s = 0.5f * invsqrt;
+				qt[3] = (M[j][k] - M[k][j]) * s;
+				qt[j] = (M[i][j] + M[j][i]) * s;
+				qt[k] = (M[i][k] + M[k][i]) * s;
+
+				quat.X = qt[0];
+				quat.Y = qt[1];
+				quat.Z = qt[2];
+				quat.W = qt[3];
+			}
+
+			return quat;
+		}
+
+		FORCEINLINE FFloat3 GetOrigin() const
+		{
+			return FFloat3(M[3][0], M[3][1], M[3][2]);
+		}
+
+		FORCEINLINE FMatrixVectorized& Scale(const FFloat3& val)
+		{
+			// Column 3 is multiplied by 1.
+			StoreRow(0, VectorMultiply(LoadRow(0), VectorSet(val.X, val.X, val.X, 1.f)));
+			StoreRow(1, VectorMultiply(LoadRow(1), VectorSet(val.Y, val.Y, val.Y, 1.f)));
+			StoreRow(2, VectorMultiply(LoadRow(2), VectorSet(val.Z, val.Z, val.Z, 1.f)));
+			return *this;
+		}
+
+		FORCEINLINE bool operator==(const FMatrixVectorized& rhs) const
+		{
+			return (VectorMaskEqual(LoadRow(0), rhs.LoadRow(0))
+				& VectorMaskEqual(LoadRow(1), rhs.LoadRow(1))
+				& VectorMaskEqual(LoadRow(2), rhs.LoadRow(2))
+				& VectorMaskEqual(LoadRow(3), rhs.LoadRow(3))) == 0xf;
+		}
+
+		FORCEINLINE FMatrixVectorized& operator=(const FMatrixVectorized& rhs)
+		{
+			StoreRow(0, rhs.LoadRow(0));
+			StoreRow(1, rhs.LoadRow(1));
+			StoreRow(2, rhs.LoadRow(2));
+			StoreRow(3, rhs.LoadRow(3));
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized operator-() const
+		{
+			FMatrixVectorized result(*this);
+			result.StoreRow(0, VectorNegate(LoadRow(0)));
+			result.StoreRow(1, VectorNegate(LoadRow(1)));
+			result.StoreRow(2, VectorNegate(LoadRow(2)));
+			result.StoreRow(3, VectorNegate(LoadRow(3)));
+			return result;
+		}
+
+		FORCEINLINE FMatrixVectorized operator+(const FMatrixVectorized& rhs) const
+		{
+			FMatrixVectorized result(*this);
+			result.StoreRow(0, VectorAdd(LoadRow(0), rhs.LoadRow(0)));
+			result.StoreRow(1, VectorAdd(LoadRow(1), rhs.LoadRow(1)));
+			result.StoreRow(2, VectorAdd(LoadRow(2), rhs.LoadRow(2)));
+			result.StoreRow(3, VectorAdd(LoadRow(3), rhs.LoadRow(3)));
+			return result;
+		}
+
+		FORCEINLINE FMatrixVectorized operator-(const FMatrixVectorized& rhs) const
+		{
+			FMatrixVectorized result(*this);
+			result.StoreRow(0, VectorSubtract(LoadRow(0), rhs.LoadRow(0)));
+			result.StoreRow(1, VectorSubtract(LoadRow(1), rhs.LoadRow(1)));
+			result.StoreRow(2, VectorSubtract(LoadRow(2), rhs.LoadRow(2)));
+			result.StoreRow(3, VectorSubtract(LoadRow(3), rhs.LoadRow(3)));
+			return result;
+		}
+
+		// Scaled by a scalar, the curves interpolate matrices with double.
+		template <typename T2>
+		FORCEINLINE FMatrixVectorized operator*(const T2& rhs) const
+		{
+			const FVectorRegister s = VectorSetFloat1(static_cast<float>(rhs));
+			FMatrixVectorized result(*this);
+			result.StoreRow(0, VectorMultiply(LoadRow(0), s));
+			result.StoreRow(1, VectorMultiply(LoadRow(1), s));
+			result.StoreRow(2, VectorMultiply(LoadRow(2), s));
+			result.StoreRow(3, VectorMultiply(LoadRow(3), s));
+			return result;
+		}
+
+		FORCEINLINE FMatrixVectorized operator*(const FMatrixVectorized& rhs) const
+		{
+			FMatrixVectorized result(*this);
+
+#if defined(__AVX__)
+			// Two rows per register, the rows of rhs are broadcast to both lanes.
+			const __m256 b0 = _mm256_broadcast_ps((const __m128*)rhs.M[0]);
+			const __m256 b1 = _mm256_broadcast_ps((const __m128*)rhs.M[1]);
+			const __m256 b2 = _mm256_broadcast_ps((const __m128*)rhs.M[2]);
+			const __m256 b3 = _mm256_broadcast_ps((const __m128*)rhs.M[3]);
+			for (int32 i = 0; i < 4; i += 2)
+			{
+				const __m256 a = _mm256_loadu_ps(M[i]);
+				__m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(0, 0, 0, 0)), b0);
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(1, 1, 1, 1)), b1));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(2, 2, 2, 2)), b2));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(3, 3, 3, 3)), b3));
+				_mm256_storeu_ps(result.M[i], r);
+			}
+#else
+			const FVectorRegister b0 = rhs.LoadRow(0);
+			const FVectorRegister b1 = rhs.LoadRow(1);
+			const FVectorRegister b2 = rhs.LoadRow(2);
+			const FVectorRegister b3 = rhs.LoadRow(3);
+			for (int32 i = 0; i < 4; ++i)
+			{
+				const FVectorRegister a = LoadRow(i);
+				FVectorRegister r = VectorMultiply(VectorReplicate(a, 0), b0);
+				r = VectorMultiplyAdd(VectorReplicate(a, 1), b1, r);
+				r = VectorMultiplyAdd(VectorReplicate(a, 2), b2, r);
+				r = VectorMultiplyAdd(VectorReplicate(a, 3), b3, r);
+				result.StoreRow(i, r);
+			}
+#endif
+
+			return result;
+		}
+
+		FORCEINLINE FMatrixVectorized& Transpose()
+		{
+			FVectorRegister r0 = LoadRow(0);
+			FVectorRegister r1 = LoadRow(1);
+			FVectorRegister r2 = LoadRow(2);
+			FVectorRegister r3 = LoadRow(3);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			StoreRow(0, r0);
+			StoreRow(1, r1);
+			StoreRow(2, r2);
+			StoreRow(3, r3);
+			return *this;
+		}
+
+		FORCEINLINE FMatrixVectorized& Normalize3x3()
+		{
+			const FVectorRegister mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+			for (int32 i = 0; i < 3; ++i)
+			{
+				const FVectorRegister row = LoadRow(i);
+				const FVectorRegister squared = VectorDot3(row, row);
+				const FVectorRegister normal = VectorGetX(squared) > SSmallFloat ? _mm_div_ps(row, _mm_sqrt_ps(squared)) : VectorZero();
+				StoreRow(i, _mm_or_ps(_mm_and_ps(mask, normal), _mm_andnot_ps(mask, row)));
+			}
+
+			return *this;
+		}
+
+		FORCEINLINE FFloat3 GetRightVector() const
+		{
+			return FFloat3(M[0][0], M[0][1], M[0][2]);
+		}
+
+		FORCEINLINE FFloat3 GetUpVector() const
+		{
+			return FFloat3(M[1][0], M[1][1], M[1][2]);
+		}
+
+		FORCEINLINE FFloat3 GetForwardVector() const
+		{
+			return FFloat3(M[2][0], M[2][1], M[2][2]);
+		}
+
+	private:
+		// 2x2 row major matrices packed as (m00, m01, m10, m11).
+		// m1 * m2
+		static FORCEINLINE FVectorRegister Mat2Mul(FVectorRegister m1, FVectorRegister m2)
+		{
+			return VectorAdd(
+				VectorMultiply(m1, VectorSwizzle(m2, 0, 3, 0, 3)),
+				VectorMultiply(VectorSwizzle(m1, 1, 0, 3, 2), VectorSwizzle(m2, 2, 1, 2, 1)));
+		}
+
+		// adj(m1) * m2
+		static FORCEINLINE FVectorRegister Mat2AdjMul(FVectorRegister m1, FVectorRegister m2)
+		{
+			return VectorSubtract(
+				VectorMultiply(VectorSwizzle(m1, 3, 3, 0, 0), m2),
+				VectorMultiply(VectorSwizzle(m1, 1, 1, 2, 2), VectorSwizzle(m2, 2, 3, 0, 1)));
+		}
+
+		// m1 * adj(m2)
+		static FORCEINLINE FVectorRegister Mat2MulAdj(FVectorRegister m1, FVectorRegister m2)
+		{
+			return VectorSubtract(
+				VectorMultiply(m1, VectorSwizzle(m2, 3, 0, 3, 0)),
+				VectorMultiply(VectorSwizzle(m1, 1, 0, 3, 2), VectorSwizzle(m2, 2, 1, 2, 1)));
+		}
+	};
+
+	FORCEINLINE void from_json(const FJson& j, FMatrixVectorized& matrix)
+	{
+		if (j.is_array() && j.size() >= 16)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int col = 0; col < 4; ++col)
+				{
+					matrix.M[row][col] = j[row * 4 + col];
+				}
+			}
+		}
+	}
+
+	FORCEINLINE void to_json(FJson& j, const FMatrixVectorized& matrix)
+	{
+		j.clear();
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 4; ++col)
+			{
+				j.push_back(matrix.M[row][col]);
+			}
+		}
+	}
+}
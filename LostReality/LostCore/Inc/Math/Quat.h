@@ -10,6 +10,7 @@
 #pragma once
 
 #include "Vector3.h"
+#include "QuatVectorized.h"
 
 namespace LostCore
 {
@@ -64,6 +65,9 @@ namespace LostCore
 			static FQuatNonVectorized SIdentity(0.f, 0.f, 0.f, 1.f);
 			return SIdentity;
 		}
+
+		// Shortest path, alpha in [0, 1], the result is normalized.
+		static FORCEINLINE FQuatNonVectorized Slerp(const FQuatNonVectorized& q1, const FQuatNonVectorized& q2, float alpha);
 	};
 
 	FORCEINLINE FQuatNonVectorized::FQuatNonVectorized(float x, float y, float z, float w) :
@@ -96,6 +100,7 @@ namespace LostCore
 		Y += quat.Y;
 		Z += quat.Z;
 		W += quat.W;
+		return *this;
 	}
 
 	FORCEINLINE FQuatNonVectorized FQuatNonVectorized::operator-(const FQuatNonVectorized& quat) const
@@ -109,6 +114,7 @@ namespace LostCore
 		Y -= quat.Y;
 		Z -= quat.Z;
 		W -= quat.W;
+		return *this;
 	}
 
 	FORCEINLINE FQuatNonVectorized  FQuatNonVectorized::operator*(const FQuatNonVectorized& quat) const
@@ -294,10 +300,37 @@ namespace LostCore
 		return RotateVector(FFloat3(1.f, 0.f, 0.f));
 	}
 
+	FORCEINLINE FQuatNonVectorized FQuatNonVectorized::Slerp(const FQuatNonVectorized& q1, const FQuatNonVectorized& q2, float alpha)
+	{
+		const float rawCos = q1 | q2;
+		const float cosOmega = std::abs(rawCos);
+
+		float scale1, scale2;
+		if (cosOmega < 0.9999f)
+		{
+			const float omega = std::acos(cosOmega);
+			const float invSin = 1.f / std::sin(omega);
+			scale1 = std::sin((1.f - alpha) * omega) * invSin;
+			scale2 = std::sin(alpha * omega) * invSin;
+		}
+		else
+		{
+			scale1 = 1.f - alpha;
+			scale2 = alpha;
+		}
+
+		scale2 = rawCos >= 0.f ? scale2 : -scale2;
+		return (q1 * scale1 + q2 * scale2).Normalize();
+	}
+
 #ifdef TYPEDEF_DECL_FQUAT
 #error "FQuat already defined somewhere else"
+#else
+#if MATH_VECTORIZED
+	typedef FQuatVectorized FQuat;
 #else
 	typedef FQuatNonVectorized FQuat;
+#endif
 	#define TYPEDEF_DECL_FQUAT
 #endif
 }
\ No newline at end of file
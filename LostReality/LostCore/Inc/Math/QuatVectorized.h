@@ -0,0 +1,299 @@
+/*
+* file QuatVectorized.h
+*
+* author luoxw
+* date 2018/03/18
+*
+* SSE version of FQuatNonVectorized, same members and layout.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Vector3.h"
+
+namespace LostCore
+{
+	__declspec(align(16)) class FQuatVectorized
+	{
+	public:
+
+		float X;
+		float Y;
+		float Z;
+		float W;
+
+	public:
+		FORCEINLINE FQuatVectorized() {}
+		FORCEINLINE FQuatVectorized(float x, float y, float z, float w);
+		FORCEINLINE FQuatVectorized(const FQuatVectorized& quat);
+		FORCEINLINE explicit FQuatVectorized(FVectorRegister v);
+
+		FORCEINLINE FVectorRegister Load() const;
+		FORCEINLINE void Store(FVectorRegister v);
+
+		FORCEINLINE FQuatVectorized& operator=(const FQuatVectorized& quat);
+		FORCEINLINE FQuatVectorized  operator+(const FQuatVectorized& quat) const;
+		FORCEINLINE FQuatVectorized& operator+=(const FQuatVectorized& quat);
+		FORCEINLINE FQuatVectorized  operator-(const FQuatVectorized& quat) const;
+		FORCEINLINE FQuatVectorized& operator-=(const FQuatVectorized& quat);
+		FORCEINLINE FQuatVectorized  operator*(const FQuatVectorized& quat) const;
+		FORCEINLINE FQuatVectorized& operator*=(const FQuatVectorized& quat);
+		FORCEINLINE FQuatVectorized  operator*(float value) const;
+		FORCEINLINE FQuatVectorized& operator*=(float value);
+
+		FORCEINLINE bool operator==(const FQuatVectorized& quat) const;
+		FORCEINLINE bool operator!=(const FQuatVectorized& quat) const;
+		FORCEINLINE float operator|(const FQuatVectorized& quat) const;
+
+		FORCEINLINE FFloat3 Euler() const;
+		FORCEINLINE FQuatVectorized& FromEuler(const FFloat3& euler);
+
+		FORCEINLINE FQuatVectorized GetNormalized() const;
+		FORCEINLINE FQuatVectorized& Normalize();
+		FORCEINLINE bool IsNormalized() const;
+		FORCEINLINE float SizeSquared() const;
+		FORCEINLINE float Size() const;
+
+		FORCEINLINE FFloat3 RotateVector(const FFloat3& vec) const;
+		FORCEINLINE FVectorRegister RotateVector(FVectorRegister vec) const;
+		FORCEINLINE FQuatVectorized GetInversed() const;
+		FORCEINLINE FQuatVectorized& Inverse();
+
+		FORCEINLINE FFloat3 GetForwardVector() const;
+		FORCEINLINE FFloat3 GetUpVector() const;
+		FORCEINLINE FFloat3 GetRightVector() const;
+
+	public:
+		static const FQuatVectorized& GetIdentity()
+		{
+			static FQuatVectorized SIdentity(0.f, 0.f, 0.f, 1.f);
+			return SIdentity;
+		}
+
+		// Shortest path, alpha in [0, 1], the result is normalized.
+		static FORCEINLINE FQuatVectorized Slerp(const FQuatVectorized& q1, const FQuatVectorized& q2, float alpha);
+	};
+
+	FORCEINLINE FQuatVectorized::FQuatVectorized(float x, float y, float z, float w) :
+		X(x), Y(y), Z(z), W(w)
+	{
+	}
+
+	FORCEINLINE FQuatVectorized::FQuatVectorized(const FQuatVectorized& quat)
+	{
+		Store(quat.Load());
+	}
+
+	FORCEINLINE FQuatVectorized::FQuatVectorized(FVectorRegister v)
+	{
+		Store(v);
+	}
+
+	FORCEINLINE FVectorRegister FQuatVectorized::Load() const
+	{
+		return VectorLoad(&X);
+	}
+
+	FORCEINLINE void FQuatVectorized::Store(FVectorRegister v)
+	{
+		VectorStore(&X, v);
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::operator=(const FQuatVectorized& quat)
+	{
+		Store(quat.Load());
+		return *this;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::operator+(const FQuatVectorized& quat) const
+	{
+		return FQuatVectorized(VectorAdd(Load(), quat.Load()));
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::operator+=(const FQuatVectorized& quat)
+	{
+		Store(VectorAdd(Load(), quat.Load()));
+		return *this;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::operator-(const FQuatVectorized& quat) const
+	{
+		return FQuatVectorized(VectorSubtract(Load(), quat.Load()));
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::operator-=(const FQuatVectorized& quat)
+	{
+		Store(VectorSubtract(Load(), quat.Load()));
+		return *this;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::operator*(const FQuatVectorized& quat) const
+	{
+		return FQuatVectorized(VectorQuaternionMultiply(Load(), quat.Load()));
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::operator*=(const FQuatVectorized& quat)
+	{
+		Store(VectorQuaternionMultiply(Load(), quat.Load()));
+		return *this;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::operator*(float value) const
+	{
+		return FQuatVectorized(VectorMultiply(Load(), VectorSetFloat1(value)));
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::operator*=(float value)
+	{
+		Store(VectorMultiply(Load(), VectorSetFloat1(value)));
+		return *this;
+	}
+
+	FORCEINLINE bool FQuatVectorized::operator==(const FQuatVectorized& quat) const
+	{
+		return VectorMaskNearlyEqual(Load(), quat.Load()) == 0xf;
+	}
+
+	FORCEINLINE bool FQuatVectorized::operator!=(const FQuatVectorized& quat) const
+	{
+		return !(*this == quat);
+	}
+
+	FORCEINLINE float FQuatVectorized::operator|(const FQuatVectorized& quat) const
+	{
+		return VectorGetX(VectorDot4(Load(), quat.Load()));
+	}
+
+	FORCEINLINE FFloat3 FQuatVectorized::Euler() const
+	{
+		FFloat3 euler;
+
+		float yy = Y*Y;
+
+		float t0 = 2.f * (-W*X - Y*Z);
+		float t1 = 1.f - 2.f*(X*X + yy);
+		euler.Pitch = Atan2(t0, t1) * SR2DConstant;
+
+		float t2 = 2.f*(-W*Y + Z*X);
+		t2 = t2 > 1.f ? 1.f : t2;
+		t2 = t2 < -1.f ? -1.f : t2;
+		euler.Yaw = -Asin(t2) * SR2DConstant;
+
+		float t3 = 2.f*(W*Z + X*Y);
+		float t4 = 1.f - 2.f*(yy + Z*Z);
+		euler.Roll = Atan2(t3, t4) * SR2DConstant;
+
+		return euler;
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::FromEuler(const FFloat3& euler)
+	{
+		const float halfD2R = SD2RConstant * 0.5f;
+		float t0, t1, t2, t3, t4, t5;
+		SinCos(t1, t0, euler.Roll * halfD2R);
+		SinCos(t3, t2, euler.Pitch * halfD2R);
+		SinCos(t5, t4, -euler.Yaw * halfD2R);
+
+		W = -t0*t2*t4 - t1*t3*t5;
+		X = t0*t3*t4 - t1*t2*t5;
+		Y = t0*t2*t5 + t1*t3*t4;
+		Z = -t1*t2*t4 + t0*t3*t5;
+
+		return *this;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::GetNormalized() const
+	{
+		return FQuatVectorized(VectorQuaternionNormalize(Load()));
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::Normalize()
+	{
+		Store(VectorQuaternionNormalize(Load()));
+		return *this;
+	}
+
+	FORCEINLINE bool FQuatVectorized::IsNormalized() const
+	{
+		return LostCore::IsEqual(1.f, SizeSquared());
+	}
+
+	FORCEINLINE float FQuatVectorized::SizeSquared() const
+	{
+		FVectorRegister q = Load();
+		return VectorGetX(VectorDot4(q, q));
+	}
+
+	FORCEINLINE float FQuatVectorized::Size() const
+	{
+		return Sqrt(SizeSquared());
+	}
+
+	FORCEINLINE FVectorRegister FQuatVectorized::RotateVector(FVectorRegister vec) const
+	{
+		const FVectorRegister q = Load();
+		const FVectorRegister t = VectorMultiply(VectorCross(q, vec), VectorSetFloat1(2.f));
+		return VectorAdd(VectorMultiplyAdd(VectorReplicate(q, 3), t, vec), VectorCross(q, t));
+	}
+
+	FORCEINLINE FFloat3 FQuatVectorized::RotateVector(const FFloat3& vec) const
+	{
+		FFloat3 result;
+		VectorStoreFloat3(&result.X, RotateVector(VectorLoadFloat3(&vec.X)));
+		return result;
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::GetInversed() const
+	{
+		return FQuatVectorized(-X, -Y, -Z, W);
+	}
+
+	FORCEINLINE FQuatVectorized& FQuatVectorized::Inverse()
+	{
+		X = -X;
+		Y = -Y;
+		Z = -Z;
+		return *this;
+	}
+
+	FORCEINLINE FFloat3 FQuatVectorized::GetForwardVector() const
+	{
+		return RotateVector(FFloat3(0.f, 0.f, 1.f));
+	}
+
+	FORCEINLINE FFloat3 FQuatVectorized::GetUpVector() const
+	{
+		return RotateVector(FFloat3(0.f, 1.f, 0.f));
+	}
+
+	FORCEINLINE FFloat3 FQuatVectorized::GetRightVector() const
+	{
+		return RotateVector(FFloat3(1.f, 0.f, 0.f));
+	}
+
+	FORCEINLINE FQuatVectorized FQuatVectorized::Slerp(const FQuatVectorized& q1, const FQuatVectorized& q2, float alpha)
+	{
+		const FVectorRegister v1 = q1.Load();
+		const FVectorRegister v2 = q2.Load();
+		const float rawCos = VectorGetX(VectorDot4(v1, v2));
+		const float cosOmega = std::abs(rawCos);
+
+		float scale1, scale2;
+		if (cosOmega < 0.9999f)
+		{
+			const float omega = std::acos(cosOmega);
+			const float invSin = 1.f / std::sin(omega);
+			scale1 = std::sin((1.f - alpha) * omega) * invSin;
+			scale2 = std::sin(alpha * omega) * invSin;
+		}
+		else
+		{
+			scale1 = 1.f - alpha;
+			scale2 = alpha;
+		}
+
+		scale2 = rawCos >= 0.f ? scale2 : -scale2;
+		return FQuatVectorized(VectorQuaternionNormalize(VectorMultiplyAdd(v1, VectorSetFloat1(scale1), VectorMultiply(v2, VectorSetFloat1(scale2)))));
+	}
+}
@@ -12,6 +12,7 @@
 #include "Vector3.h"
 #include "Quat.h"
 #include "Matrix.h"
+#include "TransformVectorized.h"
 
 namespace LostCore
 {
@@ -76,8 +77,8 @@ namespace LostCore
 		{
 			return FTransformNonVectorized(
 				transform.Orientation * Orientation,
-				transform.Scale * Scale,
-				transform.Orientation.RotateVector(transform.Scale * Translation) + transform.Translation
+				transform.Orientation.RotateVector(transform.Scale * Translation) + transform.Translation,
+				transform.Scale * Scale
 			);
 		}
 
@@ -166,8 +167,12 @@ namespace LostCore
 
 #ifdef TYPEDEF_DECL_FTRANSFORM
 #error "FTransform already defined somewhere else"
+#else
+#if MATH_VECTORIZED
+	typedef FTransformVectorized FTransform;
 #else
 	typedef FTransformNonVectorized FTransform;
+#endif
 	#define TYPEDEF_DECL_FTRANSFORM
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,723 @@
+/*
+* file TransformBatch.h
+*
+* author luoxw
+* date 2018/03/20
+*
+* Array versions of FFloat4x4::ApplyPoint/ApplyVector/operator* and FAABoundingBox::AddPoint.
+* Points come as AoS (FFloat3 array) or SoA (three float streams), matrices as AoS (FFloat4x4 array)
+* or SoA (sixteen float streams). Every call dispatches to SSE2 or AVX2 by GetSIMDLevel,
+* the remainder of a batch goes through the scalar code.
+* dst may be the same memory as src, never partially overlapping.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Vector3.h"
+#include "Matrix.h"
+#include "AABB.h"
+
+namespace LostCore
+{
+	// Non-owning float3 streams, X[i], Y[i], Z[i] is the i-th element.
+	template <typename T>
+	struct TFloat3SoA
+	{
+		T* X;
+		T* Y;
+		T* Z;
+
+		TFloat3SoA() : X(nullptr), Y(nullptr), Z(nullptr) {}
+		TFloat3SoA(T* x, T* y, T* z) : X(x), Y(y), Z(z) {}
+
+		template <typename T2>
+		TFloat3SoA(const TFloat3SoA<T2>& rhs) : X(rhs.X), Y(rhs.Y), Z(rhs.Z) {}
+	};
+
+	typedef TFloat3SoA<float> FFloat3SoA;
+	typedef TFloat3SoA<const float> FConstFloat3SoA;
+
+	// Non-owning matrix streams, M[row][col][i] is the element of the i-th matrix.
+	template <typename T>
+	struct TFloat4x4SoA
+	{
+		T* M[4][4];
+
+		TFloat4x4SoA()
+		{
+			memset(M, 0, sizeof(M));
+		}
+
+		template <typename T2>
+		TFloat4x4SoA(const TFloat4x4SoA<T2>& rhs)
+		{
+			for (int32 row = 0; row < 4; ++row)
+			{
+				for (int32 col = 0; col < 4; ++col)
+				{
+					M[row][col] = rhs.M[row][col];
+				}
+			}
+		}
+	};
+
+	typedef TFloat4x4SoA<float> FFloat4x4SoA;
+	typedef TFloat4x4SoA<const float> FConstFloat4x4SoA;
+
+	class FTransformBatch
+	{
+	public:
+		// dst[i] = m.ApplyPoint(src[i])
+		static FORCEINLINE void TransformPoints(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count);
+		static FORCEINLINE void TransformPoints(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count);
+
+		// dst[i] = m.ApplyVector(src[i]), normals and tangents are not normalized afterwards.
+		static FORCEINLINE void TransformVectors(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count);
+		static FORCEINLINE void TransformVectors(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count);
+
+		// dst[i] = src[i] * parent
+		static FORCEINLINE void ConcatenateMatrices(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count);
+		static FORCEINLINE void ConcatenateMatrices(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count);
+
+		// bounds.AddPoint(m.ApplyPoint(src[i])) for every i.
+		static FORCEINLINE void AddTransformedPoints(FAABoundingBox& bounds, const FFloat4x4& m, const FFloat3* src, uint32 count);
+		static FORCEINLINE void AddTransformedPoints(FAABoundingBox& bounds, const FFloat4x4& m, const FConstFloat3SoA& src, uint32 count);
+
+		// bounds.AddPoint(src[i]) for every i.
+		static FORCEINLINE void AddPoints(FAABoundingBox& bounds, const FFloat3* src, uint32 count);
+
+	private:
+		enum class EOp : uint8
+		{
+			Point,
+			Vector,
+			Bounds,
+			TransformedBounds,
+		};
+
+		// Accumulated by the Bounds ops, merged into the FAABoundingBox at the end.
+		struct FMinMax
+		{
+			float Min[3];
+			float Max[3];
+
+			FMinMax();
+			void Add(float x, float y, float z);
+			void MergeTo(FAABoundingBox& bounds) const;
+		};
+
+		template <EOp Op>
+		static void ScalarAoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax);
+		template <EOp Op>
+		static void ScalarSoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 begin, uint32 count, FMinMax& minMax);
+		static void ScalarConcatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 begin, uint32 count);
+
+		template <EOp Op>
+		static uint32 SSE2AoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax);
+		template <EOp Op>
+		static uint32 SSE2SoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax);
+		static void SSE2Concatenate(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count);
+		static uint32 SSE2Concatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count);
+
+		template <EOp Op>
+		static uint32 AVX2AoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax);
+		template <EOp Op>
+		static uint32 AVX2SoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax);
+		static void AVX2Concatenate(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count);
+		static uint32 AVX2Concatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count);
+
+		template <EOp Op>
+		static FORCEINLINE void DispatchAoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax);
+		template <EOp Op>
+		static FORCEINLINE void DispatchSoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax);
+	};
+
+	static_assert(sizeof(FFloat3) == sizeof(float) * 3, "FTransformBatch reads FFloat3 arrays as packed floats");
+	static_assert(sizeof(FFloat4x4) == sizeof(float) * 16, "FTransformBatch reads FFloat4x4 arrays as packed floats");
+
+	// Register helpers, 4 AoS float3 (12 floats in a, b, c) <-> SoA x, y, z.
+	// Every shuffle stays in its 128-bit lane, so the same sequence deinterleaves 2x4 points in __m256.
+#define TRANSFORM_BATCH_DEINTERLEAVE(shuffle, a, b, c, x, y, z) \
+	x = shuffle(a, shuffle(b, c, VECTOR_SHUFFLE_MASK(2, 2, 1, 1)), VECTOR_SHUFFLE_MASK(0, 3, 0, 2)); \
+	y = shuffle(shuffle(a, b, VECTOR_SHUFFLE_MASK(1, 1, 0, 0)), shuffle(b, c, VECTOR_SHUFFLE_MASK(3, 3, 2, 2)), VECTOR_SHUFFLE_MASK(0, 2, 0, 2)); \
+	z = shuffle(shuffle(a, b, VECTOR_SHUFFLE_MASK(2, 2, 1, 1)), shuffle(c, c, VECTOR_SHUFFLE_MASK(0, 0, 3, 3)), VECTOR_SHUFFLE_MASK(0, 2, 0, 2));
+
+#define TRANSFORM_BATCH_INTERLEAVE(shuffle, x, y, z, a, b, c) \
+	a = shuffle(shuffle(x, y, VECTOR_SHUFFLE_MASK(0, 0, 0, 0)), shuffle(z, x, VECTOR_SHUFFLE_MASK(0, 0, 1, 1)), VECTOR_SHUFFLE_MASK(0, 2, 0, 2)); \
+	b = shuffle(shuffle(y, z, VECTOR_SHUFFLE_MASK(1, 1, 1, 1)), shuffle(x, y, VECTOR_SHUFFLE_MASK(2, 2, 2, 2)), VECTOR_SHUFFLE_MASK(0, 2, 0, 2)); \
+	c = shuffle(shuffle(z, x, VECTOR_SHUFFLE_MASK(2, 2, 3, 3)), shuffle(y, z, VECTOR_SHUFFLE_MASK(3, 3, 3, 3)), VECTOR_SHUFFLE_MASK(0, 2, 0, 2));
+
+	FORCEINLINE FTransformBatch::FMinMax::FMinMax()
+	{
+		Min[0] = Min[1] = Min[2] = FLT_MAX;
+		Max[0] = Max[1] = Max[2] = -FLT_MAX;
+	}
+
+	FORCEINLINE void FTransformBatch::FMinMax::Add(float x, float y, float z)
+	{
+		Min[0] = x < Min[0] ? x : Min[0];
+		Min[1] = y < Min[1] ? y : Min[1];
+		Min[2] = z < Min[2] ? z : Min[2];
+		Max[0] = x > Max[0] ? x : Max[0];
+		Max[1] = y > Max[1] ? y : Max[1];
+		Max[2] = z > Max[2] ? z : Max[2];
+	}
+
+	FORCEINLINE void FTransformBatch::FMinMax::MergeTo(FAABoundingBox& bounds) const
+	{
+		if (Min[0] <= Max[0])
+		{
+			bounds.AddPoint(FFloat3(Min[0], Min[1], Min[2]));
+			bounds.AddPoint(FFloat3(Max[0], Max[1], Max[2]));
+		}
+	}
+
+	template <FTransformBatch::EOp Op>
+	inline void FTransformBatch::ScalarAoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax)
+	{
+		for (uint32 i = 0; i < count; ++i)
+		{
+			if (Op == EOp::Point)
+			{
+				m.ApplyPoint(dst[i], src[i]);
+			}
+			else if (Op == EOp::Vector)
+			{
+				m.ApplyVector(dst[i], src[i]);
+			}
+			else if (Op == EOp::Bounds)
+			{
+				minMax.Add(src[i].X, src[i].Y, src[i].Z);
+			}
+			else
+			{
+				FFloat3 pt;
+				m.ApplyPoint(pt, src[i]);
+				minMax.Add(pt.X, pt.Y, pt.Z);
+			}
+		}
+	}
+
+	template <FTransformBatch::EOp Op>
+	inline void FTransformBatch::ScalarSoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 begin, uint32 count, FMinMax& minMax)
+	{
+		const float w = (Op == EOp::Vector) ? 0.f : 1.f;
+		for (uint32 i = begin; i < count; ++i)
+		{
+			const float x = src.X[i], y = src.Y[i], z = src.Z[i];
+			const float ox = x * m.M[0][0] + y * m.M[1][0] + z * m.M[2][0] + w * m.M[3][0];
+			const float oy = x * m.M[0][1] + y * m.M[1][1] + z * m.M[2][1] + w * m.M[3][1];
+			const float oz = x * m.M[0][2] + y * m.M[1][2] + z * m.M[2][2] + w * m.M[3][2];
+			if (Op == EOp::TransformedBounds)
+			{
+				minMax.Add(ox, oy, oz);
+			}
+			else
+			{
+				dst.X[i] = ox;
+				dst.Y[i] = oy;
+				dst.Z[i] = oz;
+			}
+		}
+	}
+
+	inline void FTransformBatch::ScalarConcatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 begin, uint32 count)
+	{
+		for (uint32 i = begin; i < count; ++i)
+		{
+			for (int32 row = 0; row < 4; ++row)
+			{
+				const float a0 = src.M[row][0][i], a1 = src.M[row][1][i], a2 = src.M[row][2][i], a3 = src.M[row][3][i];
+				for (int32 col = 0; col < 4; ++col)
+				{
+					dst.M[row][col][i] = a0 * parent.M[0][col] + a1 * parent.M[1][col] + a2 * parent.M[2][col] + a3 * parent.M[3][col];
+				}
+			}
+		}
+	}
+
+	// Returns the number of elements done, the rest is left to the scalar code.
+	template <FTransformBatch::EOp Op>
+	inline uint32 FTransformBatch::SSE2AoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax)
+	{
+		FVectorRegister col[4][3];
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (int32 c = 0; c < 3; ++c)
+			{
+				col[row][c] = _mm_set1_ps(m.M[row][c]);
+			}
+		}
+
+		FVectorRegister minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		FVectorRegister maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		const uint32 num = count & ~3u;
+		for (uint32 i = 0; i < num; i += 4)
+		{
+			const float* p = &src[i].X;
+			const FVectorRegister a = _mm_loadu_ps(p);
+			const FVectorRegister b = _mm_loadu_ps(p + 4);
+			const FVectorRegister c = _mm_loadu_ps(p + 8);
+
+			FVectorRegister x, y, z;
+			TRANSFORM_BATCH_DEINTERLEAVE(_mm_shuffle_ps, a, b, c, x, y, z);
+
+			FVectorRegister ox, oy, oz;
+			if (Op == EOp::Bounds)
+			{
+				ox = x;
+				oy = y;
+				oz = z;
+			}
+			else
+			{
+				ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][0]), _mm_mul_ps(y, col[1][0])), _mm_mul_ps(z, col[2][0]));
+				oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][1]), _mm_mul_ps(y, col[1][1])), _mm_mul_ps(z, col[2][1]));
+				oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][2]), _mm_mul_ps(y, col[1][2])), _mm_mul_ps(z, col[2][2]));
+				if (Op != EOp::Vector)
+				{
+					ox = _mm_add_ps(ox, col[3][0]);
+					oy = _mm_add_ps(oy, col[3][1]);
+					oz = _mm_add_ps(oz, col[3][2]);
+				}
+			}
+
+			if (Op == EOp::Point || Op == EOp::Vector)
+			{
+				FVectorRegister oa, ob, oc;
+				TRANSFORM_BATCH_INTERLEAVE(_mm_shuffle_ps, ox, oy, oz, oa, ob, oc);
+				float* q = &dst[i].X;
+				_mm_storeu_ps(q, oa);
+				_mm_storeu_ps(q + 4, ob);
+				_mm_storeu_ps(q + 8, oc);
+			}
+			else
+			{
+				minX = _mm_min_ps(minX, ox);
+				minY = _mm_min_ps(minY, oy);
+				minZ = _mm_min_ps(minZ, oz);
+				maxX = _mm_max_ps(maxX, ox);
+				maxY = _mm_max_ps(maxY, oy);
+				maxZ = _mm_max_ps(maxZ, oz);
+			}
+		}
+
+		if (Op == EOp::Bounds || Op == EOp::TransformedBounds)
+		{
+			float mn[3][4], mx[3][4];
+			_mm_storeu_ps(mn[0], minX);
+			_mm_storeu_ps(mn[1], minY);
+			_mm_storeu_ps(mn[2], minZ);
+			_mm_storeu_ps(mx[0], maxX);
+			_mm_storeu_ps(mx[1], maxY);
+			_mm_storeu_ps(mx[2], maxZ);
+			for (int32 lane = 0; lane < 4 && num > 0; ++lane)
+			{
+				minMax.Add(mn[0][lane], mn[1][lane], mn[2][lane]);
+				minMax.Add(mx[0][lane], mx[1][lane], mx[2][lane]);
+			}
+		}
+
+		return num;
+	}
+
+	template <FTransformBatch::EOp Op>
+	inline uint32 FTransformBatch::SSE2SoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax)
+	{
+		FVectorRegister col[4][3];
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (int32 c = 0; c < 3; ++c)
+			{
+				col[row][c] = _mm_set1_ps(m.M[row][c]);
+			}
+		}
+
+		FVectorRegister minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		FVectorRegister maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		const uint32 num = count & ~3u;
+		for (uint32 i = 0; i < num; i += 4)
+		{
+			const FVectorRegister x = _mm_loadu_ps(src.X + i);
+			const FVectorRegister y = _mm_loadu_ps(src.Y + i);
+			const FVectorRegister z = _mm_loadu_ps(src.Z + i);
+
+			FVectorRegister ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][0]), _mm_mul_ps(y, col[1][0])), _mm_mul_ps(z, col[2][0]));
+			FVectorRegister oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][1]), _mm_mul_ps(y, col[1][1])), _mm_mul_ps(z, col[2][1]));
+			FVectorRegister oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[0][2]), _mm_mul_ps(y, col[1][2])), _mm_mul_ps(z, col[2][2]));
+			if (Op != EOp::Vector)
+			{
+				ox = _mm_add_ps(ox, col[3][0]);
+				oy = _mm_add_ps(oy, col[3][1]);
+				oz = _mm_add_ps(oz, col[3][2]);
+			}
+
+			if (Op == EOp::TransformedBounds)
+			{
+				minX = _mm_min_ps(minX, ox);
+				minY = _mm_min_ps(minY, oy);
+				minZ = _mm_min_ps(minZ, oz);
+				maxX = _mm_max_ps(maxX, ox);
+				maxY = _mm_max_ps(maxY, oy);
+				maxZ = _mm_max_ps(maxZ, oz);
+			}
+			else
+			{
+				_mm_storeu_ps(dst.X + i, ox);
+				_mm_storeu_ps(dst.Y + i, oy);
+				_mm_storeu_ps(dst.Z + i, oz);
+			}
+		}
+
+		if (Op == EOp::TransformedBounds)
+		{
+			float mn[3][4], mx[3][4];
+			_mm_storeu_ps(mn[0], minX);
+			_mm_storeu_ps(mn[1], minY);
+			_mm_storeu_ps(mn[2], minZ);
+			_mm_storeu_ps(mx[0], maxX);
+			_mm_storeu_ps(mx[1], maxY);
+			_mm_storeu_ps(mx[2], maxZ);
+			for (int32 lane = 0; lane < 4 && num > 0; ++lane)
+			{
+				minMax.Add(mn[0][lane], mn[1][lane], mn[2][lane]);
+				minMax.Add(mx[0][lane], mx[1][lane], mx[2][lane]);
+			}
+		}
+
+		return num;
+	}
+
+	inline void FTransformBatch::SSE2Concatenate(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count)
+	{
+		const FVectorRegister p0 = _mm_loadu_ps(parent.M[0]);
+		const FVectorRegister p1 = _mm_loadu_ps(parent.M[1]);
+		const FVectorRegister p2 = _mm_loadu_ps(parent.M[2]);
+		const FVectorRegister p3 = _mm_loadu_ps(parent.M[3]);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			for (int32 row = 0; row < 4; ++row)
+			{
+				const FVectorRegister a = _mm_loadu_ps(src[i].M[row]);
+				FVectorRegister r = _mm_mul_ps(VectorReplicate(a, 0), p0);
+				r = _mm_add_ps(r, _mm_mul_ps(VectorReplicate(a, 1), p1));
+				r = _mm_add_ps(r, _mm_mul_ps(VectorReplicate(a, 2), p2));
+				r = _mm_add_ps(r, _mm_mul_ps(VectorReplicate(a, 3), p3));
+				_mm_storeu_ps(dst[i].M[row], r);
+			}
+		}
+	}
+
+	inline uint32 FTransformBatch::SSE2Concatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count)
+	{
+		// A row of the result only reads the same row of src, one row per pass keeps 8 streams alive instead of 32.
+		const uint32 num = count & ~3u;
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (uint32 i = 0; i < num; i += 4)
+			{
+				const FVectorRegister a0 = _mm_loadu_ps(src.M[row][0] + i);
+				const FVectorRegister a1 = _mm_loadu_ps(src.M[row][1] + i);
+				const FVectorRegister a2 = _mm_loadu_ps(src.M[row][2] + i);
+				const FVectorRegister a3 = _mm_loadu_ps(src.M[row][3] + i);
+				for (int32 col = 0; col < 4; ++col)
+				{
+					FVectorRegister r = _mm_mul_ps(a0, _mm_set1_ps(parent.M[0][col]));
+					r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(parent.M[1][col])));
+					r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(parent.M[2][col])));
+					r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(parent.M[3][col])));
+					_mm_storeu_ps(dst.M[row][col] + i, r);
+				}
+			}
+		}
+
+		return num;
+	}
+
+	template <FTransformBatch::EOp Op>
+	inline uint32 FTransformBatch::AVX2AoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax)
+	{
+		__m256 col[4][3];
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (int32 c = 0; c < 3; ++c)
+			{
+				col[row][c] = _mm256_set1_ps(m.M[row][c]);
+			}
+		}
+
+		__m256 minX = _mm256_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		__m256 maxX = _mm256_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		// Points 0-3 in the low lane, 4-7 in the high lane.
+		const uint32 num = count & ~7u;
+		for (uint32 i = 0; i < num; i += 8)
+		{
+			const float* p = &src[i].X;
+			const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+			const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+			const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+
+			__m256 x, y, z;
+			TRANSFORM_BATCH_DEINTERLEAVE(_mm256_shuffle_ps, a, b, c, x, y, z);
+
+			__m256 ox, oy, oz;
+			if (Op == EOp::Bounds)
+			{
+				ox = x;
+				oy = y;
+				oz = z;
+			}
+			else
+			{
+				ox = _mm256_fmadd_ps(x, col[0][0], _mm256_fmadd_ps(y, col[1][0], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][0]) : _mm256_fmadd_ps(z, col[2][0], col[3][0])));
+				oy = _mm256_fmadd_ps(x, col[0][1], _mm256_fmadd_ps(y, col[1][1], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][1]) : _mm256_fmadd_ps(z, col[2][1], col[3][1])));
+				oz = _mm256_fmadd_ps(x, col[0][2], _mm256_fmadd_ps(y, col[1][2], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][2]) : _mm256_fmadd_ps(z, col[2][2], col[3][2])));
+			}
+
+			if (Op == EOp::Point || Op == EOp::Vector)
+			{
+				__m256 oa, ob, oc;
+				TRANSFORM_BATCH_INTERLEAVE(_mm256_shuffle_ps, ox, oy, oz, oa, ob, oc);
+				float* q = &dst[i].X;
+				_mm_storeu_ps(q, _mm256_castps256_ps128(oa));
+				_mm_storeu_ps(q + 4, _mm256_castps256_ps128(ob));
+				_mm_storeu_ps(q + 8, _mm256_castps256_ps128(oc));
+				_mm_storeu_ps(q + 12, _mm256_extractf128_ps(oa, 1));
+				_mm_storeu_ps(q + 16, _mm256_extractf128_ps(ob, 1));
+				_mm_storeu_ps(q + 20, _mm256_extractf128_ps(oc, 1));
+			}
+			else
+			{
+				minX = _mm256_min_ps(minX, ox);
+				minY = _mm256_min_ps(minY, oy);
+				minZ = _mm256_min_ps(minZ, oz);
+				maxX = _mm256_max_ps(maxX, ox);
+				maxY = _mm256_max_ps(maxY, oy);
+				maxZ = _mm256_max_ps(maxZ, oz);
+			}
+		}
+
+		if (Op == EOp::Bounds || Op == EOp::TransformedBounds)
+		{
+			float mn[3][8], mx[3][8];
+			_mm256_storeu_ps(mn[0], minX);
+			_mm256_storeu_ps(mn[1], minY);
+			_mm256_storeu_ps(mn[2], minZ);
+			_mm256_storeu_ps(mx[0], maxX);
+			_mm256_storeu_ps(mx[1], maxY);
+			_mm256_storeu_ps(mx[2], maxZ);
+			for (int32 lane = 0; lane < 8 && num > 0; ++lane)
+			{
+				minMax.Add(mn[0][lane], mn[1][lane], mn[2][lane]);
+				minMax.Add(mx[0][lane], mx[1][lane], mx[2][lane]);
+			}
+		}
+
+		_mm256_zeroupper();
+		return num;
+	}
+
+	template <FTransformBatch::EOp Op>
+	inline uint32 FTransformBatch::AVX2SoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax)
+	{
+		__m256 col[4][3];
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (int32 c = 0; c < 3; ++c)
+			{
+				col[row][c] = _mm256_set1_ps(m.M[row][c]);
+			}
+		}
+
+		__m256 minX = _mm256_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+		__m256 maxX = _mm256_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+		const uint32 num = count & ~7u;
+		for (uint32 i = 0; i < num; i += 8)
+		{
+			const __m256 x = _mm256_loadu_ps(src.X + i);
+			const __m256 y = _mm256_loadu_ps(src.Y + i);
+			const __m256 z = _mm256_loadu_ps(src.Z + i);
+
+			const __m256 ox = _mm256_fmadd_ps(x, col[0][0], _mm256_fmadd_ps(y, col[1][0], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][0]) : _mm256_fmadd_ps(z, col[2][0], col[3][0])));
+			const __m256 oy = _mm256_fmadd_ps(x, col[0][1], _mm256_fmadd_ps(y, col[1][1], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][1]) : _mm256_fmadd_ps(z, col[2][1], col[3][1])));
+			const __m256 oz = _mm256_fmadd_ps(x, col[0][2], _mm256_fmadd_ps(y, col[1][2], Op == EOp::Vector ? _mm256_mul_ps(z, col[2][2]) : _mm256_fmadd_ps(z, col[2][2], col[3][2])));
+
+			if (Op == EOp::TransformedBounds)
+			{
+				minX = _mm256_min_ps(minX, ox);
+				minY = _mm256_min_ps(minY, oy);
+				minZ = _mm256_min_ps(minZ, oz);
+				maxX = _mm256_max_ps(maxX, ox);
+				maxY = _mm256_max_ps(maxY, oy);
+				maxZ = _mm256_max_ps(maxZ, oz);
+			}
+			else
+			{
+				_mm256_storeu_ps(dst.X + i, ox);
+				_mm256_storeu_ps(dst.Y + i, oy);
+				_mm256_storeu_ps(dst.Z + i, oz);
+			}
+		}
+
+		if (Op == EOp::TransformedBounds)
+		{
+			float mn[3][8], mx[3][8];
+			_mm256_storeu_ps(mn[0], minX);
+			_mm256_storeu_ps(mn[1], minY);
+			_mm256_storeu_ps(mn[2], minZ);
+			_mm256_storeu_ps(mx[0], maxX);
+			_mm256_storeu_ps(mx[1], maxY);
+			_mm256_storeu_ps(mx[2], maxZ);
+			for (int32 lane = 0; lane < 8 && num > 0; ++lane)
+			{
+				minMax.Add(mn[0][lane], mn[1][lane], mn[2][lane]);
+				minMax.Add(mx[0][lane], mx[1][lane], mx[2][lane]);
+			}
+		}
+
+		_mm256_zeroupper();
+		return num;
+	}
+
+	inline void FTransformBatch::AVX2Concatenate(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count)
+	{
+		// Two rows per register, the parent rows are broadcast to both lanes.
+		const __m256 p0 = _mm256_broadcast_ps((const __m128*)parent.M[0]);
+		const __m256 p1 = _mm256_broadcast_ps((const __m128*)parent.M[1]);
+		const __m256 p2 = _mm256_broadcast_ps((const __m128*)parent.M[2]);
+		const __m256 p3 = _mm256_broadcast_ps((const __m128*)parent.M[3]);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			for (int32 row = 0; row < 4; row += 2)
+			{
+				const __m256 a = _mm256_loadu_ps(src[i].M[row]);
+				__m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(0, 0, 0, 0)), p0);
+				r = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(1, 1, 1, 1)), p1, r);
+				r = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(2, 2, 2, 2)), p2, r);
+				r = _mm256_fmadd_ps(_mm256_shuffle_ps(a, a, VECTOR_SHUFFLE_MASK(3, 3, 3, 3)), p3, r);
+				_mm256_storeu_ps(dst[i].M[row], r);
+			}
+		}
+
+		_mm256_zeroupper();
+	}
+
+	inline uint32 FTransformBatch::AVX2Concatenate(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count)
+	{
+		const uint32 num = count & ~7u;
+		for (int32 row = 0; row < 4; ++row)
+		{
+			for (uint32 i = 0; i < num; i += 8)
+			{
+				const __m256 a0 = _mm256_loadu_ps(src.M[row][0] + i);
+				const __m256 a1 = _mm256_loadu_ps(src.M[row][1] + i);
+				const __m256 a2 = _mm256_loadu_ps(src.M[row][2] + i);
+				const __m256 a3 = _mm256_loadu_ps(src.M[row][3] + i);
+				for (int32 col = 0; col < 4; ++col)
+				{
+					__m256 r = _mm256_mul_ps(a0, _mm256_broadcast_ss(&parent.M[0][col]));
+					r = _mm256_fmadd_ps(a1, _mm256_broadcast_ss(&parent.M[1][col]), r);
+					r = _mm256_fmadd_ps(a2, _mm256_broadcast_ss(&parent.M[2][col]), r);
+					r = _mm256_fmadd_ps(a3, _mm256_broadcast_ss(&parent.M[3][col]), r);
+					_mm256_storeu_ps(dst.M[row][col] + i, r);
+				}
+			}
+		}
+
+		_mm256_zeroupper();
+		return num;
+	}
+
+	template <FTransformBatch::EOp Op>
+	FORCEINLINE void FTransformBatch::DispatchAoS(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count, FMinMax& minMax)
+	{
+		const uint32 done = GetSIMDLevel() == ESIMDLevel::AVX2
+			? AVX2AoS<Op>(m, src, dst, count, minMax)
+			: SSE2AoS<Op>(m, src, dst, count, minMax);
+		ScalarAoS<Op>(m, src + done, dst + done, count - done, minMax);
+	}
+
+	template <FTransformBatch::EOp Op>
+	FORCEINLINE void FTransformBatch::DispatchSoA(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count, FMinMax& minMax)
+	{
+		const uint32 done = GetSIMDLevel() == ESIMDLevel::AVX2
+			? AVX2SoA<Op>(m, src, dst, count, minMax)
+			: SSE2SoA<Op>(m, src, dst, count, minMax);
+		ScalarSoA<Op>(m, src, dst, done, count, minMax);
+	}
+
+	FORCEINLINE void FTransformBatch::TransformPoints(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count)
+	{
+		FMinMax unused;
+		DispatchAoS<EOp::Point>(m, src, dst, count, unused);
+	}
+
+	FORCEINLINE void FTransformBatch::TransformPoints(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count)
+	{
+		FMinMax unused;
+		DispatchSoA<EOp::Point>(m, src, dst, count, unused);
+	}
+
+	FORCEINLINE void FTransformBatch::TransformVectors(const FFloat4x4& m, const FFloat3* src, FFloat3* dst, uint32 count)
+	{
+		FMinMax unused;
+		DispatchAoS<EOp::Vector>(m, src, dst, count, unused);
+	}
+
+	FORCEINLINE void FTransformBatch::TransformVectors(const FFloat4x4& m, const FConstFloat3SoA& src, const FFloat3SoA& dst, uint32 count)
+	{
+		FMinMax unused;
+		DispatchSoA<EOp::Vector>(m, src, dst, count, unused);
+	}
+
+	FORCEINLINE void FTransformBatch::ConcatenateMatrices(const FFloat4x4* src, const FFloat4x4& parent, FFloat4x4* dst, uint32 count)
+	{
+		// parent may be one of dst.
+		const FFloat4x4 p(parent);
+		if (GetSIMDLevel() == ESIMDLevel::AVX2)
+		{
+			AVX2Concatenate(src, p, dst, count);
+		}
+		else
+		{
+			SSE2Concatenate(src, p, dst, count);
+		}
+	}
+
+	FORCEINLINE void FTransformBatch::ConcatenateMatrices(const FConstFloat4x4SoA& src, const FFloat4x4& parent, const FFloat4x4SoA& dst, uint32 count)
+	{
+		const uint32 done = GetSIMDLevel() == ESIMDLevel::AVX2
+			? AVX2Concatenate(src, parent, dst, count)
+			: SSE2Concatenate(src, parent, dst, count);
+		ScalarConcatenate(src, parent, dst, done, count);
+	}
+
+	FORCEINLINE void FTransformBatch::AddTransformedPoints(FAABoundingBox& bounds, const FFloat4x4& m, const FFloat3* src, uint32 count)
+	{
+		FMinMax minMax;
+		DispatchAoS<EOp::TransformedBounds>(m, src, nullptr, count, minMax);
+		minMax.MergeTo(bounds);
+	}
+
+	FORCEINLINE void FTransformBatch::AddTransformedPoints(FAABoundingBox& bounds, const FFloat4x4& m, const FConstFloat3SoA& src, uint32 count)
+	{
+		FMinMax minMax;
+		DispatchSoA<EOp::TransformedBounds>(m, src, FFloat3SoA(), count, minMax);
+		minMax.MergeTo(bounds);
+	}
+
+	FORCEINLINE void FTransformBatch::AddPoints(FAABoundingBox& bounds, const FFloat3* src, uint32 count)
+	{
+		FMinMax minMax;
+		DispatchAoS<EOp::Bounds>(FFloat4x4(), src, nullptr, count, minMax);
+		minMax.MergeTo(bounds);
+	}
+
+#undef TRANSFORM_BATCH_DEINTERLEAVE
+#undef TRANSFORM_BATCH_INTERLEAVE
+}
@@ -0,0 +1,190 @@
+/*
+* file TransformVectorized.h
+*
+* author luoxw
+* date 2018/03/18
+*
+* SSE version of FTransformNonVectorized, same members.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Vector3.h"
+#include "Quat.h"
+#include "Matrix.h"
+
+namespace LostCore
+{
+	class FTransformVectorized
+	{
+	protected:
+		FQuat Orientation;
+		FFloat3 Translation;
+		FFloat3 Scale;
+
+	public:
+		FORCEINLINE FTransformVectorized()
+			: Orientation(FQuat::GetIdentity())
+			, Translation(FFloat3::GetZero())
+			, Scale(1.f, 1.f, 1.f)
+		{
+		}
+
+		FORCEINLINE explicit FTransformVectorized(const FFloat3& translation)
+			: Orientation(FQuat::GetIdentity())
+			, Translation(translation)
+			, Scale(1.f, 1.f, 1.f)
+		{
+		}
+
+		FORCEINLINE explicit FTransformVectorized(const FQuat& orientation)
+			: Orientation(orientation)
+			, Translation(FFloat3::GetZero())
+			, Scale(1.f, 1.f, 1.f)
+		{
+		}
+
+		FORCEINLINE FTransformVectorized(const FQuat& orientation, const FFloat3& translation, const FFloat3& scale = FFloat3(1.f, 1.f, 1.f))
+			: Orientation(orientation)
+			, Translation(translation)
+			, Scale(scale)
+		{
+		}
+
+		FORCEINLINE FTransformVectorized GetInversed() const
+		{
+			const FQuatVectorized orientation(VectorLoad(&Orientation.X));
+			// Zero for the zero scale as FFloat3::GetReciprocal.
+			const FVectorRegister s = VectorLoadFloat3(&Scale.X, 1.f);
+			const FVectorRegister scale = _mm_and_ps(
+				_mm_cmpge_ps(VectorAbs(s), VectorSetFloat1(SSmallFloat)),
+				_mm_div_ps(VectorSetFloat1(1.f), s));
+			const FVectorRegister translation = orientation.GetInversed().RotateVector(
+				VectorNegate(VectorMultiply(scale, VectorLoadFloat3(&Translation.X))));
+
+			FTransformVectorized result;
+			VectorStore(&result.Orientation.X, orientation.GetInversed().Load());
+			VectorStoreFloat3(&result.Translation.X, translation);
+			VectorStoreFloat3(&result.Scale.X, scale);
+			return result;
+		}
+
+		FORCEINLINE FTransformVectorized operator*(float value) const
+		{
+			return FTransformVectorized(Orientation*value, Translation*value, Scale*value);
+		}
+
+		FORCEINLINE FTransformVectorized& operator*=(float value)
+		{
+			Orientation *= value;
+			Translation *= value;
+			Scale *= value;
+			return *this;
+		}
+
+		// Applies this first, then transform.
+		FORCEINLINE FTransformVectorized operator*(const FTransformVectorized& transform) const
+		{
+			const FQuatVectorized parent(VectorLoad(&transform.Orientation.X));
+			const FVectorRegister parentScale = VectorLoadFloat3(&transform.Scale.X);
+
+			const FVectorRegister orientation = VectorQuaternionMultiply(parent.Load(), VectorLoad(&Orientation.X));
+			const FVectorRegister translation = VectorAdd(
+				parent.RotateVector(VectorMultiply(parentScale, VectorLoadFloat3(&Translation.X))),
+				VectorLoadFloat3(&transform.Translation.X));
+			const FVectorRegister scale = VectorMultiply(parentScale, VectorLoadFloat3(&Scale.X));
+
+			FTransformVectorized result;
+			VectorStore(&result.Orientation.X, orientation);
+			VectorStoreFloat3(&result.Translation.X, translation);
+			VectorStoreFloat3(&result.Scale.X, scale);
+			return result;
+		}
+
+		FORCEINLINE FTransformVectorized& operator*=(const FTransformVectorized& transform)
+		{
+			*this = (*this) * transform;
+			return *this;
+		}
+
+		FORCEINLINE FVectorRegister TranformVector(FVectorRegister vec) const
+		{
+			const FQuatVectorized orientation(VectorLoad(&Orientation.X));
+			return orientation.RotateVector(VectorMultiply(vec, VectorLoadFloat3(&Scale.X)));
+		}
+
+		FORCEINLINE FVectorRegister TransformPosition(FVectorRegister vec) const
+		{
+			return VectorAdd(TranformVector(vec), VectorLoadFloat3(&Translation.X));
+		}
+
+		FORCEINLINE FFloat3 TranformVector(const FFloat3& vec) const
+		{
+			FFloat3 result;
+			VectorStoreFloat3(&result.X, TranformVector(VectorLoadFloat3(&vec.X)));
+			return result;
+		}
+
+		FORCEINLINE FFloat3 TransformPosition(const FFloat3& vec) const
+		{
+			FFloat3 result;
+			VectorStoreFloat3(&result.X, TransformPosition(VectorLoadFloat3(&vec.X)));
+			return result;
+		}
+
+		FORCEINLINE FFloat4x4 ToMatrix(bool withScale = true) const
+		{
+			FFloat4x4 matrix;
+
+			const float x2 = Orientation.X + Orientation.X;
+			const float y2 = Orientation.Y + Orientation.Y;
+			const float z2 = Orientation.Z + Orientation.Z;
+
+			const float xx2 = Orientation.X * x2;
+			const float yy2 = Orientation.Y * y2;
+			const float zz2 = Orientation.Z * z2;
+			const float yz2 = Orientation.Y * z2;
+			const float wx2 = Orientation.W * x2;
+			const float xy2 = Orientation.X * y2;
+			const float wz2 = Orientation.W * z2;
+			const float xz2 = Orientation.X * z2;
+			const float wy2 = Orientation.W * y2;
+
+			FVectorRegister r0 = VectorSet(1.f - (yy2 + zz2), xy2 - wz2, xz2 + wy2, 0.f);
+			FVectorRegister r1 = VectorSet(xy2 + wz2, 1.f - (xx2 + zz2), yz2 - wx2, 0.f);
+			FVectorRegister r2 = VectorSet(xz2 - wy2, yz2 + wx2, 1.f - (xx2 + yy2), 0.f);
+			if (withScale)
+			{
+				r0 = VectorMultiply(r0, VectorSetFloat1(Scale.X));
+				r1 = VectorMultiply(r1, VectorSetFloat1(Scale.Y));
+				r2 = VectorMultiply(r2, VectorSetFloat1(Scale.Z));
+			}
+
+			VectorStore(matrix.M[0], r0);
+			VectorStore(matrix.M[1], r1);
+			VectorStore(matrix.M[2], r2);
+			VectorStore(matrix.M[3], VectorLoadFloat3(&Translation.X, 1.f));
+			return matrix;
+		}
+
+		FORCEINLINE FFloat4x4 ToMatrixNoScale() const
+		{
+			return ToMatrix(false);
+		}
+
+		FORCEINLINE FTransformVectorized& FromMatrix(const FFloat4x4& matrix)
+		{
+			Scale = matrix.GetScale();
+			Orientation = matrix.GetOrientation();
+			Translation = matrix.GetOrigin();
+			return *this;
+		}
+
+	public:
+		FORCEINLINE static FTransformVectorized GetIdentity()
+		{
+			return FTransformVectorized();
+		}
+	};
+}
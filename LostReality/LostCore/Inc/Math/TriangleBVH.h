@@ -0,0 +1,512 @@
+/*
+* file TriangleBVH.h
+*
+* author luoxw
+* date 2018/03/28
+*
+* Static bounding volume hierarchy over the triangles of a mesh, in mesh space.
+* Built once with binned SAH, leaves hold up to 8 triangles in one FTrianglePacket,
+* the first vertex and both edges in SoA as Moller-Trumbore reads them.
+* A leaf is tested 4 triangles per SSE2 step or 8 per AVX2 step by GetSIMDLevel.
+* Nodes and packets are plain data, .ivm keeps them next to the mesh.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "AABB.h"
+#include "Line.h"
+#include "Plane.h"
+
+namespace LostCore
+{
+	// Lanes past the triangles of the leaf are zero, their determinant is 0 and they are never hit.
+	struct FTrianglePacket
+	{
+		static const uint32 SWidth = 8;
+
+		float V0X[SWidth], V0Y[SWidth], V0Z[SWidth];
+		float E1X[SWidth], E1Y[SWidth], E1Z[SWidth];
+		float E2X[SWidth], E2Y[SWidth], E2Z[SWidth];
+
+		// Index of the triangle in the array given to FTriangleBVH::Build.
+		uint32 Indices[SWidth];
+	};
+
+	struct FTriangleBVHNode
+	{
+		FFloat3 Min;
+
+		// Packet of a leaf, or the first of the two adjacent children.
+		uint32 First;
+
+		FFloat3 Max;
+
+		// Triangles of a leaf, 0 for the inner nodes.
+		uint32 Count;
+	};
+
+	class FTriangleBVH
+	{
+	public:
+		FORCEINLINE void Build(const vector<FTriangle>& triangles);
+
+		// Takes nodes and packets saved before, false if they don't make a tree.
+		FORCEINLINE bool Assign(const TArrayView<FTriangleBVHNode>& nodes, const TArrayView<FTrianglePacket>& packets);
+
+		FORCEINLINE void Clear();
+		FORCEINLINE bool IsEmpty() const;
+		FORCEINLINE const vector<FTriangleBVHNode>& GetNodes() const;
+		FORCEINLINE const vector<FTrianglePacket>& GetPackets() const;
+
+		// Nearest triangle in front of the ray and closer than ray.Distance, both sides hit.
+		// dist and triangle are left unchanged when nothing is hit.
+		FORCEINLINE bool RayCast(const FRay& ray, FRay::FT& dist, uint32& triangle) const;
+
+	private:
+		static const uint32 SMaxDepth = 128;
+		static const int32 SNumBins = 16;
+		static const int32 SMaxSAHDepth = 48;
+
+		void BuildNode(uint32 index, const FAABoundingBox* bounds, const vector<FTriangle>& triangles, uint32* order, uint32 num, int32 depth);
+
+		static bool RayNode(const FRay& ray, const FTriangleBVHNode& node, FRay::FT maxDist, FRay::FT& enter);
+
+		// Each returns true and lowers nearest when a lane of the packet is hit closer.
+		static bool SSE2Intersect(const FRay& ray, const FTrianglePacket& packet, uint32 count, FRay::FT& nearest, uint32& triangle);
+		static bool AVX2Intersect(const FRay& ray, const FTrianglePacket& packet, FRay::FT& nearest, uint32& triangle);
+
+		vector<FTriangleBVHNode> Nodes;
+		vector<FTrianglePacket> Packets;
+	};
+
+	FORCEINLINE void FTriangleBVH::Build(const vector<FTriangle>& triangles)
+	{
+		Clear();
+		if (triangles.empty())
+		{
+			return;
+		}
+
+		const uint32 num = (uint32)triangles.size();
+		vector<FAABoundingBox> bounds(num);
+		vector<uint32> order(num);
+		for (uint32 i = 0; i < num; ++i)
+		{
+			bounds[i].AddPoint(triangles[i].P[0]);
+			bounds[i].AddPoint(triangles[i].P[1]);
+			bounds[i].AddPoint(triangles[i].P[2]);
+			order[i] = i;
+		}
+
+		Nodes.reserve(num / 2);
+		Packets.reserve(num / 4);
+		Nodes.push_back(FTriangleBVHNode());
+		BuildNode(0, bounds.data(), triangles, order.data(), num, 0);
+	}
+
+	FORCEINLINE bool FTriangleBVH::Assign(const TArrayView<FTriangleBVHNode>& nodes, const TArrayView<FTrianglePacket>& packets)
+	{
+		Clear();
+		if (nodes.Num() == 0 || packets.Num() == 0)
+		{
+			return false;
+		}
+
+		// Build puts the children after their parent, which also rules out cycles.
+		for (uint32 index = 0; index < nodes.Num(); ++index)
+		{
+			const FTriangleBVHNode& node = nodes[index];
+			const bool valid = node.Count > 0
+				? node.Count <= FTrianglePacket::SWidth && node.First < packets.Num()
+				: node.First > index && node.First < nodes.Num() - 1;
+
+			if (!valid)
+			{
+				return false;
+			}
+		}
+
+		Nodes = nodes.ToVector();
+		Packets = packets.ToVector();
+		return true;
+	}
+
+	FORCEINLINE void FTriangleBVH::Clear()
+	{
+		Nodes.clear();
+		Packets.clear();
+	}
+
+	FORCEINLINE bool FTriangleBVH::IsEmpty() const
+	{
+		return Nodes.empty();
+	}
+
+	FORCEINLINE const vector<FTriangleBVHNode>& FTriangleBVH::GetNodes() const
+	{
+		return Nodes;
+	}
+
+	FORCEINLINE const vector<FTrianglePacket>& FTriangleBVH::GetPackets() const
+	{
+		return Packets;
+	}
+
+	FORCEINLINE bool FTriangleBVH::RayCast(const FRay& ray, FRay::FT& dist, uint32& triangle) const
+	{
+		if (Nodes.empty())
+		{
+			return false;
+		}
+
+		const bool avx2 = GetSIMDLevel() == ESIMDLevel::AVX2;
+		FRay::FT nearest = ray.Distance;
+		bool hit = false;
+
+		// Entry distances go along the stack, a node behind a closer hit found meanwhile is skipped.
+		uint32 stack[SMaxDepth];
+		FRay::FT enters[SMaxDepth];
+		int32 top = 0;
+		FRay::FT enter;
+		if (RayNode(ray, Nodes[0], nearest, enter))
+		{
+			stack[top] = 0;
+			enters[top++] = enter;
+		}
+
+		while (top > 0)
+		{
+			--top;
+			if (enters[top] > nearest)
+			{
+				continue;
+			}
+
+			const FTriangleBVHNode& node = Nodes[stack[top]];
+			if (node.Count > 0)
+			{
+				const FTrianglePacket& packet = Packets[node.First];
+				hit |= avx2 ? AVX2Intersect(ray, packet, nearest, triangle) : SSE2Intersect(ray, packet, node.Count, nearest, triangle);
+				continue;
+			}
+
+			// Build never goes this deep, an assigned tree that does loses the rest of the branch.
+			if (top + 2 > (int32)SMaxDepth)
+			{
+				assert(0);
+				continue;
+			}
+
+			FRay::FT enter0, enter1;
+			const uint32 child0 = node.First, child1 = node.First + 1;
+			const bool hit0 = RayNode(ray, Nodes[child0], nearest, enter0);
+			const bool hit1 = RayNode(ray, Nodes[child1], nearest, enter1);
+			if (hit0 && hit1)
+			{
+				const bool nearFirst = enter0 < enter1;
+				stack[top] = nearFirst ? child1 : child0;
+				enters[top++] = nearFirst ? enter1 : enter0;
+				stack[top] = nearFirst ? child0 : child1;
+				enters[top++] = nearFirst ? enter0 : enter1;
+			}
+			else if (hit0)
+			{
+				stack[top] = child0;
+				enters[top++] = enter0;
+			}
+			else if (hit1)
+			{
+				stack[top] = child1;
+				enters[top++] = enter1;
+			}
+		}
+
+		if (hit)
+		{
+			dist = nearest;
+		}
+
+		return hit;
+	}
+
+	// Splits at the bin boundary of least SAH cost along the widest axis of the centers,
+	// deep ranges and ranges with one center fall back to halving the count.
+	inline void FTriangleBVH::BuildNode(uint32 index, const FAABoundingBox* bounds, const vector<FTriangle>& triangles, uint32* order, uint32 num, int32 depth)
+	{
+		FAABoundingBox nodeBounds, centers;
+		for (uint32 i = 0; i < num; ++i)
+		{
+			const FAABoundingBox& box = bounds[order[i]];
+			nodeBounds.AddBound(box);
+			centers.AddPoint((box.Min + box.Max) * 0.5f);
+		}
+
+		Nodes[index].Min = nodeBounds.Min;
+		Nodes[index].Max = nodeBounds.Max;
+
+		if (num <= FTrianglePacket::SWidth)
+		{
+			FTrianglePacket packet;
+			memset(&packet, 0, sizeof(packet));
+			for (uint32 lane = 0; lane < num; ++lane)
+			{
+				const FTriangle& tri = triangles[order[lane]];
+				const FFloat3 e1(tri.P[1] - tri.P[0]);
+				const FFloat3 e2(tri.P[2] - tri.P[0]);
+				packet.V0X[lane] = tri.P[0].X;
+				packet.V0Y[lane] = tri.P[0].Y;
+				packet.V0Z[lane] = tri.P[0].Z;
+				packet.E1X[lane] = e1.X;
+				packet.E1Y[lane] = e1.Y;
+				packet.E1Z[lane] = e1.Z;
+				packet.E2X[lane] = e2.X;
+				packet.E2Y[lane] = e2.Y;
+				packet.E2Z[lane] = e2.Z;
+				packet.Indices[lane] = order[lane];
+			}
+
+			Nodes[index].First = (uint32)Packets.size();
+			Nodes[index].Count = num;
+			Packets.push_back(packet);
+			return;
+		}
+
+		const FFloat3 size(centers.Max - centers.Min);
+		const int32 axis = size.X > size.Y ? (size.X > size.Z ? 0 : 2) : (size.Y > size.Z ? 1 : 2);
+		const float lo = centers.Min[axis];
+		const float extent = size[axis];
+		auto centerOf = [&](uint32 tri)
+		{
+			return (bounds[tri].Min[axis] + bounds[tri].Max[axis]) * 0.5f;
+		};
+
+		uint32 split = 0;
+		if (extent > 0.f && depth < SMaxSAHDepth)
+		{
+			FAABoundingBox binBounds[SNumBins];
+			uint32 binCounts[SNumBins] = { 0 };
+			const float scale = SNumBins * 0.9999f / extent;
+			auto binOf = [&](uint32 tri)
+			{
+				return (int32)((centerOf(tri) - lo) * scale);
+			};
+
+			for (uint32 i = 0; i < num; ++i)
+			{
+				const int32 bin = binOf(order[i]);
+				binBounds[bin].AddBound(bounds[order[i]]);
+				binCounts[bin]++;
+			}
+
+			// Cost of the left side of every boundary, then the right side from the other end.
+			float leftCosts[SNumBins - 1];
+			FAABoundingBox accum;
+			uint32 count = 0;
+			for (int32 bin = 0; bin < SNumBins - 1; ++bin)
+			{
+				if (binCounts[bin] > 0)
+				{
+					accum.AddBound(binBounds[bin]);
+					count += binCounts[bin];
+				}
+
+				leftCosts[bin] = count > 0 ? accum.GetHalfArea() * count : 0.f;
+			}
+
+			float bestCost = FLT_MAX;
+			int32 bestBin = -1;
+			accum = FAABoundingBox();
+			count = 0;
+			for (int32 bin = SNumBins - 1; bin > 0; --bin)
+			{
+				if (binCounts[bin] > 0)
+				{
+					accum.AddBound(binBounds[bin]);
+					count += binCounts[bin];
+				}
+
+				if (count > 0 && count < num)
+				{
+					const float cost = leftCosts[bin - 1] + accum.GetHalfArea() * count;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestBin = bin;
+					}
+				}
+			}
+
+			if (bestBin > 0)
+			{
+				uint32* mid = std::partition(order, order + num, [&](uint32 tri) { return binOf(tri) < bestBin; });
+				split = (uint32)(mid - order);
+			}
+		}
+
+		if (split == 0 || split >= num)
+		{
+			split = num / 2;
+			std::nth_element(order, order + split, order + num, [&](uint32 l, uint32 r) { return centerOf(l) < centerOf(r); });
+		}
+
+		// Children are added together, the references into Nodes don't survive the recursion.
+		const uint32 first = (uint32)Nodes.size();
+		Nodes[index].First = first;
+		Nodes[index].Count = 0;
+		Nodes.push_back(FTriangleBVHNode());
+		Nodes.push_back(FTriangleBVHNode());
+		BuildNode(first, bounds, triangles, order, split, depth + 1);
+		BuildNode(first + 1, bounds, triangles, order + split, num - split, depth + 1);
+	}
+
+	// Slabs with the reciprocal direction, a NaN of a ray inside a slab plane leaves that axis open.
+	inline bool FTriangleBVH::RayNode(const FRay& ray, const FTriangleBVHNode& node, FRay::FT maxDist, FRay::FT& enter)
+	{
+		FRay::FT tmin = 0.f, tmax = maxDist;
+		for (int32 axis = 0; axis < 3; ++axis)
+		{
+			const FRay::FT t0 = (node.Min[axis] - ray.P0[axis]) * ray.RcpNormal[axis];
+			const FRay::FT t1 = (node.Max[axis] - ray.P0[axis]) * ray.RcpNormal[axis];
+			const FRay::FT slabNear = t0 < t1 ? t0 : t1;
+			const FRay::FT slabFar = t0 < t1 ? t1 : t0;
+			tmin = slabNear > tmin ? slabNear : tmin;
+			tmax = slabFar < tmax ? slabFar : tmax;
+		}
+
+		enter = tmin;
+		return tmin <= tmax;
+	}
+
+	inline bool FTriangleBVH::SSE2Intersect(const FRay& ray, const FTrianglePacket& packet, uint32 count, FRay::FT& nearest, uint32& triangle)
+	{
+		const __m128 dx = _mm_set1_ps(ray.Normal.X);
+		const __m128 dy = _mm_set1_ps(ray.Normal.Y);
+		const __m128 dz = _mm_set1_ps(ray.Normal.Z);
+		const __m128 ox = _mm_set1_ps(ray.P0.X);
+		const __m128 oy = _mm_set1_ps(ray.P0.Y);
+		const __m128 oz = _mm_set1_ps(ray.P0.Z);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+
+		bool hit = false;
+		for (uint32 offset = 0; offset < count; offset += 4)
+		{
+			const __m128 e1x = _mm_loadu_ps(packet.E1X + offset);
+			const __m128 e1y = _mm_loadu_ps(packet.E1Y + offset);
+			const __m128 e1z = _mm_loadu_ps(packet.E1Z + offset);
+			const __m128 e2x = _mm_loadu_ps(packet.E2X + offset);
+			const __m128 e2y = _mm_loadu_ps(packet.E2Y + offset);
+			const __m128 e2z = _mm_loadu_ps(packet.E2Z + offset);
+
+			// p = d x e2, det = e1 . p
+			const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+			const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+			const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+			const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+			const __m128 inv = _mm_div_ps(one, det);
+
+			// s = o - v0, u = (s . p) / det
+			const __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(packet.V0X + offset));
+			const __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(packet.V0Y + offset));
+			const __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(packet.V0Z + offset));
+			const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv);
+
+			// q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+			const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+			const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+			const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+			const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+			const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+
+			__m128 mask = _mm_cmpneq_ps(det, zero);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(nearest)));
+
+			int32 bits = _mm_movemask_ps(mask);
+			if (bits == 0)
+			{
+				continue;
+			}
+
+			float dists[4];
+			_mm_storeu_ps(dists, t);
+			for (uint32 lane = 0; bits != 0; ++lane, bits >>= 1)
+			{
+				if ((bits & 1) != 0 && dists[lane] < nearest)
+				{
+					nearest = dists[lane];
+					triangle = packet.Indices[offset + lane];
+					hit = true;
+				}
+			}
+		}
+
+		return hit;
+	}
+
+	inline bool FTriangleBVH::AVX2Intersect(const FRay& ray, const FTrianglePacket& packet, FRay::FT& nearest, uint32& triangle)
+	{
+		const __m256 dx = _mm256_set1_ps(ray.Normal.X);
+		const __m256 dy = _mm256_set1_ps(ray.Normal.Y);
+		const __m256 dz = _mm256_set1_ps(ray.Normal.Z);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.f);
+
+		const __m256 e1x = _mm256_loadu_ps(packet.E1X);
+		const __m256 e1y = _mm256_loadu_ps(packet.E1Y);
+		const __m256 e1z = _mm256_loadu_ps(packet.E1Z);
+		const __m256 e2x = _mm256_loadu_ps(packet.E2X);
+		const __m256 e2y = _mm256_loadu_ps(packet.E2Y);
+		const __m256 e2z = _mm256_loadu_ps(packet.E2Z);
+
+		// As SSE2Intersect, 8 lanes with fma.
+		const __m256 px = _mm256_fmsub_ps(dy, e2z, _mm256_mul_ps(dz, e2y));
+		const __m256 py = _mm256_fmsub_ps(dz, e2x, _mm256_mul_ps(dx, e2z));
+		const __m256 pz = _mm256_fmsub_ps(dx, e2y, _mm256_mul_ps(dy, e2x));
+		const __m256 det = _mm256_fmadd_ps(e1x, px, _mm256_fmadd_ps(e1y, py, _mm256_mul_ps(e1z, pz)));
+		const __m256 inv = _mm256_div_ps(one, det);
+
+		const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.P0.X), _mm256_loadu_ps(packet.V0X));
+		const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.P0.Y), _mm256_loadu_ps(packet.V0Y));
+		const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.P0.Z), _mm256_loadu_ps(packet.V0Z));
+		const __m256 u = _mm256_mul_ps(_mm256_fmadd_ps(sx, px, _mm256_fmadd_ps(sy, py, _mm256_mul_ps(sz, pz))), inv);
+
+		const __m256 qx = _mm256_fmsub_ps(sy, e1z, _mm256_mul_ps(sz, e1y));
+		const __m256 qy = _mm256_fmsub_ps(sz, e1x, _mm256_mul_ps(sx, e1z));
+		const __m256 qz = _mm256_fmsub_ps(sx, e1y, _mm256_mul_ps(sy, e1x));
+		const __m256 v = _mm256_mul_ps(_mm256_fmadd_ps(dx, qx, _mm256_fmadd_ps(dy, qy, _mm256_mul_ps(dz, qz))), inv);
+		const __m256 t = _mm256_mul_ps(_mm256_fmadd_ps(e2x, qx, _mm256_fmadd_ps(e2y, qy, _mm256_mul_ps(e2z, qz))), inv);
+
+		__m256 mask = _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ);
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, zero, _CMP_GT_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, _mm256_set1_ps(nearest), _CMP_LT_OQ));
+
+		int32 bits = _mm256_movemask_ps(mask);
+		if (bits == 0)
+		{
+			return false;
+		}
+
+		float dists[8];
+		_mm256_storeu_ps(dists, t);
+		bool hit = false;
+		for (uint32 lane = 0; bits != 0; ++lane, bits >>= 1)
+		{
+			if ((bits & 1) != 0 && dists[lane] < nearest)
+			{
+				nearest = dists[lane];
+				triangle = packet.Indices[lane];
+				hit = true;
+			}
+		}
+
+		return hit;
+	}
+}
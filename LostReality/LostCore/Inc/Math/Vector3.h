@@ -210,7 +210,7 @@ namespace LostCore
 	template <typename T>
 	FORCEINLINE T TVec3NonVectorized<T>::operator[](int32 index) const
 	{
-		return (*this)[index];
+		return index == 0 ? X : (index == 1 ? Y : Z);
 	}
 
 	template <typename T>
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "MathBase.h"
+#include "Vector4Vectorized.h"
 
 namespace LostCore
 {
@@ -106,7 +107,11 @@ namespace LostCore
 #error "TYPEDEF_DECL_VEC4 already defined somewhere else"
 #endif
 
+#if MATH_VECTORIZED
+typedef FVec4Vectorized FFloat4;
+#else
 typedef TVec4NonVectorized<float> FFloat4;
+#endif
 typedef TVec4NonVectorized<double> FDouble4;
 typedef TVec4NonVectorized<int32> FSInt4;
 typedef TVec4NonVectorized<uint8> FByte4;
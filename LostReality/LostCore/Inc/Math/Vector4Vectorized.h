@@ -0,0 +1,139 @@
+/*
+* file Vector4Vectorized.h
+*
+* author luoxw
+* date 2018/03/18
+*
+* SSE version of TVec4NonVectorized<float>, same members and layout.
+*/
+
+#pragma once
+
+#include "MathSIMD.h"
+#include "Vector3.h"
+
+namespace LostCore
+{
+	class FVec4Vectorized
+	{
+	public:
+		typedef float FT;
+
+		float X;
+		float Y;
+		float Z;
+		float W;
+
+		FVec4Vectorized()
+			: X(0.f)
+			, Y(0.f)
+			, Z(0.f)
+			, W(0.f)
+		{}
+
+		FVec4Vectorized(float x, float y, float z, float w)
+			: X(x), Y(y), Z(z), W(w) {}
+
+		FVec4Vectorized(const FFloat3& vec, float w)
+			: X(vec.X), Y(vec.Y), Z(vec.Z), W(w) {}
+
+		explicit FVec4Vectorized(const float* p)
+		{
+			VectorStore(&X, VectorLoad(p));
+		}
+
+		explicit FVec4Vectorized(FVectorRegister v)
+		{
+			VectorStore(&X, v);
+		}
+
+		FORCEINLINE FVectorRegister Load() const;
+		FORCEINLINE void Store(FVectorRegister v);
+
+		FORCEINLINE float operator|(const FVec4Vectorized& vec) const;
+		FORCEINLINE float operator[](int32 index) const;
+		FORCEINLINE float& operator[](int32 index);
+		FORCEINLINE bool operator==(const FVec4Vectorized& rhs) const;
+		FORCEINLINE FVec4Vectorized& operator=(const FVec4Vectorized& rhs);
+
+		FORCEINLINE FVec4Vectorized operator+(const FVec4Vectorized& rhs) const;
+		FORCEINLINE FVec4Vectorized operator-(const FVec4Vectorized& rhs) const;
+		FORCEINLINE FVec4Vectorized operator*(const FVec4Vectorized& rhs) const;
+		FORCEINLINE FVec4Vectorized operator*(float s) const;
+	};
+
+	FORCEINLINE FVectorRegister FVec4Vectorized::Load() const
+	{
+		return VectorLoad(&X);
+	}
+
+	FORCEINLINE void FVec4Vectorized::Store(FVectorRegister v)
+	{
+		VectorStore(&X, v);
+	}
+
+	FORCEINLINE float FVec4Vectorized::operator|(const FVec4Vectorized& vec) const
+	{
+		return VectorGetX(VectorDot4(Load(), vec.Load()));
+	}
+
+	FORCEINLINE float& FVec4Vectorized::operator[](int32 index)
+	{
+		return (&X)[index];
+	}
+
+	FORCEINLINE float FVec4Vectorized::operator[](int32 index) const
+	{
+		return (&X)[index];
+	}
+
+	FORCEINLINE bool FVec4Vectorized::operator==(const FVec4Vectorized& rhs) const
+	{
+		return VectorMaskEqual(Load(), rhs.Load()) == 0xf;
+	}
+
+	FORCEINLINE FVec4Vectorized& FVec4Vectorized::operator=(const FVec4Vectorized& rhs)
+	{
+		Store(rhs.Load());
+		return *this;
+	}
+
+	FORCEINLINE FVec4Vectorized FVec4Vectorized::operator+(const FVec4Vectorized& rhs) const
+	{
+		return FVec4Vectorized(VectorAdd(Load(), rhs.Load()));
+	}
+
+	FORCEINLINE FVec4Vectorized FVec4Vectorized::operator-(const FVec4Vectorized& rhs) const
+	{
+		return FVec4Vectorized(VectorSubtract(Load(), rhs.Load()));
+	}
+
+	FORCEINLINE FVec4Vectorized FVec4Vectorized::operator*(const FVec4Vectorized& rhs) const
+	{
+		return FVec4Vectorized(VectorMultiply(Load(), rhs.Load()));
+	}
+
+	FORCEINLINE FVec4Vectorized FVec4Vectorized::operator*(float s) const
+	{
+		return FVec4Vectorized(VectorMultiply(Load(), VectorSetFloat1(s)));
+	}
+
+	FORCEINLINE void from_json(const FJson& j, FVec4Vectorized& val)
+	{
+		if (j.is_array() && j.size() >= 4)
+		{
+			val.X = j[0];
+			val.Y = j[1];
+			val.Z = j[2];
+			val.W = j[3];
+		}
+	}
+
+	FORCEINLINE void to_json(FJson& j, const FVec4Vectorized& val)
+	{
+		j[0] = val.X;
+		j[1] = val.Y;
+		j[2] = val.Z;
+		j[3] = val.W;
+	}
+}
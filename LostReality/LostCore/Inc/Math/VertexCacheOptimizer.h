@@ -0,0 +1,233 @@
+/*
+* file VertexCacheOptimizer.h
+*
+* author luoxw
+* date 2018/03/14
+*
+* Post-transform vertex cache reordering of triangle lists, after Tom Forsyth's
+* "Linear-Speed Vertex Cache Optimisation". Only the triangle order changes,
+* vertices keep their indices.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	class FVertexCacheOptimizer
+	{
+	public:
+		// indices is a triangle list, reordered in place.
+		static void Optimize(vector<uint32>& indices, uint32 numVertices);
+
+		// Average cache miss ratio (transformed vertices per triangle) of a FIFO cache.
+		static float GetACMR(const vector<uint32>& indices, uint32 numVertices, uint32 cacheSize = 16);
+
+	private:
+		static const int32 SCacheSize = 32;
+
+		static float GetVertexScore(int32 cachePosition, uint32 numActiveTriangles);
+	};
+
+	FORCEINLINE float FVertexCacheOptimizer::GetVertexScore(int32 cachePosition, uint32 numActiveTriangles)
+	{
+		if (numActiveTriangles == 0)
+		{
+			// No triangle needs this vertex any more.
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// Used by the last triangle, a fixed score avoids favouring any of its edges.
+				score = 0.75f;
+			}
+			else
+			{
+				const float scaler = 1.0f / (SCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, 1.5f);
+			}
+		}
+
+		// Boost vertices with few triangles left, so lone triangles are not left behind.
+		score += 2.0f / sqrtf((float)numActiveTriangles);
+		return score;
+	}
+
+	FORCEINLINE void FVertexCacheOptimizer::Optimize(vector<uint32>& indices, uint32 numVertices)
+	{
+		const uint32 numTriangles = indices.size() / 3;
+		if (numTriangles == 0 || numVertices == 0)
+		{
+			return;
+		}
+
+		// Triangles adjacent to every vertex, packed. The first NumActive of a vertex's
+		// range are the triangles not emitted yet.
+		vector<uint32> numActive(numVertices, 0);
+		for (auto index : indices)
+		{
+			assert(index < numVertices);
+			++numActive[index];
+		}
+
+		vector<uint32> adjacencyOffset(numVertices + 1, 0);
+		for (uint32 i = 0; i < numVertices; ++i)
+		{
+			adjacencyOffset[i + 1] = adjacencyOffset[i] + numActive[i];
+		}
+
+		vector<uint32> adjacency(indices.size());
+		{
+			vector<uint32> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (uint32 i = 0; i < indices.size(); ++i)
+			{
+				adjacency[cursor[indices[i]]++] = i / 3;
+			}
+		}
+
+		vector<int32> cachePosition(numVertices, -1);
+		vector<float> vertexScore(numVertices);
+		for (uint32 i = 0; i < numVertices; ++i)
+		{
+			vertexScore[i] = GetVertexScore(-1, numActive[i]);
+		}
+
+		vector<float> triangleScore(numTriangles);
+		vector<bool> emitted(numTriangles, false);
+		for (uint32 i = 0; i < numTriangles; ++i)
+		{
+			triangleScore[i] = vertexScore[indices[i * 3]] + vertexScore[indices[i * 3 + 1]] + vertexScore[indices[i * 3 + 2]];
+		}
+
+		vector<uint32> output;
+		output.reserve(indices.size());
+
+		// Three extra slots hold the vertices pushed out by the newest triangle.
+		array<int32, SCacheSize + 3> cache;
+		array<int32, SCacheSize + 3> newCache;
+		cache.fill(-1);
+
+		uint32 scanCursor = 0;
+		int32 bestTriangle = -1;
+		for (uint32 numEmitted = 0; numEmitted < numTriangles; ++numEmitted)
+		{
+			if (bestTriangle < 0)
+			{
+				// Nothing useful in the cache, continue with the next triangle in input order.
+				while (emitted[scanCursor])
+				{
+					++scanCursor;
+				}
+
+				bestTriangle = scanCursor;
+			}
+
+			const uint32* tri = &indices[bestTriangle * 3];
+			output.insert(output.end(), tri, tri + 3);
+			emitted[bestTriangle] = true;
+
+			for (int32 corner = 0; corner < 3; ++corner)
+			{
+				uint32 vert = tri[corner];
+
+				// Retire the triangle from the vertex's active range.
+				uint32 begin = adjacencyOffset[vert];
+				uint32 last = begin + numActive[vert] - 1;
+				for (uint32 i = begin; i <= last; ++i)
+				{
+					if (adjacency[i] == (uint32)bestTriangle)
+					{
+						std::swap(adjacency[i], adjacency[last]);
+						break;
+					}
+				}
+
+				--numActive[vert];
+				newCache[corner] = vert;
+			}
+
+			int32 newCacheSize = 3;
+			for (auto vert : cache)
+			{
+				if (vert < 0)
+				{
+					break;
+				}
+
+				if (vert != (int32)tri[0] && vert != (int32)tri[1] && vert != (int32)tri[2])
+				{
+					newCache[newCacheSize++] = vert;
+				}
+			}
+
+			for (int32 i = newCacheSize; i < SCacheSize + 3; ++i)
+			{
+				newCache[i] = -1;
+			}
+
+			// Rescore every vertex that was or is in the cache, and their remaining triangles.
+			bestTriangle = -1;
+			float bestScore = -1.0f;
+			for (int32 i = 0; i < newCacheSize; ++i)
+			{
+				int32 vert = newCache[i];
+				cachePosition[vert] = i < SCacheSize ? i : -1;
+
+				float score = GetVertexScore(cachePosition[vert], numActive[vert]);
+				float delta = score - vertexScore[vert];
+				vertexScore[vert] = score;
+
+				uint32 begin = adjacencyOffset[vert];
+				uint32 end = begin + numActive[vert];
+				for (uint32 j = begin; j < end; ++j)
+				{
+					uint32 triangle = adjacency[j];
+					triangleScore[triangle] += delta;
+					if (triangleScore[triangle] > bestScore)
+					{
+						bestScore = triangleScore[triangle];
+						bestTriangle = triangle;
+					}
+				}
+			}
+
+			for (int32 i = 0; i < SCacheSize; ++i)
+			{
+				cache[i] = newCache[i];
+			}
+
+			for (int32 i = SCacheSize; i < SCacheSize + 3; ++i)
+			{
+				cache[i] = -1;
+			}
+		}
+
+		indices.swap(output);
+	}
+
+	FORCEINLINE float FVertexCacheOptimizer::GetACMR(const vector<uint32>& indices, uint32 numVertices, uint32 cacheSize)
+	{
+		const uint32 numTriangles = indices.size() / 3;
+		if (numTriangles == 0)
+		{
+			return 0.0f;
+		}
+
+		// Timestamp of the miss that loaded each vertex; resident while it is within cacheSize misses.
+		vector<uint32> loadedAt(numVertices, 0);
+		uint32 misses = 0;
+		for (auto index : indices)
+		{
+			if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize)
+			{
+				++misses;
+				loadedAt[index] = misses;
+			}
+		}
+
+		return (float)misses / numTriangles;
+	}
+}
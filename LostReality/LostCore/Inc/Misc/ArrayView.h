@@ -0,0 +1,125 @@
+/*
+* file ArrayView.h
+*
+* author luoxw
+* date 2018/03/16
+*
+* Non-owning view of contiguous elements, e.g. a vector or a mapped file chunk.
+* The viewed memory must outlive the view.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	template<typename T>
+	class TArrayView
+	{
+	public:
+		TArrayView();
+		TArrayView(const T* data, uint32 num);
+		explicit TArrayView(const vector<T>& data);
+
+		const T* Data() const;
+		uint32 Num() const;
+		uint32 Bytes() const;
+		bool IsEmpty() const;
+
+		const T& operator[](uint32 index) const;
+		const T& Front() const;
+		const T& Back() const;
+
+		const T* begin() const;
+		const T* end() const;
+
+		vector<T> ToVector() const;
+
+	private:
+		const T* DataPtr;
+		uint32 NumElements;
+	};
+
+	template<typename T>
+	FORCEINLINE TArrayView<T>::TArrayView()
+		: DataPtr(nullptr)
+		, NumElements(0)
+	{
+	}
+
+	template<typename T>
+	FORCEINLINE TArrayView<T>::TArrayView(const T* data, uint32 num)
+		: DataPtr(data)
+		, NumElements(num)
+	{
+	}
+
+	template<typename T>
+	FORCEINLINE TArrayView<T>::TArrayView(const vector<T>& data)
+		: DataPtr(data.data())
+		, NumElements(data.size())
+	{
+	}
+
+	template<typename T>
+	FORCEINLINE const T* TArrayView<T>::Data() const
+	{
+		return DataPtr;
+	}
+
+	template<typename T>
+	FORCEINLINE uint32 TArrayView<T>::Num() const
+	{
+		return NumElements;
+	}
+
+	template<typename T>
+	FORCEINLINE uint32 TArrayView<T>::Bytes() const
+	{
+		return NumElements * sizeof(T);
+	}
+
+	template<typename T>
+	FORCEINLINE bool TArrayView<T>::IsEmpty() const
+	{
+		return NumElements == 0;
+	}
+
+	template<typename T>
+	FORCEINLINE const T& TArrayView<T>::operator[](uint32 index) const
+	{
+		assert(index < NumElements);
+		return DataPtr[index];
+	}
+
+	template<typename T>
+	FORCEINLINE const T& TArrayView<T>::Front() const
+	{
+		assert(NumElements > 0);
+		return DataPtr[0];
+	}
+
+	template<typename T>
+	FORCEINLINE const T& TArrayView<T>::Back() const
+	{
+		assert(NumElements > 0);
+		return DataPtr[NumElements - 1];
+	}
+
+	template<typename T>
+	FORCEINLINE const T* TArrayView<T>::begin() const
+	{
+		return DataPtr;
+	}
+
+	template<typename T>
+	FORCEINLINE const T* TArrayView<T>::end() const
+	{
+		return DataPtr + NumElements;
+	}
+
+	template<typename T>
+	FORCEINLINE vector<T> TArrayView<T>::ToVector() const
+	{
+		return vector<T>(begin(), end());
+	}
+}
@@ -0,0 +1,947 @@
+/*
+* file AsyncLog.h
+*
+* author luoxw
+* date 2018/03/17
+*
+* Backend of LVMSG/LVWARN/LVERR/LVDEBUG.
+* Every logging thread owns a single-producer ring of FLogRecord. A record keeps
+* the format pointer (always a literal) and a copy of the arguments, a writer
+* thread formats, sorts and appends them in batches, callers never touch a file.
+* Like the log files, each module has its own FAsyncLog.
+* Shutdown has to be called before the module is unloaded, the writer thread
+* can not be joined under the loader lock. DestroyProcessUnique does it in the module
+* owning FProcessUnique, SetProcessUnique(nullptr) in a dll given the instance.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	enum class ELogOverflow : uint8
+	{
+		// Use FAsyncLog::GetOverflow.
+		Default,
+
+		// Count and discard the record, the caller never waits.
+		Drop,
+
+		// Wait until the writer has made room.
+		Block,
+	};
+
+	struct FLogArg
+	{
+		enum class EType : uint8
+		{
+			Int,
+			UInt,
+			Real,
+			Pointer,
+			String,
+		};
+
+		union
+		{
+			int64 Int;
+			uint64 UInt;
+			double Real;
+			const void* Pointer;
+			uint32 StringOffset;
+		};
+
+		EType Type;
+
+		// Bytes of an integer argument, %x and %d print it at that width as printf does.
+		uint8 Size;
+	};
+
+	struct FLogRecord
+	{
+		static const uint32 SMaxArgs = 12;
+		static const uint32 SMaxHead = 64;
+		static const uint32 SMaxPayload = 512;
+
+		FTimeStamp Tick;
+		time_t Time;
+		const char* Prefix;
+		const char* Format;
+		uint32 NumArgs;
+		uint32 PayloadSize;
+		FLogArg Args[SMaxArgs];
+		char Head[SMaxHead];
+
+		// String arguments, copied since they rarely outlive the call. Longer ones are truncated.
+		char Payload[SMaxPayload];
+
+		void Reset(const char* prefix, const char* head, const char* fmt);
+
+		void PushInt(int64 value, uint8 size = 8);
+		void PushUInt(uint64 value, uint8 size = 8);
+		void PushReal(double value);
+		void PushPointer(const void* value);
+		void PushString(const char* value, size_t length);
+		void PushString(const wchar_t* value);
+
+		const char* GetString(const FLogArg& arg) const;
+	};
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, const char* value)
+	{
+		if (value == nullptr)
+		{
+			value = "(null)";
+		}
+
+		record.PushString(value, strlen(value));
+	}
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, char* value)
+	{
+		PushLogArg(record, (const char*)value);
+	}
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, const wchar_t* value)
+	{
+		record.PushString(value == nullptr ? L"(null)" : value);
+	}
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, wchar_t* value)
+	{
+		PushLogArg(record, (const wchar_t*)value);
+	}
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, const string& value)
+	{
+		record.PushString(value.c_str(), value.size());
+	}
+
+	FORCEINLINE void PushLogArg(FLogRecord& record, nullptr_t)
+	{
+		record.PushPointer(nullptr);
+	}
+
+	template <typename T>
+	FORCEINLINE void PushLogArg(FLogRecord& record, T* value)
+	{
+		record.PushPointer(value);
+	}
+
+	template <typename T>
+	FORCEINLINE typename enable_if<is_floating_point<T>::value>::type PushLogArg(FLogRecord& record, T value)
+	{
+		record.PushReal(value);
+	}
+
+	template <typename T>
+	FORCEINLINE typename enable_if<is_integral<T>::value || is_enum<T>::value>::type PushLogArg(FLogRecord& record, T value)
+	{
+		// Narrower types are promoted to int, as through the ... of printf.
+		const uint8 size = (uint8)(sizeof(T) < sizeof(int32) ? sizeof(int32) : sizeof(T));
+		if (is_signed<T>::value)
+		{
+			record.PushInt((int64)value, size);
+		}
+		else
+		{
+			record.PushUInt((uint64)value, size);
+		}
+	}
+
+	template <typename T>
+	struct TIsLogArg : integral_constant<bool, is_arithmetic<T>::value || is_enum<T>::value
+		|| is_pointer<typename decay<T>::type>::value || is_same<T, nullptr_t>::value || is_convertible<const T&, string>::value>
+	{
+	};
+
+	// Anything else fails here instead of in the overload resolution above.
+	template <typename T>
+	FORCEINLINE typename enable_if<!TIsLogArg<T>::value>::type PushLogArg(FLogRecord& record, const T& value)
+	{
+		static_assert(TIsLogArg<T>::value, "LVMSG argument not recorded, pass a number, a pointer or a string (GetThreadId for a thread::id).");
+	}
+
+	FORCEINLINE void PushLogArgs(FLogRecord& record)
+	{
+	}
+
+	template <typename T, typename... Rest>
+	FORCEINLINE void PushLogArgs(FLogRecord& record, const T& arg, const Rest&... rest)
+	{
+		PushLogArg(record, arg);
+		PushLogArgs(record, rest...);
+	}
+
+	class FLogRing
+	{
+	public:
+		// Power of 2.
+		static const uint32 SCapacity = 512;
+
+		FLogRing();
+
+		// nullptr when the ring is full.
+		FLogRecord* TryBeginWrite();
+
+		// Returns the number of unread records.
+		uint32 EndWrite();
+
+		// Unread records are [first, first + count), released by EndRead.
+		uint32 BeginRead(uint32& first) const;
+		const FLogRecord& At(uint32 index) const;
+		void EndRead(uint32 count);
+
+		bool IsEmpty() const;
+
+		atomic<bool> bOwned;
+		atomic<uint32> Dropped;
+		atomic<const char*> DroppedPrefix;
+		DWORD ThreadId;
+
+	private:
+		atomic<uint32> Head;
+		atomic<uint32> Tail;
+		vector<FLogRecord> Records;
+	};
+
+	class FAsyncLog
+	{
+	public:
+		// Created on first use and never destroyed, records can arrive during static destruction.
+		static FAsyncLog* Get();
+
+		// Flushes from the unhandled exception filter, then calls the previous filter.
+		static void InstallCrashHandler();
+
+		template <typename... Args>
+		void Write(ELogOverflow overflow, const char* prefix, const char* head, const char* fmt, const Args&... args);
+
+		void SetOverflow(ELogOverflow overflow);
+		ELogOverflow GetOverflow() const;
+
+		// Blocks until everything logged before the call is in the files.
+		void Flush();
+
+		// Flushes and stops the writer, later records are written by the caller.
+		void Shutdown();
+
+	private:
+		static const uint32 SMaxRings = 64;
+		static const uint32 SWritePeriodMs = 5;
+		static const uint32 SFlushTimeoutMs = 2000;
+
+		FAsyncLog();
+
+		static void StaticFlush();
+		static LONG WINAPI CrashHandler(EXCEPTION_POINTERS* info);
+		static LPTOP_LEVEL_EXCEPTION_FILTER& GetPreviousFilter();
+
+		FLogRing* GetThreadRing();
+		FLogRing* AcquireRing();
+		bool IsWriterAlive();
+
+		void WriterLoop();
+		uint32 Drain();
+		void WriteNow(const FLogRecord& record);
+		void WriteLine(const char* prefix, const string& line);
+		ofstream* GetFile(const char* prefix);
+
+		void FormatRecord(string& output, const FLogRecord& record) const;
+		void FormatText(string& output, const FLogRecord& record) const;
+
+		array<atomic<FLogRing*>, SMaxRings> Rings;
+		atomic<uint32> NumRings;
+		mutex RingsMutex;
+
+		atomic<uint8> Overflow;
+
+		thread Writer;
+		atomic<bool> bRunning;
+		mutex WakeMutex;
+		condition_variable WakeCondition;
+		condition_variable FlushCondition;
+		atomic<uint64> FlushRequest;
+		atomic<uint64> FlushDone;
+
+		// Guards everything below, held by whoever writes the files.
+		mutex DrainMutex;
+		vector<const FLogRecord*> Batch;
+		map<string, ofstream*> Files;
+		set<ofstream*> DirtyFiles;
+		string Line;
+		DWORD ProcessId;
+	};
+
+	FORCEINLINE void FLogRecord::Reset(const char* prefix, const char* head, const char* fmt)
+	{
+		Tick = FPerformanceCounter::GetTimeStamp();
+		Time = ::time(0);
+		Prefix = prefix;
+		Format = fmt;
+		NumArgs = 0;
+		PayloadSize = 0;
+		strncpy_s(Head, head == nullptr ? "" : head, _TRUNCATE);
+	}
+
+	FORCEINLINE void FLogRecord::PushInt(int64 value, uint8 size)
+	{
+		if (NumArgs < SMaxArgs)
+		{
+			Args[NumArgs].Type = FLogArg::EType::Int;
+			Args[NumArgs].Size = size;
+			Args[NumArgs++].Int = value;
+		}
+	}
+
+	FORCEINLINE void FLogRecord::PushUInt(uint64 value, uint8 size)
+	{
+		if (NumArgs < SMaxArgs)
+		{
+			Args[NumArgs].Type = FLogArg::EType::UInt;
+			Args[NumArgs].Size = size;
+			Args[NumArgs++].UInt = value;
+		}
+	}
+
+	FORCEINLINE void FLogRecord::PushReal(double value)
+	{
+		if (NumArgs < SMaxArgs)
+		{
+			Args[NumArgs].Type = FLogArg::EType::Real;
+			Args[NumArgs++].Real = value;
+		}
+	}
+
+	FORCEINLINE void FLogRecord::PushPointer(const void* value)
+	{
+		if (NumArgs < SMaxArgs)
+		{
+			Args[NumArgs].Type = FLogArg::EType::Pointer;
+			Args[NumArgs++].Pointer = value;
+		}
+	}
+
+	FORCEINLINE void FLogRecord::PushString(const char* value, size_t length)
+	{
+		if (NumArgs >= SMaxArgs)
+		{
+			return;
+		}
+
+		auto& arg = Args[NumArgs++];
+		arg.Type = FLogArg::EType::String;
+		if (PayloadSize >= SMaxPayload)
+		{
+			// The last byte is always the terminator of the previous string.
+			arg.StringOffset = SMaxPayload - 1;
+			return;
+		}
+
+		// Truncated when the payload runs out.
+		size_t room = SMaxPayload - 1 - PayloadSize;
+		size_t num = length < room ? length : room;
+		memcpy(Payload + PayloadSize, value, num);
+		Payload[PayloadSize + num] = '\0';
+		arg.StringOffset = PayloadSize;
+		PayloadSize += num + 1;
+	}
+
+	FORCEINLINE void FLogRecord::PushString(const wchar_t* value)
+	{
+		char narrow[SMaxPayload];
+		if (WideCharToMultiByte(CP_ACP, 0, value, -1, narrow, SMaxPayload, nullptr, nullptr) == 0)
+		{
+			// Too long, keep the ascii part of the head.
+			uint32 i = 0;
+			for (; i < SMaxPayload - 1 && value[i] != 0; ++i)
+			{
+				narrow[i] = value[i] < 0x80 ? (char)value[i] : '?';
+			}
+
+			narrow[i] = '\0';
+		}
+
+		PushString(narrow, strlen(narrow));
+	}
+
+	FORCEINLINE const char* FLogRecord::GetString(const FLogArg& arg) const
+	{
+		assert(arg.Type == FLogArg::EType::String);
+		return Payload + arg.StringOffset;
+	}
+
+	FORCEINLINE FLogRing::FLogRing()
+		: bOwned(false)
+		, Dropped(0)
+		, DroppedPrefix(nullptr)
+		, ThreadId(0)
+		, Head(0)
+		, Tail(0)
+		, Records(SCapacity)
+	{
+	}
+
+	FORCEINLINE FLogRecord* FLogRing::TryBeginWrite()
+	{
+		uint32 head = Head.load(memory_order_relaxed);
+		if (head - Tail.load(memory_order_acquire) >= SCapacity)
+		{
+			return nullptr;
+		}
+
+		return &Records[head & (SCapacity - 1)];
+	}
+
+	FORCEINLINE uint32 FLogRing::EndWrite()
+	{
+		uint32 head = Head.load(memory_order_relaxed) + 1;
+		Head.store(head, memory_order_release);
+		return head - Tail.load(memory_order_relaxed);
+	}
+
+	FORCEINLINE uint32 FLogRing::BeginRead(uint32& first) const
+	{
+		first = Tail.load(memory_order_relaxed);
+		return Head.load(memory_order_acquire) - first;
+	}
+
+	FORCEINLINE const FLogRecord& FLogRing::At(uint32 index) const
+	{
+		return Records[index & (SCapacity - 1)];
+	}
+
+	FORCEINLINE void FLogRing::EndRead(uint32 count)
+	{
+		Tail.store(Tail.load(memory_order_relaxed) + count, memory_order_release);
+	}
+
+	FORCEINLINE bool FLogRing::IsEmpty() const
+	{
+		return Head.load(memory_order_acquire) == Tail.load(memory_order_acquire);
+	}
+
+	FORCEINLINE FAsyncLog* FAsyncLog::Get()
+	{
+		static FAsyncLog* SInstance = nullptr;
+		static once_flag SOnce;
+		call_once(SOnce, []()
+		{
+			SInstance = new FAsyncLog;
+			atexit(&FAsyncLog::StaticFlush);
+		});
+
+		return SInstance;
+	}
+
+	FORCEINLINE void FAsyncLog::InstallCrashHandler()
+	{
+		Get();
+		auto& previous = GetPreviousFilter();
+		if (previous == nullptr)
+		{
+			previous = SetUnhandledExceptionFilter(&FAsyncLog::CrashHandler);
+		}
+	}
+
+	template <typename... Args>
+	FORCEINLINE void FAsyncLog::Write(ELogOverflow overflow, const char* prefix, const char* head, const char* fmt, const Args&... args)
+	{
+		FLogRing* ring = bRunning.load(memory_order_acquire) ? GetThreadRing() : nullptr;
+		if (ring == nullptr)
+		{
+			FLogRecord record;
+			record.Reset(prefix, head, fmt);
+			PushLogArgs(record, args...);
+			WriteNow(record);
+			return;
+		}
+
+		if (overflow == ELogOverflow::Default)
+		{
+			overflow = GetOverflow();
+		}
+
+		FLogRecord* record = ring->TryBeginWrite();
+		while (record == nullptr && overflow == ELogOverflow::Block && IsWriterAlive())
+		{
+			WakeCondition.notify_one();
+			this_thread::yield();
+			record = ring->TryBeginWrite();
+		}
+
+		if (record == nullptr)
+		{
+			ring->DroppedPrefix.store(prefix, memory_order_relaxed);
+			ring->Dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+
+		record->Reset(prefix, head, fmt);
+		PushLogArgs(*record, args...);
+		if (ring->EndWrite() == FLogRing::SCapacity / 2)
+		{
+			WakeCondition.notify_one();
+		}
+	}
+
+	FORCEINLINE void FAsyncLog::SetOverflow(ELogOverflow overflow)
+	{
+		assert(overflow != ELogOverflow::Default);
+		Overflow.store((uint8)overflow, memory_order_relaxed);
+	}
+
+	FORCEINLINE ELogOverflow FAsyncLog::GetOverflow() const
+	{
+		return (ELogOverflow)Overflow.load(memory_order_relaxed);
+	}
+
+	FORCEINLINE void FAsyncLog::Flush()
+	{
+		if (!IsWriterAlive())
+		{
+			// The writer is gone (process exit) or stopped, drain on this thread.
+			// try_lock: the crashing thread may be the one holding it.
+			if (DrainMutex.try_lock())
+			{
+				Drain();
+				DrainMutex.unlock();
+			}
+
+			return;
+		}
+
+		uint64 ticket = FlushRequest.fetch_add(1) + 1;
+		WakeCondition.notify_one();
+
+		unique_lock<mutex> lock(WakeMutex);
+		FlushCondition.wait_for(lock, chrono::milliseconds(SFlushTimeoutMs), [&]()
+		{
+			return FlushDone.load() >= ticket || !bRunning.load();
+		});
+	}
+
+	FORCEINLINE void FAsyncLog::Shutdown()
+	{
+		if (!bRunning.exchange(false))
+		{
+			return;
+		}
+
+		WakeCondition.notify_all();
+		if (Writer.joinable())
+		{
+			Writer.join();
+		}
+	}
+
+	FORCEINLINE FAsyncLog::FAsyncLog()
+		: NumRings(0)
+		, Overflow((uint8)ELogOverflow::Drop)
+		, bRunning(true)
+		, FlushRequest(0)
+		, FlushDone(0)
+		, ProcessId(::GetCurrentProcessId())
+	{
+		for (auto& ring : Rings)
+		{
+			ring.store(nullptr, memory_order_relaxed);
+		}
+
+		Writer = thread([this]() { WriterLoop(); });
+	}
+
+	FORCEINLINE void FAsyncLog::StaticFlush()
+	{
+		Get()->Flush();
+	}
+
+	FORCEINLINE LONG WINAPI FAsyncLog::CrashHandler(EXCEPTION_POINTERS* info)
+	{
+		Get()->Flush();
+
+		auto previous = GetPreviousFilter();
+		return previous != nullptr ? previous(info) : EXCEPTION_CONTINUE_SEARCH;
+	}
+
+	FORCEINLINE LPTOP_LEVEL_EXCEPTION_FILTER& FAsyncLog::GetPreviousFilter()
+	{
+		static LPTOP_LEVEL_EXCEPTION_FILTER SPrevious = nullptr;
+		return SPrevious;
+	}
+
+	FORCEINLINE FLogRing* FAsyncLog::GetThreadRing()
+	{
+		struct FRingOwner
+		{
+			FLogRing* Ring = nullptr;
+
+			~FRingOwner()
+			{
+				if (Ring != nullptr)
+				{
+					Ring->bOwned.store(false, memory_order_release);
+				}
+			}
+		};
+
+		static thread_local FRingOwner SOwner;
+		if (SOwner.Ring == nullptr)
+		{
+			SOwner.Ring = AcquireRing();
+		}
+
+		return SOwner.Ring;
+	}
+
+	FORCEINLINE FLogRing* FAsyncLog::AcquireRing()
+	{
+		lock_guard<mutex> lock(RingsMutex);
+
+		// Rings of exited threads are reused once the writer has emptied them.
+		uint32 numRings = NumRings.load(memory_order_relaxed);
+		for (uint32 i = 0; i < numRings; ++i)
+		{
+			FLogRing* ring = Rings[i].load(memory_order_relaxed);
+			if (!ring->bOwned.load(memory_order_acquire) && ring->IsEmpty())
+			{
+				ring->bOwned.store(true, memory_order_relaxed);
+				ring->ThreadId = ::GetCurrentThreadId();
+				return ring;
+			}
+		}
+
+		if (numRings == SMaxRings)
+		{
+			// Threads beyond SMaxRings write synchronously.
+			return nullptr;
+		}
+
+		FLogRing* ring = new FLogRing;
+		ring->bOwned.store(true, memory_order_relaxed);
+		ring->ThreadId = ::GetCurrentThreadId();
+		Rings[numRings].store(ring, memory_order_release);
+		NumRings.store(numRings + 1, memory_order_release);
+		return ring;
+	}
+
+	FORCEINLINE bool FAsyncLog::IsWriterAlive()
+	{
+		// Threads are already killed when atexit handlers of a dll run.
+		return bRunning.load(memory_order_acquire) && Writer.joinable() &&
+			WaitForSingleObject(Writer.native_handle(), 0) == WAIT_TIMEOUT;
+	}
+
+	FORCEINLINE void FAsyncLog::WriterLoop()
+	{
+		while (bRunning.load(memory_order_acquire))
+		{
+			uint64 request = FlushRequest.load();
+			{
+				lock_guard<mutex> lock(DrainMutex);
+				Drain();
+			}
+
+			unique_lock<mutex> lock(WakeMutex);
+			if (request > FlushDone.load())
+			{
+				FlushDone.store(request);
+				FlushCondition.notify_all();
+			}
+
+			WakeCondition.wait_for(lock, chrono::milliseconds(SWritePeriodMs), [&]()
+			{
+				return !bRunning.load() || FlushRequest.load() > FlushDone.load();
+			});
+		}
+
+		{
+			lock_guard<mutex> lock(DrainMutex);
+			Drain();
+		}
+
+		lock_guard<mutex> lock(WakeMutex);
+		FlushDone.store(FlushRequest.load());
+		FlushCondition.notify_all();
+	}
+
+	FORCEINLINE uint32 FAsyncLog::Drain()
+	{
+		array<uint32, SMaxRings> counts;
+		uint32 numRings = NumRings.load(memory_order_acquire);
+
+		Batch.clear();
+		for (uint32 i = 0; i < numRings; ++i)
+		{
+			FLogRing* ring = Rings[i].load(memory_order_acquire);
+
+			uint32 dropped = ring->Dropped.exchange(0, memory_order_relaxed);
+			if (dropped > 0)
+			{
+				char msg[128];
+				snprintf(msg, sizeof(msg), "%s\tPID: %d\tFAsyncLog: %u records of thread %u are dropped",
+					GetNowStr().c_str(), ProcessId, dropped, ring->ThreadId);
+				WriteLine(ring->DroppedPrefix.load(memory_order_relaxed), msg);
+			}
+
+			uint32 first;
+			counts[i] = ring->BeginRead(first);
+			for (uint32 j = 0; j < counts[i]; ++j)
+			{
+				Batch.push_back(&ring->At(first + j));
+			}
+		}
+
+		// Rings are in order, the batch is merged by capture time.
+		stable_sort(Batch.begin(), Batch.end(), [](const FLogRecord* lhs, const FLogRecord* rhs)
+		{
+			return lhs->Tick < rhs->Tick;
+		});
+
+		for (auto record : Batch)
+		{
+			FormatRecord(Line, *record);
+			WriteLine(record->Prefix, Line);
+		}
+
+		for (uint32 i = 0; i < numRings; ++i)
+		{
+			Rings[i].load(memory_order_relaxed)->EndRead(counts[i]);
+		}
+
+		for (auto file : DirtyFiles)
+		{
+			file->flush();
+		}
+
+		DirtyFiles.clear();
+		return Batch.size();
+	}
+
+	FORCEINLINE void FAsyncLog::WriteNow(const FLogRecord& record)
+	{
+		lock_guard<mutex> lock(DrainMutex);
+		FormatRecord(Line, record);
+		WriteLine(record.Prefix, Line);
+		for (auto file : DirtyFiles)
+		{
+			file->flush();
+		}
+
+		DirtyFiles.clear();
+	}
+
+	FORCEINLINE void FAsyncLog::WriteLine(const char* prefix, const string& line)
+	{
+		ofstream* file = GetFile(prefix);
+		if (file != nullptr)
+		{
+			*file << line << "\n";
+			DirtyFiles.insert(file);
+		}
+	}
+
+	FORCEINLINE ofstream* FAsyncLog::GetFile(const char* prefix)
+	{
+		string key(prefix == nullptr ? "" : prefix);
+		auto it = Files.find(key);
+		if (it != Files.end())
+		{
+			return it->second;
+		}
+
+		// A file failed to open is not retried.
+		ofstream* file = nullptr;
+		string path;
+		if (GetLogFilePath(path, key.c_str()))
+		{
+			file = new ofstream(path, ios::app | ios::out);
+			if (!*file)
+			{
+				SAFE_DELETE(file);
+			}
+		}
+
+		Files[key] = file;
+		return file;
+	}
+
+	FORCEINLINE void FAsyncLog::FormatRecord(string& output, const FLogRecord& record) const
+	{
+		char pid[32];
+		snprintf(pid, sizeof(pid), "%d", ProcessId);
+
+		output = GetTimeStr(record.Time);
+		output.append("\tPID: ").append(pid).append("\t").append(record.Head).append(": ");
+		FormatText(output, record);
+	}
+
+	FORCEINLINE void FAsyncLog::FormatText(string& output, const FLogRecord& record) const
+	{
+		const char* conversions = "diouxXcCeEfFgGaAsSpn";
+		char spec[48];
+		char buf[512];
+		uint32 argIndex = 0;
+
+		auto nextArg = [&]() -> const FLogArg*
+		{
+			return argIndex < record.NumArgs ? &record.Args[argIndex++] : nullptr;
+		};
+
+		auto toInt = [](const FLogArg& arg) -> int64
+		{
+			switch (arg.Type)
+			{
+			case FLogArg::EType::UInt: return (int64)arg.UInt;
+			case FLogArg::EType::Real: return (int64)arg.Real;
+			case FLogArg::EType::Pointer: return (int64)(intptr_t)arg.Pointer;
+			case FLogArg::EType::String: return 0;
+			default: return arg.Int;
+			}
+		};
+
+		// An integer narrower than 64 bits, as printf reads it: the low bytes only for %u and %x,
+		// sign extended from its own width for %d.
+		auto toUnsigned = [&](const FLogArg& arg) -> uint64
+		{
+			const uint64 value = (uint64)toInt(arg);
+			const bool integer = arg.Type == FLogArg::EType::Int || arg.Type == FLogArg::EType::UInt;
+			return integer && arg.Size < 8 ? value & ((1ull << (arg.Size * 8)) - 1) : value;
+		};
+
+		auto toSigned = [&](const FLogArg& arg) -> int64
+		{
+			const bool integer = arg.Type == FLogArg::EType::Int || arg.Type == FLogArg::EType::UInt;
+			if (!integer || arg.Size >= 8)
+			{
+				return toInt(arg);
+			}
+
+			const uint32 shift = 64 - arg.Size * 8;
+			return (int64)(toUnsigned(arg) << shift) >> shift;
+		};
+
+		const char* p = record.Format != nullptr ? record.Format : "";
+		while (*p != '\0')
+		{
+			if (*p != '%')
+			{
+				output.push_back(*p++);
+				continue;
+			}
+
+			if (p[1] == '%')
+			{
+				output.push_back('%');
+				p += 2;
+				continue;
+			}
+
+			// %[flags][width][.precision][length]conversion, the length is replaced
+			// by one matching the captured argument.
+			const char* start = p++;
+			uint32 len = 0;
+			spec[len++] = '%';
+			while (*p != '\0' && strchr("-+ #0", *p) != nullptr && len < 8)
+			{
+				spec[len++] = *p++;
+			}
+
+			for (int32 part = 0; part < 2; ++part)
+			{
+				if (part == 1)
+				{
+					if (*p != '.')
+					{
+						break;
+					}
+
+					spec[len++] = *p++;
+				}
+
+				if (*p == '*')
+				{
+					auto arg = nextArg();
+					len += snprintf(spec + len, 8, "%d", arg != nullptr ? (int32)toInt(*arg) : 0);
+					++p;
+				}
+
+				while (isdigit((uint8)*p) && len < 20)
+				{
+					spec[len++] = *p++;
+				}
+			}
+
+			while (*p != '\0' && strchr("hlLqjztwI", *p) != nullptr)
+			{
+				if (*p++ == 'I')
+				{
+					while (isdigit((uint8)*p))
+					{
+						++p;
+					}
+				}
+			}
+
+			char conv = *p;
+			if (conv == '\0' || strchr(conversions, conv) == nullptr)
+			{
+				output.append(start, p);
+				continue;
+			}
+
+			++p;
+			if (conv == 'n')
+			{
+				continue;
+			}
+
+			auto arg = nextArg();
+			if (arg == nullptr)
+			{
+				output.append("(missing)");
+				continue;
+			}
+
+			switch (conv)
+			{
+			case 'd': case 'i':
+				strcpy_s(spec + len, sizeof(spec) - len, "lld");
+				snprintf(buf, sizeof(buf), spec, toSigned(*arg));
+				break;
+			case 'o': case 'u': case 'x': case 'X':
+				spec[len++] = 'l';
+				spec[len++] = 'l';
+				spec[len++] = conv;
+				spec[len] = '\0';
+				snprintf(buf, sizeof(buf), spec, toUnsigned(*arg));
+				break;
+			case 'c': case 'C':
+				strcpy_s(spec + len, sizeof(spec) - len, "c");
+				snprintf(buf, sizeof(buf), spec, (int32)toInt(*arg));
+				break;
+			case 's': case 'S':
+				if (arg->Type == FLogArg::EType::String)
+				{
+					strcpy_s(spec + len, sizeof(spec) - len, "s");
+					snprintf(buf, sizeof(buf), spec, record.GetString(*arg));
+				}
+				else
+				{
+					snprintf(buf, sizeof(buf), "(0x%llx)", (uint64)toInt(*arg));
+				}
+				break;
+			case 'p':
+				strcpy_s(spec + len, sizeof(spec) - len, "p");
+				snprintf(buf, sizeof(buf), spec, arg->Type == FLogArg::EType::Pointer ? arg->Pointer : (const void*)(intptr_t)toInt(*arg));
+				break;
+			default:
+				spec[len++] = conv;
+				spec[len] = '\0';
+				snprintf(buf, sizeof(buf), spec, arg->Type == FLogArg::EType::Real ? arg->Real : (double)toInt(*arg));
+				break;
+			}
+
+			output.append(buf);
+		}
+	}
+}
@@ -0,0 +1,273 @@
+/*
+* file CommandArena.h
+*
+* author luoxw
+* date 2018/03/23
+*
+* 1. Per-frame linear buffer of commands, a POD header followed by the payload bytes.
+* 2. Push copies the payload into the current block, no allocation once the blocks are warm.
+* 3. Execute runs the commands in push order, Reset drops them all at once and keeps the blocks.
+* 4. Payloads are copied as bytes and never destructed, they must be POD.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	class FCommandArena
+	{
+	public:
+		// payload is SAlignment aligned.
+		typedef void(*FExec)(void* object, const void* payload, uint32 size);
+
+		struct FStats
+		{
+			uint32 NumCommands;
+			uint32 NumBytes;
+
+			FORCEINLINE FStats() : NumCommands(0), NumBytes(0) {}
+		};
+
+		static const uint32 SAlignment = 16;
+		static const uint32 SDefaultBlockSize = 64 * 1024;
+
+		FORCEINLINE explicit FCommandArena(bool threadSafe = true, uint32 blockSize = SDefaultBlockSize);
+		FORCEINLINE ~FCommandArena();
+
+		FCommandArena(const FCommandArena&) = delete;
+		FCommandArena& operator=(const FCommandArena&) = delete;
+
+		// Room for size payload bytes, the caller fills it before the arena is executed.
+		FORCEINLINE void* Push(FExec exec, void* object, uint32 size);
+		FORCEINLINE void Push(FExec exec, void* object, const void* payload, uint32 size);
+		FORCEINLINE void Push(void(*exec)(void*), void* object);
+
+		// exec(object, args, data, size), args and data are copied one after another.
+		template <typename TArgs>
+		FORCEINLINE void PushArgs(void(*exec)(void*, const TArgs&, const void*, uint32), void* object,
+			const TArgs& args, const void* data = nullptr, uint32 size = 0);
+
+		// Consumer thread, Reset once the commands are executed.
+		FORCEINLINE void Execute();
+		FORCEINLINE void Reset();
+
+		FORCEINLINE FStats GetStats() const;
+		FORCEINLINE bool IsEmpty() const;
+
+	private:
+		struct FHeader
+		{
+			FExec Exec;
+			void* Object;
+			uint32 Size;
+		};
+
+		struct FBlock
+		{
+			uint8* Raw;
+			uint8* Data;
+			uint32 Capacity;
+			uint32 Used;
+		};
+
+		static FORCEINLINE uint32 Align(uint32 size)
+		{
+			return (size + SAlignment - 1) & ~(SAlignment - 1);
+		}
+
+		static FORCEINLINE uint32 GetHeaderSize()
+		{
+			return Align(sizeof(FHeader));
+		}
+
+		template <typename TArgs>
+		static FORCEINLINE void ExecArgs(void* object, const void* payload, uint32 size);
+		static FORCEINLINE void ExecNoPayload(void* object, const void* payload, uint32 size);
+
+		FORCEINLINE uint8* Allocate(uint32 size);
+		FORCEINLINE void Lock();
+		FORCEINLINE void Unlock();
+
+		mutex* Mutex;
+		uint32 BlockSize;
+		vector<FBlock> Blocks;
+		uint32 CurrentBlock;
+		FStats Stats;
+	};
+
+	FCommandArena::FCommandArena(bool threadSafe, uint32 blockSize)
+		: Mutex(threadSafe ? new mutex : nullptr)
+		, BlockSize(Align(blockSize))
+		, CurrentBlock(0)
+	{
+	}
+
+	FCommandArena::~FCommandArena()
+	{
+		for (auto& block : Blocks)
+		{
+			SAFE_DELETE_ARRAY(block.Raw);
+		}
+
+		Blocks.clear();
+		SAFE_DELETE(Mutex);
+	}
+
+	void* FCommandArena::Push(FExec exec, void* object, uint32 size)
+	{
+		Lock();
+		uint8* record = Allocate(GetHeaderSize() + Align(size));
+		Unlock();
+
+		FHeader* header = (FHeader*)record;
+		header->Exec = exec;
+		header->Object = object;
+		header->Size = size;
+		return record + GetHeaderSize();
+	}
+
+	void FCommandArena::Push(FExec exec, void* object, const void* payload, uint32 size)
+	{
+		void* dst = Push(exec, object, size);
+		if (size > 0)
+		{
+			memcpy(dst, payload, size);
+		}
+	}
+
+	void FCommandArena::Push(void(*exec)(void*), void* object)
+	{
+		Push(&ExecNoPayload, object, &exec, sizeof(exec));
+	}
+
+	template <typename TArgs>
+	void FCommandArena::PushArgs(void(*exec)(void*, const TArgs&, const void*, uint32), void* object,
+		const TArgs& args, const void* data, uint32 size)
+	{
+		static_assert(alignof(TArgs) <= SAlignment, "Over aligned command arguments");
+
+		const uint32 argsOffset = Align(sizeof(exec));
+		const uint32 dataOffset = argsOffset + Align(sizeof(TArgs));
+		uint8* dst = (uint8*)Push(&ExecArgs<TArgs>, object, dataOffset + size);
+		memcpy(dst, &exec, sizeof(exec));
+		memcpy(dst + argsOffset, &args, sizeof(TArgs));
+		if (size > 0)
+		{
+			memcpy(dst + dataOffset, data, size);
+		}
+	}
+
+	void FCommandArena::Execute()
+	{
+		for (uint32 index = 0; index < Blocks.size() && index <= CurrentBlock; ++index)
+		{
+			const FBlock& block = Blocks[index];
+			uint32 offset = 0;
+			while (offset < block.Used)
+			{
+				const FHeader* header = (const FHeader*)(block.Data + offset);
+				header->Exec(header->Object, block.Data + offset + GetHeaderSize(), header->Size);
+				offset += GetHeaderSize() + Align(header->Size);
+			}
+		}
+	}
+
+	void FCommandArena::Reset()
+	{
+		Lock();
+
+		// Oversized blocks hold one-off uploads (meshes), they are not kept.
+		for (auto it = Blocks.begin(); it != Blocks.end();)
+		{
+			if (it->Capacity > BlockSize)
+			{
+				SAFE_DELETE_ARRAY(it->Raw);
+				it = Blocks.erase(it);
+			}
+			else
+			{
+				it->Used = 0;
+				++it;
+			}
+		}
+
+		CurrentBlock = 0;
+		Stats = FStats();
+		Unlock();
+	}
+
+	FCommandArena::FStats FCommandArena::GetStats() const
+	{
+		return Stats;
+	}
+
+	bool FCommandArena::IsEmpty() const
+	{
+		return Stats.NumCommands == 0;
+	}
+
+	template <typename TArgs>
+	void FCommandArena::ExecArgs(void* object, const void* payload, uint32 size)
+	{
+		typedef void(*FArgsExec)(void*, const TArgs&, const void*, uint32);
+
+		const uint32 argsOffset = Align(sizeof(FArgsExec));
+		const uint32 dataOffset = argsOffset + Align(sizeof(TArgs));
+		const uint8* src = (const uint8*)payload;
+
+		FArgsExec exec;
+		memcpy(&exec, src, sizeof(exec));
+		exec(object, *(const TArgs*)(src + argsOffset), src + dataOffset, size - dataOffset);
+	}
+
+	void FCommandArena::ExecNoPayload(void* object, const void* payload, uint32 size)
+	{
+		void(*exec)(void*);
+		memcpy(&exec, payload, sizeof(exec));
+		exec(object);
+	}
+
+	uint8* FCommandArena::Allocate(uint32 size)
+	{
+		if (Blocks.empty() || Blocks[CurrentBlock].Used + size > Blocks[CurrentBlock].Capacity)
+		{
+			// Blocks after the current one are empty, take the next one if it fits.
+			const uint32 next = Blocks.empty() ? 0 : CurrentBlock + 1;
+			if (next >= Blocks.size() || Blocks[next].Capacity < size)
+			{
+				FBlock block;
+				block.Capacity = size > BlockSize ? size : BlockSize;
+				block.Raw = new uint8[block.Capacity + SAlignment];
+				block.Data = (uint8*)(((uintptr_t)block.Raw + SAlignment - 1) & ~(uintptr_t)(SAlignment - 1));
+				block.Used = 0;
+				Blocks.insert(Blocks.begin() + next, block);
+			}
+
+			CurrentBlock = next;
+		}
+
+		FBlock& block = Blocks[CurrentBlock];
+		uint8* record = block.Data + block.Used;
+		block.Used += size;
+
+		Stats.NumCommands++;
+		Stats.NumBytes += size;
+		return record;
+	}
+
+	void FCommandArena::Lock()
+	{
+		if (Mutex != nullptr)
+		{
+			Mutex->lock();
+		}
+	}
+
+	void FCommandArena::Unlock()
+	{
+		if (Mutex != nullptr)
+		{
+			Mutex->unlock();
+		}
+	}
+}
@@ -188,6 +188,8 @@
 #define K_PRIMITIVE_EXT					"iv"
 #define K_ANIM_EXT_CURVE				"animc"
 #define K_ANIM_EXT_KEYFRAME				"animk"
+#define K_PRIMITIVE_MAPPED_EXT			"ivm"
+#define K_ANIM_EXT_KEYFRAME_MAPPED		"animkm"
 
 #define K_DEPTH_STENCIL_Z_WRITE			"Z_ENABLE_WRITE"
 #define K_DEPTH_STENCIL_ALWAYS			"ALWAYS"
@@ -206,6 +208,8 @@
 #define MAX_BONES_PER_MESH (1<<16)
 
 #define MAGIC_VERTEX 0xaabbabab
+#define MAGIC_MAPPED_ASSET 0x414d524c
+#define MAPPED_ASSET_VERSION 1
 
 #define SHADER_SLOT_GLOBAL		0
 #define SHADER_SLOT_MATRICES	1
@@ -0,0 +1,39 @@
+/*
+* file Hash.h
+*
+* author luoxw
+* date 2018/03/14
+*
+* FNV-1a, for content keys (vertex dedup, caches), not for security.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	FORCEINLINE uint32 HashBytes32(const void* buf, uint32 sz, uint32 seed = 2166136261u)
+	{
+		const uint8* p = (const uint8*)buf;
+		uint32 hash = seed;
+		for (uint32 i = 0; i < sz; ++i)
+		{
+			hash ^= p[i];
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	FORCEINLINE uint64 HashBytes64(const void* buf, uint32 sz, uint64 seed = 14695981039346656037ull)
+	{
+		const uint8* p = (const uint8*)buf;
+		uint64 hash = seed;
+		for (uint32 i = 0; i < sz; ++i)
+		{
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
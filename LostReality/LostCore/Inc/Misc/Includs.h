@@ -16,6 +16,7 @@
 #include <assert.h>
 #include <set>
 #include <vector>
+#include <algorithm>
 #include <map>
 #include <string>
 #include <iostream>
@@ -28,5 +29,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <chrono>
 #include <atomic>
 #include <sstream>
@@ -0,0 +1,620 @@
+/*
+* file JobSystem.h
+*
+* author luoxw
+* date 2018/03/22
+*
+* 1. Fixed pool of worker FThreads sized to the hardware, shared by the whole process.
+* 2. Every worker owns a Chase-Lev deque, it pushes and pops at the bottom, idle threads steal at the top.
+*    Threads outside the pool push to a shared queue.
+* 3. FJobCounter counts the unfinished jobs of a Run, RunAfter starts jobs once a counter reaches zero.
+*    Wait runs other jobs until the counter reaches zero, so waiting inside a job never blocks a worker.
+* 4. Workers are FThreads, jobs may use TTlsSingleton and FStackCounterRequest.
+*    A job's StackCounter is started and stopped around it on the thread running it.
+*    Jobs run by a waiting thread outside the pool can only use them if that thread is an FThread too.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	class FJobCounter;
+	class FJobSystem;
+
+	struct FJob
+	{
+		typedef function<void()> FFunc;
+
+		FFunc Func;
+
+		// Optional, started and stopped around Func.
+		FStackCounterRequest* StackCounter;
+
+		// Set by Run and RunAfter.
+		FJobCounter* Counter;
+
+		FORCEINLINE FJob() : StackCounter(nullptr), Counter(nullptr) {}
+		FORCEINLINE FJob(const FFunc& func, FStackCounterRequest* stackCounter = nullptr)
+			: Func(func), StackCounter(stackCounter), Counter(nullptr)
+		{
+		}
+	};
+
+	// Unfinished jobs of one or more Run calls, must outlive them.
+	class FJobCounter
+	{
+	public:
+		FORCEINLINE FJobCounter();
+		FORCEINLINE ~FJobCounter();
+
+		FORCEINLINE bool IsDone() const;
+
+	private:
+		friend class FJobSystem;
+
+		FORCEINLINE void Add(int32 num);
+
+		// Jobs to start, empty until the counter reaches zero.
+		FORCEINLINE void Finish(vector<FJob*>& continuations);
+
+		// False if the counter is already zero, the jobs are not kept then.
+		FORCEINLINE bool AddContinuations(FJob* jobs, uint32 num);
+
+		atomic<int32> Count;
+		mutable mutex CountMutex;
+		vector<FJob*> Continuations;
+	};
+
+	// Fixed capacity work stealing deque (Chase & Lev, Le et al. memory orders).
+	class FJobQueue
+	{
+	public:
+		static const int64 SCapacity = 4096;
+
+		FORCEINLINE FJobQueue();
+
+		// Owner thread only, false when full.
+		FORCEINLINE bool Push(FJob* job);
+		FORCEINLINE FJob* Pop();
+
+		// Any thread.
+		FORCEINLINE FJob* Steal();
+		FORCEINLINE bool IsEmpty() const;
+
+	private:
+		atomic<int64> Top;
+		atomic<int64> Bottom;
+		atomic<FJob*> Jobs[SCapacity];
+	};
+
+	class FJobSystem : public TProcessUniqueSingleton<FJobSystem, 3>
+	{
+	public:
+		typedef function<void(uint32 begin, uint32 end)> FRangeFunc;
+
+		FORCEINLINE FJobSystem();
+		FORCEINLINE virtual ~FJobSystem() override;
+
+		FORCEINLINE virtual void Tick() override;
+
+		// Threads taking jobs, the waiting thread included, clamped to [1, GetMaxConcurrency()].
+		FORCEINLINE void SetConcurrency(uint32 num);
+		FORCEINLINE uint32 GetConcurrency() const;
+		FORCEINLINE uint32 GetMaxConcurrency() const;
+
+		// Jobs must stay alive until counter reaches zero, counter may be shared by several calls.
+		FORCEINLINE void Run(FJob* jobs, uint32 num, FJobCounter* counter);
+
+		// As Run, the jobs start once dependency reaches zero.
+		FORCEINLINE void RunAfter(FJobCounter* dependency, FJob* jobs, uint32 num, FJobCounter* counter);
+
+		// Runs jobs on the calling thread until counter reaches zero.
+		FORCEINLINE void Wait(FJobCounter* counter);
+
+		// func(begin, end) for every batch of [0, count), batches are batchSize long except the last one.
+		// The calling thread takes batches too, it returns once every batch is done.
+		FORCEINLINE void ParallelFor(uint32 count, uint32 batchSize, const FRangeFunc& func,
+			FStackCounterRequest* stackCounter = nullptr);
+
+	private:
+		class FWorkerTask : public ITask
+		{
+		public:
+			FORCEINLINE FWorkerTask(FJobSystem* jobs, uint32 index) : Jobs(jobs), Index(index) {}
+
+			// Inherited via ITask
+			FORCEINLINE virtual bool Initialize() override;
+			FORCEINLINE virtual void Tick() override;
+			FORCEINLINE virtual void Destroy() override {}
+			FORCEINLINE virtual bool IsThreadPrivate() const override { return false; }
+			FORCEINLINE virtual bool IsLoop() const override { return true; }
+
+		private:
+			FJobSystem* Jobs;
+			uint32 Index;
+		};
+
+		// Spins before a worker parks, seconds a worker runs jobs before its FThread ticks the singletons.
+		static const uint32 SSpinCount = 64;
+		static const int32 SParkMilliseconds = 2;
+		static const int32 STickMilliseconds = 16;
+
+		FORCEINLINE void Push(FJob* job);
+		FORCEINLINE void WakeUpWorkers();
+		FORCEINLINE bool IsWorkerActive(uint32 index) const;
+		FORCEINLINE bool HasJobs() const;
+		FORCEINLINE FJob* FindJob();
+		FORCEINLINE void Execute(FJob* job);
+		FORCEINLINE void WorkerTick(uint32 index);
+
+		// Index of the worker running on this thread, -1 outside the pool.
+		static FORCEINLINE int32& GetWorkerIndex()
+		{
+			static thread_local int32 SWorkerIndex = -1;
+			return SWorkerIndex;
+		}
+
+		vector<FThread*> Workers;
+		vector<FWorkerTask*> Tasks;
+		vector<unique_ptr<FJobQueue>> Queues;
+		atomic<uint32> Concurrency;
+		atomic<bool> bQuit;
+
+		// Jobs pushed from threads outside the pool.
+		deque<FJob*> Shared;
+		mutex SharedMutex;
+		atomic<uint32> NumShared;
+
+		mutex ParkMutex;
+		condition_variable WakeUp;
+		atomic<uint32> NumParked;
+	};
+
+	FJobCounter::FJobCounter()
+		: Count(0)
+	{
+	}
+
+	FJobCounter::~FJobCounter()
+	{
+		assert(Count == 0);
+	}
+
+	bool FJobCounter::IsDone() const
+	{
+		if (Count.load() != 0)
+		{
+			return false;
+		}
+
+		// The last Finish may still hold the lock.
+		lock_guard<mutex> lck(CountMutex);
+		return true;
+	}
+
+	void FJobCounter::Add(int32 num)
+	{
+		lock_guard<mutex> lck(CountMutex);
+		Count += num;
+	}
+
+	void FJobCounter::Finish(vector<FJob*>& continuations)
+	{
+		lock_guard<mutex> lck(CountMutex);
+		assert(Count > 0);
+		if (--Count == 0)
+		{
+			continuations.swap(Continuations);
+		}
+	}
+
+	bool FJobCounter::AddContinuations(FJob* jobs, uint32 num)
+	{
+		lock_guard<mutex> lck(CountMutex);
+		if (Count == 0)
+		{
+			return false;
+		}
+
+		for (uint32 i = 0; i < num; ++i)
+		{
+			Continuations.push_back(&jobs[i]);
+		}
+
+		return true;
+	}
+
+	FJobQueue::FJobQueue()
+		: Top(0)
+		, Bottom(0)
+	{
+		for (auto& job : Jobs)
+		{
+			job.store(nullptr, memory_order_relaxed);
+		}
+	}
+
+	bool FJobQueue::Push(FJob* job)
+	{
+		const int64 b = Bottom.load(memory_order_relaxed);
+		const int64 t = Top.load(memory_order_acquire);
+		if (b - t >= SCapacity)
+		{
+			return false;
+		}
+
+		Jobs[b & (SCapacity - 1)].store(job, memory_order_relaxed);
+		Bottom.store(b + 1, memory_order_seq_cst);
+		return true;
+	}
+
+	FJob* FJobQueue::Pop()
+	{
+		const int64 b = Bottom.load(memory_order_relaxed) - 1;
+		Bottom.store(b, memory_order_seq_cst);
+		int64 t = Top.load(memory_order_seq_cst);
+		if (t > b)
+		{
+			Bottom.store(b + 1, memory_order_relaxed);
+			return nullptr;
+		}
+
+		FJob* job = Jobs[b & (SCapacity - 1)].load(memory_order_relaxed);
+		if (t == b)
+		{
+			// Last one, race the thieves for it.
+			if (!Top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			{
+				job = nullptr;
+			}
+
+			Bottom.store(b + 1, memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	FJob* FJobQueue::Steal()
+	{
+		int64 t = Top.load(memory_order_seq_cst);
+		const int64 b = Bottom.load(memory_order_seq_cst);
+		if (t >= b)
+		{
+			return nullptr;
+		}
+
+		FJob* job = Jobs[t & (SCapacity - 1)].load(memory_order_relaxed);
+		if (!Top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		{
+			return nullptr;
+		}
+
+		return job;
+	}
+
+	bool FJobQueue::IsEmpty() const
+	{
+		return Top.load(memory_order_seq_cst) >= Bottom.load(memory_order_seq_cst);
+	}
+
+	bool FJobSystem::FWorkerTask::Initialize()
+	{
+		GetWorkerIndex() = (int32)Index;
+		return true;
+	}
+
+	void FJobSystem::FWorkerTask::Tick()
+	{
+		Jobs->WorkerTick(Index);
+	}
+
+	FJobSystem::FJobSystem()
+		: Concurrency(1)
+		, bQuit(false)
+		, NumShared(0)
+		, NumParked(0)
+	{
+		const uint32 hardware = thread::hardware_concurrency();
+		const uint32 numWorkers = hardware > 1 ? hardware - 1 : 0;
+		for (uint32 i = 0; i < numWorkers; ++i)
+		{
+			Queues.push_back(unique_ptr<FJobQueue>(new FJobQueue));
+		}
+
+		Concurrency = numWorkers + 1;
+
+		// Workers must not call FJobSystem::Get(), the singleton is not registered before the constructor returns.
+		for (uint32 i = 0; i < numWorkers; ++i)
+		{
+			Tasks.push_back(new FWorkerTask(this, i));
+			Workers.push_back(new FThread(Tasks.back(), string("Job") + to_string(i)));
+		}
+	}
+
+	FJobSystem::~FJobSystem()
+	{
+		bQuit = true;
+		{
+			lock_guard<mutex> lck(ParkMutex);
+			WakeUp.notify_all();
+		}
+
+		for (auto& worker : Workers)
+		{
+			SAFE_DELETE(worker);
+		}
+
+		for (auto& task : Tasks)
+		{
+			SAFE_DELETE(task);
+		}
+
+		Workers.clear();
+		Tasks.clear();
+	}
+
+	void FJobSystem::Tick()
+	{
+	}
+
+	void FJobSystem::SetConcurrency(uint32 num)
+	{
+		Concurrency = num < 1 ? 1 : (num > GetMaxConcurrency() ? GetMaxConcurrency() : num);
+		WakeUpWorkers();
+	}
+
+	uint32 FJobSystem::GetConcurrency() const
+	{
+		return Concurrency;
+	}
+
+	uint32 FJobSystem::GetMaxConcurrency() const
+	{
+		return (uint32)Queues.size() + 1;
+	}
+
+	void FJobSystem::Run(FJob* jobs, uint32 num, FJobCounter* counter)
+	{
+		assert(counter != nullptr);
+		if (num == 0)
+		{
+			return;
+		}
+
+		counter->Add((int32)num);
+		for (uint32 i = 0; i < num; ++i)
+		{
+			jobs[i].Counter = counter;
+			Push(&jobs[i]);
+		}
+
+		WakeUpWorkers();
+	}
+
+	void FJobSystem::RunAfter(FJobCounter* dependency, FJob* jobs, uint32 num, FJobCounter* counter)
+	{
+		assert(dependency != nullptr && counter != nullptr);
+		if (num == 0)
+		{
+			return;
+		}
+
+		counter->Add((int32)num);
+		for (uint32 i = 0; i < num; ++i)
+		{
+			jobs[i].Counter = counter;
+		}
+
+		if (!dependency->AddContinuations(jobs, num))
+		{
+			for (uint32 i = 0; i < num; ++i)
+			{
+				Push(&jobs[i]);
+			}
+
+			WakeUpWorkers();
+		}
+	}
+
+	void FJobSystem::Wait(FJobCounter* counter)
+	{
+		uint32 idle = 0;
+		while (!counter->IsDone())
+		{
+			FJob* job = FindJob();
+			if (job != nullptr)
+			{
+				Execute(job);
+				idle = 0;
+			}
+			else if (++idle > SSpinCount)
+			{
+				this_thread::yield();
+			}
+		}
+	}
+
+	void FJobSystem::ParallelFor(uint32 count, uint32 batchSize, const FRangeFunc& func, FStackCounterRequest* stackCounter)
+	{
+		batchSize = batchSize < 1 ? 1 : batchSize;
+		if (count <= batchSize || Concurrency == 1)
+		{
+			if (stackCounter != nullptr)
+			{
+				stackCounter->Start();
+			}
+
+			for (uint32 begin = 0; begin < count; begin += batchSize)
+			{
+				func(begin, count - begin > batchSize ? begin + batchSize : count);
+			}
+
+			if (stackCounter != nullptr)
+			{
+				stackCounter->Stop();
+			}
+
+			return;
+		}
+
+		const uint32 numBatches = (count + batchSize - 1) / batchSize;
+		vector<FJob> jobs(numBatches);
+		for (uint32 batch = 0; batch < numBatches; ++batch)
+		{
+			const uint32 begin = batch * batchSize;
+			const uint32 end = count - begin > batchSize ? begin + batchSize : count;
+			jobs[batch].Func = [&func, begin, end]() { func(begin, end); };
+			jobs[batch].StackCounter = stackCounter;
+		}
+
+		FJobCounter counter;
+		Run(jobs.data(), numBatches, &counter);
+		Wait(&counter);
+	}
+
+	void FJobSystem::Push(FJob* job)
+	{
+		const int32 index = GetWorkerIndex();
+		if (index >= 0 && Queues[index]->Push(job))
+		{
+			return;
+		}
+
+		lock_guard<mutex> lck(SharedMutex);
+		Shared.push_back(job);
+		++NumShared;
+	}
+
+	void FJobSystem::WakeUpWorkers()
+	{
+		if (NumParked.load() > 0)
+		{
+			lock_guard<mutex> lck(ParkMutex);
+			WakeUp.notify_all();
+		}
+	}
+
+	bool FJobSystem::IsWorkerActive(uint32 index) const
+	{
+		return index + 1 < Concurrency;
+	}
+
+	bool FJobSystem::HasJobs() const
+	{
+		if (NumShared.load() > 0)
+		{
+			return true;
+		}
+
+		for (auto& queue : Queues)
+		{
+			if (!queue->IsEmpty())
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	FJob* FJobSystem::FindJob()
+	{
+		const int32 index = GetWorkerIndex();
+		FJob* job = nullptr;
+		if (index >= 0 && (job = Queues[index]->Pop()) != nullptr)
+		{
+			return job;
+		}
+
+		if (NumShared.load() > 0)
+		{
+			lock_guard<mutex> lck(SharedMutex);
+			if (!Shared.empty())
+			{
+				job = Shared.front();
+				Shared.pop_front();
+				--NumShared;
+				return job;
+			}
+		}
+
+		// Start with the next worker so thieves spread over the queues.
+		const uint32 numQueues = (uint32)Queues.size();
+		for (uint32 i = 1; i <= numQueues; ++i)
+		{
+			const uint32 victim = (uint32)(index + i) % numQueues;
+			if ((int32)victim != index && (job = Queues[victim]->Steal()) != nullptr)
+			{
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void FJobSystem::Execute(FJob* job)
+	{
+		// The owner may release job once the counter reaches zero.
+		FJobCounter* counter = job->Counter;
+		if (job->StackCounter != nullptr)
+		{
+			FScopedStackCounterRequest scopedCounter(*job->StackCounter);
+			job->Func();
+		}
+		else
+		{
+			job->Func();
+		}
+
+		vector<FJob*> continuations;
+		counter->Finish(continuations);
+		if (!continuations.empty())
+		{
+			for (auto item : continuations)
+			{
+				Push(item);
+			}
+
+			WakeUpWorkers();
+		}
+	}
+
+	void FJobSystem::WorkerTick(uint32 index)
+	{
+		auto start = chrono::steady_clock::now();
+		uint32 idle = 0;
+		while (!bQuit)
+		{
+			FJob* job = IsWorkerActive(index) ? FindJob() : nullptr;
+			if (job != nullptr)
+			{
+				Execute(job);
+				idle = 0;
+
+				// Back to the FThread now and then, it ticks the thread local singletons (stack counters).
+				if (chrono::steady_clock::now() - start > chrono::milliseconds(STickMilliseconds))
+				{
+					return;
+				}
+
+				continue;
+			}
+
+			if (++idle < SSpinCount)
+			{
+				this_thread::yield();
+				continue;
+			}
+
+			unique_lock<mutex> lck(ParkMutex);
+			++NumParked;
+			WakeUp.wait_for(lck, chrono::milliseconds(SParkMilliseconds), [&]()
+			{
+				return bQuit || (IsWorkerActive(index) && HasJobs());
+			});
+
+			--NumParked;
+			return;
+		}
+	}
+}
@@ -9,9 +9,8 @@
 
 #pragma once
 
-static string GetNowStr(bool asFileName = false)
+static string GetTimeStr(time_t t, bool asFileName = false)
 {
-	time_t t = ::time(0);
 	tm curr;
 	::localtime_s(&curr, &t);
 	char cdate[1024];
@@ -27,22 +26,20 @@ static string GetNowStr(bool asFileName = false)
 	return string(cdate);
 }
 
-static void log_cap_cnt(const CHAR* prefix, const CHAR* head, const CHAR* fmt, ...)
+static string GetNowStr(bool asFileName = false)
 {
-	char msg[1024];
-
-	va_list args;
-	va_start(args, fmt);
-	vsnprintf(msg, 1023, fmt, args);
-	//msg[sz] = '\0';
-	va_end(args);
+	return GetTimeStr(::time(0), asFileName);
+}
 
+// %APPDATA%\_LostVR\prefix-pid.log, the directory is created if missing.
+static bool GetLogFilePath(string& output, const CHAR* prefix)
+{
 	char* envdir = nullptr;
 	size_t sz = 0;
 	if (!_dupenv_s(&envdir, &sz, "APPDATA") == 0 || envdir == nullptr)
 	{
 		::MessageBoxA(0, "", "failed to get environment path", 0);
-		return;
+		return false;
 	}
 
 	char logpath[1024];
@@ -54,8 +51,7 @@ static void log_cap_cnt(const CHAR* prefix, const CHAR* head, const CHAR* fmt, .
 	char filepath[1024];
 	snprintf(filepath, 1023, "%s\\%s-%d.log", logpath, prefix, pid);
 
-	ofstream logfile(filepath, ios::app | ios::out);
-	if (!logfile)
+	if (::GetFileAttributesA(logpath) == INVALID_FILE_ATTRIBUTES)
 	{
 		SECURITY_ATTRIBUTES secu;
 		secu.bInheritHandle = TRUE;
@@ -64,25 +60,64 @@ static void log_cap_cnt(const CHAR* prefix, const CHAR* head, const CHAR* fmt, .
 		if (::CreateDirectoryA(logpath, &secu) == FALSE)
 		{
 			::MessageBoxA(0, logpath, "failed to create directory", 0);
-			return;
+			return false;
 		}
 	}
 
+	output = filepath;
+	return true;
+}
+
+// Synchronous path, opens, appends and closes the file on the calling thread.
+static void log_cap_cnt(const CHAR* prefix, const CHAR* head, const CHAR* fmt, ...)
+{
+	char msg[1024];
+
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(msg, 1023, fmt, args);
+	//msg[sz] = '\0';
+	va_end(args);
+
+	string filepath;
+	if (!GetLogFilePath(filepath, prefix))
+	{
+		return;
+	}
+
+	DWORD pid = ::GetCurrentProcessId();
+	ofstream logfile(filepath, ios::app | ios::out);
 	logfile << GetNowStr() << "\t";
 	logfile << "PID: " << pid << "\t";
 	logfile << head << ": " << string(msg).c_str() << endl;
 	logfile.flush();
 }
 
-#define LVMSG_PREFIX(prefix, head, ...) {\
+#include "Misc/AsyncLog.h"
+
+// 0 writes every record on the calling thread, as before FAsyncLog.
+#ifndef ASYNC_LOG
+#define ASYNC_LOG 1
+#endif
+
+#if ASYNC_LOG
+#define LVMSG_OVERFLOW(overflow, prefix, head, ...) {\
+LostCore::FAsyncLog::Get()->Write(overflow, prefix, head, __VA_ARGS__);}
+#define LVFLUSH() LostCore::FAsyncLog::Get()->Flush()
+#else
+#define LVMSG_OVERFLOW(overflow, prefix, head, ...) {\
 log_cap_cnt(prefix, head, __VA_ARGS__);}
+#define LVFLUSH()
+#endif
+
+#define LVMSG_PREFIX(prefix, head, ...) LVMSG_OVERFLOW(LostCore::ELogOverflow::Default, prefix, head, __VA_ARGS__)
 
 //#ifdef MODULE_MSG_PREFIX
 #define LVMSG(head, ...) LVMSG_PREFIX(MODULE_MSG_PREFIX, head, __VA_ARGS__)
 //#endif
 
 //#ifdef MODULE_ERR_PREFIX
-#define LVERR(head, ...) LVMSG_PREFIX(MODULE_ERR_PREFIX, head, __VA_ARGS__)
+#define LVERR(head, ...) LVMSG_OVERFLOW(LostCore::ELogOverflow::Block, MODULE_ERR_PREFIX, head, __VA_ARGS__)
 //#endif
 
 //#ifdef MODULE_WARN_PREFIX
@@ -98,8 +133,9 @@ log_cap_cnt(prefix, head, __VA_ARGS__);}
 #define LVASSERT_PREFIX(prefix, Condition, head, ...) {\
 	if (!(Condition))\
 	{\
-		LVMSG_PREFIX(prefix, head, __VA_ARGS__);\
-		LVMSG_PREFIX(prefix, "assert failed", "file: %s, line: %d.", __FILE__, __LINE__);\
+		LVMSG_OVERFLOW(LostCore::ELogOverflow::Block, prefix, head, __VA_ARGS__);\
+		LVMSG_OVERFLOW(LostCore::ELogOverflow::Block, prefix, "assert failed", "file: %s, line: %d.", __FILE__, __LINE__);\
+		LVFLUSH();\
 		assert(0);\
 	}\
 }
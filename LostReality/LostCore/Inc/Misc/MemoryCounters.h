@@ -4,56 +4,274 @@
 * author luoxw
 * date 2018/01/01
 *
-*
+* Allocations of the classes declaring MEMORY_ALLOC, counted by tag.
+* Every thread adds to counters only it writes, no lock and no shared cache line,
+* Sample merges the counters of all threads, once a frame by FMemoryCounterConsole.
 */
 
 #pragma once
 
 namespace LostCore
 {
-	typedef tuple<int32, int32> FUsage;
-	typedef map<string, tuple<int32, int32>> FNameUsageMap;
+	// Add the name to GetMemoryTagName too.
+	enum class EMemoryTag : uint8
+	{
+		Untagged = 0,
+		Font,
+		UserInterface,
+		Texture,
+		ConstantBuffer,
+		InstancingData,
+		PrimitiveGroup,
+		Shader,
+		Num,
+	};
+
+	static const int32 SNumMemoryTags = (int32)EMemoryTag::Num;
+
+	FORCEINLINE const char* GetMemoryTagName(EMemoryTag tag)
+	{
+		static const char* SNames[SNumMemoryTags] =
+		{
+			"Untagged",
+			"Font",
+			"UserInterface",
+			"Texture",
+			"ConstantBuffer",
+			"InstancingData",
+			"PrimitiveGroup",
+			"Shader",
+		};
+
+		return (int32)tag < SNumMemoryTags ? SNames[(int32)tag] : "Invalid";
+	}
+
+	// Merged over all threads by FMemoryCounterManager::Sample.
+	struct FMemoryTagUsage
+	{
+		int64 Count;
+		int64 Bytes;
+
+		// Highest Bytes seen by Sample, a peak between two samples is not seen.
+		int64 PeakBytes;
+
+		int64 NumAllocs;
+		int64 AllocatedBytes;
+
+		// Since the previous Sample.
+		int64 FrameAllocs;
+		double BytesPerSec;
+	};
+
+	typedef array<FMemoryTagUsage, SNumMemoryTags> FMemoryUsage;
+
+	// Where sampled allocations came from, return addresses of the allocating thread.
+	struct FAllocStack
+	{
+		static const uint32 SMaxFrames = 16;
+
+		EMemoryTag Tag;
+		uint32 NumFrames;
+		array<void*, SMaxFrames> Frames;
+		int64 NumAllocs;
+		int64 Bytes;
+	};
+
 	class FMemoryCounterManager : public TProcessUniqueSingleton<FMemoryCounterManager, 1>
 	{
 	public:
+		FORCEINLINE FMemoryCounterManager();
+		FORCEINLINE virtual ~FMemoryCounterManager() override;
+
 		FORCEINLINE virtual void Tick() override;
-		FORCEINLINE void Update(const string& name, int32 delta);
-		FORCEINLINE FNameUsageMap GetMemoryUsage() const;
+
+		// On the allocating thread, the counters of a thread are created at its first call.
+		static FORCEINLINE void OnAlloc(EMemoryTag tag, size_t size);
+		static FORCEINLINE void OnFree(EMemoryTag tag, size_t size);
+
+		// Merges the counters of every thread, rates are since the previous call, from one thread only.
+		FORCEINLINE FMemoryUsage Sample();
+
+		// Of the last Sample.
+		FORCEINLINE FMemoryUsage GetMemoryUsage() const;
+
+		// Call stack of every Nth allocation of a tag on a thread, 0 turns it off.
+		FORCEINLINE void SetStackSampling(uint32 everyNthAlloc);
+		FORCEINLINE vector<FAllocStack> GetAllocStacks() const;
 
 		static FORCEINLINE vector<string> GetInfoHeader();
+		static FORCEINLINE vector<string> GetDescs(EMemoryTag tag, const FMemoryTagUsage& usage);
 
 	private:
-		FNameUsageMap MemoryUsage;
-		mutex Mutex;
+		// Written by one thread, read by Sample.
+		struct FTagCounters
+		{
+			atomic<int64> NumAllocs;
+			atomic<int64> AllocatedBytes;
+			atomic<int64> NumFrees;
+			atomic<int64> FreedBytes;
+		};
+
+		struct FThreadCounters
+		{
+			array<FTagCounters, SNumMemoryTags> Tags;
+		};
+
+		// Per module, the exe and every dll cache the counters of the thread once.
+		struct FThreadCountersRef
+		{
+			FThreadCounters* Counters;
+			int64 ManagerId;
+		};
+
+		static FORCEINLINE FThreadCounters* GetThreadCounters();
+		static FORCEINLINE void Increase(atomic<int64>& counter, int64 delta);
+
+		FORCEINLINE FThreadCounters* AddThreadCounters();
+		FORCEINLINE void CaptureStack(EMemoryTag tag, size_t size);
+
+		// Creation stamp, tells a manager apart from a destroyed one at the same address.
+		const int64 Id;
+
+		// Kept after the threads exit, what they allocated may be freed by others.
+		vector<FThreadCounters*> ThreadCounters;
+		mutable mutex ThreadCountersMutex;
+
+		FMemoryUsage Usage;
+		FTimeStamp LastSampleStamp;
+
+		atomic<uint32> StackSampling;
+		map<uint32, FAllocStack> AllocStacks;
+		mutable mutex AllocStacksMutex;
 	};
 
+	FMemoryCounterManager::FMemoryCounterManager()
+		: Id(FPerformanceCounter::GetTimeStamp())
+		, LastSampleStamp(FPerformanceCounter::GetTimeStamp())
+		, StackSampling(0)
+	{
+		memset(&Usage, 0, sizeof(Usage));
+	}
+
+	FMemoryCounterManager::~FMemoryCounterManager()
+	{
+		lock_guard<mutex> lck(ThreadCountersMutex);
+		for (auto counters : ThreadCounters)
+		{
+			delete counters;
+		}
+
+		ThreadCounters.clear();
+	}
+
 	void FMemoryCounterManager::Tick()
 	{
 
 	}
 
-	void FMemoryCounterManager::Update(const string& name, int32 delta)
+	void FMemoryCounterManager::OnAlloc(EMemoryTag tag, size_t size)
 	{
-		lock_guard<mutex> lck(Mutex);
-		auto it = MemoryUsage.find(name);
-		if (it == MemoryUsage.end())
+		auto counters = GetThreadCounters();
+		if (counters == nullptr)
 		{
-			assert(delta > 0);
-			it = MemoryUsage.insert(FNameUsageMap::value_type(name, FUsage(1, delta))).first;
+			return;
 		}
-		else
+
+		auto& tagCounters = counters->Tags[(int32)tag];
+		Increase(tagCounters.NumAllocs, 1);
+		Increase(tagCounters.AllocatedBytes, (int64)size);
+
+		auto manager = Get();
+		const uint32 everyNth = manager->StackSampling.load(memory_order_relaxed);
+		if (everyNth != 0 && tagCounters.NumAllocs.load(memory_order_relaxed) % everyNth == 0)
+		{
+			manager->CaptureStack(tag, size);
+		}
+	}
+
+	void FMemoryCounterManager::OnFree(EMemoryTag tag, size_t size)
+	{
+		auto counters = GetThreadCounters();
+		if (counters == nullptr)
+		{
+			return;
+		}
+
+		auto& tagCounters = counters->Tags[(int32)tag];
+		Increase(tagCounters.NumFrees, 1);
+		Increase(tagCounters.FreedBytes, (int64)size);
+	}
+
+	FMemoryUsage FMemoryCounterManager::Sample()
+	{
+		int64 totals[SNumMemoryTags][4];
+		memset(totals, 0, sizeof(totals));
+
+		{
+			lock_guard<mutex> lck(ThreadCountersMutex);
+			for (auto counters : ThreadCounters)
+			{
+				for (int32 tag = 0; tag < SNumMemoryTags; ++tag)
+				{
+					const auto& tagCounters = counters->Tags[tag];
+					totals[tag][0] += tagCounters.NumAllocs.load(memory_order_relaxed);
+					totals[tag][1] += tagCounters.AllocatedBytes.load(memory_order_relaxed);
+					totals[tag][2] += tagCounters.NumFrees.load(memory_order_relaxed);
+					totals[tag][3] += tagCounters.FreedBytes.load(memory_order_relaxed);
+				}
+			}
+		}
+
+		const FTimeStamp stamp = FPerformanceCounter::GetTimeStamp();
+		const double sec = FPerformanceCounter::ToSeconds(stamp - LastSampleStamp);
+		LastSampleStamp = stamp;
+
+		for (int32 tag = 0; tag < SNumMemoryTags; ++tag)
 		{
-			std::get<0>(it->second) += delta > 0 ? 1 : -1;
-			std::get<1>(it->second) += delta;
+			auto& usage = Usage[tag];
+			const int64 frameAllocs = totals[tag][0] - usage.NumAllocs;
+			const int64 frameBytes = totals[tag][1] - usage.AllocatedBytes;
+
+			usage.Count = totals[tag][0] - totals[tag][2];
+			usage.Bytes = totals[tag][1] - totals[tag][3];
+			usage.PeakBytes = usage.Bytes > usage.PeakBytes ? usage.Bytes : usage.PeakBytes;
+			usage.NumAllocs = totals[tag][0];
+			usage.AllocatedBytes = totals[tag][1];
+			usage.FrameAllocs = frameAllocs;
+			usage.BytesPerSec = sec > 0.0 ? frameBytes / sec : 0.0;
 		}
+
+		return Usage;
+	}
+
+	FMemoryUsage FMemoryCounterManager::GetMemoryUsage() const
+	{
+		return Usage;
+	}
+
+	void FMemoryCounterManager::SetStackSampling(uint32 everyNthAlloc)
+	{
+		StackSampling.store(everyNthAlloc, memory_order_relaxed);
 	}
 
-	FNameUsageMap FMemoryCounterManager::GetMemoryUsage() const
+	vector<FAllocStack> FMemoryCounterManager::GetAllocStacks() const
 	{
-		return MemoryUsage;
+		lock_guard<mutex> lck(AllocStacksMutex);
+		vector<FAllocStack> stacks;
+		for (auto& item : AllocStacks)
+		{
+			stacks.push_back(item.second);
+		}
+
+		sort(stacks.begin(), stacks.end(), [](const FAllocStack& a, const FAllocStack& b)
+		{
+			return a.Bytes > b.Bytes;
+		});
+
+		return stacks;
 	}
 
-	vector<std::string> FMemoryCounterManager::GetInfoHeader()
+	vector<string> FMemoryCounterManager::GetInfoHeader()
 	{
 		static vector<string> header;
 		if (header.empty())
@@ -61,24 +279,107 @@ namespace LostCore
 			header.push_back("Name");
 			header.push_back("Count");
 			header.push_back("Usage");
+			header.push_back("Peak");
+			header.push_back("Allocs/frame");
+			header.push_back("Bytes/sec");
 		}
 		
 		return header;
 	}
 
+	vector<string> FMemoryCounterManager::GetDescs(EMemoryTag tag, const FMemoryTagUsage& usage)
+	{
+		vector<string> result;
+		result.push_back(GetMemoryTagName(tag));
+		result.push_back(to_string(usage.Count));
+		result.push_back(to_string(usage.Bytes));
+		result.push_back(to_string(usage.PeakBytes));
+		result.push_back(to_string(usage.FrameAllocs));
+		result.push_back(to_string((int64)usage.BytesPerSec));
+		return result;
+	}
+
+	FMemoryCounterManager::FThreadCounters* FMemoryCounterManager::GetThreadCounters()
+	{
+		// No counting before FProcessUnique::StaticInitialize, or in a dll before SetInstance.
+		if (FProcessUnique::Get() == nullptr)
+		{
+			return nullptr;
+		}
+
+		static thread_local FThreadCountersRef SRef = { nullptr, 0 };
+		auto manager = Get();
+		if (SRef.Counters == nullptr || SRef.ManagerId != manager->Id)
+		{
+			SRef.Counters = manager->AddThreadCounters();
+			SRef.ManagerId = manager->Id;
+		}
+
+		return SRef.Counters;
+	}
+
+	void FMemoryCounterManager::Increase(atomic<int64>& counter, int64 delta)
+	{
+		// Only the owning thread writes, a plain add instead of a locked one.
+		counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+	}
+
+	FMemoryCounterManager::FThreadCounters* FMemoryCounterManager::AddThreadCounters()
+	{
+		auto counters = new FThreadCounters;
+		for (auto& tagCounters : counters->Tags)
+		{
+			tagCounters.NumAllocs.store(0, memory_order_relaxed);
+			tagCounters.AllocatedBytes.store(0, memory_order_relaxed);
+			tagCounters.NumFrees.store(0, memory_order_relaxed);
+			tagCounters.FreedBytes.store(0, memory_order_relaxed);
+		}
+
+		lock_guard<mutex> lck(ThreadCountersMutex);
+		ThreadCounters.push_back(counters);
+		return counters;
+	}
+
+	void FMemoryCounterManager::CaptureStack(EMemoryTag tag, size_t size)
+	{
+		FAllocStack stack;
+		ULONG hash = 0;
+
+		// The first frames are the counter and the operator new of the class, inlined or not.
+		stack.NumFrames = CaptureStackBackTrace(0, FAllocStack::SMaxFrames, stack.Frames.data(), &hash);
+		stack.Tag = tag;
+		stack.NumAllocs = 1;
+		stack.Bytes = (int64)size;
+
+		const uint32 key = (uint32)hash ^ ((uint32)tag << 24);
+		lock_guard<mutex> lck(AllocStacksMutex);
+		auto it = AllocStacks.find(key);
+		if (it == AllocStacks.end())
+		{
+			AllocStacks.insert(make_pair(key, stack));
+		}
+		else
+		{
+			it->second.NumAllocs++;
+			it->second.Bytes += stack.Bytes;
+		}
+	}
+
 #if ENABLE_MEMORY_COUNTER
-#define MEMORY_ALLOC(cls)\
-void* operator new(uint32 sz)\
+// Size of the dynamic type on delete, as long as the destructor is virtual.
+#define MEMORY_ALLOC(tag)\
+void* operator new(size_t sz)\
 {\
-LostCore::FMemoryCounterManager::Get()->Update(#cls, sz);\
+LostCore::FMemoryCounterManager::OnAlloc(LostCore::EMemoryTag::tag, sz);\
 return malloc(sz);\
 }\
-void operator delete(void* p)\
+void operator delete(void* p, size_t sz)\
 {\
-LostCore::FMemoryCounterManager::Get()->Update(#cls, -static_cast<int32>(sizeof(cls))); \
+if (p == nullptr) return;\
+LostCore::FMemoryCounterManager::OnFree(LostCore::EMemoryTag::tag, sz);\
 free(p);\
 }
 #else
-#define MEMORY_ALLOC(name)
+#define MEMORY_ALLOC(tag)
 #endif
-}
\ No newline at end of file
+}
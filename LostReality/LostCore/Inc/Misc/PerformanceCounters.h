@@ -4,42 +4,203 @@
 * author luoxw
 * date 2017/09/15
 *
-*
+* Time stamps are int64 ticks of std::chrono::steady_clock in nanoseconds,
+* or of the invariant tsc of x86 calibrated against it.
+* Every module has its own copy of the clock, the exe detects and calibrates it and
+* FProcessUnique::SetInstance hands that one to the dlls, so stamps and conversions agree across modules.
+* Define PERFORMANCE_COUNTER_TSC 0 to build with steady_clock only.
 */
 
 #pragma once
 
+#ifndef PERFORMANCE_COUNTER_TSC
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PERFORMANCE_COUNTER_TSC 1
+#else
+#define PERFORMANCE_COUNTER_TSC 0
+#endif
+#endif
+
+#if PERFORMANCE_COUNTER_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
 namespace LostCore
 {
+	// Only the difference of two stamps means something.
+	typedef int64 FTimeStamp;
+
+	enum class EClockSource : uint8
+	{
+		SteadyClock,
+		Tsc,	// rdtsc, a few cycles instead of a call into the os
+	};
+
 	class FPerformanceCounter
 	{
 	public:
-		static FORCEINLINE LARGE_INTEGER GetFreq()
+		struct FClockCalibration
+		{
+			EClockSource Source;
+			int64 Freq;
+			double SecondsPerTick;
+		};
+
+		static FORCEINLINE FTimeStamp GetTimeStamp()
+		{
+			return ReadClock(GetState().Source);
+		}
+
+		// One stamp of the given source whatever the module uses, benchmarks compare the sources with it.
+		static FORCEINLINE FTimeStamp ReadClock(EClockSource source)
+		{
+#if PERFORMANCE_COUNTER_TSC
+			if (source == EClockSource::Tsc)
+			{
+				return (FTimeStamp)__rdtsc();
+			}
+#endif
+
+			return GetSteadyTimeStamp();
+		}
+
+		// Ticks per second.
+		static FORCEINLINE int64 GetFreq()
+		{
+			return GetCalibration().Freq;
+		}
+
+		static FORCEINLINE double ToSeconds(int64 ticks)
+		{
+			return double(ticks) * GetCalibration().SecondsPerTick;
+		}
+
+		static FORCEINLINE int64 ToNanoseconds(int64 ticks)
+		{
+			return (int64)(double(ticks) * GetCalibration().SecondsPerTick * 1000000000.0);
+		}
+
+		// Since start.
+		static FORCEINLINE double GetSeconds(FTimeStamp start)
 		{
-			static LARGE_INTEGER SFreq = { 0, 0 };
-			if (SFreq.QuadPart == 0)
+			return ToSeconds(GetTimeStamp() - start);
+		}
+
+		static FORCEINLINE EClockSource GetClockSource()
+		{
+			return GetState().Source;
+		}
+
+		// Calibrated on the first conversion, a dll converts nothing before SetInstance and never calibrates.
+		static FORCEINLINE const FClockCalibration& GetCalibration()
+		{
+			FClockState& state = GetState();
+			if (state.bShared)
 			{
-				QueryPerformanceFrequency(&SFreq);
+				return state.Shared;
 			}
 
-			return SFreq;
+			static FClockCalibration SCalibration = CreateCalibration(state.Source);
+			return SCalibration;
+		}
+
+		// FProcessUnique::SetInstance only, before the dll takes its first stamp.
+		static FORCEINLINE void SetCalibration(const FClockCalibration& calibration)
+		{
+			FClockState& state = GetState();
+			state.Source = calibration.Source;
+			state.Shared = calibration;
+			state.bShared = true;
 		}
 
-		static FORCEINLINE LARGE_INTEGER GetTimeStamp()
+		// Tsc only with an invariant tsc, the one detected is the default.
+		static FORCEINLINE EClockSource DetectClockSource()
 		{
-			LARGE_INTEGER s;
-			QueryPerformanceCounter(&s);
-			return s;
+#if PERFORMANCE_COUNTER_TSC
+			// Invariant tsc, constant rate in every P/C state and synchronized across cores.
+			int32 info[4];
+			GetCpuId(info, 0x80000000);
+			if ((uint32)info[0] >= 0x80000007)
+			{
+				GetCpuId(info, 0x80000007);
+				if ((info[3] & (1 << 8)) != 0)
+				{
+					return EClockSource::Tsc;
+				}
+			}
+#endif
+
+			return EClockSource::SteadyClock;
 		}
 
-		static FORCEINLINE double GetSeconds(LONGLONG count)
+	private:
+		struct FClockState
+		{
+			EClockSource Source;
+			bool bShared;
+			FClockCalibration Shared;
+		};
+
+		static FORCEINLINE FClockState& GetState()
 		{
-			return double(count) / FPerformanceCounter::GetFreq().QuadPart;
+			static FClockState SState = { DetectClockSource(), false, { EClockSource::SteadyClock, 0, 0.0 } };
+			return SState;
 		}
 
-		static FORCEINLINE double GetSeconds(LARGE_INTEGER start)
+		static FORCEINLINE FTimeStamp GetSteadyTimeStamp()
 		{
-			return FPerformanceCounter::GetSeconds(FPerformanceCounter::GetTimeStamp().QuadPart - start.QuadPart);
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static FORCEINLINE FClockCalibration CreateCalibration(EClockSource source)
+		{
+			FClockCalibration clock;
+			clock.Source = source;
+			clock.Freq = 1000000000;
+			clock.SecondsPerTick = 1.0 / 1000000000.0;
+
+#if PERFORMANCE_COUNTER_TSC
+			if (source == EClockSource::Tsc)
+			{
+				// Tsc ticks over 10ms of steady_clock, in the exe only.
+				const int64 calibrateNanoseconds = 10000000;
+				const FTimeStamp steadyStart = GetSteadyTimeStamp();
+				const FTimeStamp tscStart = (FTimeStamp)__rdtsc();
+				FTimeStamp steadyEnd = steadyStart;
+				while (steadyEnd - steadyStart < calibrateNanoseconds)
+				{
+					steadyEnd = GetSteadyTimeStamp();
+				}
+
+				const FTimeStamp tscEnd = (FTimeStamp)__rdtsc();
+				const double freq = double(tscEnd - tscStart) * 1000000000.0 / double(steadyEnd - steadyStart);
+				clock.Freq = (int64)freq;
+				clock.SecondsPerTick = 1.0 / freq;
+			}
+#endif
+
+			return clock;
+		}
+
+#if PERFORMANCE_COUNTER_TSC
+		static FORCEINLINE void GetCpuId(int32 info[4], uint32 leaf)
+		{
+#if defined(_MSC_VER)
+			__cpuid(info, (int32)leaf);
+#else
+			uint32 regs[4];
+			__cpuid(leaf, regs[0], regs[1], regs[2], regs[3]);
+			for (int32 i = 0; i < 4; ++i)
+			{
+				info[i] = (int32)regs[i];
+			}
+#endif
 		}
+#endif
 	};
-}
\ No newline at end of file
+}
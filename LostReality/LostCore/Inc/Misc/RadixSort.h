@@ -0,0 +1,72 @@
+/*
+* file RadixSort.h
+*
+* author luoxw
+* date 2018/03/25
+*
+* LSD radix sort of 64-bit keys, 8 bits per pass, stable.
+* Passes whose digit is the same for every key are skipped, sort keys with
+* mostly constant fields cost a few passes only.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	// scratch holds num keys, the result is in keys.
+	FORCEINLINE void RadixSort64(uint64* keys, uint64* scratch, uint32 num)
+	{
+		static const uint32 SPasses = 8;
+		static const uint32 SBuckets = 256;
+
+		if (num < 2)
+		{
+			return;
+		}
+
+		// Histograms of all the passes in one read.
+		uint32 counts[SPasses][SBuckets];
+		memset(counts, 0, sizeof(counts));
+		for (uint32 i = 0; i < num; ++i)
+		{
+			uint64 key = keys[i];
+			for (uint32 pass = 0; pass < SPasses; ++pass)
+			{
+				counts[pass][(key >> (pass * 8)) & 0xff]++;
+			}
+		}
+
+		uint64* src = keys;
+		uint64* dst = scratch;
+		for (uint32 pass = 0; pass < SPasses; ++pass)
+		{
+			uint32* count = counts[pass];
+			const uint32 shift = pass * 8;
+			if (count[(src[0] >> shift) & 0xff] == num)
+			{
+				continue;
+			}
+
+			uint32 offset = 0;
+			for (uint32 bucket = 0; bucket < SBuckets; ++bucket)
+			{
+				uint32 c = count[bucket];
+				count[bucket] = offset;
+				offset += c;
+			}
+
+			for (uint32 i = 0; i < num; ++i)
+			{
+				uint64 key = src[i];
+				dst[count[(key >> shift) & 0xff]++] = key;
+			}
+
+			swap(src, dst);
+		}
+
+		if (src != keys)
+		{
+			memcpy(keys, src, num * sizeof(uint64));
+		}
+	}
+}
@@ -16,11 +16,17 @@ namespace LostCore
 		string Name;
 		int32 RequestId;
 
+		// Of FTraceProfiler, shared by every thread.
+		uint32 TraceNameId;
+
 		FORCEINLINE FStackCounterRequest(const string& name);
 		FORCEINLINE ~FStackCounterRequest();
 
 		FORCEINLINE void Start();
 		FORCEINLINE void Stop();
+
+		// Untimed, summed over the frame and listed after the stack of the thread.
+		FORCEINLINE void AddCount(int32 count);
 	};
 
 	struct FScopedStackCounterRequest
@@ -45,15 +51,21 @@ namespace LostCore
 		string Name;
 		int32 RequestId;
 
-		LARGE_INTEGER Stamp;
+		FTimeStamp Stamp;
 		double Past;
 		int32 Count;
 		int32 Depth;
 
 		bool bUnFold;
 
+		// Allocation order in the frame, children of one request keep it.
+		uint32 Order;
+
+		// Children are listed in start order until MergeLeaves sorts them by request.
 		FStackCounter* ParentCounter;
-		multimap<int32, FStackCounter*> ChildCounters;
+		FStackCounter* FirstChild;
+		FStackCounter* LastChild;
+		FStackCounter* NextSibling;
 
 		FORCEINLINE FStackCounter();
 		FORCEINLINE ~FStackCounter();
@@ -102,33 +114,46 @@ namespace LostCore
 
 		FORCEINLINE void Start(const FStackCounterRequest& request);
 		FORCEINLINE void Stop(const FStackCounterRequest& request);
+		FORCEINLINE void AddCount(const FStackCounterRequest& request, int32 count);
 
 		FORCEINLINE int32 AllocRequestId();
 		FORCEINLINE void DeallocRequestId(int32 id);
 
+		// From the frame arena, every counter of the frame is recycled at once by Finish.
 		FORCEINLINE FStackCounter* AllocCounter();
-		FORCEINLINE void DeallocCounter(FStackCounter* counter);
+
+		// By request id, then start order, as listed in the sheet.
+		FORCEINLINE void SortChildren(FStackCounter* parent);
 
 		FORCEINLINE void Finish();
 		FORCEINLINE void RecycleCounters();
 
 	private:
+		static const uint32 SCountersPerBlock = 1024;
 
 		int32 LastAllocatedID;
 		vector<int32> IDPool;
 
+		// Kept across frames, as many as the busiest frame used.
+		vector<FStackCounter*> CounterBlocks;
+		uint32 NumUsedCounters;
+		vector<FStackCounter*> SortedChildren;
+		vector<FStackCounter*> VisibleCounters;
+
 		// Frame data.
 		FStackCounter* Current;
 		FStackCounter Root;
+		map<int32, pair<string, int64>> Counts;
 	};
 
 	FStackCounterRequest::FStackCounterRequest(const string& name)
 		: RequestId(FStackCounterManager::Get()->AllocRequestId())
 		, Name(name)
+		, TraceNameId(FTraceProfiler::Get()->InternName(name))
 	{
 		auto tid = this_thread::get_id();
 		auto mgrAddr = FStackCounterManager::Get();
-		LVDEBUG("FStackCounterRequest::FStackCounterRequest", "thread: %d, manager address: 0x%08x %s.", tid, mgrAddr, Name.c_str());
+		LVDEBUG("FStackCounterRequest::FStackCounterRequest", "thread: %d, manager address: 0x%08x %s.", GetThreadId(tid), mgrAddr, Name.c_str());
 	}
 
 	FStackCounterRequest::~FStackCounterRequest()
@@ -139,20 +164,31 @@ namespace LostCore
 	void FStackCounterRequest::Start()
 	{
 		FStackCounterManager::Get()->Start(*this);
+		FTraceProfiler::Record(ETraceEvent::Begin, TraceNameId);
 	}
 
 	void FStackCounterRequest::Stop()
 	{
+		FTraceProfiler::Record(ETraceEvent::End, TraceNameId);
 		FStackCounterManager::Get()->Stop(*this);
 	}
 
+	void FStackCounterRequest::AddCount(int32 count)
+	{
+		FStackCounterManager::Get()->AddCount(*this, count);
+	}
+
 	FStackCounter::FStackCounter() 
 		: ParentCounter(nullptr)
+		, FirstChild(nullptr)
+		, LastChild(nullptr)
+		, NextSibling(nullptr)
 		, bUnFold(true)
+		, Order(0)
+		, Past(0.0)
 		, Count(0)
 		, Depth(0)
 	{
-		ChildCounters.clear();
 	}
 
 	FStackCounter::~FStackCounter()
@@ -162,20 +198,31 @@ namespace LostCore
 	void FStackCounter::Start(FStackCounter* parentCounter)
 	{
 		Stamp = FPerformanceCounter::GetTimeStamp();
-		ChildCounters.clear();
+		FirstChild = nullptr;
+		LastChild = nullptr;
+		NextSibling = nullptr;
 		Count = 1;
 		ParentCounter = parentCounter;
 		Depth = 1;
 		if (ParentCounter != nullptr)
 		{
-			ParentCounter->ChildCounters.insert(pair<int32, FStackCounter*>(RequestId, this));
+			if (ParentCounter->LastChild != nullptr)
+			{
+				ParentCounter->LastChild->NextSibling = this;
+			}
+			else
+			{
+				ParentCounter->FirstChild = this;
+			}
+
+			ParentCounter->LastChild = this;
 			Depth = ParentCounter->GetDepth() + 1;
 		}
 	}
 
 	FStackCounter* FStackCounter::Stop()
 	{
-		assert(Stamp.QuadPart != 0);
+		assert(Stamp != 0);
 		Past = FPerformanceCounter::GetSeconds(Stamp);
 		return ParentCounter;
 	}
@@ -187,10 +234,10 @@ namespace LostCore
 
 	void FStackCounter::GetChildCounters(vector<FStackCounter*>& counters) const
 	{
-		for (auto it = ChildCounters.begin(); it != ChildCounters.end(); it++)
+		for (auto child = FirstChild; child != nullptr; child = child->NextSibling)
 		{
-			counters.push_back(it->second);
-			it->second->GetChildCounters(counters);
+			counters.push_back(child);
+			child->GetChildCounters(counters);
 		}
 	}
 
@@ -198,10 +245,10 @@ namespace LostCore
 	{
 		if (bUnFold)
 		{
-			for (auto item : ChildCounters)
+			for (auto child = FirstChild; child != nullptr; child = child->NextSibling)
 			{
-				counters.push_back(item.second);
-				item.second->GetVisibleChildCounters(counters);
+				counters.push_back(child);
+				child->GetVisibleChildCounters(counters);
 			}
 		}
 	}
@@ -238,62 +285,73 @@ namespace LostCore
 
 	bool FStackCounter::IsLeaf() const
 	{
-		return ChildCounters.empty();
+		return FirstChild == nullptr;
 	}
 
 	void FStackCounter::MergeLeaves()
 	{
-		if (ChildCounters.empty())
+		if (FirstChild == nullptr)
 		{
 			return;
 		}
 
-		auto lastIt = ChildCounters.begin();
-		auto it = lastIt;
-		it++;
-		while (it != ChildCounters.end())
+		FStackCounterManager::Get()->SortChildren(this);
+
+		// Leaves of one request merge into the first of them, nodes with children are kept.
+		auto last = FirstChild;
+		auto prev = FirstChild;
+		auto it = FirstChild->NextSibling;
+		while (it != nullptr)
 		{
-			if (it->first != lastIt->first)
+			if (it->RequestId != last->RequestId)
 			{
-				lastIt = it++;
+				last = prev = it;
+				it = it->NextSibling;
 			}
-			else if (it->second->IsLeaf() && !lastIt->second->IsLeaf())
+			else if (it->IsLeaf() && !last->IsLeaf())
 			{
-				lastIt = it++;
+				last = prev = it;
+				it = it->NextSibling;
 			}
-			else if (it->second->IsLeaf() && lastIt->second->IsLeaf())
+			else if (it->IsLeaf() && last->IsLeaf())
 			{
-				lastIt->second->Past += it->second->Past;
-				lastIt->second->Count++;
-				FStackCounterManager::Get()->DeallocCounter(it->second);
-				it = ChildCounters.erase(it);
+				last->Past += it->Past;
+				last->Count++;
+				prev->NextSibling = it->NextSibling;
+				it = it->NextSibling;
 			}
 			else
 			{
-				it++;
+				prev = it;
+				it = it->NextSibling;
 			}
 		}
 
+		LastChild = prev;
+
 		auto pastAll = 0.0;
-		for (auto item : ChildCounters)
+		for (auto child = FirstChild; child != nullptr; child = child->NextSibling)
 		{
-			pastAll += item.second->Past;
-			item.second->MergeLeaves();
+			pastAll += child->Past;
+			child->MergeLeaves();
 		}
 
+		// SOthers is below every request id, listed first.
 		auto counter = FStackCounterManager::Get()->AllocCounter();
 		counter->RequestId = FStackCounterManager::SOthers;
 		counter->Name = "Others";
 		counter->Past = Past - pastAll;
 		counter->ParentCounter = this;
 		counter->Depth = GetDepth() + 1;
-		ChildCounters.insert(pair<int32, FStackCounter*>(counter->RequestId, counter));
+		counter->NextSibling = FirstChild;
+		FirstChild = counter;
 	}
 
 	FStackCounterManager::FStackCounterManager()
 		: Current(nullptr)
 		, LastAllocatedID(SOthers)
 		, IDPool(0)
+		, NumUsedCounters(0)
 	{
 		Root.Name = "Root";
 		Root.RequestId = SRoot;
@@ -303,7 +361,12 @@ namespace LostCore
 
 	FStackCounterManager::~FStackCounterManager()
 	{
+		for (auto block : CounterBlocks)
+		{
+			delete[] block;
+		}
 
+		CounterBlocks.clear();
 	}
 
 	void FStackCounterManager::Tick()
@@ -315,12 +378,7 @@ namespace LostCore
 	{
 		assert(Current == &Root || Current == nullptr);
 
-		vector<FStackCounter*> counters;
-		Root.GetChildCounters(counters);
-		for (auto item : counters)
-		{
-			DeallocCounter(item);
-		}
+		NumUsedCounters = 0;
 	}
 
 	void FStackCounterManager::Start(const FStackCounterRequest& request)
@@ -338,6 +396,13 @@ namespace LostCore
 		Current = Current->Stop();
 	}
 
+	void FStackCounterManager::AddCount(const FStackCounterRequest& request, int32 count)
+	{
+		auto& item = Counts[request.RequestId];
+		item.first = request.Name;
+		item.second += count;
+	}
+
 	int32 FStackCounterManager::AllocRequestId()
 	{
 		// LastAllocatedIDӵSMaxIDǰ,ֻLastAllocatedID.
@@ -360,12 +425,48 @@ namespace LostCore
 
 	FStackCounter * FStackCounterManager::AllocCounter()
 	{
-		return new FStackCounter;
+		if (NumUsedCounters == CounterBlocks.size() * SCountersPerBlock)
+		{
+			CounterBlocks.push_back(new FStackCounter[SCountersPerBlock]);
+		}
+
+		const uint32 index = NumUsedCounters++;
+		auto counter = &CounterBlocks[index / SCountersPerBlock][index % SCountersPerBlock];
+
+		// Name is assigned by the caller, its buffer is reused.
+		counter->Order = index;
+		counter->Past = 0.0;
+		counter->Count = 0;
+		counter->Depth = 0;
+		counter->bUnFold = true;
+		counter->ParentCounter = nullptr;
+		counter->FirstChild = nullptr;
+		counter->LastChild = nullptr;
+		counter->NextSibling = nullptr;
+		return counter;
 	}
 
-	void FStackCounterManager::DeallocCounter(FStackCounter * counter)
+	void FStackCounterManager::SortChildren(FStackCounter * parent)
 	{
-		SAFE_DELETE(counter);
+		SortedChildren.clear();
+		for (auto child = parent->FirstChild; child != nullptr; child = child->NextSibling)
+		{
+			SortedChildren.push_back(child);
+		}
+
+		sort(SortedChildren.begin(), SortedChildren.end(), [](const FStackCounter* a, const FStackCounter* b)
+		{
+			return a->RequestId != b->RequestId ? a->RequestId < b->RequestId : a->Order < b->Order;
+		});
+
+		parent->FirstChild = SortedChildren.front();
+		parent->LastChild = SortedChildren.back();
+		for (size_t i = 0; i + 1 < SortedChildren.size(); ++i)
+		{
+			SortedChildren[i]->NextSibling = SortedChildren[i + 1];
+		}
+
+		parent->LastChild->NextSibling = nullptr;
 	}
 
 	void FStackCounterManager::Finish()
@@ -374,14 +475,26 @@ namespace LostCore
 		Root.MergeLeaves();
 
 		vector<vector<string>> statistics;
-		vector<FStackCounter*> counters;
-		Root.GetVisibleChildCounters(counters);
+		VisibleCounters.clear();
+		Root.GetVisibleChildCounters(VisibleCounters);
 
-		for (auto item : counters)
+		for (auto item : VisibleCounters)
 		{
 			statistics.push_back(item->GetDescs(">> "));
 		}
 
+		for (auto& item : Counts)
+		{
+			vector<string> row;
+			row.push_back(string(">> ").append(item.second.first));
+			row.push_back(to_string(item.second.second));
+			row.push_back("");
+			row.push_back("");
+			row.push_back("");
+			statistics.push_back(row);
+			item.second.second = 0;
+		}
+
 		FStackCounterCollector::Get()->OnNotified(
 			FStackInfo(FProcessUnique::Get()->GetCurrentThread()->GetFrameInfo(), statistics));
 
@@ -19,7 +19,9 @@ namespace LostCore
 		virtual void Tick() = 0;
 	};
 
-	typedef map<int32, ITickable*> FTickableObjects;
+	// Class indices of TTlsSingleton and TProcessUniqueSingleton are slots in these arrays.
+	static const int32 SMaxSingletons = 16;
+	typedef array<ITickable*, SMaxSingletons> FTickableObjects;
 
 	enum class ECondition : uint8
 	{
@@ -28,23 +30,53 @@ namespace LostCore
 		BeginFrame,
 	};
 
+	// Spins before a waiting side of TFramePipeline parks, milliseconds Read stays parked before giving up.
+	struct FWaitPolicy
+	{
+		uint32 SpinCount;
+		uint32 ParkMilliseconds;
+
+		FORCEINLINE explicit FWaitPolicy(uint32 spinCount = 4096, uint32 parkMilliseconds = 100)
+			: SpinCount(spinCount), ParkMilliseconds(parkMilliseconds)
+		{
+		}
+	};
+
+	// Frame handoff between a producer and a consumer thread over three T, swapped, never copied.
+	// The producer fills Ref() and Commit()s it, the consumer Read()s the oldest committed frame
+	// and must be done with it (an executed and reset command arena) before the next Read, it goes back to the producer then.
+	// The producer runs at most one frame ahead, both sides spin then park on a condition variable.
 	template <typename T>
-	class TSynchronizer
+	class TFramePipeline
 	{
 	public:
-		explicit TSynchronizer(int32 num);
-		~TSynchronizer();
+		explicit TFramePipeline(const FWaitPolicy& policy = FWaitPolicy());
+		~TFramePipeline();
 
-		double SyncCommit();
-		double SyncRead(T* obj);
+		// Before the producer and the consumer start.
+		void SetWaitPolicy(const FWaitPolicy& policy);
 
+		// Producer thread, returns the seconds waited for the consumer.
 		T& Ref();
+		double Commit();
+
+		// Consumer thread, nullptr if nothing was committed within the policy's park time.
+		T* Read();
 
 	private:
-		atomic<bool> bWaitingForRead;
-		atomic<int32> ReadIndex;
-		atomic<int32> WriteIndex;
-		vector<T> Objects;
+		bool WaitFor(bool full, bool bCanTimeout);
+
+		T Buffers[3];
+		int32 WriteIndex;
+		int32 FullIndex;
+		int32 ReadIndex;
+
+		// FullIndex holds a committed frame the consumer has not read yet.
+		atomic<bool> bFull;
+
+		FWaitPolicy Policy;
+		mutex StateMutex;
+		condition_variable Changed;
 	};
 
 	class ITask
@@ -85,6 +117,10 @@ namespace LostCore
 		{
 			SInstance = instance;
 			SIsOriginal = false;
+			if (instance != nullptr)
+			{
+				FPerformanceCounter::SetCalibration(instance->Clock);
+			}
 		}
 
 	public:
@@ -102,19 +138,33 @@ namespace LostCore
 		FORCEINLINE void RemoveThread(FThread* t);
 		FORCEINLINE FThread* GetCurrentThread();
 
+		// Set by FTraceProfiler while a capture is pending, every module checks it before recording a scope.
+		FORCEINLINE bool IsTracing() const;
+		FORCEINLINE void SetTracing(bool tracing);
+
 		template <typename T>
 		FORCEINLINE T* GetSingleton(int32 index);
 
 	private:
-	
+		// Per thread and per module, the exe and every dll look their FThread up in ThreadMap once.
+		static FORCEINLINE FThread*& CurrentThread();
+
 		map<thread::id, FThread*> ThreadMap;
 		mutex ThreadMapMutex;
 
 		typedef function<void()> FCmd;
 		FCommandQueue<FCmd> Commands;
 
+		// The clock of the exe, every dll converts its stamps with it.
+		// Calibrated before GuardThread starts.
+		FPerformanceCounter::FClockCalibration Clock;
+
+		atomic<bool> bTracing;
+
 		FThread* GuardThread;
-		FTickableObjects Singletons;
+
+		// Read without the lock, created under it.
+		array<atomic<ITickable*>, SMaxSingletons> Singletons;
 		mutex SingletonsMutex;
 
 		static bool SIsOriginal;
@@ -127,6 +177,8 @@ namespace LostCore
 	{
 	public:
 		static const int32 SClassIndex = ClassIndex;
+		static_assert(ClassIndex >= 0 && ClassIndex < SMaxSingletons, "ClassIndex out of the singleton slots");
+
 		static T* Get()
 		{
 			return FProcessUnique::Get()->GetSingleton<T>(SClassIndex);
@@ -165,7 +217,7 @@ namespace LostCore
 		TAverage<double, 30> TickSeconds;
 		uint32 AffinityMask;
 
-		FTickableObjects IndexedSingletonMap;
+		FTickableObjects IndexedSingletons;
 		thread Thread;
 	};
 
@@ -178,8 +230,14 @@ namespace LostCore
 
 	FProcessUnique::FProcessUnique()
 		: Commands(true)
+		, Clock(FPerformanceCounter::GetCalibration())
+		, bTracing(false)
 		, GuardThread(new FThread(this, "Guard"))
 	{
+		for (auto& singleton : Singletons)
+		{
+			singleton.store(nullptr, memory_order_relaxed);
+		}
 	}
 	
 	FProcessUnique::~FProcessUnique()
@@ -199,34 +257,60 @@ namespace LostCore
 		lock_guard<mutex> lck(ThreadMapMutex);
 		assert(ThreadMap.find(t->GetId()) != ThreadMap.end());
 		ThreadMap.erase(t->GetId());
+
+		if (CurrentThread() == t)
+		{
+			CurrentThread() = nullptr;
+		}
+	}
+
+	FThread*& FProcessUnique::CurrentThread()
+	{
+		static thread_local FThread* SThread = nullptr;
+		return SThread;
 	}
 	
 	FThread * FProcessUnique::GetCurrentThread()
 	{
-		lock_guard<mutex> lck(ThreadMapMutex);
-		auto id = this_thread::get_id();
-		assert(ThreadMap.find(id) != ThreadMap.end());
-		return ThreadMap.find(this_thread::get_id())->second;
+		FThread*& current = CurrentThread();
+		if (current == nullptr)
+		{
+			lock_guard<mutex> lck(ThreadMapMutex);
+			auto it = ThreadMap.find(this_thread::get_id());
+			assert(it != ThreadMap.end());
+			current = it->second;
+		}
+
+		return current;
+	}
+
+	bool FProcessUnique::IsTracing() const
+	{
+		return bTracing.load(memory_order_relaxed);
+	}
+
+	void FProcessUnique::SetTracing(bool tracing)
+	{
+		bTracing.store(tracing, memory_order_relaxed);
 	}
 
 	template <typename T>
 	T* FProcessUnique::GetSingleton(int32 index)
 	{
-		auto it = Singletons.find(index);
-		if (it == Singletons.end())
+		assert(index >= 0 && index < SMaxSingletons);
+		ITickable* singleton = Singletons[index].load(memory_order_acquire);
+		if (singleton == nullptr)
 		{
 			lock_guard<mutex> lck(SingletonsMutex);
-			it = Singletons.find(index);
-			if (it == Singletons.end())
+			singleton = Singletons[index].load(memory_order_relaxed);
+			if (singleton == nullptr)
 			{
-				it = Singletons.insert(FTickableObjects::value_type(index, new T)).first;
+				singleton = new T;
+				Singletons[index].store(singleton, memory_order_release);
 			}
-
-			assert(it != Singletons.end());
-			return dynamic_cast<T*>(it->second);
 		}
 
-		return dynamic_cast<T*>(it->second);
+		return static_cast<T*>(singleton);
 	}
 
 	bool FProcessUnique::Initialize()
@@ -255,9 +339,9 @@ namespace LostCore
 
 		for (auto& item : Singletons)
 		{
-			SAFE_DELETE(item.second);
+			ITickable* singleton = item.exchange(nullptr);
+			SAFE_DELETE(singleton);
 		}
-		Singletons.clear();
 
 		assert(ThreadMap.empty());
 	}
@@ -276,6 +360,7 @@ namespace LostCore
 		: Name("unnamed")
 		, Task(nullptr)
 	{
+		IndexedSingletons.fill(nullptr);
 	}
 
 	FThread::FThread(ITask * task, const string & name, uint32 affinityMask)
@@ -284,6 +369,7 @@ namespace LostCore
 		, AffinityMask(affinityMask)
 		, bRunning(true)
 	{
+		IndexedSingletons.fill(nullptr);
 		if (task != nullptr)
 		{
 			Thread = thread([&]() {Run(); });
@@ -322,22 +408,16 @@ namespace LostCore
 	ITickable * FThread::GetSingleton(int32 index)
 	{
 		assert(this_thread::get_id() == Thread.get_id());
-		auto it = IndexedSingletonMap.find(index);
-		if (it != IndexedSingletonMap.end())
-		{
-			return it->second;
-		}
-		else
-		{
-			return nullptr;
-		}
+		assert(index >= 0 && index < SMaxSingletons);
+		return IndexedSingletons[index];
 	}
 
 	FORCEINLINE void FThread::AddSingleton(int32 index, ITickable* singleton)
 	{
 		assert(this_thread::get_id() == Thread.get_id());
-		assert(IndexedSingletonMap.find(index) == IndexedSingletonMap.end());
-		IndexedSingletonMap[index] = singleton;
+		assert(index >= 0 && index < SMaxSingletons);
+		assert(IndexedSingletons[index] == nullptr);
+		IndexedSingletons[index] = singleton;
 		LVDEBUG("AddSingleton", "thread: %d, class: %d, 0x%08x.", GetThreadId(this_thread::get_id()), index, singleton);
 	}
 
@@ -380,7 +460,7 @@ namespace LostCore
 			return;
 		}
 
-		LARGE_INTEGER timeStamp = FPerformanceCounter::GetTimeStamp();
+		FTimeStamp timeStamp = FPerformanceCounter::GetTimeStamp();
 
 		do
 		{
@@ -388,9 +468,12 @@ namespace LostCore
 			TickSeconds.Add(FPerformanceCounter::GetSeconds(timeStamp));
 			timeStamp = FPerformanceCounter::GetTimeStamp();
 
-			for (auto& item : IndexedSingletonMap)
+			for (auto singleton : IndexedSingletons)
 			{
-				item.second->Tick();
+				if (singleton != nullptr)
+				{
+					singleton->Tick();
+				}
 			}
 
 			this_thread::sleep_for(chrono::microseconds(10));
@@ -411,87 +494,99 @@ namespace LostCore
 		assert(this_thread::get_id() == Thread.get_id());
 
 		// ߳̽,ͷűص.
-		for (auto item : IndexedSingletonMap)
+		for (auto& singleton : IndexedSingletons)
 		{
-			assert(item.second != nullptr);
-			SAFE_DELETE(item.second);
+			SAFE_DELETE(singleton);
 		}
 
-		IndexedSingletonMap.clear();
 		FProcessUnique::Get()->RemoveThread(this);
 	}
 
 	template<typename T>
-	TSynchronizer<T>::TSynchronizer(int32 num)
-		: ReadIndex(-1)
-		, WriteIndex(0)
-		, Objects(num)
-		, bWaitingForRead(false)
+	TFramePipeline<T>::TFramePipeline(const FWaitPolicy& policy)
+		: WriteIndex(0)
+		, FullIndex(1)
+		, ReadIndex(2)
+		, bFull(false)
+		, Policy(policy)
 	{
 	}
-	
+
 	template<typename T>
-	TSynchronizer<T>::~TSynchronizer()
+	TFramePipeline<T>::~TFramePipeline()
 	{
 	}
-	
+
 	template<typename T>
-	double TSynchronizer<T>::SyncCommit()
+	void TFramePipeline<T>::SetWaitPolicy(const FWaitPolicy& policy)
 	{
-		LARGE_INTEGER timeStamp = FPerformanceCounter::GetTimeStamp();
+		Policy = policy;
+	}
 
-		// ³ʼֵ.
-		if (ReadIndex == -1)
-		{
-			ReadIndex = 0;
-		}
+	template<typename T>
+	T& TFramePipeline<T>::Ref()
+	{
+		return Buffers[WriteIndex];
+	}
+
+	template<typename T>
+	double TFramePipeline<T>::Commit()
+	{
+		FTimeStamp timeStamp = FPerformanceCounter::GetTimeStamp();
 
-		// д.
-		WriteIndex = (WriteIndex + 1) % Objects.size();
+		// The consumer has not taken the last frame yet.
+		WaitFor(false, false);
 
-		// дָ򲻿д,ȴ̶߳ȡ.		
-		if (ReadIndex == WriteIndex)
 		{
-			bWaitingForRead = true;
+			lock_guard<mutex> lck(StateMutex);
+			swap(WriteIndex, FullIndex);
+			bFull = true;
 		}
 
-		while (ReadIndex == WriteIndex && bWaitingForRead)
-		{
-			this_thread::yield();
-		}
+		Changed.notify_all();
 
 		return FPerformanceCounter::GetSeconds(timeStamp);
 	}
 
 	template<typename T>
-	double TSynchronizer<T>::SyncRead(T * obj)
+	T* TFramePipeline<T>::Read()
 	{
-		LARGE_INTEGER timeStamp = FPerformanceCounter::GetTimeStamp();
-
-		// ָ򲻿ɶȡ,ȴ߳ύ.
-		while (ReadIndex == -1 || (ReadIndex == WriteIndex && !bWaitingForRead))
+		if (!WaitFor(true, true))
 		{
-			this_thread::yield();
+			return nullptr;
 		}
 
-		// objָǿֵ.
-		if (obj != nullptr)
 		{
-			*obj = Objects[ReadIndex];
+			lock_guard<mutex> lck(StateMutex);
+			swap(ReadIndex, FullIndex);
+			bFull = false;
 		}
 
-		// 
-		Objects[ReadIndex] = 0;
-
-		// ¶,֪ͨѾ߳.
-		ReadIndex = (ReadIndex + 1) % Objects.size();
-		bWaitingForRead = false;
-		return FPerformanceCounter::GetSeconds(timeStamp);
+		Changed.notify_all();
+		return &Buffers[ReadIndex];
 	}
-	
+
 	template<typename T>
-	T & TSynchronizer<T>::Ref()
+	bool TFramePipeline<T>::WaitFor(bool full, bool bCanTimeout)
 	{
-		return Objects[WriteIndex];
+		for (uint32 i = 0; i < Policy.SpinCount; ++i)
+		{
+			if (bFull.load(memory_order_acquire) == full)
+			{
+				return true;
+			}
+
+			YieldProcessor();
+		}
+
+		unique_lock<mutex> lck(StateMutex);
+		auto pred = [&]() { return bFull == full; };
+		if (bCanTimeout)
+		{
+			return Changed.wait_for(lck, chrono::milliseconds(Policy.ParkMilliseconds), pred);
+		}
+
+		Changed.wait(lck, pred);
+		return true;
 	}
 }
\ No newline at end of file
@@ -19,6 +19,7 @@ namespace LostCore
 	public:
 		static const int32 SClassIndex = ClassIndex;
 
+		// A thread local and a slot of the FThread, no lock, every FStackCounterRequest scope goes through here.
 		static T* Get()
 		{
 			auto t = FProcessUnique::Get()->GetCurrentThread();
@@ -29,7 +30,7 @@ namespace LostCore
 				t->AddSingleton(T::SClassIndex, p);
 			}
 
-			return dynamic_cast<T*>(p);
+			return static_cast<T*>(p);
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,658 @@
+/*
+* file TraceProfiler.h
+*
+* author luoxw
+* date 2018/03/31
+*
+* 1. While a capture is pending, every FStackCounterRequest scope also pushes a begin and an end event to a ring
+*    of its thread, 16 bytes each: the time stamp, the interned name and the kind. The FThread pushes a frame event
+*    after each tick. Otherwise a scope only checks FProcessUnique::IsTracing.
+* 2. A ring has one writer, its thread, and one reader, the collecting thread. A full ring drops events and counts them.
+* 3. The collecting thread sleeps until a capture is asked for, then drains the rings and keeps the events of the
+*    capture, written as Chrome trace json (chrome://tracing, ui.perfetto.dev) with every thread on one timeline.
+* 4. Nothing is captured before Start, Stop before FProcessUnique is destroyed.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	enum class ETraceEvent : uint8
+	{
+		Begin,
+		End,
+		Frame,
+	};
+
+	struct FTraceEvent
+	{
+		FTimeStamp Stamp;
+		uint32 NameId;
+		ETraceEvent Type;
+	};
+
+	class FTraceEventRing
+	{
+	public:
+		// Power of two, a megabyte per thread.
+		static const uint32 SCapacity = 1 << 16;
+
+		FORCEINLINE FTraceEventRing(uint32 threadId, const string& threadName);
+
+		// Thread of the ring only.
+		FORCEINLINE void Push(ETraceEvent type, uint32 nameId);
+
+		// Collecting thread only, appends the events pushed since the last call.
+		FORCEINLINE void Drain(vector<FTraceEvent>& output);
+
+		FORCEINLINE uint32 GetThreadId() const;
+		FORCEINLINE const string& GetThreadName() const;
+		FORCEINLINE uint32 GetNumDropped() const;
+
+	private:
+		uint32 ThreadId;
+		string ThreadName;
+		vector<FTraceEvent> Events;
+
+		// Free running, masked into Events.
+		atomic<uint32> Head;
+		atomic<uint32> Tail;
+		atomic<uint32> NumDropped;
+	};
+
+	class FTraceProfiler : public TProcessUniqueSingleton<FTraceProfiler, 4>
+	{
+	public:
+		// Name of the frame events.
+		static const uint32 SFrameNameId = 0;
+
+		FORCEINLINE FTraceProfiler();
+		FORCEINLINE virtual ~FTraceProfiler() override;
+
+		FORCEINLINE virtual void Tick() override;
+
+		// Calling thread, nothing unless a capture is pending.
+		static FORCEINLINE void Record(ETraceEvent type, uint32 nameId);
+
+		// Starts the collecting thread, captures are taken from then on.
+		FORCEINLINE void Start();
+		FORCEINLINE void Stop();
+		FORCEINLINE bool IsRunning() const;
+
+		// Once per FStackCounterRequest, any thread.
+		FORCEINLINE uint32 InternName(const string& name);
+
+		// From the next frame of the calling thread, numFrames of them, the events of every thread are written to path.
+		// False if the profiler is not running or a capture is not finished yet.
+		FORCEINLINE bool Capture(uint32 numFrames, const string& path);
+		FORCEINLINE bool IsCapturing() const;
+
+		// FTraceThread, on the thread of the ring.
+		FORCEINLINE FTraceEventRing* AddRing();
+		FORCEINLINE void RemoveRing(FTraceEventRing* ring);
+
+	private:
+		class FCollectTask : public ITask
+		{
+		public:
+			FORCEINLINE FCollectTask(FTraceProfiler* profiler) : Profiler(profiler) {}
+
+			// Inherited via ITask
+			FORCEINLINE virtual bool Initialize() override { return true; }
+			FORCEINLINE virtual void Tick() override;
+			FORCEINLINE virtual void Destroy() override {}
+			FORCEINLINE virtual bool IsThreadPrivate() const override { return false; }
+			FORCEINLINE virtual bool IsLoop() const override { return true; }
+
+		private:
+			FTraceProfiler* Profiler;
+		};
+
+		struct FRingState
+		{
+			FTraceEventRing* Ring;
+
+			// Drained, not processed yet.
+			vector<FTraceEvent> Pending;
+		};
+
+		struct FCapturedThread
+		{
+			string Name;
+			vector<FTraceEvent> Events;
+		};
+
+		static const int32 SCollectMilliseconds = 2;
+
+		// Collecting thread.
+		FORCEINLINE void Collect();
+		FORCEINLINE void WaitForCapture();
+
+		// After bCapturing or bRunning changed, through WakeMutex so the collecting thread can't miss it.
+		FORCEINLINE void Wake();
+
+		// RingsMutex held.
+		FORCEINLINE void ProcessPending(FRingState& state);
+		FORCEINLINE void FinishCapture(map<uint32, FCapturedThread>& captured, FTimeStamp& begin, FTimeStamp& end, string& path);
+
+		FORCEINLINE void WriteCapture(const map<uint32, FCapturedThread>& captured, FTimeStamp begin, FTimeStamp end, const string& path);
+		static FORCEINLINE string Escape(const string& name);
+
+		atomic<bool> bRunning;
+		FThread* Collector;
+		FCollectTask* CollectTask;
+		mutex WakeMutex;
+		condition_variable WakeCondition;
+
+		vector<string> Names;
+		map<string, uint32> NameIds;
+		mutex NamesMutex;
+
+		vector<FRingState> Rings;
+		uint32 NextThreadId;
+		mutex RingsMutex;
+
+		// Capture, RingsMutex held, CaptureBegin is 0 until the first frame.
+		atomic<bool> bCapturing;
+		FTraceEventRing* CaptureRing;
+		FTimeStamp CaptureRequested;
+		FTimeStamp CaptureBegin;
+		FTimeStamp CaptureEnd;
+		uint32 CaptureFramesLeft;
+		string CapturePath;
+		map<uint32, FCapturedThread> Captured;
+	};
+
+	// The ring of a thread, registered with FTraceProfiler once the thread records its first event.
+	class FTraceThread : public TTlsSingleton<FTraceThread, 3>
+	{
+	public:
+		FORCEINLINE FTraceThread();
+		FORCEINLINE virtual ~FTraceThread() override;
+
+		// After the task of the FThread, the end of a frame of this thread.
+		FORCEINLINE virtual void Tick() override;
+
+		FORCEINLINE FTraceEventRing* GetRing();
+
+	private:
+		FTraceEventRing* Ring;
+	};
+
+	FTraceEventRing::FTraceEventRing(uint32 threadId, const string& threadName)
+		: ThreadId(threadId)
+		, ThreadName(threadName)
+		, Events(SCapacity)
+		, Head(0)
+		, Tail(0)
+		, NumDropped(0)
+	{
+	}
+
+	void FTraceEventRing::Push(ETraceEvent type, uint32 nameId)
+	{
+		const uint32 head = Head.load(memory_order_relaxed);
+		if (head - Tail.load(memory_order_acquire) >= SCapacity)
+		{
+			NumDropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+
+		FTraceEvent& e = Events[head & (SCapacity - 1)];
+		e.Stamp = FPerformanceCounter::GetTimeStamp();
+		e.NameId = nameId;
+		e.Type = type;
+		Head.store(head + 1, memory_order_release);
+	}
+
+	void FTraceEventRing::Drain(vector<FTraceEvent>& output)
+	{
+		const uint32 tail = Tail.load(memory_order_relaxed);
+		const uint32 head = Head.load(memory_order_acquire);
+		for (uint32 i = tail; i != head; ++i)
+		{
+			output.push_back(Events[i & (SCapacity - 1)]);
+		}
+
+		Tail.store(head, memory_order_release);
+	}
+
+	uint32 FTraceEventRing::GetThreadId() const
+	{
+		return ThreadId;
+	}
+
+	const string& FTraceEventRing::GetThreadName() const
+	{
+		return ThreadName;
+	}
+
+	uint32 FTraceEventRing::GetNumDropped() const
+	{
+		return NumDropped.load(memory_order_relaxed);
+	}
+
+	void FTraceProfiler::FCollectTask::Tick()
+	{
+		Profiler->Collect();
+		Profiler->WaitForCapture();
+	}
+
+	FTraceProfiler::FTraceProfiler()
+		: bRunning(false)
+		, Collector(nullptr)
+		, CollectTask(nullptr)
+		, NextThreadId(1)
+		, bCapturing(false)
+		, CaptureRing(nullptr)
+		, CaptureRequested(0)
+		, CaptureBegin(0)
+		, CaptureEnd(0)
+		, CaptureFramesLeft(0)
+	{
+		Names.push_back("Frame");
+		NameIds[Names.back()] = SFrameNameId;
+	}
+
+	FTraceProfiler::~FTraceProfiler()
+	{
+		Stop();
+
+		// The threads of the rings are gone.
+		for (auto& state : Rings)
+		{
+			SAFE_DELETE(state.Ring);
+		}
+
+		Rings.clear();
+	}
+
+	void FTraceProfiler::Tick()
+	{
+	}
+
+	void FTraceProfiler::Record(ETraceEvent type, uint32 nameId)
+	{
+		FProcessUnique* processUnique = FProcessUnique::Get();
+		if (processUnique != nullptr && processUnique->IsTracing())
+		{
+			FTraceThread::Get()->GetRing()->Push(type, nameId);
+		}
+	}
+
+	void FTraceProfiler::Start()
+	{
+		if (Collector != nullptr)
+		{
+			return;
+		}
+
+		bRunning = true;
+		CollectTask = new FCollectTask(this);
+		Collector = new FThread(CollectTask, "TraceCollector");
+	}
+
+	void FTraceProfiler::Stop()
+	{
+		if (Collector == nullptr)
+		{
+			return;
+		}
+
+		bRunning = false;
+		FProcessUnique::Get()->SetTracing(false);
+		Wake();
+		SAFE_DELETE(Collector);
+		SAFE_DELETE(CollectTask);
+
+		lock_guard<mutex> lck(RingsMutex);
+		bCapturing = false;
+		CaptureRing = nullptr;
+		Captured.clear();
+	}
+
+	bool FTraceProfiler::IsRunning() const
+	{
+		return bRunning.load(memory_order_relaxed);
+	}
+
+	uint32 FTraceProfiler::InternName(const string& name)
+	{
+		lock_guard<mutex> lck(NamesMutex);
+		auto it = NameIds.find(name);
+		if (it != NameIds.end())
+		{
+			return it->second;
+		}
+
+		const uint32 id = (uint32)Names.size();
+		Names.push_back(name);
+		NameIds[name] = id;
+		return id;
+	}
+
+	bool FTraceProfiler::Capture(uint32 numFrames, const string& path)
+	{
+		if (!IsRunning() || numFrames == 0)
+		{
+			return false;
+		}
+
+		// The calling thread's ring, frames are counted on it.
+		FTraceEventRing* ring = FTraceThread::Get()->GetRing();
+
+		{
+			lock_guard<mutex> lck(RingsMutex);
+			if (bCapturing)
+			{
+				return false;
+			}
+
+			CaptureRing = ring;
+			CaptureRequested = FPerformanceCounter::GetTimeStamp();
+			CaptureBegin = 0;
+			CaptureEnd = 0;
+			CaptureFramesLeft = numFrames;
+			CapturePath = path;
+			Captured.clear();
+			bCapturing = true;
+		}
+
+		FProcessUnique::Get()->SetTracing(true);
+		Wake();
+		return true;
+	}
+
+	bool FTraceProfiler::IsCapturing() const
+	{
+		return bCapturing.load();
+	}
+
+	FTraceEventRing* FTraceProfiler::AddRing()
+	{
+		const string name = FProcessUnique::Get()->GetCurrentThread()->GetName();
+
+		lock_guard<mutex> lck(RingsMutex);
+		FRingState state;
+		state.Ring = new FTraceEventRing(NextThreadId++, name);
+		Rings.push_back(state);
+		return state.Ring;
+	}
+
+	void FTraceProfiler::RemoveRing(FTraceEventRing* ring)
+	{
+		lock_guard<mutex> lck(RingsMutex);
+		for (auto it = Rings.begin(); it != Rings.end(); ++it)
+		{
+			if (it->Ring != ring)
+			{
+				continue;
+			}
+
+			ring->Drain(it->Pending);
+			ProcessPending(*it);
+
+			// Its thread ends before the frames asked for, the capture ends with it.
+			if (CaptureRing == ring)
+			{
+				CaptureRing = nullptr;
+				if (bCapturing && CaptureEnd == 0)
+				{
+					CaptureEnd = CaptureBegin != 0 ? FPerformanceCounter::GetTimeStamp() : CaptureRequested;
+					CaptureBegin = CaptureBegin != 0 ? CaptureBegin : CaptureRequested;
+				}
+			}
+
+			if (ring->GetNumDropped() > 0)
+			{
+				LVWARN("FTraceProfiler::RemoveRing", "%s dropped %d events.", ring->GetThreadName().c_str(), ring->GetNumDropped());
+			}
+
+			SAFE_DELETE(ring);
+			Rings.erase(it);
+			return;
+		}
+	}
+
+	void FTraceProfiler::Collect()
+	{
+		map<uint32, FCapturedThread> captured;
+		FTimeStamp begin = 0, end = 0;
+		string path;
+
+		{
+			lock_guard<mutex> lck(RingsMutex);
+
+			// A capture ended in the last pass, the events stamped before its end have all been drained since.
+			const bool bFinishing = bCapturing && CaptureEnd != 0;
+
+			for (auto& state : Rings)
+			{
+				state.Ring->Drain(state.Pending);
+			}
+
+			// The capture starts and ends with the frames of its ring, processed first.
+			for (auto& state : Rings)
+			{
+				if (state.Ring == CaptureRing)
+				{
+					ProcessPending(state);
+				}
+			}
+
+			for (auto& state : Rings)
+			{
+				ProcessPending(state);
+			}
+
+			if (bFinishing)
+			{
+				FinishCapture(captured, begin, end, path);
+			}
+		}
+
+		if (!path.empty())
+		{
+			WriteCapture(captured, begin, end, path);
+		}
+	}
+
+	void FTraceProfiler::WaitForCapture()
+	{
+		unique_lock<mutex> lck(WakeMutex);
+		if (bCapturing.load())
+		{
+			WakeCondition.wait_for(lck, chrono::milliseconds(SCollectMilliseconds));
+			return;
+		}
+
+		WakeCondition.wait(lck, [this]() { return bCapturing.load() || !IsRunning(); });
+	}
+
+	void FTraceProfiler::Wake()
+	{
+		{
+			lock_guard<mutex> lck(WakeMutex);
+		}
+
+		WakeCondition.notify_all();
+	}
+
+	void FTraceProfiler::ProcessPending(FRingState& state)
+	{
+		for (auto& e : state.Pending)
+		{
+			if (!bCapturing)
+			{
+				continue;
+			}
+
+			if (state.Ring == CaptureRing && e.Type == ETraceEvent::Frame && e.Stamp >= CaptureRequested && CaptureEnd == 0)
+			{
+				if (CaptureBegin == 0)
+				{
+					CaptureBegin = e.Stamp;
+				}
+				else if (--CaptureFramesLeft == 0)
+				{
+					CaptureEnd = e.Stamp;
+				}
+			}
+
+			if (CaptureBegin != 0 && e.Stamp >= CaptureBegin && (CaptureEnd == 0 || e.Stamp <= CaptureEnd))
+			{
+				FCapturedThread& thread = Captured[state.Ring->GetThreadId()];
+				if (thread.Name.empty())
+				{
+					thread.Name = state.Ring->GetThreadName();
+				}
+
+				thread.Events.push_back(e);
+			}
+		}
+
+		state.Pending.clear();
+	}
+
+	void FTraceProfiler::FinishCapture(map<uint32, FCapturedThread>& captured, FTimeStamp& begin, FTimeStamp& end, string& path)
+	{
+		captured.swap(Captured);
+		begin = CaptureBegin;
+		end = CaptureEnd;
+		path = CapturePath;
+
+		CaptureRing = nullptr;
+		CapturePath.clear();
+		bCapturing = false;
+		FProcessUnique::Get()->SetTracing(false);
+	}
+
+	void FTraceProfiler::WriteCapture(const map<uint32, FCapturedThread>& captured, FTimeStamp begin, FTimeStamp end, const string& path)
+	{
+		vector<string> names;
+		{
+			lock_guard<mutex> lck(NamesMutex);
+			names = Names;
+		}
+
+		ofstream file(path);
+		if (!file)
+		{
+			LVERR("FTraceProfiler::WriteCapture", "failed to open %s.", path.c_str());
+			return;
+		}
+
+		const double usPerTick = 1000000.0 / FPerformanceCounter::GetFreq();
+		auto getTs = [&](int64 stamp)
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%.3f", (double)(stamp - begin) * usPerTick);
+			return string(buf);
+		};
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"LostReality\"}}";
+
+		uint32 numEvents = 0;
+		for (auto& item : captured)
+		{
+			const uint32 tid = item.first;
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+				<< ",\"args\":{\"name\":\"" << Escape(item.second.Name) << "\"}}";
+
+			// Ends of scopes begun before the capture are left out, scopes still open are ended with it.
+			uint32 depth = 0;
+			for (auto& e : item.second.Events)
+			{
+				if (e.Type == ETraceEvent::End && depth == 0)
+				{
+					continue;
+				}
+
+				const char* ph = e.Type == ETraceEvent::Begin ? "B" : (e.Type == ETraceEvent::End ? "E" : "i");
+				file << ",\n{\"name\":\"" << Escape(names[e.NameId]) << "\",\"ph\":\"" << ph
+					<< "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << getTs(e.Stamp);
+				if (e.Type == ETraceEvent::Frame)
+				{
+					file << ",\"s\":\"t\"";
+				}
+
+				file << "}";
+				if (e.Type == ETraceEvent::Begin)
+				{
+					depth++;
+				}
+				else if (e.Type == ETraceEvent::End)
+				{
+					depth--;
+				}
+
+				numEvents++;
+			}
+
+			for (; depth > 0; --depth)
+			{
+				file << ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << getTs(end) << "}";
+			}
+		}
+
+		file << "\n]}\n";
+		LVMSG("FTraceProfiler::WriteCapture", "%d events of %d threads, %.2fms, %s.",
+			numEvents, captured.size(), FPerformanceCounter::ToSeconds(end - begin) * 1000.0, path.c_str());
+	}
+
+	string FTraceProfiler::Escape(const string& name)
+	{
+		string result;
+		result.reserve(name.size());
+		for (auto c : name)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result.push_back('\\');
+				result.push_back(c);
+			}
+			else if ((uint8)c < 0x20)
+			{
+				result.push_back(' ');
+			}
+			else
+			{
+				result.push_back(c);
+			}
+		}
+
+		return result;
+	}
+	FTraceThread::FTraceThread()
+		: Ring(nullptr)
+	{
+	}
+
+	FTraceThread::~FTraceThread()
+	{
+		if (Ring != nullptr)
+		{
+			FTraceProfiler::Get()->RemoveRing(Ring);
+			Ring = nullptr;
+		}
+	}
+
+	void FTraceThread::Tick()
+	{
+		if (Ring != nullptr && FProcessUnique::Get()->IsTracing())
+		{
+			Ring->Push(ETraceEvent::Frame, FTraceProfiler::SFrameNameId);
+		}
+	}
+
+	FTraceEventRing* FTraceThread::GetRing()
+	{
+		if (Ring == nullptr)
+		{
+			Ring = FTraceProfiler::Get()->AddRing();
+		}
+
+		return Ring;
+	}
+}
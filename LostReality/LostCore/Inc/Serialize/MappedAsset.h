@@ -0,0 +1,311 @@
+/*
+* file MappedAsset.h
+*
+* author luoxw
+* date 2018/03/16
+*
+* Chunked binary layout that can be used in place from a file mapping:
+* FMappedAssetHeader, then NumChunks x FMappedAssetChunk, then chunk data.
+* Every chunk starts at a SMappedAssetAlignment boundary and holds either a
+* POD array or an FBinaryIO stream (for trees and maps).
+* Bump MAPPED_ASSET_VERSION whenever a chunk layout changes, old files are
+* rejected and loaders fall back to the FBinaryIO formats.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	static const uint32 SMappedAssetAlignment = 16;
+
+	enum class EMappedAssetType : uint32
+	{
+		Mesh = 1,
+		AnimKeyFrame = 2,
+	};
+
+	struct FMappedAssetHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		EMappedAssetType Type;
+		uint32 NumChunks;
+		uint32 FileSize;
+		uint32 Reserved[3];
+	};
+
+	struct FMappedAssetChunk
+	{
+		uint32 Id;
+		uint32 Offset;
+		uint32 Size;
+		uint32 Count;
+	};
+
+	static_assert(sizeof(FMappedAssetHeader) % SMappedAssetAlignment == 0, "header breaks chunk alignment");
+	static_assert(sizeof(FMappedAssetChunk) % SMappedAssetAlignment == 0, "chunk table breaks chunk alignment");
+
+	class FMappedAssetWriter
+	{
+	public:
+		explicit FMappedAssetWriter(EMappedAssetType type);
+
+		void AddChunk(uint32 id, const void* data, uint32 elementSize, uint32 count);
+
+		template<typename T>
+		void AddChunk(uint32 id, const vector<T>& data);
+
+		void AddChunk(uint32 id, const string& data);
+
+		// Arbitrary serializable data, read back with FMappedAssetReader::ReadChunk.
+		template<typename T>
+		void AddStreamChunk(uint32 id, const T& data);
+
+		bool WriteToFile(const string& url) const;
+
+	private:
+		struct FPendingChunk
+		{
+			uint32 Id;
+			uint32 Count;
+			FBuf Data;
+		};
+
+		EMappedAssetType Type;
+		vector<FPendingChunk> Chunks;
+	};
+
+	class FMappedAssetReader
+	{
+	public:
+		FMappedAssetReader();
+
+		bool Open(const string& url, EMappedAssetType type);
+		void Close();
+		bool IsOpen() const;
+
+		const FMappedAssetChunk* FindChunk(uint32 id) const;
+
+		// Points into the mapping, valid until Close.
+		template<typename T>
+		TArrayView<T> GetChunk(uint32 id) const;
+
+		string GetString(uint32 id) const;
+
+		template<typename T>
+		bool ReadChunk(uint32 id, T& data) const;
+
+		uint32 GetFileSize() const;
+
+	private:
+		FMappedFile File;
+		TArrayView<FMappedAssetChunk> Chunks;
+	};
+
+	FORCEINLINE FMappedAssetWriter::FMappedAssetWriter(EMappedAssetType type)
+		: Type(type)
+	{
+	}
+
+	FORCEINLINE void FMappedAssetWriter::AddChunk(uint32 id, const void* data, uint32 elementSize, uint32 count)
+	{
+		Chunks.push_back(FPendingChunk());
+		auto& chunk = Chunks.back();
+		chunk.Id = id;
+		chunk.Count = count;
+		chunk.Data.resize(elementSize * count);
+		if (chunk.Data.size() > 0)
+		{
+			memcpy(chunk.Data.data(), data, chunk.Data.size());
+		}
+	}
+
+	template<typename T>
+	FORCEINLINE void FMappedAssetWriter::AddChunk(uint32 id, const vector<T>& data)
+	{
+		AddChunk(id, data.data(), sizeof(T), data.size());
+	}
+
+	FORCEINLINE void FMappedAssetWriter::AddChunk(uint32 id, const string& data)
+	{
+		AddChunk(id, data.data(), sizeof(char), data.size());
+	}
+
+	template<typename T>
+	FORCEINLINE void FMappedAssetWriter::AddStreamChunk(uint32 id, const T& data)
+	{
+		FBinaryIO stream;
+		stream << data;
+		AddChunk(id, stream.Data(), 1, stream.RemainingSize());
+	}
+
+	FORCEINLINE bool FMappedAssetWriter::WriteToFile(const string& url) const
+	{
+		uint32 offset = sizeof(FMappedAssetHeader) + sizeof(FMappedAssetChunk) * Chunks.size();
+		vector<FMappedAssetChunk> table;
+		for (const auto& chunk : Chunks)
+		{
+			FMappedAssetChunk entry;
+			entry.Id = chunk.Id;
+			entry.Offset = offset;
+			entry.Size = chunk.Data.size();
+			entry.Count = chunk.Count;
+			table.push_back(entry);
+
+			offset = GetAlignedSize(offset + entry.Size, SMappedAssetAlignment);
+		}
+
+		FMappedAssetHeader header;
+		memset(&header, 0, sizeof(header));
+		header.Magic = MAGIC_MAPPED_ASSET;
+		header.Version = MAPPED_ASSET_VERSION;
+		header.Type = Type;
+		header.NumChunks = Chunks.size();
+		header.FileSize = offset;
+
+		FBinaryIO stream(offset);
+		memcpy(stream.Reserve(sizeof(header)), &header, sizeof(header));
+		if (table.size() > 0)
+		{
+			memcpy(stream.Reserve(sizeof(FMappedAssetChunk) * table.size()), table.data(), sizeof(FMappedAssetChunk) * table.size());
+		}
+
+		for (uint32 i = 0; i < Chunks.size(); ++i)
+		{
+			const auto& data = Chunks[i].Data;
+			uint32 paddedSize = GetAlignedSize(table[i].Offset + table[i].Size, SMappedAssetAlignment) - table[i].Offset;
+			uint8* dst = (uint8*)stream.Reserve(paddedSize);
+			memset(dst, 0, paddedSize);
+			if (data.size() > 0)
+			{
+				memcpy(dst, data.data(), data.size());
+			}
+		}
+
+		assert(stream.RemainingSize() == offset);
+		stream.WriteToFile(url);
+		return true;
+	}
+
+	FORCEINLINE FMappedAssetReader::FMappedAssetReader()
+	{
+	}
+
+	FORCEINLINE bool FMappedAssetReader::Open(const string& url, EMappedAssetType type)
+	{
+		const char* head = "FMappedAssetReader::Open";
+
+		Close();
+		if (!File.Open(url))
+		{
+			return false;
+		}
+
+		auto data = File.GetData();
+		auto size = File.GetSize();
+		auto header = (const FMappedAssetHeader*)data;
+		if (size < sizeof(FMappedAssetHeader) || header->Magic != MAGIC_MAPPED_ASSET)
+		{
+			LVERR(head, "not a mapped asset: %s", url.c_str());
+			Close();
+			return false;
+		}
+
+		if (header->Version != MAPPED_ASSET_VERSION || header->Type != type)
+		{
+			LVWARN(head, "version/type mismatch [%d, %d], expected [%d, %d]: %s",
+				header->Version, (uint32)header->Type, MAPPED_ASSET_VERSION, (uint32)type, url.c_str());
+			Close();
+			return false;
+		}
+
+		// Checked by division and subtraction, a forged NumChunks, Offset or Size must not wrap a uint32 past the size.
+		if (header->FileSize != size || header->NumChunks > (size - sizeof(FMappedAssetHeader)) / sizeof(FMappedAssetChunk))
+		{
+			LVERR(head, "truncated file: %s", url.c_str());
+			Close();
+			return false;
+		}
+
+		uint32 tableEnd = sizeof(FMappedAssetHeader) + sizeof(FMappedAssetChunk) * header->NumChunks;
+		Chunks = TArrayView<FMappedAssetChunk>((const FMappedAssetChunk*)(data + sizeof(FMappedAssetHeader)), header->NumChunks);
+		for (const auto& chunk : Chunks)
+		{
+			if (chunk.Offset < tableEnd || chunk.Offset > size || chunk.Size > size - chunk.Offset || (chunk.Offset % SMappedAssetAlignment) != 0)
+			{
+				LVERR(head, "corrupt chunk[%d]: %s", chunk.Id, url.c_str());
+				Close();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	FORCEINLINE void FMappedAssetReader::Close()
+	{
+		Chunks = TArrayView<FMappedAssetChunk>();
+		File.Close();
+	}
+
+	FORCEINLINE bool FMappedAssetReader::IsOpen() const
+	{
+		return File.IsOpen();
+	}
+
+	FORCEINLINE const FMappedAssetChunk* FMappedAssetReader::FindChunk(uint32 id) const
+	{
+		for (const auto& chunk : Chunks)
+		{
+			if (chunk.Id == id)
+			{
+				return &chunk;
+			}
+		}
+
+		return nullptr;
+	}
+
+	template<typename T>
+	FORCEINLINE TArrayView<T> FMappedAssetReader::GetChunk(uint32 id) const
+	{
+		auto chunk = FindChunk(id);
+		if (chunk == nullptr || chunk->Count == 0)
+		{
+			return TArrayView<T>();
+		}
+
+		if (chunk->Size % sizeof(T) != 0 || chunk->Size / sizeof(T) != chunk->Count)
+		{
+			LVERR("FMappedAssetReader::GetChunk", "chunk[%d] is not %d elements of %d bytes", id, chunk->Count, (uint32)sizeof(T));
+			return TArrayView<T>();
+		}
+
+		return TArrayView<T>((const T*)(File.GetData() + chunk->Offset), chunk->Count);
+	}
+
+	FORCEINLINE string FMappedAssetReader::GetString(uint32 id) const
+	{
+		auto chars = GetChunk<char>(id);
+		return string(chars.begin(), chars.end());
+	}
+
+	template<typename T>
+	FORCEINLINE bool FMappedAssetReader::ReadChunk(uint32 id, T& data) const
+	{
+		auto chunk = FindChunk(id);
+		if (chunk == nullptr || chunk->Size == 0)
+		{
+			return false;
+		}
+
+		FBinaryIO stream((uint8*)(File.GetData() + chunk->Offset), chunk->Size);
+		stream >> data;
+		return true;
+	}
+
+	FORCEINLINE uint32 FMappedAssetReader::GetFileSize() const
+	{
+		return File.GetSize();
+	}
+}
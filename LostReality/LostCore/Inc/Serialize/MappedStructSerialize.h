@@ -0,0 +1,462 @@
+/*
+* file MappedStructSerialize.h
+*
+* author luoxw
+* date 2018/03/16
+*
+* Mapped (FMappedAsset) layouts of FMeshData and FAnimKeyFrameData.
+* .ivm keeps the prebuilt GPU buffers, so loading needs neither the per-element
+* FBinaryIO pass nor BuildGPUData, it keeps the FTriangleBVH for precise ray tests too.
+* .animkm keeps key times and values as flat arrays that TBakedCurve can use in place.
+*/
+
+#pragma once
+
+namespace LostCore
+{
+	// Mapped file next to a FBinaryIO asset, "a\b.iv" -> "a\b.ivm".
+	FORCEINLINE string GetMappedAssetUrl(const string& url, const char* mappedExt)
+	{
+		auto lastDot = url.rfind('.');
+		auto lastSlash = url.rfind('\\');
+		if (lastDot == string::npos || (lastSlash != string::npos && lastDot < lastSlash))
+		{
+			return url + "." + mappedExt;
+		}
+
+		return url.substr(0, lastDot + 1) + mappedExt;
+	}
+
+	enum class EMappedMeshChunk : uint32
+	{
+		Info = 1,
+		Name,
+		TexCoordName,
+		Coordinates,
+		TexCoords,
+		Normals,
+		Tangents,
+		Binormals,
+		VertexColors,
+		BlendWeights,
+		BlendIndices,
+		Triangles,
+		Skeleton,
+		SkeletonIndexMap,
+		VertexPolygonMap,
+		PoseT,
+		GPUVertices,
+		GPUIndices,
+		TriangleBVHNodes,
+		TriangleBVHPackets,
+	};
+
+	struct FMappedMeshInfo
+	{
+		uint32 IndexCount;
+		uint32 VertexCount;
+		uint32 VertexFlags;
+		uint32 IndexStride;
+	};
+
+	class FMappedMeshData
+	{
+	public:
+		// Builds the GPU buffers if data has none yet.
+		static string Save(FMeshData& data, const string& outputDir);
+
+		FMappedMeshData();
+
+		bool Open(const string& url);
+		void Close();
+
+		const FMappedMeshInfo& GetInfo() const;
+		const FMappedAssetReader& GetReader() const;
+
+		template<typename T>
+		TArrayView<T> GetChunk(EMappedMeshChunk chunk) const;
+
+		TArrayView<uint8> GetVertices() const;
+		TArrayView<uint8> GetIndices() const;
+
+		// Fills everything but the GPU buffers, one copy per attribute array.
+		void Extract(FMeshData& data) const;
+
+		// False for files saved before the bvh was kept, the caller builds it then.
+		bool GetTriangleBVH(FTriangleBVH& bvh) const;
+
+	private:
+		FMappedAssetReader Reader;
+		FMappedMeshInfo Info;
+	};
+
+	enum class EMappedAnimChunk : uint32
+	{
+		Info = 1,
+		Name,
+		Bones,
+		BoneNames,
+		Times,
+		Values,
+	};
+
+	struct FMappedAnimInfo
+	{
+		float SampleRate;
+		float Length;
+		int32 NumKeys;
+		uint32 NumBones;
+	};
+
+	struct FMappedAnimBone
+	{
+		uint32 NameOffset;
+		uint32 NameLength;
+		uint32 FirstKey;
+		uint32 NumKeys;
+		uint32 WrapMode;
+		uint32 InterpolationMode;
+		uint32 Reserved[2];
+	};
+
+	class FMappedAnimKeyFrameData
+	{
+	public:
+		static string Save(const FAnimKeyFrameData& data, const string& outputDir);
+
+		FMappedAnimKeyFrameData();
+
+		bool Open(const string& url);
+		void Close();
+
+		const FMappedAnimInfo& GetInfo() const;
+		string GetName() const;
+
+		uint32 GetNumBones() const;
+		string GetBoneName(uint32 index) const;
+		TArrayView<float> GetTimes(uint32 index) const;
+		TArrayView<FFloat4x4> GetValues(uint32 index) const;
+
+		// Curves of data borrow the mapped keys, this object must outlive data.
+		void Attach(FBakedAnimKeyFrameData& data) const;
+
+	private:
+		FMappedAssetReader Reader;
+		FMappedAnimInfo Info;
+		TArrayView<FMappedAnimBone> Bones;
+		TArrayView<char> BoneNames;
+		TArrayView<float> Times;
+		TArrayView<FFloat4x4> Values;
+	};
+
+	template<typename T>
+	FORCEINLINE TArrayView<T> FMappedMeshData::GetChunk(EMappedMeshChunk chunk) const
+	{
+		return Reader.GetChunk<T>((uint32)chunk);
+	}
+}
+
+FORCEINLINE string LostCore::FMappedMeshData::Save(FMeshData& data, const string& outputDir)
+{
+	if (outputDir.empty())
+	{
+		return "";
+	}
+
+	string outputFile = outputDir;
+	LostCore::ReplaceChar(outputFile, "/", "\\");
+	if (LostCore::IsDirectory(outputFile))
+	{
+		outputFile += data.Name + "." + K_PRIMITIVE_MAPPED_EXT;
+	}
+
+	if (data.Vertices.empty())
+	{
+		data.BuildGPUData(0, FMeshData::EGPUDataLayout::IndexedCacheOptimized);
+	}
+
+	FMappedMeshInfo info;
+	info.IndexCount = data.IndexCount;
+	info.VertexCount = data.VertexCount;
+	info.VertexFlags = data.VertexFlags;
+	info.IndexStride = data.IndexStride;
+
+	FMappedAssetWriter writer(EMappedAssetType::Mesh);
+	writer.AddChunk((uint32)EMappedMeshChunk::Info, &info, sizeof(info), 1);
+	writer.AddChunk((uint32)EMappedMeshChunk::Name, data.Name);
+	writer.AddChunk((uint32)EMappedMeshChunk::TexCoordName, data.TexCoordName);
+	writer.AddChunk((uint32)EMappedMeshChunk::Coordinates, data.Coordinates);
+	writer.AddChunk((uint32)EMappedMeshChunk::TexCoords, data.TexCoords);
+	writer.AddChunk((uint32)EMappedMeshChunk::Normals, data.Normals);
+	writer.AddChunk((uint32)EMappedMeshChunk::Tangents, data.Tangents);
+	writer.AddChunk((uint32)EMappedMeshChunk::Binormals, data.Binormals);
+	writer.AddChunk((uint32)EMappedMeshChunk::VertexColors, data.VertexColors);
+	writer.AddChunk((uint32)EMappedMeshChunk::BlendWeights, data.BlendWeights);
+	writer.AddChunk((uint32)EMappedMeshChunk::BlendIndices, data.BlendIndices);
+	writer.AddChunk((uint32)EMappedMeshChunk::Triangles, data.Triangles);
+	writer.AddStreamChunk((uint32)EMappedMeshChunk::Skeleton, data.Skeleton);
+	writer.AddStreamChunk((uint32)EMappedMeshChunk::SkeletonIndexMap, data.SkeletonIndexMap);
+	writer.AddStreamChunk((uint32)EMappedMeshChunk::VertexPolygonMap, data.VertexPolygonMap);
+	writer.AddStreamChunk((uint32)EMappedMeshChunk::PoseT, data.PoseT);
+	writer.AddChunk((uint32)EMappedMeshChunk::GPUVertices, data.Vertices);
+	writer.AddChunk((uint32)EMappedMeshChunk::GPUIndices, data.Indices);
+
+	FTriangleBVH bvh;
+	data.BuildTriangleBVH(bvh);
+	writer.AddChunk((uint32)EMappedMeshChunk::TriangleBVHNodes, bvh.GetNodes());
+	writer.AddChunk((uint32)EMappedMeshChunk::TriangleBVHPackets, bvh.GetPackets());
+	writer.WriteToFile(outputFile);
+
+	LVMSG("FMappedMeshData::Save", "Mesh[%s, %s] is saved[%s]", data.Name.c_str(),
+		GetVertexDetails(data.VertexFlags).Name.c_str(), outputFile.c_str());
+
+	return outputFile;
+}
+
+FORCEINLINE LostCore::FMappedMeshData::FMappedMeshData()
+{
+	memset(&Info, 0, sizeof(Info));
+}
+
+FORCEINLINE bool LostCore::FMappedMeshData::Open(const string& url)
+{
+	if (!Reader.Open(url, EMappedAssetType::Mesh))
+	{
+		return false;
+	}
+
+	auto info = Reader.GetChunk<FMappedMeshInfo>((uint32)EMappedMeshChunk::Info);
+	if (info.Num() != 1)
+	{
+		LVERR("FMappedMeshData::Open", "missing mesh info: %s", url.c_str());
+		Close();
+		return false;
+	}
+
+	Info = info.Front();
+	return true;
+}
+
+FORCEINLINE void LostCore::FMappedMeshData::Close()
+{
+	Reader.Close();
+	memset(&Info, 0, sizeof(Info));
+}
+
+FORCEINLINE const LostCore::FMappedMeshInfo& LostCore::FMappedMeshData::GetInfo() const
+{
+	return Info;
+}
+
+FORCEINLINE const LostCore::FMappedAssetReader& LostCore::FMappedMeshData::GetReader() const
+{
+	return Reader;
+}
+
+FORCEINLINE LostCore::TArrayView<uint8> LostCore::FMappedMeshData::GetVertices() const
+{
+	return GetChunk<uint8>(EMappedMeshChunk::GPUVertices);
+}
+
+FORCEINLINE LostCore::TArrayView<uint8> LostCore::FMappedMeshData::GetIndices() const
+{
+	return GetChunk<uint8>(EMappedMeshChunk::GPUIndices);
+}
+
+FORCEINLINE void LostCore::FMappedMeshData::Extract(FMeshData& data) const
+{
+	assert(Reader.IsOpen());
+
+	data.Name = Reader.GetString((uint32)EMappedMeshChunk::Name);
+	data.TexCoordName = Reader.GetString((uint32)EMappedMeshChunk::TexCoordName);
+	data.IndexCount = Info.IndexCount;
+	data.VertexCount = Info.VertexCount;
+	data.VertexFlags = Info.VertexFlags | VERTEX_COORDINATE3D;
+	data.IndexStride = Info.IndexStride;
+
+	data.Coordinates = GetChunk<FFloat3>(EMappedMeshChunk::Coordinates).ToVector();
+	data.TexCoords = GetChunk<FFloat2>(EMappedMeshChunk::TexCoords).ToVector();
+	data.Normals = GetChunk<FFloat3>(EMappedMeshChunk::Normals).ToVector();
+	data.Tangents = GetChunk<FFloat3>(EMappedMeshChunk::Tangents).ToVector();
+	data.Binormals = GetChunk<FFloat3>(EMappedMeshChunk::Binormals).ToVector();
+	data.VertexColors = GetChunk<FColor128>(EMappedMeshChunk::VertexColors).ToVector();
+	data.BlendWeights = GetChunk<FFloat4>(EMappedMeshChunk::BlendWeights).ToVector();
+	data.BlendIndices = GetChunk<FSInt4>(EMappedMeshChunk::BlendIndices).ToVector();
+	data.Triangles = GetChunk<FMeshData::FTriangle>(EMappedMeshChunk::Triangles).ToVector();
+
+	Reader.ReadChunk((uint32)EMappedMeshChunk::Skeleton, data.Skeleton);
+	Reader.ReadChunk((uint32)EMappedMeshChunk::SkeletonIndexMap, data.SkeletonIndexMap);
+	Reader.ReadChunk((uint32)EMappedMeshChunk::VertexPolygonMap, data.VertexPolygonMap);
+	Reader.ReadChunk((uint32)EMappedMeshChunk::PoseT, data.PoseT);
+	data.VertexMagic = MAGIC_VERTEX;
+
+	LVMSG("FMappedMeshData::Extract", "Mesh[%s, %.1fKB, %s] is mapped", data.Name.c_str(),
+		Reader.GetFileSize() / 1024.f, GetVertexDetails(data.VertexFlags).Name.c_str());
+}
+
+FORCEINLINE bool LostCore::FMappedMeshData::GetTriangleBVH(FTriangleBVH& bvh) const
+{
+	return bvh.Assign(GetChunk<FTriangleBVHNode>(EMappedMeshChunk::TriangleBVHNodes),
+		GetChunk<FTrianglePacket>(EMappedMeshChunk::TriangleBVHPackets));
+}
+
+FORCEINLINE string LostCore::FMappedAnimKeyFrameData::Save(const FAnimKeyFrameData& data, const string& outputDir)
+{
+	if (outputDir.empty())
+	{
+		return "";
+	}
+
+	string outputFile = outputDir;
+	LostCore::ReplaceChar(outputFile, "/", "\\");
+	if (LostCore::IsDirectory(outputFile))
+	{
+		outputFile += data.Name + "." + K_ANIM_EXT_KEYFRAME_MAPPED;
+	}
+
+	FMappedAnimInfo info;
+	info.SampleRate = data.SampleRate;
+	info.Length = data.Length;
+	info.NumKeys = data.NumKeys;
+	info.NumBones = data.KeyFrameMap.size();
+
+	vector<FMappedAnimBone> bones;
+	string boneNames;
+	vector<float> times;
+	vector<FFloat4x4> values;
+	for (const auto& keyFrame : data.KeyFrameMap)
+	{
+		const auto& curve = keyFrame.second;
+
+		FMappedAnimBone bone;
+		memset(&bone, 0, sizeof(bone));
+		bone.NameOffset = boneNames.size();
+		bone.NameLength = keyFrame.first.size();
+		bone.FirstKey = times.size();
+		bone.NumKeys = curve.GetNumKeys();
+		bone.WrapMode = (uint32)curve.GetWrapMode();
+		bone.InterpolationMode = (uint32)curve.GetInterpolationMode();
+		bones.push_back(bone);
+
+		boneNames += keyFrame.first;
+		for (const auto& key : curve.GetKeys())
+		{
+			times.push_back(key.first);
+			values.push_back(key.second);
+		}
+	}
+
+	FMappedAssetWriter writer(EMappedAssetType::AnimKeyFrame);
+	writer.AddChunk((uint32)EMappedAnimChunk::Info, &info, sizeof(info), 1);
+	writer.AddChunk((uint32)EMappedAnimChunk::Name, data.Name);
+	writer.AddChunk((uint32)EMappedAnimChunk::Bones, bones);
+	writer.AddChunk((uint32)EMappedAnimChunk::BoneNames, boneNames);
+	writer.AddChunk((uint32)EMappedAnimChunk::Times, times);
+	writer.AddChunk((uint32)EMappedAnimChunk::Values, values);
+	writer.WriteToFile(outputFile);
+
+	LVMSG("FMappedAnimKeyFrameData::Save", "Animation is saved: %s, %d bones, %d keys, %s",
+		data.Name.c_str(), info.NumBones, times.size(), outputFile.c_str());
+
+	return outputFile;
+}
+
+FORCEINLINE LostCore::FMappedAnimKeyFrameData::FMappedAnimKeyFrameData()
+{
+	memset(&Info, 0, sizeof(Info));
+}
+
+FORCEINLINE bool LostCore::FMappedAnimKeyFrameData::Open(const string& url)
+{
+	const char* head = "FMappedAnimKeyFrameData::Open";
+	if (!Reader.Open(url, EMappedAssetType::AnimKeyFrame))
+	{
+		return false;
+	}
+
+	auto info = Reader.GetChunk<FMappedAnimInfo>((uint32)EMappedAnimChunk::Info);
+	Bones = Reader.GetChunk<FMappedAnimBone>((uint32)EMappedAnimChunk::Bones);
+	BoneNames = Reader.GetChunk<char>((uint32)EMappedAnimChunk::BoneNames);
+	Times = Reader.GetChunk<float>((uint32)EMappedAnimChunk::Times);
+	Values = Reader.GetChunk<FFloat4x4>((uint32)EMappedAnimChunk::Values);
+	if (info.Num() != 1 || Bones.Num() != info.Front().NumBones || Times.Num() != Values.Num())
+	{
+		LVERR(head, "corrupt animation: %s", url.c_str());
+		Close();
+		return false;
+	}
+
+	for (const auto& bone : Bones)
+	{
+		if (bone.NameOffset + bone.NameLength > BoneNames.Num() || bone.FirstKey + bone.NumKeys > Times.Num())
+		{
+			LVERR(head, "corrupt bone table: %s", url.c_str());
+			Close();
+			return false;
+		}
+	}
+
+	Info = info.Front();
+	return true;
+}
+
+FORCEINLINE void LostCore::FMappedAnimKeyFrameData::Close()
+{
+	Reader.Close();
+	memset(&Info, 0, sizeof(Info));
+	Bones = TArrayView<FMappedAnimBone>();
+	BoneNames = TArrayView<char>();
+	Times = TArrayView<float>();
+	Values = TArrayView<FFloat4x4>();
+}
+
+FORCEINLINE const LostCore::FMappedAnimInfo& LostCore::FMappedAnimKeyFrameData::GetInfo() const
+{
+	return Info;
+}
+
+FORCEINLINE string LostCore::FMappedAnimKeyFrameData::GetName() const
+{
+	return Reader.GetString((uint32)EMappedAnimChunk::Name);
+}
+
+FORCEINLINE uint32 LostCore::FMappedAnimKeyFrameData::GetNumBones() const
+{
+	return Bones.Num();
+}
+
+FORCEINLINE string LostCore::FMappedAnimKeyFrameData::GetBoneName(uint32 index) const
+{
+	const auto& bone = Bones[index];
+	return string(BoneNames.Data() + bone.NameOffset, bone.NameLength);
+}
+
+FORCEINLINE LostCore::TArrayView<float> LostCore::FMappedAnimKeyFrameData::GetTimes(uint32 index) const
+{
+	const auto& bone = Bones[index];
+	return TArrayView<float>(Times.Data() + bone.FirstKey, bone.NumKeys);
+}
+
+FORCEINLINE LostCore::TArrayView<LostCore::FFloat4x4> LostCore::FMappedAnimKeyFrameData::GetValues(uint32 index) const
+{
+	const auto& bone = Bones[index];
+	return TArrayView<FFloat4x4>(Values.Data() + bone.FirstKey, bone.NumKeys);
+}
+
+FORCEINLINE void LostCore::FMappedAnimKeyFrameData::Attach(FBakedAnimKeyFrameData& data) const
+{
+	assert(Reader.IsOpen());
+
+	data.Name = GetName();
+	data.SampleRate = Info.SampleRate;
+	data.Length = Info.Length;
+	data.NumKeys = Info.NumKeys;
+
+	data.KeyFrameMap.clear();
+	for (uint32 i = 0; i < Bones.Num(); ++i)
+	{
+		data.KeyFrameMap[GetBoneName(i)].Attach(GetTimes(i), GetValues(i),
+			(FBakedMatrixCurve::EWrap)Bones[i].WrapMode,
+			(FBakedMatrixCurve::EInterpolation)Bones[i].InterpolationMode);
+	}
+}
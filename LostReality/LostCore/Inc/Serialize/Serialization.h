@@ -305,7 +305,8 @@ namespace LostCore
 	template<typename T1, typename T2>
 	FORCEINLINE FBinaryIO& operator<<(FBinaryIO& stream, const std::map<T1, T2>& data)
 	{
-		stream << data.size();
+		uint32 sz = data.size();
+		stream << sz;
 		for (auto& it = data.begin(); it != data.end(); ++it)
 		{
 			stream << it->first << it->second;
@@ -219,6 +219,7 @@ namespace LostCore
 		// л
 		vector<uint8> Indices;
 		vector<uint8> Vertices;
+		uint32 IndexStride;
 
 		FMeshData();
 
@@ -229,8 +230,22 @@ namespace LostCore
 		string Save(const string& outputDir) const;
 		void Load(const string& inputDir);
 
-		// ʱû壬ֻת
-		void BuildGPUData(uint32 flags);
+		enum class EGPUDataLayout : uint8
+		{
+			// One vertex per triangle corner, no index buffer.
+			Expanded,
+
+			// Identical expanded vertices are shared, Indices is 16 or 32 bits per IndexStride.
+			Indexed,
+
+			// Indexed, triangles reordered for the post-transform vertex cache.
+			IndexedCacheOptimized,
+		};
+
+		void BuildGPUData(uint32 flags, EGPUDataLayout layout);
+
+		// Triangles of Coordinates for precise ray tests, in mesh space.
+		void BuildTriangleBVH(FTriangleBVH& bvh) const;
 	};
 
 	FORCEINLINE FBinaryIO& operator<<(FBinaryIO& stream, const FMeshData& data)
@@ -329,6 +344,129 @@ namespace LostCore
 		stream >> data.Name >> data.SampleRate >> data.Length >> data.NumKeys >> data.KeyFrameMap;
 		return stream;
 	}
+
+	// Transform channels of FAnimCurveData, in the order they compose a bone matrix.
+	enum class EAnimChannel : uint8
+	{
+		RotateX,
+		RotateY,
+		RotateZ,
+		TranslateX,
+		TranslateY,
+		TranslateZ,
+		ScaleX,
+		ScaleY,
+		ScaleZ,
+		Num,
+	};
+
+	FORCEINLINE int32 GetAnimChannel(const string& componentName)
+	{
+		static const char* SNames[] =
+		{
+			K_ROTATE_X, K_ROTATE_Y, K_ROTATE_Z,
+			K_TRANSLATE_X, K_TRANSLATE_Y, K_TRANSLATE_Z,
+			K_SCALE_X, K_SCALE_Y, K_SCALE_Z,
+		};
+
+		for (int32 i = 0; i < (int32)EAnimChannel::Num; ++i)
+		{
+			if (componentName.compare(SNames[i]) == 0)
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	// Runtime form of FAnimCurveData, channels are addressed by EAnimChannel
+	// instead of component names, and curves are baked for random access.
+	struct FBakedAnimCurveData
+	{
+		struct FChannels
+		{
+			array<FBakedRealCurve, (uint32)EAnimChannel::Num> Curves;
+			uint32 Mask;
+
+			FChannels() : Mask(0) {}
+
+			bool HasChannel(EAnimChannel channel) const
+			{
+				return (Mask & (1 << (uint32)channel)) != 0;
+			}
+		};
+
+		string Name;
+		float SampleRate;
+		float Length;
+		int32 NumKeys;
+
+		// <SkeletonName, Channels> map.
+		map<string, FChannels> ChannelMap;
+
+		FBakedAnimCurveData();
+		explicit FBakedAnimCurveData(const FAnimCurveData& data);
+
+		void Bake(const FAnimCurveData& data);
+	};
+
+	// Reads the FAnimCurveData stream directly, without building the key sets.
+	FORCEINLINE FBinaryIO& operator >> (FBinaryIO& stream, FBakedAnimCurveData& data)
+	{
+		stream >> data.Name >> data.SampleRate >> data.Length >> data.NumKeys;
+
+		data.ChannelMap.clear();
+
+		uint32 numSkeletons;
+		stream >> numSkeletons;
+		for (uint32 i = 0; i < numSkeletons; ++i)
+		{
+			string skeletonName;
+			uint32 numComponents;
+			stream >> skeletonName >> numComponents;
+
+			auto& channels = data.ChannelMap[skeletonName];
+			for (uint32 j = 0; j < numComponents; ++j)
+			{
+				string componentName;
+				FBakedRealCurve curve;
+				stream >> componentName >> curve;
+
+				auto channel = GetAnimChannel(componentName);
+				if (channel >= 0)
+				{
+					channels.Curves[channel] = curve;
+					channels.Mask |= 1 << channel;
+				}
+			}
+		}
+
+		return stream;
+	}
+
+	struct FBakedAnimKeyFrameData
+	{
+		string Name;
+		float SampleRate;
+		float Length;
+		int32 NumKeys;
+
+		map<string, FBakedMatrixCurve> KeyFrameMap;
+
+		FBakedAnimKeyFrameData();
+		explicit FBakedAnimKeyFrameData(const FAnimKeyFrameData& data);
+
+		void Bake(const FAnimKeyFrameData& data);
+	};
+
+	// Reads the FAnimKeyFrameData stream directly.
+	FORCEINLINE FBinaryIO& operator >> (FBinaryIO& stream, FBakedAnimKeyFrameData& data)
+	{
+		data.KeyFrameMap.clear();
+		stream >> data.Name >> data.SampleRate >> data.Length >> data.NumKeys >> data.KeyFrameMap;
+		return stream;
+	}
 }
 
 FORCEINLINE LostCore::FMeshData::FMeshData()
@@ -337,6 +475,7 @@ FORCEINLINE LostCore::FMeshData::FMeshData()
 	, VertexCount(0)
 	, VertexFlags(0)
 	, VertexMagic(0)
+	, IndexStride(0)
 {
 	Coordinates.clear();
 	TexCoords.clear();
@@ -427,86 +566,175 @@ FORCEINLINE void LostCore::FMeshData::Load(const string & inputFile)
 		sz / 1024.f, GetVertexDetails(VertexFlags).Name.c_str(), inputFile.c_str());
 }
 
-// ʱû壬ֻ춥
-FORCEINLINE void LostCore::FMeshData::BuildGPUData(uint32 flags = 0)
+FORCEINLINE void LostCore::FMeshData::BuildGPUData(uint32 flags = 0, EGPUDataLayout layout = EGPUDataLayout::Expanded)
 {
-	uint32 buildFlags = flags;
+	const char* head = "FMeshData::BuildGPUData";
 	if (flags == 0)
 	{
 		flags = VertexFlags;
 	}
 	else if ((flags & ~VertexFlags) != 0)
 	{
-		LVWARN("FMeshData::BuildGPUData", "Invalid override flags[%s], original flags[%s]",
+		LVWARN(head, "Invalid override flags[%s], original flags[%s]",
 			GetVertexDetails(flags).Name.c_str(), GetVertexDetails(VertexFlags).Name.c_str());
 
 		flags = VertexFlags;
 	}
 
-	// splitΪգԿǹ
 	bool splitUV = TexCoords.size() == 0;
 	bool splitNormal = Normals.size() == 0;
 	bool splitVertexColor = VertexColors.size() == 0;
 
-	Vertices.clear();
-	FBinaryIO stream;
-	vector<uint8> padding;
-	uint32 paddingSz = GetPaddingSize(GetVertexDetails(flags).Stride, 16);
-	padding.resize(paddingSz);
-	for (const auto& tri : Triangles)
+	// Attributes are written straight into the vertex, padded up to a 16 bytes stride.
+	const uint32 stride = GetAlignedSize(GetVertexDetails(flags).Stride, 16);
+	auto writeVertex = [&](uint8* dst, const FVertex& vert)
 	{
-		for (const auto& vert : tri.Vertices)
+		auto write = [&dst](const void* src, uint32 sz)
+		{
+			memcpy(dst, src, sz);
+			dst += sz;
+		};
+
+		write(&Coordinates[vert.Index], sizeof(FFloat3));
+
+		if (HAS_FLAGS(VERTEX_TEXCOORD0, flags))
+		{
+			write(splitUV ? &vert.TexCoord : &TexCoords[vert.Index], sizeof(FFloat2));
+		}
+
+		if (HAS_FLAGS(VERTEX_NORMAL, flags))
+		{
+			write(splitNormal ? &vert.Normal : &Normals[vert.Index], sizeof(FFloat3));
+		}
+
+		if (HAS_FLAGS(VERTEX_TANGENT, flags))
 		{
-			stream << Coordinates[vert.Index];
+			write(splitNormal ? &vert.Tangent : &Tangents[vert.Index], sizeof(FFloat3));
+			write(splitNormal ? &vert.Binormal : &Binormals[vert.Index], sizeof(FFloat3));
+		}
 
-			if (HAS_FLAGS(VERTEX_TEXCOORD0, flags))
+		if (HAS_FLAGS(VERTEX_COLOR, flags))
+		{
+			if (splitVertexColor)
 			{
-				stream << (splitUV ? vert.TexCoord : TexCoords[vert.Index]);
+				write(&vert.Color, sizeof(vert.Color));
 			}
-
-			if (HAS_FLAGS(VERTEX_NORMAL, flags))
+			else
 			{
-				stream << (splitNormal ? vert.Normal : Normals[vert.Index]);
+				write(&VertexColors[vert.Index], sizeof(VertexColors[vert.Index]));
 			}
+		}
+
+		if (HAS_FLAGS(VERTEX_SKIN, flags))
+		{
+			write(&BlendWeights[vert.Index], sizeof(FFloat4));
+			write(&BlendIndices[vert.Index], sizeof(FSInt4));
+		}
+	};
+
+	const uint32 numCorners = Triangles.size() * 3;
+	Vertices.clear();
+	Indices.clear();
+	IndexStride = 0;
 
-			if (HAS_FLAGS(VERTEX_TANGENT, flags))
+	if (layout == EGPUDataLayout::Expanded)
+	{
+		Vertices.resize(numCorners * stride, 0);
+		uint8* dst = Vertices.data();
+		for (const auto& tri : Triangles)
+		{
+			for (const auto& vert : tri.Vertices)
 			{
-				if (splitNormal)
-				{
-					stream << vert.Tangent << vert.Binormal;
-				}
-				else
-				{
-					stream << Tangents[vert.Index] << Binormals[vert.Index];
-				}
+				writeVertex(dst, vert);
+				dst += stride;
 			}
+		}
+
+		return;
+	}
 
-			if (HAS_FLAGS(VERTEX_COLOR, flags))
+	// Open addressing table of (vertex index + 1), keyed by the hash of the expanded vertex.
+	uint32 tableSize = 16;
+	while (tableSize < numCorners * 2)
+	{
+		tableSize <<= 1;
+	}
+
+	vector<uint32> table(tableSize, 0);
+	vector<uint32> indices;
+	vector<uint8> scratch(stride);
+	indices.reserve(numCorners);
+	Vertices.reserve(numCorners * stride);
+
+	uint32 numVertices = 0;
+	for (const auto& tri : Triangles)
+	{
+		for (const auto& vert : tri.Vertices)
+		{
+			memset(scratch.data(), 0, stride);
+			writeVertex(scratch.data(), vert);
+
+			uint32 slot = HashBytes32(scratch.data(), stride) & (tableSize - 1);
+			while (true)
 			{
-				if (splitVertexColor)
+				uint32 entry = table[slot];
+				if (entry == 0)
 				{
-					stream << vert.Color;
+					table[slot] = ++numVertices;
+					indices.push_back(numVertices - 1);
+					Vertices.insert(Vertices.end(), scratch.begin(), scratch.end());
+					break;
 				}
-				else
+				else if (memcmp(&Vertices[(entry - 1) * stride], scratch.data(), stride) == 0)
 				{
-					stream << VertexColors[vert.Index];
+					indices.push_back(entry - 1);
+					break;
 				}
-			}
 
-			if (HAS_FLAGS(VERTEX_SKIN, flags))
-			{
-				stream << BlendWeights[vert.Index] << BlendIndices[vert.Index];
+				slot = (slot + 1) & (tableSize - 1);
 			}
+		}
+	}
 
-			if (padding.size() > 0)
-			{
-				Serialize(stream, &padding[0], padding.size());
-			}
+	float acmr = FVertexCacheOptimizer::GetACMR(indices, numVertices);
+	if (layout == EGPUDataLayout::IndexedCacheOptimized)
+	{
+		FVertexCacheOptimizer::Optimize(indices, numVertices);
+	}
+
+	IndexStride = numVertices < (1 << 16) ? 2 : 4;
+	Indices.resize(indices.size() * IndexStride);
+	if (IndexStride == 2)
+	{
+		uint16* dst = (uint16*)Indices.data();
+		for (auto index : indices)
+		{
+			*dst++ = (uint16)index;
+		}
+	}
+	else
+	{
+		memcpy(Indices.data(), indices.data(), Indices.size());
+	}
+
+	LVMSG(head, "%s: %d corners -> %d vertices, VB %.1f KB -> %.1f KB, IB %.1f KB, ACMR %.2f -> %.2f",
+		Name.c_str(), numCorners, numVertices, numCorners * stride / 1000.0f, Vertices.size() / 1000.0f,
+		Indices.size() / 1000.0f, acmr, FVertexCacheOptimizer::GetACMR(indices, numVertices));
+}
+
+FORCEINLINE void LostCore::FMeshData::BuildTriangleBVH(FTriangleBVH& bvh) const
+{
+	// FTriangle of the mesh holds the vertex attributes, the bvh takes the positions only.
+	vector<LostCore::FTriangle> triangles(Triangles.size());
+	for (uint32 i = 0; i < Triangles.size(); ++i)
+	{
+		for (uint32 corner = 0; corner < 3; ++corner)
+		{
+			triangles[i].P[corner] = Coordinates[Triangles[i].Vertices[corner].Index];
 		}
 	}
 
-	Vertices.resize(stream.RemainingSize());
-	Deserialize(stream, &Vertices[0], stream.RemainingSize());
+	bvh.Build(triangles);
 }
 
 FORCEINLINE string LostCore::FAnimCurveData::Save(const string& outputDir) const
@@ -588,4 +816,67 @@ FORCEINLINE void LostCore::FAnimKeyFrameData::Load(const string& inputDir)
 
 	LVMSG("FAnimKeyFrameData::Load", "Animation is loaded: %s, %.1f KB, %s",
 		Name.c_str(), sz / 1000.0f, inputDir.c_str());
+}
+
+FORCEINLINE LostCore::FBakedAnimCurveData::FBakedAnimCurveData()
+	: Name("")
+	, SampleRate(0.0f)
+	, Length(0.0f)
+	, NumKeys(0)
+{
+}
+
+FORCEINLINE LostCore::FBakedAnimCurveData::FBakedAnimCurveData(const FAnimCurveData& data)
+{
+	Bake(data);
+}
+
+FORCEINLINE void LostCore::FBakedAnimCurveData::Bake(const FAnimCurveData& data)
+{
+	Name = data.Name;
+	SampleRate = data.SampleRate;
+	Length = data.Length;
+	NumKeys = data.NumKeys;
+
+	ChannelMap.clear();
+	for (auto& skeleton : data.CurveMap)
+	{
+		auto& channels = ChannelMap[skeleton.first];
+		for (auto& component : skeleton.second)
+		{
+			auto channel = GetAnimChannel(component.first);
+			if (channel >= 0)
+			{
+				channels.Curves[channel].Bake(component.second);
+				channels.Mask |= 1 << channel;
+			}
+		}
+	}
+}
+
+FORCEINLINE LostCore::FBakedAnimKeyFrameData::FBakedAnimKeyFrameData()
+	: Name("")
+	, SampleRate(0.0f)
+	, Length(0.0f)
+	, NumKeys(0)
+{
+}
+
+FORCEINLINE LostCore::FBakedAnimKeyFrameData::FBakedAnimKeyFrameData(const FAnimKeyFrameData& data)
+{
+	Bake(data);
+}
+
+FORCEINLINE void LostCore::FBakedAnimKeyFrameData::Bake(const FAnimKeyFrameData& data)
+{
+	Name = data.Name;
+	SampleRate = data.SampleRate;
+	Length = data.Length;
+	NumKeys = data.NumKeys;
+
+	KeyFrameMap.clear();
+	for (auto& keyFrame : data.KeyFrameMap)
+	{
+		KeyFrameMap[keyFrame.first].Bake(keyFrame.second);
+	}
 }
\ No newline at end of file
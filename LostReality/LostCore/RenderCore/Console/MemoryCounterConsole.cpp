@@ -37,6 +37,9 @@ std::vector<std::string> LostCore::FMemoryCounterConsole::GetPageNames() const
 
 void LostCore::FMemoryCounterConsole::Refresh()
 {
+	// Every frame, shown or not, allocations per frame and the peaks are between two samples.
+	auto usage = FMemoryCounterManager::Get()->Sample();
+
 	if (!EnsureInitialized())
 	{
 		return;
@@ -50,14 +53,12 @@ void LostCore::FMemoryCounterConsole::Refresh()
 	auto head = FMemoryCounterManager::GetInfoHeader();
 	Sheet->SetHeader(head);
 
-	auto info = FMemoryCounterManager::Get()->GetMemoryUsage();
-	for (auto& item : info)
+	for (int32 tag = 0; tag < SNumMemoryTags; ++tag)
 	{
-		vector<string> str;
-		str.push_back(item.first);
-		str.push_back(to_string(std::get<0>(item.second)));
-		str.push_back(to_string(std::get<1>(item.second)));
-		Sheet->AddRow(str);
+		if (usage[tag].NumAllocs > 0)
+		{
+			Sheet->AddRow(FMemoryCounterManager::GetDescs((EMemoryTag)tag, usage[tag]));
+		}
 	}
 }
 
@@ -80,12 +81,40 @@ void LostCore::FMemoryCounterConsole::Record()
 	}
 	csv << "\n";
 
-	auto info = FMemoryCounterManager::Get()->GetMemoryUsage();
-	for (auto& item : info)
+	auto usage = FMemoryCounterManager::Get()->GetMemoryUsage();
+	for (int32 tag = 0; tag < SNumMemoryTags; ++tag)
+	{
+		if (usage[tag].NumAllocs > 0)
+		{
+			for (auto& item : FMemoryCounterManager::GetDescs((EMemoryTag)tag, usage[tag]))
+			{
+				csv << item << ",";
+			}
+			csv << "\n";
+		}
+	}
+
+	csv.close();
+
+	// Only with FMemoryCounterManager::SetStackSampling, addresses to resolve with the pdb.
+	auto stacks = FMemoryCounterManager::Get()->GetAllocStacks();
+	if (stacks.empty())
+	{
+		return;
+	}
+
+	string stackUrl("MemStacks-");
+	FDirectoryHelper::Get()->GetSpecifiedAbsolutePath("Profile", stackUrl.append(GetNowStr(true)).append(ext), output);
+	csv.open(output);
+	csv << "Name,Allocs,Bytes,Frames,\n";
+	for (auto& stack : stacks)
 	{
-		csv << item.first << ","
-			<< std::get<0>(item.second) << "," 
-			<< std::get<1>(item.second) << "\n";
+		csv << GetMemoryTagName(stack.Tag) << "," << stack.NumAllocs << "," << stack.Bytes << ",";
+		for (uint32 i = 0; i < stack.NumFrames; ++i)
+		{
+			csv << hex << "0x" << (uintptr_t)stack.Frames[i] << dec << " ";
+		}
+		csv << ",\n";
 	}
 
 	csv.close();
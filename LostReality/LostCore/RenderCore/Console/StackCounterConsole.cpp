@@ -16,6 +16,9 @@ using namespace LostCore;
 
 static FStackCounterConsole SObj;
 
+// Frames of the calling thread in the trace written with the csv.
+static const uint32 SNumTraceFrames = 10;
+
 LostCore::FStackCounterConsole::FStackCounterConsole()
 	: bInitialized(false)
 	, Sheet(nullptr)
@@ -101,6 +104,13 @@ void LostCore::FStackCounterConsole::Record()
 	}
 
 	csv.close();
+
+	string trace("Trace-");
+	FDirectoryHelper::Get()->GetSpecifiedAbsolutePath("Profile", trace.append(GetNowStr(true)).append(".json"), output);
+	if (!FTraceProfiler::Get()->Capture(SNumTraceFrames, output))
+	{
+		LVWARN("FStackCounterConsole::Record", "trace not captured, profiler stopped or a capture going on.");
+	}
 }
 
 void LostCore::FStackCounterConsole::DisplayPage(const string& name)
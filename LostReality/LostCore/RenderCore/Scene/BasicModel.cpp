@@ -20,6 +20,9 @@ LostCore::FBasicModel::FBasicModel()
 	, Material(nullptr)
 	, MatricesBuffer(nullptr)
 	, CustomBuffer(nullptr)
+	, bWorldInvertValid(false)
+	, BoundsTree(nullptr)
+	, BoundsProxy(TDynamicBVH<FBasicModel*>::SNull)
 	, ActorFlags(0)
 {
 }
@@ -91,6 +94,17 @@ void LostCore::FBasicModel::Tick()
 	CommitGizmos();
 }
 
+void LostCore::FBasicModel::UpdateSortDepth(const FFloat4x4& view)
+{
+	if (Primitive == nullptr || !BoundingBox.IsValid())
+	{
+		return;
+	}
+
+	FFloat3 center = (BoundingBox.Min + BoundingBox.Max) * 0.5f;
+	Primitive->SetSortDepth(view.ApplyPoint(GetWorldMatrix().ApplyPoint(center)).Z);
+}
+
 void LostCore::FBasicModel::CommitModel()
 {
 	if (MatricesBuffer != nullptr)
@@ -123,8 +137,27 @@ bool LostCore::FBasicModel::ConfigPrimitive(const string& url, IPrimitive*& pg,
 	}
 
 	// Ⱦ.
-	pgdata.Load(urlAbs);
-	pgdata.BuildGPUData();
+	// A converted .ivm sibling already holds the GPU buffers, which are uploaded straight from the mapping.
+	FMappedMeshData mapped;
+	TArrayView<uint8> vertices, indices;
+	if (mapped.Open(GetMappedAssetUrl(urlAbs, K_PRIMITIVE_MAPPED_EXT)))
+	{
+		mapped.Extract(pgdata);
+		vertices = mapped.GetVertices();
+		indices = mapped.GetIndices();
+		if (!mapped.GetTriangleBVH(TriangleBVH))
+		{
+			pgdata.BuildTriangleBVH(TriangleBVH);
+		}
+	}
+	else
+	{
+		pgdata.Load(urlAbs);
+		pgdata.BuildGPUData(0, FMeshData::EGPUDataLayout::IndexedCacheOptimized);
+		pgdata.BuildTriangleBVH(TriangleBVH);
+		vertices = TArrayView<uint8>(pgdata.Vertices);
+		indices = TArrayView<uint8>(pgdata.Indices);
+	}
 
 	// Χ.
 	ValidateBoundingBox();
@@ -133,14 +166,13 @@ bool LostCore::FBasicModel::ConfigPrimitive(const string& url, IPrimitive*& pg,
 	D3D11::WrappedCreatePrimitiveGroup(&pg);
 	(pg)->SetVertexElement(pgdata.VertexFlags);
 
-	if (pgdata.IndexCount > 0)
+	if (!indices.IsEmpty())
 	{
-		uint32 ibStride = pgdata.VertexCount < (1 << 16) ? 2 : 4;
-		pg->ConstructIB(pgdata.Indices, ibStride, false);
+		pg->ConstructIB(FBuf(indices.begin(), indices.end()), pgdata.IndexStride, false);
 	}
 
 	uint32 vbStride = GetAlignedSize(GetVertexDetails(pgdata.VertexFlags).Stride, 16);
-	pg->ConstructVB(pgdata.Vertices.data(), pgdata.Vertices.size(), vbStride, false);
+	pg->ConstructVB(vertices.Data(), vertices.Bytes(), vbStride, false);
 
 	return pg != nullptr;
 }
@@ -266,9 +298,56 @@ void LostCore::FBasicModel::SetColor(const FColor128 & color)
 	Custom.Color = color;
 }
 
-bool LostCore::FBasicModel::RayTest(const FRay & ray, FRay::FT & dist)
+bool LostCore::FBasicModel::RayTest(const FRay & ray, FRay::FT & dist, bool precise)
+{
+	if (!bWorldInvertValid)
+	{
+		WorldInvert = GetWorldMatrix().GetInvert();
+		bWorldInvertValid = true;
+	}
+
+	if (!precise || TriangleBVH.IsEmpty())
+	{
+		return RayBoxIntersect(ray, BoundingBox, WorldInvert, dist);
+	}
+
+	// The root of the bvh is the bounding box, no box test first.
+	// The local distance goes back to world space as RayBoxIntersect does.
+	const FRay localRay(ray.GetTransformed(WorldInvert));
+	FRay::FT localDist;
+	uint32 triangle;
+	if (!TriangleBVH.RayCast(localRay, localDist, triangle))
+	{
+		return false;
+	}
+
+	dist = localDist * ray.Distance / localRay.Distance;
+	return true;
+}
+
+FAABoundingBox LostCore::FBasicModel::GetWorldBoundingBox()
+{
+	return GetTransformedBoundingBox(BoundingBox, GetWorldMatrix());
+}
+
+void LostCore::FBasicModel::SetBoundsProxy(TDynamicBVH<FBasicModel*>* tree, int32 proxy)
+{
+	BoundsTree = tree;
+	BoundsProxy = proxy;
+}
+
+int32 LostCore::FBasicModel::GetBoundsProxy() const
 {
-	return RayBoxIntersect(ray, BoundingBox, GetWorldMatrix().GetInvert(), dist);
+	return BoundsProxy;
+}
+
+void LostCore::FBasicModel::OnWorldMatrixChanged()
+{
+	bWorldInvertValid = false;
+	if (BoundsTree != nullptr && BoundsProxy != TDynamicBVH<FBasicModel*>::SNull)
+	{
+		BoundsTree->Move(BoundsProxy, GetWorldBoundingBox());
+	}
 }
 
 FSegmentTool * LostCore::FBasicModel::GetSegmentRenderer()
@@ -325,10 +404,7 @@ void LostCore::FBasicModel::ValidateBoundingBox()
 		return;
 	}
 
-	for (auto& coord : PrimitiveData.Coordinates)
-	{
-		BoundingBox.AddPoint(coord);
-	}
+	FTransformBatch::AddPoints(BoundingBox, PrimitiveData.Coordinates.data(), (uint32)PrimitiveData.Coordinates.size());
 }
 
 void LostCore::FBasicModel::Destroy()
@@ -350,6 +426,12 @@ void LostCore::FBasicModel::Destroy()
 		D3D11::WrappedDestroyConstantBuffer(forward<IConstantBuffer*>(MatricesBuffer));
 		CustomBuffer = nullptr;
 	}
+
+	if (BoundsTree != nullptr && BoundsProxy != TDynamicBVH<FBasicModel*>::SNull)
+	{
+		BoundsTree->Remove(BoundsProxy);
+		SetBoundsProxy(nullptr, TDynamicBVH<FBasicModel*>::SNull);
+	}
 }
 
 LostCore::FStaticModel::FStaticModel() : FBasicModel()
@@ -370,6 +452,7 @@ void LostCore::FStaticModel::Tick()
 void LostCore::FStaticModel::SetWorldMatrix(const FFloat4x4 & world)
 {
 	World.Matrix = world;
+	OnWorldMatrixChanged();
 }
 
 FFloat4x4 LostCore::FStaticModel::GetWorldMatrix()
@@ -382,6 +465,18 @@ void LostCore::FStaticModel::Clone(FBasicModel & model)
 	FBasicModel::Clone(model);
 }
 
+bool LostCore::FStaticModel::ConfigPrimitive(const string & url, IPrimitive *& pg, FMeshData & pgdata)
+{
+	if (!FBasicModel::ConfigPrimitive(url, pg, pgdata))
+	{
+		return false;
+	}
+
+	// Models loaded from the same primitive are drawn instanced.
+	pg->SetInstancingKey(HashBytes32(url.data(), (uint32)url.size()));
+	return true;
+}
+
 bool LostCore::FStaticModel::ConfigMaterial(const string & url)
 {
 	bool success = FBasicModel::ConfigMaterial(url);
@@ -436,18 +531,29 @@ void LostCore::FStaticModel::UpdateGizmosNormalTangent()
 	const FColor128 endColor((uint32)0xffffff);
 	const float segLen = FGlobalHandler::Get()->GetDisplayNormalLength();
 	auto& world = World.Matrix;
+
+	// Per vertex streams are transformed in batch, the per polygon ones below stay per element.
+	vector<FFloat3> coords(prim.Coordinates.size());
+	vector<FFloat3> normals(prim.Normals.size());
+	vector<FFloat3> tangents(displayTangent ? prim.Tangents.size() : 0);
+	vector<FFloat3> binormals(displayTangent ? prim.Binormals.size() : 0);
+	FTransformBatch::TransformPoints(world, prim.Coordinates.data(), coords.data(), (uint32)coords.size());
+	FTransformBatch::TransformVectors(world, prim.Normals.data(), normals.data(), (uint32)normals.size());
+	FTransformBatch::TransformVectors(world, prim.Tangents.data(), tangents.data(), (uint32)tangents.size());
+	FTransformBatch::TransformVectors(world, prim.Binormals.data(), binormals.data(), (uint32)binormals.size());
+
 	for (uint32 i = 0; i < prim.Coordinates.size(); ++i)
 	{
 		if (displayNormal)
 		{
 			FSegmentData seg;
-			seg.StartPt = world.ApplyPoint(prim.Coordinates[i]);
+			seg.StartPt = coords[i];
 			seg.StartPtColor = normalColor;
 			seg.StopPtColor = endColor;
 
 			if (prim.Normals.size() > 0)
 			{
-				FFloat3 normal = world.ApplyVector(prim.Normals[i]);
+				const FFloat3& normal = normals[i];
 				seg.StopPt = seg.StartPt + normal * segLen;
 				renderer.AddSegment(seg);
 			}
@@ -465,16 +571,13 @@ void LostCore::FStaticModel::UpdateGizmosNormalTangent()
 		if (displayTangent)
 		{
 			FAxisData axis;
-			axis.Origin = world.ApplyPoint(prim.Coordinates[i]);
+			axis.Origin = coords[i];
 
 			if (prim.Normals.size() > 0)
 			{
-				FFloat3 normal = world.ApplyVector(prim.Normals[i]);
-				FFloat3 tangent = world.ApplyVector(prim.Tangents[i]);
-				FFloat3 binormal = world.ApplyVector(prim.Binormals[i]);
-				axis.DirX = binormal;
-				axis.DirY = normal;
-				axis.DirZ = tangent;
+				axis.DirX = binormals[i];
+				axis.DirY = normals[i];
+				axis.DirZ = tangents[i];
 				axis.Length = segLen;
 				AxisRenderer.AddAxis(axis);
 			}
@@ -501,6 +604,7 @@ void LostCore::FStaticModel::Destroy()
 }
 
 LostCore::FSkeletalModel::FSkeletalModel() : FBasicModel()
+	, bAnimationUpdated(false)
 {
 }
 
@@ -515,7 +619,7 @@ void LostCore::FSkeletalModel::Destroy()
 
 void LostCore::FSkeletalModel::PlayAnimation(const string & animName)
 {
-	Root.SetAnimation(animName);
+	Skeleton.SetAnimation(animName);
 }
 
 void LostCore::FSkeletalModel::Tick()
@@ -529,6 +633,7 @@ void LostCore::FSkeletalModel::Tick()
 void LostCore::FSkeletalModel::SetWorldMatrix(const FFloat4x4 & world)
 {
 	Matrices.World = world;
+	OnWorldMatrixChanged();
 }
 
 FFloat4x4 LostCore::FSkeletalModel::GetWorldMatrix()
@@ -544,19 +649,14 @@ void LostCore::FSkeletalModel::Clone(FBasicModel & model)
 void LostCore::FSkeletalModel::UpdateConstant()
 {
 	FBasicModel::UpdateConstant();
-	auto& prim = *GetPrimitiveData();
-	Root.UpdateWorldMatrix(Matrices.World);
 
-	LostCore::FPoseMap pose;
-	Root.GetWorldPose(pose);
-	for (const auto& it : pose)
+	if (!bAnimationUpdated)
 	{
-		if (prim.SkeletonIndexMap.find(it.first) != prim.SkeletonIndexMap.end())
-		{
-			Matrices.Bones[prim.SkeletonIndexMap[it.first]] = it.second;
-		}
+		UpdateAnimation((float)FProcessUnique::Get()->GetCurrentThread()->GetFrameSec());
 	}
 
+	bAnimationUpdated = false;
+
 	auto cb = GetMatricesBuffer();
 	if (cb != nullptr)
 	{
@@ -566,13 +666,20 @@ void LostCore::FSkeletalModel::UpdateConstant()
 	}
 }
 
+void LostCore::FSkeletalModel::UpdateAnimation(float sec)
+{
+	// The pose is built in model space, the world matrix goes to every bone in one batch.
+	Skeleton.AdvanceTime(sec * FGlobalHandler::Get()->GetAnimateRate());
+	Skeleton.UpdatePose(Matrices.Bones.data());
+	FTransformBatch::ConcatenateMatrices(Matrices.Bones.data(), Matrices.World, Matrices.Bones.data(), Skeleton.GetSkinCount());
+	bAnimationUpdated = true;
+}
+
 bool LostCore::FSkeletalModel::ConfigPrimitive(const string& url, IPrimitive*& pg, FMeshData& pgdata)
 {
 	if (FBasicModel::ConfigPrimitive(url, pg, pgdata))
 	{
-		FFloat4x4 world;
-		world.SetIdentity();
-		Root.LoadSkeleton(pgdata.Skeleton, world);
+		Skeleton.LoadSkeleton(pgdata.Skeleton, pgdata.SkeletonIndexMap);
 		return true;
 	}
 	
@@ -716,24 +823,20 @@ void LostCore::FSkeletalModel::UpdateGizmosSkeleton()
 {
 	if (FGlobalHandler::Get()->IsDisplay(FLAG_DISPLAY_SKEL))
 	{
-		map<string, pair<FFloat3, vector<FFloat3>>> skels;
+		vector<pair<FFloat3, FFloat3>> bones;
+		Skeleton.GetSkeletonRenderData(bones);
 
-		Root.GetSkeletonRenderData(skels);
-		for (auto& skel : skels)
+		FSegmentData seg;
+		seg.StartPtColor = FColor128((uint32)0x80ff40);
+		seg.StopPtColor = FColor128((uint32)0xffffff);
+		for (auto& bone : bones)
 		{
-			FSegmentData seg;
-			seg.StartPt = skel.second.first;
-			seg.StartPtColor = FColor128((uint32)0x80ff40);
-			seg.StopPtColor = FColor128((uint32)0xffffff);
-			for (auto & childSkel : skel.second.second)
-			{
-				seg.StopPt = childSkel;
-				SkeletonRenderer.AddSegment(seg);
-			}
+			seg.StartPt = bone.first;
+			seg.StopPt = bone.second;
+			SkeletonRenderer.AddSegment(seg);
 		}
 
-		FFloat4x4 mat;
-		mat.SetIdentity();
-		SkeletonRenderer.SetWorldMatrix(mat);
+		// Bone positions are in model space.
+		SkeletonRenderer.SetWorldMatrix(Matrices.World);
 	}
 }
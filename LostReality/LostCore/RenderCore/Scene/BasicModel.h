@@ -49,7 +49,19 @@ namespace LostCore
 		FMeshData* GetPrimitiveData();
 		void SetColor(const FColor128& color);
 
-		bool RayTest(const FRay& ray, FRay::FT& dist);
+		// The bounding box by default, the triangles of the mesh when precise.
+		// Skeletal models are tested in the bind pose.
+		bool RayTest(const FRay& ray, FRay::FT& dist, bool precise = false);
+
+		// The bounding box in world space, as held by the bounds tree of the scene.
+		FAABoundingBox GetWorldBoundingBox();
+
+		// The leaf of the model in the bounds tree, moved along with the world matrix.
+		void SetBoundsProxy(TDynamicBVH<FBasicModel*>* tree, int32 proxy);
+		int32 GetBoundsProxy() const;
+
+		// View space depth of the bounding box center, orders the translucent draws.
+		void UpdateSortDepth(const FFloat4x4& view);
 
 	protected:
 		virtual bool ConfigPrimitive(const string& url, IPrimitive*& pg, FMeshData& pgdata);
@@ -63,6 +75,9 @@ namespace LostCore
 
 		FSegmentTool* GetSegmentRenderer();
 
+		// SetWorldMatrix of the subclasses calls it, drops the cached inverse and moves the leaf.
+		void OnWorldMatrixChanged();
+
 	private:
 		void ValidateBoundingBox();
 		void Destroy();
@@ -72,11 +87,17 @@ namespace LostCore
 		IMaterial* Material;
 		IConstantBuffer* MatricesBuffer;
 		FMeshData PrimitiveData;
+		FTriangleBVH TriangleBVH;
 		FSegmentTool SegmentRenderer;
 		FAABoundingBox BoundingBox;
 		FCustomParameter Custom;
 		IConstantBuffer* CustomBuffer;
 
+		FFloat4x4 WorldInvert;
+		bool bWorldInvertValid;
+		TDynamicBVH<FBasicModel*>* BoundsTree;
+		int32 BoundsProxy;
+
 		uint32 ActorFlags;
 	};
 
@@ -92,6 +113,7 @@ namespace LostCore
 		virtual void Clone(FBasicModel& model) override;
 
 	protected:
+		virtual bool ConfigPrimitive(const string& url, IPrimitive*& pg, FMeshData& pgdata) override;
 		virtual bool ConfigMaterial(const string& url) override;
 		virtual void UpdateConstant() override;
 		virtual void CommitGizmos() override;
@@ -120,6 +142,11 @@ namespace LostCore
 
 		void PlayAnimation(const string& animName);
 
+		// Samples the animation and builds the skinning matrices, touches nothing but this model.
+		// FBasicScene runs it for all skeletal models on the job system before they tick,
+		// a model ticked alone updates itself in UpdateConstant.
+		void UpdateAnimation(float sec);
+
 	protected:
 		virtual void UpdateConstant() override;
 		//virtual void RayTest() = 0;
@@ -138,7 +165,8 @@ namespace LostCore
 	private:
 
 		FSkinnedParameter Matrices;
-		FSkeletonTree Root;
+		FSkeleton Skeleton;
+		bool bAnimationUpdated;
 		FAxisRenderer AxisRenderer;
 		FSegmentTool SkeletonRenderer;
 	};
@@ -31,13 +31,88 @@ void FBasicScene::Tick()
 	static FStackCounterRequest SCounter("FBasicScene::Tick");
 	FScopedStackCounterRequest req(SCounter);
 
+	UpdateAnimations();
+	CullModels();
+
+	auto camera = GetCamera();
+	const FFloat4x4 view = camera != nullptr ? camera->GetViewMatrix() : FFloat4x4();
+	for (auto sm : VisibleModels)
+	{
+		sm->UpdateSortDepth(view);
+		sm->Tick();
+	}
+}
+
+void FBasicScene::CullModels()
+{
+	static FStackCounterRequest SCounter("FBasicScene::CullModels");
+	FScopedStackCounterRequest req(SCounter);
+
+	VisibleModels.clear();
+	CullingBoxes.Clear();
 	for (auto sm : Models)
 	{
 		if (sm != nullptr)
 		{
-			sm->Tick();
+			VisibleModels.push_back(sm);
+			CullingBoxes.AddTransformed(*sm->GetBoundingBox(), sm->GetWorldMatrix());
+		}
+	}
+
+	static FStackCounterRequest SVisible("Models visible");
+	static FStackCounterRequest STotal("Models total");
+	const uint32 total = (uint32)VisibleModels.size();
+	STotal.AddCount(total);
+
+	auto camera = GetCamera();
+	if (camera == nullptr)
+	{
+		SVisible.AddCount(total);
+		return;
+	}
+
+	const FFrustum frustum(camera->GetViewProjectMatrix());
+	CullingResults.resize(total);
+	SVisible.AddCount(frustum.CullBoxes(CullingBoxes, CullingResults.data()));
+
+	// Compacted in place, the order of Models is kept.
+	uint32 numVisible = 0;
+	for (uint32 index = 0; index < total; ++index)
+	{
+		if (CullingResults[index] != 0)
+		{
+			VisibleModels[numVisible++] = VisibleModels[index];
+		}
+	}
+
+	VisibleModels.resize(numVisible);
+}
+
+void FBasicScene::UpdateAnimations()
+{
+	static FStackCounterRequest SCounter("FBasicScene::UpdateAnimations");
+	FScopedStackCounterRequest req(SCounter);
+
+	AnimatedModels.clear();
+	for (auto sm : Models)
+	{
+		auto skeletal = dynamic_cast<FSkeletalModel*>(sm);
+		if (skeletal != nullptr)
+		{
+			AnimatedModels.push_back(skeletal);
 		}
 	}
+
+	// The frame time of the scene thread, the jobs may run on the workers.
+	static FStackCounterRequest SJobCounter("FSkeletalModel::UpdateAnimation");
+	const float sec = (float)FProcessUnique::Get()->GetCurrentThread()->GetFrameSec();
+	FJobSystem::Get()->ParallelFor((uint32)AnimatedModels.size(), 1, [&](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			AnimatedModels[i]->UpdateAnimation(sec);
+		}
+	}, &SJobCounter);
 }
 
 bool LostCore::FBasicScene::Config(const FJson & config)
@@ -73,6 +148,9 @@ bool LostCore::FBasicScene::Config(const FJson & config)
 		{
 			Cameras.push_back(new FBasicCamera);
 		}
+
+		// One at a time the leaves went where they fit at the moment, a full build packs them better.
+		BoundsTree.Rebuild();
 	}
 
 	return true;
@@ -113,6 +191,13 @@ void FBasicScene::AddModel(FBasicModel * sm)
 	if (sm != nullptr && std::find(Models.begin(), Models.end(), sm) == Models.end())
 	{
 		Models.push_back(sm);
+
+		// A model without a valid box can't be hit.
+		const FAABoundingBox bounds(sm->GetWorldBoundingBox());
+		if (bounds.IsValid())
+		{
+			sm->SetBoundsProxy(&BoundsTree, BoundsTree.Insert(bounds, sm));
+		}
 	}
 }
 
@@ -128,6 +213,12 @@ void FBasicScene::RemoveModel(FBasicModel * sm)
 	{
 		Models.erase(result);
 	}
+
+	if (sm->GetBoundsProxy() != TDynamicBVH<FBasicModel*>::SNull)
+	{
+		BoundsTree.Remove(sm->GetBoundsProxy());
+		sm->SetBoundsProxy(nullptr, TDynamicBVH<FBasicModel*>::SNull);
+	}
 }
 
 void LostCore::FBasicScene::ClearModels()
@@ -138,6 +229,7 @@ void LostCore::FBasicScene::ClearModels()
 	}
 
 	Models.clear();
+	BoundsTree.Clear();
 }
 
 FBasicCamera* LostCore::FBasicScene::GetCamera()
@@ -150,21 +242,16 @@ FBasicCamera* LostCore::FBasicScene::GetCamera()
 	return nullptr;
 }
 
-FBasicModel* LostCore::FBasicScene::RayTest(const FRay & ray, FRay::FT & dist)
+FBasicModel* LostCore::FBasicScene::RayTest(const FRay & ray, FRay::FT & dist, bool precise)
 {
-	FBasicModel* nearest = nullptr;
-	FRay localRay(ray);
-
-	// Գ.
+	// The tree gives the models whose world box the ray reaches, nearer ones first,
+	// each of them tests its own box or its triangles with the cached world inverse.
 	// TODO: Should be Actor with or without model.
-	for (auto model : Models)
+	FBasicModel* nearest = nullptr;
+	BoundsTree.RayCast(ray, [precise](FBasicModel* model, const FRay& r, FRay::FT& d)
 	{
-		if (model != nullptr && model->RayTest(localRay, dist))
-		{
-			nearest = model;
-			localRay.Distance = dist;
-		}
-	}
+		return model->RayTest(r, d, precise);
+	}, nearest, dist);
 
 	return nearest;
 }
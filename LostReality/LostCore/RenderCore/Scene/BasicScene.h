@@ -39,12 +39,27 @@ namespace LostCore
 
 		// TODO: Ҫһ
 		FBasicCamera* GetCamera();
-		FBasicModel* RayTest(const FRay& ray, FRay::FT& dist);
+		FBasicModel* RayTest(const FRay& ray, FRay::FT& dist, bool precise = false);
 
 	private:
 		void Destroy();
 
+		// Animation phase of Tick, every skeletal model is updated on the job system and joined
+		// before any model commits, each model only writes its own matrices.
+		void UpdateAnimations();
+
+		// Culling phase of Tick, the world bounding boxes of the models are tested against
+		// the frustum of the camera in SIMD batches, only the visible models are ticked and committed.
+		void CullModels();
+
 		vector<FBasicModel*> Models;
+		vector<FSkeletalModel*> AnimatedModels;
+		vector<FBasicModel*> VisibleModels;
+		FBoxStreams CullingBoxes;
+		vector<uint8> CullingResults;
+
+		// World bounds of the models for RayTest, rebuilt after Config and moved by SetWorldMatrix.
+		TDynamicBVH<FBasicModel*> BoundsTree;
 		vector<FBasicCamera*> Cameras;
 	};
 }
\ No newline at end of file
@@ -12,96 +12,186 @@
 
 using namespace LostCore;
 
-LostCore::FSkeletonTree::FSkeletonTree()
+LostCore::FSkeleton::FSkeleton()
+	: SkinCount(0)
+	, CurrAnimName("")
+	, CurrKeyTime(0.0f)
+	, TrackRevision(0)
 {
 }
 
-LostCore::FSkeletonTree::FSkeletonTree(const FPoseTree & skelRoot, const FFloat4x4& parentInvBindPose)
+void LostCore::FSkeleton::LoadSkeleton(const FPoseTree & skelRoot, const map<string, int32>& skinIndexMap)
 {
-	LoadSkeleton(skelRoot, parentInvBindPose);
+	Names.clear();
+	Parents.clear();
+	SkinIndices.clear();
+	Locals.clear();
+	InvBindPoses.clear();
+	SkinCount = 0;
+
+	FFloat4x4 identity;
+	identity.SetIdentity();
+	AddBone(skelRoot, -1, identity, skinIndexMap);
+
+	BoneWorlds.resize(Names.size());
+	for (uint32 i = 0; i < Names.size(); ++i)
+	{
+		BoneWorlds[i] = Parents[i] < 0 ? Locals[i] : Locals[i] * BoneWorlds[Parents[i]];
+	}
+
+	Tracks.clear();
+	Cursors.clear();
+	if (!CurrAnimName.empty())
+	{
+		BindTracks();
+	}
 }
 
-void LostCore::FSkeletonTree::LoadSkeleton(const FPoseTree & skelRoot, const FFloat4x4& parentInvBindPose)
+void LostCore::FSkeleton::AddBone(const FPoseTree & node, int32 parent, const FFloat4x4 & parentInvBindPose, const map<string, int32>& skinIndexMap)
 {
-	Name = skelRoot.Data.Name;
-	Local = skelRoot.Data.Matrix;
+	const char* head = "LostCore::FSkeleton::AddBone";
 
-	auto invLocal = Local;
-	InvBindPose = parentInvBindPose * invLocal.Invert();
+	const int32 index = (int32)Names.size();
+	Names.push_back(node.Data.Name);
+	Parents.push_back(parent);
+	Locals.push_back(node.Data.Matrix);
 
-	CurrAnimName = "";
-	CurrKeyTime = 0.0f;
+	auto invLocal = node.Data.Matrix;
+	InvBindPoses.push_back(parentInvBindPose * invLocal.Invert());
+
+	int32 skinIndex = -1;
+	auto it = skinIndexMap.find(node.Data.Name);
+	if (it != skinIndexMap.end())
+	{
+		if (it->second >= 0 && it->second < MAX_BONES_PER_BATCH)
+		{
+			skinIndex = it->second;
+			SkinCount = (uint32)skinIndex >= SkinCount ? (uint32)skinIndex + 1 : SkinCount;
+		}
+		else
+		{
+			LVERR(head, "Bone [%s] index %d is out of the skinning buffer.", node.Data.Name.c_str(), it->second);
+		}
+	}
+
+	SkinIndices.push_back(skinIndex);
 
-	Children.clear();
-	for (auto it = skelRoot.Children.begin(); it != skelRoot.Children.end(); ++it)
+	// InvBindPoses may grow in the recursion, pass a copy.
+	const FFloat4x4 invBindPose(InvBindPoses[index]);
+	for (const auto& child : node.Children)
 	{
-		Children.push_back(FSkeletonTree(*it, InvBindPose));
+		AddBone(child, index, invBindPose, skinIndexMap);
 	}
 }
 
-void LostCore::FSkeletonTree::UpdateWorldMatrix(const FFloat4x4 & parentWorld)
+void LostCore::FSkeleton::BindTracks()
 {
-	auto sec = FProcessUnique::Get()->GetCurrentThread()->GetFrameSec();
-	if (!CurrAnimName.empty())
+	const FAnimationLibrary* library = FAnimationLibrary::Get();
+	TrackRevision = library->GetRevision();
+
+	Tracks.resize(Names.size());
+	Cursors.resize(Names.size());
+	for (uint32 i = 0; i < Names.size(); ++i)
 	{
-		CurrKeyTime += sec * FGlobalHandler::Get()->GetAnimateRate();
-		FFloat4x4 offset;
-		if (FAnimationLibrary::Get()->GetMatrix(offset, CurrKeyTime, CurrAnimName, Name))
+		Tracks[i] = FAnimationTrack();
+		library->GetTrack(Tracks[i], CurrAnimName, Names[i]);
+		for (auto& cursor : Cursors[i])
 		{
-			FFloat4x4 invBP(Local);
-			BoneWorld = offset * parentWorld;
+			cursor.Reset();
 		}
 	}
-	else
+}
+
+void LostCore::FSkeleton::SetAnimation(const string & animName)
+{
+	CurrAnimName = animName;
+	CurrKeyTime = 0.0f;
+	if (CurrAnimName.empty())
 	{
-		BoneWorld = Local * parentWorld;
+		Tracks.clear();
+		Cursors.clear();
 	}
-
-	World = InvBindPose * BoneWorld;
-	for (auto& child : Children)
+	else
 	{
-		child.UpdateWorldMatrix(BoneWorld);
+		BindTracks();
 	}
 }
 
-void LostCore::FSkeletonTree::GetWorldPose(FPoseMap& pose)
+void LostCore::FSkeleton::AdvanceTime(float sec)
 {
-	pose[Name] = World;
-	for (auto& child : Children)
+	if (!CurrAnimName.empty())
 	{
-		child.GetWorldPose(pose);
+		CurrKeyTime += sec;
 	}
 }
 
-void LostCore::FSkeletonTree::SetAnimation(const string & animName)
+void LostCore::FSkeleton::UpdatePose(FFloat4x4* skin)
 {
-	CurrAnimName = animName;
+	if (!CurrAnimName.empty() && TrackRevision != FAnimationLibrary::Get()->GetRevision())
+	{
+		BindTracks();
+	}
 
-	for (auto& child : Children)
+	const bool animated = !Tracks.empty();
+	const uint32 numBones = (uint32)Names.size();
+	for (uint32 i = 0; i < numBones; ++i)
 	{
-		child.SetAnimation(animName);
+		FFloat4x4 local;
+		if (animated && Tracks[i].IsValid())
+		{
+			FAnimationLibrary::EvalTrack(local, Tracks[i], CurrKeyTime, &Cursors[i]);
+		}
+		else
+		{
+			local = Locals[i];
+		}
+
+		const int32 parent = Parents[i];
+		BoneWorlds[i] = parent < 0 ? local : local * BoneWorlds[parent];
+
+		if (SkinIndices[i] >= 0)
+		{
+			skin[SkinIndices[i]] = InvBindPoses[i] * BoneWorlds[i];
+		}
 	}
 }
 
-void LostCore::FSkeletonTree::GetSkeletonRenderData(map<string, pair<FFloat3, vector<FFloat3>>>& data)
+uint32 LostCore::FSkeleton::GetNumBones() const
 {
-	data[Name] = pair<FFloat3, vector<FFloat3>>();
+	return (uint32)Names.size();
+}
+
+uint32 LostCore::FSkeleton::GetSkinCount() const
+{
+	return SkinCount;
+}
 
-	pair<FFloat3, vector<FFloat3>>& selfData = data[Name];
-	selfData.first = BoneWorld.GetOrigin();
-	for (auto& child : Children)
+void LostCore::FSkeleton::GetSkeletonRenderData(vector<pair<FFloat3, FFloat3>>& data) const
+{
+	data.clear();
+	for (uint32 i = 0; i < BoneWorlds.size(); ++i)
 	{
-		child.GetSkeletonRenderData(data);
-		selfData.second.push_back(child.BoneWorld.GetOrigin());
+		if (Parents[i] >= 0)
+		{
+			data.push_back(make_pair(BoneWorlds[Parents[i]].GetOrigin(), BoneWorlds[i].GetOrigin()));
+		}
 	}
 }
 
 LostCore::FAnimationLibrary::FAnimationLibrary()
+	: Revision(0)
 {
 }
 
 LostCore::FAnimationLibrary::~FAnimationLibrary()
 {
+	KeyFrames.clear();
+	for (auto& mapped : MappedKeyFrames)
+	{
+		SAFE_DELETE(mapped.second);
+	}
+
+	MappedKeyFrames.clear();
 }
 
 bool LostCore::FAnimationLibrary::Load(const string & path, string& animName)
@@ -114,30 +204,41 @@ bool LostCore::FAnimationLibrary::Load(const string & path, string& animName)
 	string animPath;
 	if (FDirectoryHelper::Get()->GetPrimitiveAbsolutePath(path, animPath))
 	{
+		string name, ext;
+		GetFileName(name, ext, animPath);
+
+		// Key frame animations converted to the mapped layout are used in place.
+		if ((ext.compare(K_ANIM_EXT_KEYFRAME) == 0 && LoadMappedKeyFrame(GetMappedAssetUrl(animPath, K_ANIM_EXT_KEYFRAME_MAPPED), animName)) ||
+			(ext.compare(K_ANIM_EXT_KEYFRAME_MAPPED) == 0 && LoadMappedKeyFrame(animPath, animName)))
+		{
+			LoadRecord.insert(animPath);
+			return true;
+		}
+
 		FBinaryIO stream;
 		if (!stream.ReadFromFile(animPath))
 		{
 			return false;
 		}
 
-		string name, ext;
-		GetFileName(name, ext, animPath);
 		if (ext.compare(K_ANIM_EXT_CURVE) == 0)
 		{
-			FAnimCurveData anim;
+			FBakedAnimCurveData anim;
 			stream >> anim;
 			LoadRecord.insert(animPath);
-			AddAnimationCurve(anim);
+			Curves[anim.Name] = anim;
 			animName = anim.Name;
+			++Revision;
 			return true;
 		}
 		else if (ext.compare(K_ANIM_EXT_KEYFRAME) == 0)
 		{
-			FAnimKeyFrameData anim;
+			FBakedAnimKeyFrameData anim;
 			stream >> anim;
 			LoadRecord.insert(animPath);
-			AddAnimationKeyFrame(anim);
+			KeyFrames[anim.Name] = anim;
 			animName = anim.Name;
+			++Revision;
 			return true;
 		}
 	}
@@ -145,24 +246,49 @@ bool LostCore::FAnimationLibrary::Load(const string & path, string& animName)
 	return false;
 }
 
+bool LostCore::FAnimationLibrary::LoadMappedKeyFrame(const string & path, string & animName)
+{
+	FMappedAnimKeyFrameData* mapped = new FMappedAnimKeyFrameData;
+	if (!mapped->Open(path))
+	{
+		SAFE_DELETE(mapped);
+		return false;
+	}
+
+	animName = mapped->GetName();
+	mapped->Attach(KeyFrames[animName]);
+
+	auto it = MappedKeyFrames.find(animName);
+	if (it != MappedKeyFrames.end())
+	{
+		SAFE_DELETE(it->second);
+	}
+
+	MappedKeyFrames[animName] = mapped;
+	++Revision;
+	return true;
+}
+
 void LostCore::FAnimationLibrary::AddAnimationCurve(const FAnimCurveData & anim)
 {
-	Curves[anim.Name] = anim;
+	Curves[anim.Name].Bake(anim);
+	++Revision;
 }
 
 void LostCore::FAnimationLibrary::AddAnimationKeyFrame(const FAnimKeyFrameData & anim)
 {
-	KeyFrames[anim.Name] = anim;
+	KeyFrames[anim.Name].Bake(anim);
+	++Revision;
 }
 
 bool LostCore::FAnimationLibrary::GetMatrix(FFloat4x4 & outMatrix,
-	float keyTime, const string & animName, const string & skeletonName) const
+	float keyTime, const string & animName, const string & skeletonName, FAnimationCursor* cursor) const
 {
-	if (GetMatrixKeyFrame(outMatrix, keyTime, animName, skeletonName))
+	if (GetMatrixKeyFrame(outMatrix, keyTime, animName, skeletonName, cursor))
 	{
 		return true;
 	}
-	else if (GetMatrixCurve(outMatrix, keyTime, animName, skeletonName))
+	else if (GetMatrixCurve(outMatrix, keyTime, animName, skeletonName, cursor))
 	{
 		return true;
 	}
@@ -172,7 +298,7 @@ bool LostCore::FAnimationLibrary::GetMatrix(FFloat4x4 & outMatrix,
 	}
 }
 
-bool LostCore::FAnimationLibrary::GetMatrixCurve(FFloat4x4 & outMatrix, float keyTime, const string & animName, const string & skeletonName) const
+bool LostCore::FAnimationLibrary::GetMatrixCurve(FFloat4x4 & outMatrix, float keyTime, const string & animName, const string & skeletonName, FAnimationCursor* cursor) const
 {
 	auto it = Curves.find(animName);
 	if (it == Curves.end())
@@ -180,90 +306,104 @@ bool LostCore::FAnimationLibrary::GetMatrixCurve(FFloat4x4 & outMatrix, float ke
 		return false;
 	}
 
-	auto& animData = (*it).second.CurveMap;
+	auto& animData = (*it).second.ChannelMap;
 	auto it2 = animData.find(skeletonName);
 	if (it2 == animData.end())
 	{
 		return false;
 	}
 
-	auto& curves = (*it2).second;
+	FAnimationTrack track;
+	track.Channels = &(*it2).second;
+	EvalTrack(outMatrix, track, keyTime, cursor);
+	return true;
+}
 
-	FFloat3::FT rx = 0.0;
-	if (curves.find(K_ROTATE_X) != curves.end())
+bool LostCore::FAnimationLibrary::GetMatrixKeyFrame(FFloat4x4 & outMatrix, float keyTime, const string & animName, const string & skeletonName, FAnimationCursor* cursor) const
+{
+	auto it = KeyFrames.find(animName);
+	if (it == KeyFrames.end())
 	{
-		rx = (*curves.find(K_ROTATE_X)).second.Eval(keyTime);
+		return false;
 	}
 
-	FFloat3::FT ry = 0.0;
-	if (curves.find(K_ROTATE_Y) != curves.end())
+	auto& animData = (*it).second.KeyFrameMap;
+	auto it2 = animData.find(skeletonName);
+	if (it2 == animData.end())
 	{
-		ry = (*curves.find(K_ROTATE_Y)).second.Eval(keyTime);
+		return false;
 	}
 
-	FFloat3::FT rz = 0.0;
-	if (curves.find(K_ROTATE_Z) != curves.end())
-	{
-		rz = (*curves.find(K_ROTATE_Z)).second.Eval(keyTime);
-	}
+	FAnimationTrack track;
+	track.KeyFrames = &(*it2).second;
+	EvalTrack(outMatrix, track, keyTime, cursor);
+	return true;
+}
 
-	FFloat3::FT tx = 0.0;
-	if (curves.find(K_TRANSLATE_X) != curves.end())
-	{
-		tx = (*curves.find(K_TRANSLATE_X)).second.Eval(keyTime);
-	}
+bool LostCore::FAnimationLibrary::GetTrack(FAnimationTrack & outTrack, const string & animName, const string & skeletonName) const
+{
+	outTrack = FAnimationTrack();
 
-	FFloat3::FT ty = 0.0;
-	if (curves.find(K_TRANSLATE_Y) != curves.end())
+	auto keyFrames = KeyFrames.find(animName);
+	if (keyFrames != KeyFrames.end())
 	{
-		ty = (*curves.find(K_TRANSLATE_Y)).second.Eval(keyTime);
+		auto it = (*keyFrames).second.KeyFrameMap.find(skeletonName);
+		if (it != (*keyFrames).second.KeyFrameMap.end())
+		{
+			outTrack.KeyFrames = &(*it).second;
+			return true;
+		}
 	}
 
-	FFloat3::FT tz = 0.0;
-	if (curves.find(K_TRANSLATE_Z) != curves.end())
+	auto curves = Curves.find(animName);
+	if (curves != Curves.end())
 	{
-		tz = (*curves.find(K_TRANSLATE_Z)).second.Eval(keyTime);
+		auto it = (*curves).second.ChannelMap.find(skeletonName);
+		if (it != (*curves).second.ChannelMap.end())
+		{
+			outTrack.Channels = &(*it).second;
+			return true;
+		}
 	}
 
-	FFloat3::FT sx = 1.0;
-	if (curves.find(K_SCALE_X) != curves.end())
-	{
-		sx = (*curves.find(K_SCALE_X)).second.Eval(keyTime);
-	}
+	return false;
+}
 
-	FFloat3::FT sy = 1.0;
-	if (curves.find(K_SCALE_Y) != curves.end())
-	{
-		sy = (*curves.find(K_SCALE_Y)).second.Eval(keyTime);
-	}
+uint32 LostCore::FAnimationLibrary::GetRevision() const
+{
+	return Revision;
+}
 
-	FFloat3::FT sz = 1.0;
-	if (curves.find(K_SCALE_Z) != curves.end())
+void LostCore::FAnimationLibrary::EvalTrack(FFloat4x4 & outMatrix, const FAnimationTrack & track, float keyTime, FAnimationCursor * cursor)
+{
+	if (track.KeyFrames != nullptr)
 	{
-		sz = (*curves.find(K_SCALE_Z)).second.Eval(keyTime);
+		auto& curve = *track.KeyFrames;
+		outMatrix = cursor != nullptr ? curve.Eval(keyTime, (*cursor)[0]) : curve.Eval(keyTime);
+		return;
 	}
 
-	outMatrix.SetRotateAndOrigin(FQuat().FromEuler(FFloat3(rx, ry, rz)), FFloat3(tx, ty, tz), FFloat3(sx, sy, sz));
-	return true;
-}
-
-bool LostCore::FAnimationLibrary::GetMatrixKeyFrame(FFloat4x4 & outMatrix, float keyTime, const string & animName, const string & skeletonName) const
-{
-	auto it = KeyFrames.find(animName);
-	if (it == KeyFrames.end())
+	if (track.Channels == nullptr)
 	{
-		return false;
+		outMatrix.SetIdentity();
+		return;
 	}
 
-	auto& animData = (*it).second.KeyFrameMap;
-	auto it2 = animData.find(skeletonName);
-	if (it2 == animData.end())
+	auto& channels = *track.Channels;
+
+	// Defaults of missing channels: no rotation, no translation, unit scale.
+	FFloat3::FT values[(uint32)EAnimChannel::Num] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 };
+	for (uint32 i = 0; i < (uint32)EAnimChannel::Num; ++i)
 	{
-		return false;
+		if (channels.HasChannel((EAnimChannel)i))
+		{
+			auto& curve = channels.Curves[i];
+			values[i] = cursor != nullptr ? curve.Eval(keyTime, (*cursor)[i]) : curve.Eval(keyTime);
+		}
 	}
 
-	auto& curve = (*it2).second;
-	outMatrix.SetIdentity();
-	outMatrix = curve.Eval(keyTime);
-	return true;
+	outMatrix.SetRotateAndOrigin(
+		FQuat().FromEuler(FFloat3(values[(uint32)EAnimChannel::RotateX], values[(uint32)EAnimChannel::RotateY], values[(uint32)EAnimChannel::RotateZ])),
+		FFloat3(values[(uint32)EAnimChannel::TranslateX], values[(uint32)EAnimChannel::TranslateY], values[(uint32)EAnimChannel::TranslateZ]),
+		FFloat3(values[(uint32)EAnimChannel::ScaleX], values[(uint32)EAnimChannel::ScaleY], values[(uint32)EAnimChannel::ScaleZ]));
 }
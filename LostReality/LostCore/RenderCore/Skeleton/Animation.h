@@ -11,39 +11,80 @@
 
 namespace LostCore
 {
+	// Curve cursors of one bone, indexed by EAnimChannel. Key frame animations only use the first one.
+	typedef array<FCurveCursor, (uint32)EAnimChannel::Num> FAnimationCursor;
 
-	class FSkeletonTree
+	// Curves of one bone in one animation, resolved by name once instead of every frame.
+	// Key frames win over curves, as FAnimationLibrary::GetMatrix.
+	struct FAnimationTrack
 	{
-		string Name;
-		FFloat4x4 Local;
-		FFloat4x4 InvBindPose;
-		FFloat4x4 World;
-		FFloat4x4 BoneWorld;
-		std::vector<FSkeletonTree> Children;
+		const FBakedAnimCurveData::FChannels* Channels;
+		const FBakedMatrixCurve* KeyFrames;
+
+		FAnimationTrack() : Channels(nullptr), KeyFrames(nullptr) {}
+
+		bool IsValid() const
+		{
+			return Channels != nullptr || KeyFrames != nullptr;
+		}
+	};
+
+	// Flattened skeleton, bones are stored depth first so a parent always comes before its children.
+	// Each bone attribute is an array indexed by bone, the pose is evaluated by one pass over them.
+	class FSkeleton
+	{
+		vector<string> Names;
+		vector<int32> Parents;			// -1 for the root
+		vector<int32> SkinIndices;		// Slot in FSkinnedParameter::Bones, -1 if the mesh does not use the bone
+		vector<FFloat4x4> Locals;		// Bind pose, relative to the parent
+		vector<FFloat4x4> InvBindPoses;	// Model space
+		vector<FFloat4x4> BoneWorlds;	// Model space, last evaluated pose
+		uint32 SkinCount;
 
 		string CurrAnimName;
 		float CurrKeyTime;
+		uint32 TrackRevision;
+		vector<FAnimationTrack> Tracks;
+		vector<FAnimationCursor> Cursors;
 
 	public:
-		FSkeletonTree();
-		FSkeletonTree(const FPoseTree & skelRoot, const FFloat4x4& parentInvBindPose);
+		FSkeleton();
 
-		void LoadSkeleton(const FPoseTree& skelRoot, const FFloat4x4& parentInvBindPose);
-
-		void UpdateWorldMatrix(const FFloat4x4& parentWorld);
-		void GetWorldPose(FPoseMap& pose);
+		// skinIndexMap is FMeshData::SkeletonIndexMap, bones missing from it are animated but not skinned.
+		void LoadSkeleton(const FPoseTree& skelRoot, const map<string, int32>& skinIndexMap);
 
 		void SetAnimation(const string& animName);
+		void AdvanceTime(float sec);
+
+		// Evaluates every bone in order and writes InvBindPose * BoneWorld of the skinned ones to skin[SkinIndex].
+		// skin needs GetSkinCount() elements, the result is in model space.
+		void UpdatePose(FFloat4x4* skin);
 
-		void GetSkeletonRenderData(map<string, pair<FFloat3, vector<FFloat3>>>& data);
+		uint32 GetNumBones() const;
+		uint32 GetSkinCount() const;
+
+		// One (parent, child) pair of model space origins per bone with a parent.
+		void GetSkeletonRenderData(vector<pair<FFloat3, FFloat3>>& data) const;
+
+	private:
+		void AddBone(const FPoseTree& node, int32 parent, const FFloat4x4& parentInvBindPose, const map<string, int32>& skinIndexMap);
+		void BindTracks();
 	};
 
 	class FAnimationLibrary
 	{
-		map<string, FAnimCurveData> Curves;
-		map<string, FAnimKeyFrameData> KeyFrames;
+		map<string, FBakedAnimCurveData> Curves;
+		map<string, FBakedAnimKeyFrameData> KeyFrames;
 		set<string> LoadRecord;
 
+		// Mappings backing attached KeyFrames entries, released with the library.
+		map<string, FMappedAnimKeyFrameData*> MappedKeyFrames;
+
+		// Bumped whenever Curves or KeyFrames change.
+		uint32 Revision;
+
+		bool LoadMappedKeyFrame(const string& path, string& animName);
+
 	public:
 
 		static FAnimationLibrary* Get()
@@ -58,9 +99,17 @@ namespace LostCore
 		bool Load(const string& path, string& animName);
 		void AddAnimationCurve(const FAnimCurveData& anim);
 		void AddAnimationKeyFrame(const FAnimKeyFrameData& anim);
-		bool GetMatrix(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName) const;
-		bool GetMatrixCurve(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName) const;
-		bool GetMatrixKeyFrame(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName) const;
+
+		// cursor is optional, passing the caller's own cursor makes monotonic playback O(1) per channel.
+		bool GetMatrix(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName, FAnimationCursor* cursor = nullptr) const;
+		bool GetMatrixCurve(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName, FAnimationCursor* cursor = nullptr) const;
+		bool GetMatrixKeyFrame(FFloat4x4& outMatrix, float keyTime, const string& animName, const string& skeletonName, FAnimationCursor* cursor = nullptr) const;
+
+		// Tracks point into the library, they are resolved again once GetRevision changes.
+		bool GetTrack(FAnimationTrack& outTrack, const string& animName, const string& skeletonName) const;
+		uint32 GetRevision() const;
+
+		static void EvalTrack(FFloat4x4& outMatrix, const FAnimationTrack& track, float keyTime, FAnimationCursor* cursor = nullptr);
 	};
 }
 
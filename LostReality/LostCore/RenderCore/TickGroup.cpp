@@ -36,21 +36,21 @@ void LostCore::FTickBase::TryTick(float seconds)
 }
 
 LostCore::FTickGroup::FTickGroup()
-	: TimeStamp({ 0 })
+	: TimeStamp(0)
 {
 
 }
 
 void LostCore::FTickGroup::Tick()
 {
-	if (TimeStamp.QuadPart == 0)
+	if (TimeStamp == 0)
 	{
 		TimeStamp = FPerformanceCounter::GetTimeStamp();
 		return;
 	}
 
 	auto stamp = FPerformanceCounter::GetTimeStamp();
-	auto elapsed = FPerformanceCounter::GetSeconds(stamp.QuadPart - TimeStamp.QuadPart);
+	auto elapsed = FPerformanceCounter::ToSeconds(stamp - TimeStamp);
 	TimeStamp = stamp;
 	for (auto item : TickObjects)
 	{
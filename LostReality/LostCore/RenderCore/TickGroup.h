@@ -39,7 +39,7 @@ namespace LostCore
 
 	private:
 		vector<FTickBase*> TickObjects;
-		LARGE_INTEGER TimeStamp;
+		FTimeStamp TimeStamp;
 	};
 }
 
@@ -16,7 +16,7 @@ namespace LostCore
 	class FFontTile : public FRect
 	{
 	public:
-		MEMORY_ALLOC(FFontTile);
+		MEMORY_ALLOC(Font);
 
 		class IListener
 		{
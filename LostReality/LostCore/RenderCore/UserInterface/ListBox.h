@@ -16,7 +16,7 @@ namespace LostCore
 	class FListBox : public FRect
 	{
 	public:
-		MEMORY_ALLOC(FListBox);
+		MEMORY_ALLOC(UserInterface);
 
 		enum class EAlignment : uint8
 		{
@@ -16,7 +16,7 @@ namespace LostCore
 	class FTextBox : public FRect
 	{
 	public:
-		MEMORY_ALLOC(FTextBox);
+		MEMORY_ALLOC(UserInterface);
 
 		FTextBox();
 		virtual ~FTextBox() override;
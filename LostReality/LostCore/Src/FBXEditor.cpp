@@ -778,8 +778,18 @@ void FFBXEditor::InitializeWindow(HWND wnd, bool windowed, int32 width, int32 he
 	}
 
 	// Ⱦ߳
-	auto ret = WrappedCreateRenderContext(&RC);
-	RC->InitializeDevice(EContextID::D3D11_DXGI0, wnd, windowed, width, height);
+	// Without a window the frame is recorded by the null render context, nothing is drawn.
+	if (wnd == NULL)
+	{
+		WrappedCreateNullRenderContext(&RC);
+		RC->InitializeDevice(EContextID::Null, wnd, windowed, width, height);
+	}
+	else
+	{
+		WrappedCreateRenderContext(&RC);
+		RC->InitializeDevice(EContextID::D3D11_DXGI0, wnd, windowed, width, height);
+	}
+
 	FFontProvider::Get()->Initialize();
 
 	ScreenWidth = width;
@@ -856,7 +866,8 @@ FBasicModel * FFBXEditor::ScreenRayTest(int32 x, int32 y)
 		return nullptr;
 	}
 
-	auto result = Scene->RayTest(worldRay, minDist);
+	// Triangles, a click through the empty corners of a bounding box goes on to the models behind.
+	auto result = Scene->RayTest(worldRay, minDist, true);
 	FGlobalHandler::Get()->UpdateFlagAnd32Bit(EUpdateFlag::UpdateRayTestDistance, *(uint32*)&minDist);
 	return result;
 }
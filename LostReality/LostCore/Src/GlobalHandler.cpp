@@ -28,22 +28,33 @@ LostCore::FGlobalHandler::FGlobalHandler()
 
 EReturnCode LostCore::FGlobalHandler::InitializeProcessUnique()
 {
+	FAsyncLog::InstallCrashHandler();
 	FProcessUnique::StaticInitialize();
 	LVMSG("FGlobalHandler::InitializeProcessUnique", "ProcessUnique: 0x%08x", FProcessUnique::Get());
 	D3D11::WrappedSetProcessUnique(FProcessUnique::Get());
+	FTraceProfiler::Get()->Start();
 	return SSuccess;
 }
 
 EReturnCode LostCore::FGlobalHandler::DestroyProcessUnique()
 {
 	LVMSG("FGlobalHandler::DestroyProcessUnique", "ProcessUnique: 0x%08x", FProcessUnique::Get());
+	FTraceProfiler::Get()->Stop();
+	D3D11::WrappedSetProcessUnique(nullptr);
 	FProcessUnique::StaticDestroy();
+	FAsyncLog::Get()->Shutdown();
 	return SSuccess;
 }
 
 EReturnCode LostCore::FGlobalHandler::SetProcessUnique(void* p)
 {
+	FAsyncLog::InstallCrashHandler();
 	FProcessUnique::SetInstance((FProcessUnique*)p);
+	if (p == nullptr)
+	{
+		FAsyncLog::Get()->Shutdown();
+	}
+
 	return SSuccess;
 }
 
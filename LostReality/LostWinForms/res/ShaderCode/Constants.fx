@@ -16,6 +16,7 @@
 // VERTEX_SKIN
 // VERTEX_TEXCOORD1
 // VERTEX_COORDINATE2D
+// INSTANCE_TRANSFORM3D
 
 // Switches
 #define VE_HAS_POS2D HAS_FLAGS(VERTEX_COORDINATE2D, VERTEX_FLAGS)
@@ -25,5 +26,6 @@
 #define VE_HAS_TANGENT HAS_FLAGS(VERTEX_TANGENT, VERTEX_FLAGS)
 #define VE_HAS_COLOR HAS_FLAGS(VERTEX_COLOR, VERTEX_FLAGS)
 #define VE_HAS_SKIN HAS_FLAGS(VERTEX_SKIN, VERTEX_FLAGS)
+#define VE_HAS_INSTANCE_TRANSFORM3D HAS_FLAGS(INSTANCE_TRANSFORM3D, VERTEX_FLAGS)
 
 #endif //CONSTANTS_H
\ No newline at end of file
@@ -31,6 +31,11 @@ VertexOut VsMain(VertexIn input)
 
 	pos = 2 * pos * float2(ScreenWidthRcp, -ScreenHeightRcp) + float2(-1.0, 1.0);
 	output.Pos = float4(pos, 0.0f, 1.0f);
+#elif VE_HAS_INSTANCE_TRANSFORM3D
+	// Rows of the world matrix per instance, batched by the draw list.
+	float4x4 mat = float4x4(input.Transform0, input.Transform1, input.Transform2, input.Transform3);
+	output.Pos = mul(float4(input.Pos, 1.0f), mat);
+	output.Pos = mul(output.Pos, ViewProject);
 #else
 	float4x4 mat = World;
 	output.Pos = mul(float4(input.Pos, 1.0f), mat);
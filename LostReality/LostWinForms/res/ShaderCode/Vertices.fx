@@ -36,6 +36,13 @@ struct VertexIn
 	float4 Weights : BLENDWEIGHTS;
 	int4 Indices : BLENDINDICES;
 #endif
+
+#if VE_HAS_INSTANCE_TRANSFORM3D
+	float4 Transform0 : TRANSFORM0;
+	float4 Transform1 : TRANSFORM1;
+	float4 Transform2 : TRANSFORM2;
+	float4 Transform3 : TRANSFORM3;
+#endif
 };
 
 struct VertexOut